@@ -24,6 +24,7 @@
 
 globus_result_t
 globus_i_dsi_rest_add_header(
+    globus_i_dsi_rest_arena_t          *arena,
     struct curl_slist                 **request_headers,
     const char                         *header_name,
     const char                         *header_value)
@@ -58,21 +59,50 @@ globus_i_dsi_rest_add_header(
     size_t len = snprintf(NULL, 0, "%s: %s",
             header_name,
             header_value);
-    char str[len+1];
 
-    snprintf(str, sizeof(str), "%s: %s",
-            header_name,
-            header_value);
+    if (arena != NULL)
+    {
+        struct curl_slist              *node;
+        struct curl_slist             **lastp = request_headers;
 
-    /* TODO: replace if header already present */
-    tmp = curl_slist_append(*request_headers, str);
+        /* The node and its string are freed with the rest of the arena */
+        node = globus_i_dsi_rest_arena_alloc(arena, sizeof(*node) + len + 1);
+        if (node == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto error_memory;
+        }
+        node->data = (char *) (node + 1);
+        node->next = NULL;
+        snprintf(node->data, len + 1, "%s: %s",
+                header_name,
+                header_value);
 
-    if (tmp == NULL)
+        /* TODO: replace if header already present */
+        while (*lastp != NULL)
+        {
+            lastp = &(*lastp)->next;
+        }
+        *lastp = node;
+    }
+    else
     {
-        result = GlobusDsiRestErrorMemory();
-        goto error_memory;
+        char                            str[len+1];
+
+        snprintf(str, sizeof(str), "%s: %s",
+                header_name,
+                header_value);
+
+        /* TODO: replace if header already present */
+        tmp = curl_slist_append(*request_headers, str);
+
+        if (tmp == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto error_memory;
+        }
+        *request_headers = tmp;
     }
-    *request_headers = tmp;
 
 error_memory:
     GlobusDsiRestExitResult(result);
@@ -0,0 +1,351 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file arena.c GridFTP DSI REST Request Arena
+ * @details
+ *     Everything a request allocates for itself, from the request state to
+ *     the copied headers, callback arguments, URI, libcurl header list, and
+ *     parsed response headers, is carved out of chunks owned by the
+ *     request's arena, and released together when the request is cleaned
+ *     up. Chunks of the standard size are kept on a free list shared by
+ *     all requests, so a typical request doesn't call malloc() at all once
+ *     the list is warm. Allocations too large to share a chunk are given a
+ *     chunk of their own, which is freed instead of kept.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+enum
+{
+    GLOBUS_L_DSI_REST_ARENA_ALIGN = 16
+};
+
+typedef
+struct globus_i_dsi_rest_arena_chunk_s
+{
+    struct globus_i_dsi_rest_arena_chunk_s
+                                       *next;
+    // Bytes of data following the chunk header
+    size_t                              size;
+    size_t                              used;
+    // Pads the header so data is aligned to GLOBUS_L_DSI_REST_ARENA_ALIGN
+    size_t                              pad;
+    unsigned char                       data[];
+}
+globus_l_dsi_rest_arena_chunk_t;
+
+/* Data in a chunk of the standard size */
+#define GLOBUS_L_DSI_REST_ARENA_CHUNK_DATA \
+    (GLOBUS_I_DSI_REST_ARENA_CHUNK_SIZE \
+        - sizeof(globus_l_dsi_rest_arena_chunk_t))
+
+static globus_mutex_t                   globus_l_dsi_rest_arena_pool_mutex;
+static globus_l_dsi_rest_arena_chunk_t *globus_l_dsi_rest_arena_pool_free;
+static size_t                           globus_l_dsi_rest_arena_pool_count;
+
+int
+globus_i_dsi_rest_arena_pool_init(void)
+{
+    int                                 rc;
+
+    GlobusDsiRestEnter();
+
+    globus_l_dsi_rest_arena_pool_free = NULL;
+    globus_l_dsi_rest_arena_pool_count = 0;
+    rc = globus_mutex_init(&globus_l_dsi_rest_arena_pool_mutex, NULL);
+
+    GlobusDsiRestExitInt(rc);
+    return rc;
+}
+/* globus_i_dsi_rest_arena_pool_init() */
+
+void
+globus_i_dsi_rest_arena_pool_destroy(void)
+{
+    GlobusDsiRestEnter();
+
+    while (globus_l_dsi_rest_arena_pool_free != NULL)
+    {
+        globus_l_dsi_rest_arena_chunk_t *next;
+
+        next = globus_l_dsi_rest_arena_pool_free->next;
+        free(globus_l_dsi_rest_arena_pool_free);
+        globus_l_dsi_rest_arena_pool_free = next;
+    }
+    globus_l_dsi_rest_arena_pool_count = 0;
+    globus_mutex_destroy(&globus_l_dsi_rest_arena_pool_mutex);
+
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_arena_pool_destroy() */
+
+/**
+ * @brief Get a chunk with room for at least size bytes
+ * @details
+ *     Chunks of the standard size come from the free list when it isn't
+ *     empty. Returns NULL if memory is short.
+ */
+static
+globus_l_dsi_rest_arena_chunk_t *
+globus_l_dsi_rest_arena_chunk_get(
+    size_t                              size)
+{
+    globus_l_dsi_rest_arena_chunk_t    *chunk = NULL;
+
+    if (size <= GLOBUS_L_DSI_REST_ARENA_CHUNK_DATA)
+    {
+        size = GLOBUS_L_DSI_REST_ARENA_CHUNK_DATA;
+
+        globus_mutex_lock(&globus_l_dsi_rest_arena_pool_mutex);
+        chunk = globus_l_dsi_rest_arena_pool_free;
+        if (chunk != NULL)
+        {
+            globus_l_dsi_rest_arena_pool_free = chunk->next;
+            globus_l_dsi_rest_arena_pool_count--;
+        }
+        globus_mutex_unlock(&globus_l_dsi_rest_arena_pool_mutex);
+    }
+    else if (size > SIZE_MAX - sizeof(globus_l_dsi_rest_arena_chunk_t))
+    {
+        goto done;
+    }
+    if (chunk == NULL)
+    {
+        chunk = malloc(sizeof(globus_l_dsi_rest_arena_chunk_t) + size);
+        if (chunk == NULL)
+        {
+            goto done;
+        }
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+done:
+    return chunk;
+}
+/* globus_l_dsi_rest_arena_chunk_get() */
+
+void *
+globus_i_dsi_rest_arena_alloc(
+    globus_i_dsi_rest_arena_t          *arena,
+    size_t                              size)
+{
+    globus_l_dsi_rest_arena_chunk_t    *chunk = arena->chunks;
+    size_t                              offset = 0;
+    void                               *p = NULL;
+
+    if (size > SIZE_MAX - GLOBUS_L_DSI_REST_ARENA_ALIGN)
+    {
+        goto done;
+    }
+    size = (size + GLOBUS_L_DSI_REST_ARENA_ALIGN - 1)
+         & ~(size_t) (GLOBUS_L_DSI_REST_ARENA_ALIGN - 1);
+
+    if (chunk != NULL)
+    {
+        offset = chunk->used;
+        if (chunk->size - offset >= size)
+        {
+            chunk->used = offset + size;
+            p = chunk->data + offset;
+            goto done;
+        }
+    }
+    if (size > GLOBUS_L_DSI_REST_ARENA_CHUNK_DATA / 4 && chunk != NULL)
+    {
+        /* Too large to be worth starting a new chunk for; give it one of
+         * its own behind the current one, which keeps its free space
+         */
+        chunk = globus_l_dsi_rest_arena_chunk_get(size);
+        if (chunk == NULL)
+        {
+            goto done;
+        }
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+    }
+    else
+    {
+        chunk = globus_l_dsi_rest_arena_chunk_get(size);
+        if (chunk == NULL)
+        {
+            goto done;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    chunk->used = size;
+    p = chunk->data;
+
+done:
+    return p;
+}
+/* globus_i_dsi_rest_arena_alloc() */
+
+void *
+globus_i_dsi_rest_arena_calloc(
+    globus_i_dsi_rest_arena_t          *arena,
+    size_t                              count,
+    size_t                              size)
+{
+    void                               *p = NULL;
+
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        goto done;
+    }
+    p = globus_i_dsi_rest_arena_alloc(arena, count * size);
+    if (p != NULL)
+    {
+        memset(p, 0, count * size);
+    }
+
+done:
+    return p;
+}
+/* globus_i_dsi_rest_arena_calloc() */
+
+void *
+globus_i_dsi_rest_arena_grow(
+    globus_i_dsi_rest_arena_t          *arena,
+    void                               *p,
+    size_t                              old_size,
+    size_t                              new_size)
+{
+    globus_l_dsi_rest_arena_chunk_t    *chunk = arena->chunks;
+    size_t                              offset;
+    void                               *q = NULL;
+
+    if (p == NULL || chunk == NULL
+        || new_size > SIZE_MAX - GLOBUS_L_DSI_REST_ARENA_ALIGN)
+    {
+        goto copy;
+    }
+    old_size = (old_size + GLOBUS_L_DSI_REST_ARENA_ALIGN - 1)
+             & ~(size_t) (GLOBUS_L_DSI_REST_ARENA_ALIGN - 1);
+    if ((unsigned char *) p < chunk->data
+        || (unsigned char *) p >= chunk->data + chunk->used)
+    {
+        goto copy;
+    }
+    offset = (unsigned char *) p - chunk->data;
+    if (offset + old_size == chunk->used)
+    {
+        /* Last thing allocated from the current chunk: extend if it fits */
+        new_size = (new_size + GLOBUS_L_DSI_REST_ARENA_ALIGN - 1)
+                 & ~(size_t) (GLOBUS_L_DSI_REST_ARENA_ALIGN - 1);
+        if (chunk->size - offset >= new_size)
+        {
+            chunk->used = offset + new_size;
+            q = p;
+            goto done;
+        }
+    }
+copy:
+    q = globus_i_dsi_rest_arena_alloc(arena, new_size);
+    if (q != NULL && p != NULL)
+    {
+        memcpy(q, p, old_size < new_size ? old_size : new_size);
+    }
+
+done:
+    return q;
+}
+/* globus_i_dsi_rest_arena_grow() */
+
+char *
+globus_i_dsi_rest_arena_strndup(
+    globus_i_dsi_rest_arena_t          *arena,
+    const char                         *s,
+    size_t                              n)
+{
+    char                               *p = NULL;
+
+    p = globus_i_dsi_rest_arena_alloc(arena, n + 1);
+    if (p != NULL)
+    {
+        memcpy(p, s, n);
+        p[n] = 0;
+    }
+    return p;
+}
+/* globus_i_dsi_rest_arena_strndup() */
+
+char *
+globus_i_dsi_rest_arena_strdup(
+    globus_i_dsi_rest_arena_t          *arena,
+    const char                         *s)
+{
+    return globus_i_dsi_rest_arena_strndup(arena, s, strlen(s));
+}
+/* globus_i_dsi_rest_arena_strdup() */
+
+void
+globus_i_dsi_rest_arena_release(
+    globus_i_dsi_rest_arena_t          *arena)
+{
+    globus_l_dsi_rest_arena_chunk_t    *chunk = arena->chunks;
+    globus_l_dsi_rest_arena_chunk_t    *pooled = NULL;
+    globus_l_dsi_rest_arena_chunk_t   **pooled_last = &pooled;
+    size_t                              pooled_count = 0;
+
+    arena->chunks = NULL;
+    while (chunk != NULL)
+    {
+        globus_l_dsi_rest_arena_chunk_t *next = chunk->next;
+
+        if (chunk->size == GLOBUS_L_DSI_REST_ARENA_CHUNK_DATA)
+        {
+            *pooled_last = chunk;
+            pooled_last = &chunk->next;
+            pooled_count++;
+        }
+        else
+        {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    *pooled_last = NULL;
+    if (pooled == NULL)
+    {
+        return;
+    }
+
+    globus_mutex_lock(&globus_l_dsi_rest_arena_pool_mutex);
+    if (globus_l_dsi_rest_arena_pool_count + pooled_count
+            <= GLOBUS_I_DSI_REST_ARENA_POOL_MAX)
+    {
+        *pooled_last = globus_l_dsi_rest_arena_pool_free;
+        globus_l_dsi_rest_arena_pool_free = pooled;
+        globus_l_dsi_rest_arena_pool_count += pooled_count;
+        pooled = NULL;
+    }
+    globus_mutex_unlock(&globus_l_dsi_rest_arena_pool_mutex);
+
+    /* The free list is full */
+    while (pooled != NULL)
+    {
+        chunk = pooled->next;
+        free(pooled);
+        pooled = chunk;
+    }
+}
+/* globus_i_dsi_rest_arena_release() */
@@ -46,20 +46,13 @@ globus_i_dsi_rest_buffer_get(
                 size = optimal_blocksize;
             }
 
-            if (size > (SIZE_MAX - sizeof(globus_i_dsi_rest_buffer_t)))
-            {
-                size = SIZE_MAX - sizeof(globus_i_dsi_rest_buffer_t);
-            }
-            new_buffer = malloc(sizeof(globus_i_dsi_rest_buffer_t) + size);
-
+            new_buffer = globus_i_dsi_rest_buffer_pool_get(
+                    size,
+                    gridftp_op_arg->registered_buffers_count == 0);
             if (new_buffer == NULL)
             {
                 return NULL;
             }
-            new_buffer->buffer_len = size;
-            new_buffer->buffer_used = 0;
-            new_buffer->next = NULL;
-            new_buffer->transfer_offset = UINT64_C(-1);
 
             gridftp_op_arg->free_buffers = new_buffer;
         }
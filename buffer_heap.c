@@ -0,0 +1,127 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file buffer_heap.c GridFTP DSI REST Pending Buffer Heap
+ * @details
+ *     Buffers read from the GridFTP data channels out of order are kept in
+ *     a binary min-heap keyed by transfer_offset, so the buffer with the
+ *     next offset to send is always at the top.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+globus_result_t
+globus_i_dsi_rest_buffer_heap_push(
+    globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg,
+    globus_i_dsi_rest_buffer_t         *buffer)
+{
+    globus_i_dsi_rest_buffer_t        **heap;
+    size_t                              i;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (gridftp_op_arg->pending_heap_count
+            == gridftp_op_arg->pending_heap_size)
+    {
+        size_t                          new_size;
+
+        new_size = gridftp_op_arg->pending_heap_size
+                ? 2 * gridftp_op_arg->pending_heap_size
+                : 16;
+        heap = realloc(gridftp_op_arg->pending_heap,
+                new_size * sizeof(globus_i_dsi_rest_buffer_t *));
+        if (heap == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto realloc_fail;
+        }
+        gridftp_op_arg->pending_heap = heap;
+        gridftp_op_arg->pending_heap_size = new_size;
+    }
+    heap = gridftp_op_arg->pending_heap;
+
+    /* Sift up from the end */
+    i = gridftp_op_arg->pending_heap_count++;
+    while (i > 0)
+    {
+        size_t                          parent = (i - 1) / 2;
+
+        if (heap[parent]->transfer_offset <= buffer->transfer_offset)
+        {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = buffer;
+    gridftp_op_arg->pending_bytes +=
+            buffer->buffer_used - buffer->buffer_consumed;
+
+realloc_fail:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_i_dsi_rest_buffer_heap_push() */
+
+globus_i_dsi_rest_buffer_t *
+globus_i_dsi_rest_buffer_heap_pop(
+    globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg)
+{
+    globus_i_dsi_rest_buffer_t        **heap = gridftp_op_arg->pending_heap;
+    globus_i_dsi_rest_buffer_t         *top = NULL;
+    globus_i_dsi_rest_buffer_t         *last;
+    size_t                              count;
+    size_t                              i = 0;
+
+    GlobusDsiRestEnter();
+
+    if (gridftp_op_arg->pending_heap_count == 0)
+    {
+        goto empty;
+    }
+    top = heap[0];
+    count = --gridftp_op_arg->pending_heap_count;
+    gridftp_op_arg->pending_bytes -= top->buffer_used - top->buffer_consumed;
+
+    /* Sift the last element down from the top */
+    last = heap[count];
+    while (2 * i + 1 < count)
+    {
+        size_t                          child = 2 * i + 1;
+
+        if (child + 1 < count
+            && heap[child + 1]->transfer_offset < heap[child]->transfer_offset)
+        {
+            child++;
+        }
+        if (last->transfer_offset <= heap[child]->transfer_offset)
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+
+empty:
+    GlobusDsiRestExitPointer(top);
+    return top;
+}
+/* globus_i_dsi_rest_buffer_heap_pop() */
@@ -0,0 +1,483 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file buffer_pool.c GridFTP DSI REST Buffer Pool
+ * @details
+ *     GridFTP data buffers are shared by all operations through a pool of
+ *     free lists, one for each power of two size from 64 KiB to 64 MiB.
+ *     The memory held by the pool, in use or free, is limited to a budget.
+ *     When the budget is used up, free buffers of other sizes are released
+ *     to make room, and after that the pool refuses to allocate more
+ *     unless the caller has no other way to make progress.
+ *
+ *     Buffers are normally allocated with malloc(). When huge pages are
+ *     enabled, buffers of 2 MiB or more are instead mapped so that their
+ *     data starts on a huge page boundary, with the buffer header on the
+ *     small page just before it. When NUMA binding is enabled, all buffers
+ *     are mapped and bound to the node of the allocating thread, and the
+ *     pool prefers to reuse free buffers from the caller's node.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+enum
+{
+    GLOBUS_L_DSI_REST_BUFFER_POOL_MIN_SHIFT = 16,
+    GLOBUS_L_DSI_REST_BUFFER_POOL_CLASSES = 11
+};
+
+long                                    globus_i_dsi_rest_buffer_pool_max;
+static globus_mutex_t                   globus_l_dsi_rest_buffer_pool_mutex;
+static globus_i_dsi_rest_buffer_t      *globus_l_dsi_rest_buffer_pool_free[
+                                        GLOBUS_L_DSI_REST_BUFFER_POOL_CLASSES];
+/* Bytes in all buffers from the pool, in use or free */
+static size_t                           globus_l_dsi_rest_buffer_pool_allocated;
+/* Bytes in the free lists */
+static size_t                           globus_l_dsi_rest_buffer_pool_cached;
+static size_t                           globus_l_dsi_rest_buffer_page_size;
+long                                    globus_i_dsi_rest_buffer_huge_pages;
+long                                    globus_i_dsi_rest_buffer_numa;
+
+/**
+ * @brief Return the NUMA node of the CPU the calling thread is running on
+ * @details
+ *     Returns -1 if NUMA binding is disabled or the node can't be
+ *     determined.
+ */
+static
+int
+globus_l_dsi_rest_buffer_numa_node(void)
+{
+    int                                 node = -1;
+#ifdef SYS_getcpu
+    unsigned int                        cpu, this_node;
+
+    if (globus_i_dsi_rest_buffer_numa
+        && syscall(SYS_getcpu, &cpu, &this_node, NULL) == 0)
+    {
+        node = this_node;
+    }
+#endif
+    return node;
+}
+/* globus_l_dsi_rest_buffer_numa_node() */
+
+/**
+ * @brief Map a buffer with len bytes of data
+ * @details
+ *     The data is aligned to a huge page if huge is true, and to a small
+ *     page otherwise, and the header sits at the end of the small page
+ *     before it. If node is not -1, the mapping is bound to that NUMA node
+ *     before it is first touched. Returns NULL if the mapping fails.
+ */
+static
+globus_i_dsi_rest_buffer_t *
+globus_l_dsi_rest_buffer_map(
+    size_t                              len,
+    bool                                huge,
+    int                                 node)
+{
+    size_t                              page = globus_l_dsi_rest_buffer_page_size;
+    size_t                              align = huge
+                                          ? GLOBUS_I_DSI_REST_HUGE_PAGE_SIZE
+                                          : page;
+    size_t                              data_len;
+    size_t                              map_len;
+    unsigned char                      *base;
+    unsigned char                      *start;
+    unsigned char                      *data;
+    globus_i_dsi_rest_buffer_t         *buffer = NULL;
+
+    if (len > SIZE_MAX - 2 * align - page)
+    {
+        goto done;
+    }
+    data_len = (len + align - 1) / align * align;
+    /* Room to slide the data up to an alignment boundary */
+    map_len = page + data_len + (align > page ? align : 0);
+
+    base = mmap(NULL, map_len, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        goto done;
+    }
+    data = (unsigned char *)
+            (((uintptr_t) base + page + align - 1) & ~(uintptr_t) (align - 1));
+    start = data - page;
+
+    /* Trim the slack on either side */
+    if (start > base)
+    {
+        munmap(base, start - base);
+    }
+    if (base + map_len > data + data_len)
+    {
+        munmap(data + data_len, (base + map_len) - (data + data_len));
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge)
+    {
+        madvise(data, data_len, MADV_HUGEPAGE);
+    }
+#endif
+#ifdef SYS_mbind
+    if (node >= 0 && node < (int) (sizeof(unsigned long) * CHAR_BIT))
+    {
+        unsigned long                   nodemask = 1UL << node;
+
+        if (syscall(SYS_mbind, start, page + data_len, MPOL_PREFERRED,
+                &nodemask, sizeof(nodemask) * CHAR_BIT, 0) != 0)
+        {
+            node = -1;
+        }
+    }
+    else
+#endif
+    {
+        node = -1;
+    }
+
+    buffer = GlobusDsiRestBufferFromData(data);
+    buffer->mapped_len = page + data_len;
+    buffer->numa_node = node;
+
+done:
+    return buffer;
+}
+/* globus_l_dsi_rest_buffer_map() */
+
+/**
+ * @brief Allocate a buffer with len bytes of data
+ * @details
+ *     Uses a huge page or NUMA bound mapping when those are enabled, and
+ *     malloc() otherwise or if the mapping fails.
+ */
+static
+globus_i_dsi_rest_buffer_t *
+globus_l_dsi_rest_buffer_alloc(
+    size_t                              len,
+    int                                 node)
+{
+    globus_i_dsi_rest_buffer_t         *buffer = NULL;
+    bool                                huge;
+
+    huge = globus_i_dsi_rest_buffer_huge_pages
+        && len >= GLOBUS_I_DSI_REST_HUGE_PAGE_SIZE;
+
+    if (huge || node >= 0)
+    {
+        buffer = globus_l_dsi_rest_buffer_map(len, huge, node);
+    }
+    if (buffer == NULL && len <= SIZE_MAX - sizeof(globus_i_dsi_rest_buffer_t))
+    {
+        buffer = malloc(sizeof(globus_i_dsi_rest_buffer_t) + len);
+        if (buffer != NULL)
+        {
+            buffer->mapped_len = 0;
+            buffer->numa_node = -1;
+        }
+    }
+    if (buffer != NULL)
+    {
+        buffer->buffer_len = len;
+    }
+    return buffer;
+}
+/* globus_l_dsi_rest_buffer_alloc() */
+
+static
+void
+globus_l_dsi_rest_buffer_free(
+    globus_i_dsi_rest_buffer_t         *buffer)
+{
+    if (buffer == NULL)
+    {
+        return;
+    }
+    if (buffer->mapped_len != 0)
+    {
+        munmap(buffer->buffer - globus_l_dsi_rest_buffer_page_size,
+                buffer->mapped_len);
+    }
+    else
+    {
+        free(buffer);
+    }
+}
+/* globus_l_dsi_rest_buffer_free() */
+
+/**
+ * @brief Find the size class for a buffer size
+ * @details
+ *     Returns the index of the smallest class holding size bytes, or -1 if
+ *     size is larger than the largest class.
+ */
+static
+int
+globus_l_dsi_rest_buffer_pool_class(
+    size_t                              size)
+{
+    for (int c = 0; c < GLOBUS_L_DSI_REST_BUFFER_POOL_CLASSES; c++)
+    {
+        if (size <= ((size_t) 1 << (GLOBUS_L_DSI_REST_BUFFER_POOL_MIN_SHIFT + c)))
+        {
+            return c;
+        }
+    }
+    return -1;
+}
+/* globus_l_dsi_rest_buffer_pool_class() */
+
+int
+globus_i_dsi_rest_buffer_pool_init(
+    long                                max_bytes)
+{
+    int                                 rc;
+
+    GlobusDsiRestEnter();
+
+    globus_i_dsi_rest_buffer_pool_max = max_bytes;
+    globus_l_dsi_rest_buffer_pool_allocated = 0;
+    globus_l_dsi_rest_buffer_pool_cached = 0;
+    globus_l_dsi_rest_buffer_page_size = sysconf(_SC_PAGESIZE);
+    if (globus_l_dsi_rest_buffer_page_size < sizeof(globus_i_dsi_rest_buffer_t))
+    {
+        globus_l_dsi_rest_buffer_page_size = 4096;
+    }
+    memset(globus_l_dsi_rest_buffer_pool_free, 0,
+            sizeof(globus_l_dsi_rest_buffer_pool_free));
+
+    rc = globus_mutex_init(&globus_l_dsi_rest_buffer_pool_mutex, NULL);
+
+    GlobusDsiRestExitInt(rc);
+    return rc;
+}
+/* globus_i_dsi_rest_buffer_pool_init() */
+
+void
+globus_i_dsi_rest_buffer_pool_destroy(void)
+{
+    GlobusDsiRestEnter();
+
+    for (int c = 0; c < GLOBUS_L_DSI_REST_BUFFER_POOL_CLASSES; c++)
+    {
+        while (globus_l_dsi_rest_buffer_pool_free[c] != NULL)
+        {
+            globus_i_dsi_rest_buffer_t *next;
+
+            next = globus_l_dsi_rest_buffer_pool_free[c]->next;
+            globus_l_dsi_rest_buffer_free(
+                    globus_l_dsi_rest_buffer_pool_free[c]);
+            globus_l_dsi_rest_buffer_pool_free[c] = next;
+        }
+    }
+    globus_mutex_destroy(&globus_l_dsi_rest_buffer_pool_mutex);
+
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_buffer_pool_destroy() */
+
+globus_i_dsi_rest_buffer_t *
+globus_i_dsi_rest_buffer_pool_get(
+    size_t                              size,
+    bool                                force)
+{
+    globus_i_dsi_rest_buffer_t         *buffer = NULL;
+    globus_i_dsi_rest_buffer_t         *released = NULL;
+    globus_i_dsi_rest_buffer_t        **free_list = NULL;
+    int                                 c;
+    int                                 node;
+    size_t                              len = size;
+
+    GlobusDsiRestEnter();
+
+    c = globus_l_dsi_rest_buffer_pool_class(size);
+    if (c >= 0)
+    {
+        len = (size_t) 1 << (GLOBUS_L_DSI_REST_BUFFER_POOL_MIN_SHIFT + c);
+    }
+    node = globus_l_dsi_rest_buffer_numa_node();
+
+    globus_mutex_lock(&globus_l_dsi_rest_buffer_pool_mutex);
+    if (c >= 0 && globus_l_dsi_rest_buffer_pool_free[c] != NULL)
+    {
+        free_list = &globus_l_dsi_rest_buffer_pool_free[c];
+
+        /* Prefer a buffer on this thread's node, then a new one if there's
+         * room for it, then a buffer from another node.
+         */
+        while (node >= 0
+            && *free_list != NULL
+            && (*free_list)->numa_node != node)
+        {
+            free_list = &(*free_list)->next;
+        }
+        if (*free_list == NULL)
+        {
+            free_list = NULL;
+            if (globus_i_dsi_rest_buffer_pool_max > 0
+                && globus_l_dsi_rest_buffer_pool_allocated + len
+                    > (size_t) globus_i_dsi_rest_buffer_pool_max)
+            {
+                free_list = &globus_l_dsi_rest_buffer_pool_free[c];
+            }
+        }
+    }
+    if (free_list != NULL)
+    {
+        buffer = *free_list;
+        *free_list = buffer->next;
+        globus_l_dsi_rest_buffer_pool_cached -= len;
+        globus_mutex_unlock(&globus_l_dsi_rest_buffer_pool_mutex);
+
+        goto reuse;
+    }
+    if (globus_i_dsi_rest_buffer_pool_max > 0)
+    {
+        /* Release free buffers of other sizes, largest first */
+        for (int i = GLOBUS_L_DSI_REST_BUFFER_POOL_CLASSES - 1;
+             i >= 0
+             && globus_l_dsi_rest_buffer_pool_allocated + len
+                    > (size_t) globus_i_dsi_rest_buffer_pool_max;
+             i--)
+        {
+            while (globus_l_dsi_rest_buffer_pool_free[i] != NULL
+                && globus_l_dsi_rest_buffer_pool_allocated + len
+                    > (size_t) globus_i_dsi_rest_buffer_pool_max)
+            {
+                globus_i_dsi_rest_buffer_t
+                                       *victim;
+
+                victim = globus_l_dsi_rest_buffer_pool_free[i];
+                globus_l_dsi_rest_buffer_pool_free[i] = victim->next;
+                globus_l_dsi_rest_buffer_pool_allocated -= victim->buffer_len;
+                globus_l_dsi_rest_buffer_pool_cached -= victim->buffer_len;
+                victim->next = released;
+                released = victim;
+            }
+        }
+        if (!force
+            && globus_l_dsi_rest_buffer_pool_allocated + len
+                > (size_t) globus_i_dsi_rest_buffer_pool_max)
+        {
+            GlobusDsiRestDebug(
+                    "buffer pool full: allocated=%zu size=%zu max=%ld\n",
+                    globus_l_dsi_rest_buffer_pool_allocated,
+                    len,
+                    globus_i_dsi_rest_buffer_pool_max);
+            globus_mutex_unlock(&globus_l_dsi_rest_buffer_pool_mutex);
+
+            goto release;
+        }
+    }
+    globus_l_dsi_rest_buffer_pool_allocated += len;
+    globus_mutex_unlock(&globus_l_dsi_rest_buffer_pool_mutex);
+
+    buffer = globus_l_dsi_rest_buffer_alloc(len, node);
+    if (buffer == NULL)
+    {
+        globus_mutex_lock(&globus_l_dsi_rest_buffer_pool_mutex);
+        globus_l_dsi_rest_buffer_pool_allocated -= len;
+        globus_mutex_unlock(&globus_l_dsi_rest_buffer_pool_mutex);
+
+        goto release;
+    }
+
+reuse:
+    buffer->buffer_used = 0;
+    buffer->buffer_consumed = 0;
+    buffer->transfer_offset = UINT64_C(-1);
+    buffer->next = NULL;
+
+release:
+    while (released != NULL)
+    {
+        globus_i_dsi_rest_buffer_t     *next = released->next;
+
+        globus_l_dsi_rest_buffer_free(released);
+        released = next;
+    }
+    GlobusDsiRestExitPointer(buffer);
+    return buffer;
+}
+/* globus_i_dsi_rest_buffer_pool_get() */
+
+void
+globus_i_dsi_rest_buffer_pool_put(
+    globus_i_dsi_rest_buffer_t         *buffer)
+{
+    int                                 c;
+
+    GlobusDsiRestEnter();
+
+    if (buffer == NULL)
+    {
+        goto done;
+    }
+    c = globus_l_dsi_rest_buffer_pool_class(buffer->buffer_len);
+
+    globus_mutex_lock(&globus_l_dsi_rest_buffer_pool_mutex);
+    if (globus_i_dsi_rest_buffer_pool_max > 0
+        && c >= 0
+        && buffer->buffer_len
+            == (size_t) 1 << (GLOBUS_L_DSI_REST_BUFFER_POOL_MIN_SHIFT + c))
+    {
+        buffer->next = globus_l_dsi_rest_buffer_pool_free[c];
+        globus_l_dsi_rest_buffer_pool_free[c] = buffer;
+        globus_l_dsi_rest_buffer_pool_cached += buffer->buffer_len;
+        buffer = NULL;
+    }
+    else
+    {
+        globus_l_dsi_rest_buffer_pool_allocated -= buffer->buffer_len;
+    }
+    globus_mutex_unlock(&globus_l_dsi_rest_buffer_pool_mutex);
+
+    globus_l_dsi_rest_buffer_free(buffer);
+
+done:
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_buffer_pool_put() */
+
+void
+globus_i_dsi_rest_buffer_pool_totals(
+    size_t                             *allocated,
+    size_t                             *cached)
+{
+    GlobusDsiRestEnter();
+
+    globus_mutex_lock(&globus_l_dsi_rest_buffer_pool_mutex);
+    *allocated = globus_l_dsi_rest_buffer_pool_allocated;
+    *cached = globus_l_dsi_rest_buffer_pool_cached;
+    globus_mutex_unlock(&globus_l_dsi_rest_buffer_pool_mutex);
+
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_buffer_pool_totals() */
@@ -24,6 +24,7 @@
 
 globus_result_t
 globus_i_dsi_rest_compute_headers(
+    globus_i_dsi_rest_arena_t          *arena,
     struct  curl_slist                **request_headers,
     const globus_dsi_rest_key_array_t  *headers)
 {
@@ -45,6 +46,7 @@ globus_i_dsi_rest_compute_headers(
             headers->key_value[i].value)
         {
             result = globus_i_dsi_rest_add_header(
+                    arena,
                     request_headers,
                     headers->key_value[i].key,
                     headers->key_value[i].value);
@@ -57,7 +59,10 @@ globus_i_dsi_rest_compute_headers(
 
     if (result != GLOBUS_SUCCESS)
     {
-        curl_slist_free_all(*request_headers);
+        if (arena == NULL)
+        {
+            curl_slist_free_all(*request_headers);
+        }
         *request_headers = NULL;
     }
 no_headers:
@@ -35,8 +35,11 @@ globus_i_dsi_rest_encode_form_data(
 
     for (size_t i = 0; i < form_fields->count; i++)
     {
-        form_len += 3 * strlen(form_fields->key_value[i].key)
-                 +  3 * strlen(form_fields->key_value[i].value) 
+        const char                     *key = form_fields->key_value[i].key;
+        const char                     *value = form_fields->key_value[i].value;
+
+        form_len += globus_i_dsi_rest_uri_escaped_length(key, strlen(key))
+                 +  globus_i_dsi_rest_uri_escaped_length(value, strlen(value))
                  +  2;
     }
     form_data = malloc(form_len);
@@ -50,22 +53,16 @@ globus_i_dsi_rest_encode_form_data(
 
     for (size_t i = 0; i < form_fields->count; i++)
     {
+        const char                     *key = form_fields->key_value[i].key;
+        const char                     *value = form_fields->key_value[i].value;
+
         if (i > 0)
         {
             *(p++) = '&';
-            form_len--;
         }
-
-        globus_i_dsi_rest_uri_escape(
-                form_fields->key_value[i].key,
-                &p,
-                &form_len);
+        p = globus_i_dsi_rest_uri_escape(key, strlen(key), p);
         *(p++) = '=';
-        form_len--;
-        globus_i_dsi_rest_uri_escape(
-                form_fields->key_value[i].value,
-                &p,
-                &form_len);
+        p = globus_i_dsi_rest_uri_escape(value, strlen(value), p);
     }
     *p = 0;
 
@@ -0,0 +1,654 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file engine.c GridFTP DSI REST Multi Handle Request Engine
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Socket libcurl has asked an engine to watch
+ */
+typedef
+struct globus_l_dsi_rest_engine_socket_s
+{
+    curl_socket_t                       fd;
+    short                               events;
+}
+globus_l_dsi_rest_engine_socket_t;
+
+/**
+ * @brief Engine thread state
+ */
+typedef
+struct globus_l_dsi_rest_engine_s
+{
+    globus_mutex_t                      mutex;
+    /** Requests waiting to be added to multi, protected by mutex */
+    globus_i_dsi_rest_request_t        *pending;
+    globus_i_dsi_rest_request_t       **pending_last;
+    bool                                shutdown;
+    bool                                running;
+
+    /* The rest are only used by the engine thread */
+    CURLM                              *multi;
+    int                                 wakeup[2];
+    /** Monotonic time in ms when libcurl wants a timeout action, or -1 */
+    int64_t                             deadline;
+    size_t                              active;
+    globus_l_dsi_rest_engine_socket_t  *sockets;
+    size_t                              sockets_count;
+    size_t                              sockets_len;
+    struct pollfd                      *pollfds;
+    size_t                              pollfds_len;
+}
+globus_l_dsi_rest_engine_t;
+
+int                                     globus_i_dsi_rest_engine_threads;
+static globus_l_dsi_rest_engine_t      *globus_l_dsi_rest_engines;
+static int                              globus_l_dsi_rest_engines_count;
+static unsigned int                     globus_l_dsi_rest_engine_next;
+static globus_mutex_t                   globus_l_dsi_rest_engine_mutex;
+static globus_cond_t                    globus_l_dsi_rest_engine_cond;
+
+static
+void *
+globus_l_dsi_rest_engine_thread(
+    void                               *thread_arg);
+
+static
+int
+globus_l_dsi_rest_engine_socket(
+    CURL                               *easy,
+    curl_socket_t                       s,
+    int                                 what,
+    void                               *userp,
+    void                               *socketp);
+
+static
+int
+globus_l_dsi_rest_engine_timer(
+    CURLM                              *multi,
+    long                                timeout_ms,
+    void                               *userp);
+
+static
+void
+globus_l_dsi_rest_engine_start_pending(
+    globus_l_dsi_rest_engine_t         *engine);
+
+static
+void
+globus_l_dsi_rest_engine_check_done(
+    globus_l_dsi_rest_engine_t         *engine);
+
+static
+int64_t
+globus_l_dsi_rest_engine_now(void)
+{
+    struct timespec                     now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+/* globus_l_dsi_rest_engine_now() */
+
+static
+int
+globus_l_dsi_rest_engine_setup(
+    globus_l_dsi_rest_engine_t         *engine)
+{
+    int                                 rc = GLOBUS_SUCCESS;
+
+    engine->pending = NULL;
+    engine->pending_last = &engine->pending;
+    engine->shutdown = false;
+    engine->running = false;
+    engine->deadline = -1;
+    engine->active = 0;
+    engine->sockets = NULL;
+    engine->sockets_count = 0;
+    engine->sockets_len = 0;
+    engine->pollfds_len = 1;
+    engine->pollfds = malloc(sizeof(struct pollfd));
+    if (engine->pollfds == NULL)
+    {
+        rc = GLOBUS_FAILURE;
+        goto pollfds_alloc_fail;
+    }
+
+    rc = globus_mutex_init(&engine->mutex, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto mutex_init_fail;
+    }
+    rc = pipe(engine->wakeup);
+    if (rc != 0)
+    {
+        rc = GLOBUS_FAILURE;
+        goto pipe_fail;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl(engine->wakeup[i], F_SETFL,
+              fcntl(engine->wakeup[i], F_GETFL) | O_NONBLOCK);
+        fcntl(engine->wakeup[i], F_SETFD, FD_CLOEXEC);
+    }
+    engine->multi = curl_multi_init();
+    if (engine->multi == NULL)
+    {
+        rc = GLOBUS_FAILURE;
+        goto multi_init_fail;
+    }
+    curl_multi_setopt(engine->multi,
+            CURLMOPT_SOCKETFUNCTION, globus_l_dsi_rest_engine_socket);
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETDATA, engine);
+    curl_multi_setopt(engine->multi,
+            CURLMOPT_TIMERFUNCTION, globus_l_dsi_rest_engine_timer);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERDATA, engine);
+    curl_multi_setopt(engine->multi,
+            CURLMOPT_MAXCONNECTS, globus_i_dsi_rest_max_connects);
+
+    if (rc != GLOBUS_SUCCESS)
+    {
+multi_init_fail:
+        close(engine->wakeup[0]);
+        close(engine->wakeup[1]);
+pipe_fail:
+        globus_mutex_destroy(&engine->mutex);
+mutex_init_fail:
+        free(engine->pollfds);
+    }
+pollfds_alloc_fail:
+    return rc;
+}
+/* globus_l_dsi_rest_engine_setup() */
+
+static
+void
+globus_l_dsi_rest_engine_teardown(
+    globus_l_dsi_rest_engine_t         *engine)
+{
+    curl_multi_cleanup(engine->multi);
+    close(engine->wakeup[0]);
+    close(engine->wakeup[1]);
+    globus_mutex_destroy(&engine->mutex);
+    free(engine->sockets);
+    free(engine->pollfds);
+}
+/* globus_l_dsi_rest_engine_teardown() */
+
+int
+globus_i_dsi_rest_engine_init(void)
+{
+    int                                 rc = GLOBUS_SUCCESS;
+    int                                 count = 0;
+
+    GlobusDsiRestEnter();
+
+    globus_l_dsi_rest_engines_count = 0;
+
+    if (globus_i_dsi_rest_engine_threads <= 0)
+    {
+        goto no_engine;
+    }
+    rc = globus_mutex_init(&globus_l_dsi_rest_engine_mutex, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto mutex_init_fail;
+    }
+    rc = globus_cond_init(&globus_l_dsi_rest_engine_cond, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto cond_init_fail;
+    }
+    globus_l_dsi_rest_engines = calloc(
+            globus_i_dsi_rest_engine_threads,
+            sizeof(globus_l_dsi_rest_engine_t));
+    if (globus_l_dsi_rest_engines == NULL)
+    {
+        rc = GLOBUS_FAILURE;
+        goto engines_alloc_fail;
+    }
+    for (count = 0; count < globus_i_dsi_rest_engine_threads; count++)
+    {
+        rc = globus_l_dsi_rest_engine_setup(
+                &globus_l_dsi_rest_engines[count]);
+        if (rc != GLOBUS_SUCCESS)
+        {
+            goto engine_setup_fail;
+        }
+    }
+    globus_l_dsi_rest_engines_count = count;
+
+    globus_mutex_lock(&globus_l_dsi_rest_engine_mutex);
+    for (int i = 0; i < count; i++)
+    {
+        globus_thread_t                 thr;
+
+        globus_l_dsi_rest_engines[i].running = true;
+        rc = globus_thread_create(
+                &thr,
+                NULL,
+                globus_l_dsi_rest_engine_thread,
+                &globus_l_dsi_rest_engines[i]);
+        if (rc != GLOBUS_SUCCESS)
+        {
+            globus_l_dsi_rest_engines[i].running = false;
+            break;
+        }
+    }
+    globus_mutex_unlock(&globus_l_dsi_rest_engine_mutex);
+
+    if (rc != GLOBUS_SUCCESS)
+    {
+        /* Stops the threads that did start and frees everything */
+        globus_i_dsi_rest_engine_destroy();
+        goto no_engine;
+    }
+
+    if (rc != GLOBUS_SUCCESS)
+    {
+engine_setup_fail:
+        while (count-- > 0)
+        {
+            globus_l_dsi_rest_engine_teardown(
+                    &globus_l_dsi_rest_engines[count]);
+        }
+        free(globus_l_dsi_rest_engines);
+        globus_l_dsi_rest_engines = NULL;
+engines_alloc_fail:
+        globus_cond_destroy(&globus_l_dsi_rest_engine_cond);
+cond_init_fail:
+        globus_mutex_destroy(&globus_l_dsi_rest_engine_mutex);
+    }
+mutex_init_fail:
+no_engine:
+    GlobusDsiRestExitInt(rc);
+    return rc;
+}
+/* globus_i_dsi_rest_engine_init() */
+
+void
+globus_i_dsi_rest_engine_destroy(void)
+{
+    GlobusDsiRestEnter();
+
+    if (globus_l_dsi_rest_engines_count == 0)
+    {
+        goto no_engine;
+    }
+    for (int i = 0; i < globus_l_dsi_rest_engines_count; i++)
+    {
+        globus_l_dsi_rest_engine_t     *engine = &globus_l_dsi_rest_engines[i];
+
+        globus_mutex_lock(&engine->mutex);
+        engine->shutdown = true;
+        globus_mutex_unlock(&engine->mutex);
+        (void) write(engine->wakeup[1], "", 1);
+    }
+
+    globus_mutex_lock(&globus_l_dsi_rest_engine_mutex);
+    for (int i = 0; i < globus_l_dsi_rest_engines_count; i++)
+    {
+        while (globus_l_dsi_rest_engines[i].running)
+        {
+            globus_cond_wait(
+                    &globus_l_dsi_rest_engine_cond,
+                    &globus_l_dsi_rest_engine_mutex);
+        }
+    }
+    globus_mutex_unlock(&globus_l_dsi_rest_engine_mutex);
+
+    for (int i = 0; i < globus_l_dsi_rest_engines_count; i++)
+    {
+        globus_l_dsi_rest_engine_teardown(&globus_l_dsi_rest_engines[i]);
+    }
+    free(globus_l_dsi_rest_engines);
+    globus_l_dsi_rest_engines = NULL;
+    globus_l_dsi_rest_engines_count = 0;
+
+    globus_cond_destroy(&globus_l_dsi_rest_engine_cond);
+    globus_mutex_destroy(&globus_l_dsi_rest_engine_mutex);
+
+no_engine:
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_engine_destroy() */
+
+globus_result_t
+globus_i_dsi_rest_engine_add(
+    globus_i_dsi_rest_request_t        *request)
+{
+    globus_l_dsi_rest_engine_t         *engine;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    unsigned int                        index;
+
+    GlobusDsiRestEnter();
+
+    index = __atomic_fetch_add(
+            &globus_l_dsi_rest_engine_next, 1, __ATOMIC_RELAXED);
+    engine = &globus_l_dsi_rest_engines[
+            index % globus_l_dsi_rest_engines_count];
+
+    curl_easy_setopt(request->handle, CURLOPT_PRIVATE, request);
+    request->engine_next = NULL;
+
+    globus_mutex_lock(&engine->mutex);
+    if (engine->shutdown)
+    {
+        result = GlobusDsiRestErrorThreadFail(GLOBUS_FAILURE);
+    }
+    else
+    {
+        *engine->pending_last = request;
+        engine->pending_last = &request->engine_next;
+    }
+    globus_mutex_unlock(&engine->mutex);
+
+    if (result == GLOBUS_SUCCESS)
+    {
+        (void) write(engine->wakeup[1], "", 1);
+    }
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_i_dsi_rest_engine_add() */
+
+static
+void *
+globus_l_dsi_rest_engine_thread(
+    void                               *thread_arg)
+{
+    globus_l_dsi_rest_engine_t         *engine = thread_arg;
+    bool                                shutdown = false;
+
+    GlobusDsiRestEnter();
+
+    while (!shutdown || engine->active > 0)
+    {
+        size_t                          nfds = engine->sockets_count + 1;
+        int                             running_handles = 0;
+        int                             timeout = -1;
+        int                             rc;
+
+        if (nfds > engine->pollfds_len)
+        {
+            struct pollfd              *new_pollfds;
+
+            new_pollfds = realloc(engine->pollfds,
+                    (engine->sockets_len + 1) * sizeof(struct pollfd));
+            if (new_pollfds == NULL)
+            {
+                /* Poll what fits and try again next time around */
+                nfds = engine->pollfds_len;
+            }
+            else
+            {
+                engine->pollfds = new_pollfds;
+                engine->pollfds_len = engine->sockets_len + 1;
+            }
+        }
+        engine->pollfds[0] = (struct pollfd)
+        {
+            .fd = engine->wakeup[0],
+            .events = POLLIN
+        };
+        for (size_t i = 0; i < nfds - 1; i++)
+        {
+            engine->pollfds[i+1] = (struct pollfd)
+            {
+                .fd = engine->sockets[i].fd,
+                .events = engine->sockets[i].events
+            };
+        }
+
+        if (engine->deadline >= 0)
+        {
+            int64_t                     remaining;
+
+            remaining = engine->deadline - globus_l_dsi_rest_engine_now();
+            timeout = remaining < 0 ? 0 : remaining > INT_MAX ? INT_MAX
+                    : (int) remaining;
+        }
+
+        rc = poll(engine->pollfds, nfds, timeout);
+
+        if (rc > 0)
+        {
+            if (engine->pollfds[0].revents)
+            {
+                char                    drain[64];
+
+                while (read(engine->wakeup[0], drain, sizeof(drain)) > 0)
+                {
+                }
+            }
+            /*
+             * libcurl may change engine->sockets while processing an
+             * action, so walk the pollfds copy.
+             */
+            for (size_t i = 1; i < nfds; i++)
+            {
+                short                   revents = engine->pollfds[i].revents;
+                int                     mask = 0;
+
+                if (revents == 0)
+                {
+                    continue;
+                }
+                if (revents & POLLIN)
+                {
+                    mask |= CURL_CSELECT_IN;
+                }
+                if (revents & POLLOUT)
+                {
+                    mask |= CURL_CSELECT_OUT;
+                }
+                if (revents & (POLLERR|POLLHUP|POLLNVAL))
+                {
+                    mask |= CURL_CSELECT_ERR;
+                }
+                curl_multi_socket_action(
+                        engine->multi,
+                        engine->pollfds[i].fd,
+                        mask,
+                        &running_handles);
+            }
+        }
+        if (engine->deadline >= 0
+            && engine->deadline <= globus_l_dsi_rest_engine_now())
+        {
+            engine->deadline = -1;
+            curl_multi_socket_action(
+                    engine->multi,
+                    CURL_SOCKET_TIMEOUT,
+                    0,
+                    &running_handles);
+        }
+        globus_l_dsi_rest_engine_check_done(engine);
+
+        globus_mutex_lock(&engine->mutex);
+        shutdown = engine->shutdown;
+        globus_mutex_unlock(&engine->mutex);
+
+        globus_l_dsi_rest_engine_start_pending(engine);
+    }
+
+    globus_mutex_lock(&globus_l_dsi_rest_engine_mutex);
+    engine->running = false;
+    globus_cond_broadcast(&globus_l_dsi_rest_engine_cond);
+    globus_mutex_unlock(&globus_l_dsi_rest_engine_mutex);
+
+    GlobusDsiRestExit();
+
+    return NULL;
+}
+/* globus_l_dsi_rest_engine_thread() */
+
+static
+void
+globus_l_dsi_rest_engine_start_pending(
+    globus_l_dsi_rest_engine_t         *engine)
+{
+    globus_i_dsi_rest_request_t        *pending;
+
+    globus_mutex_lock(&engine->mutex);
+    pending = engine->pending;
+    engine->pending = NULL;
+    engine->pending_last = &engine->pending;
+    globus_mutex_unlock(&engine->mutex);
+
+    while (pending != NULL)
+    {
+        globus_i_dsi_rest_request_t    *request = pending;
+        CURLMcode                       mrc;
+
+        pending = request->engine_next;
+        request->engine_next = NULL;
+
+        mrc = curl_multi_add_handle(engine->multi, request->handle);
+        if (mrc != CURLM_OK)
+        {
+            GlobusDsiRestDebug("curl_multi_add_handle: %s\n",
+                    curl_multi_strerror(mrc));
+            globus_i_dsi_rest_perform_complete(request, CURLE_FAILED_INIT);
+            continue;
+        }
+        engine->active++;
+    }
+}
+/* globus_l_dsi_rest_engine_start_pending() */
+
+static
+void
+globus_l_dsi_rest_engine_check_done(
+    globus_l_dsi_rest_engine_t         *engine)
+{
+    CURLMsg                            *msg;
+    int                                 msgs_in_queue = 0;
+
+    while ((msg = curl_multi_info_read(engine->multi, &msgs_in_queue)) != NULL)
+    {
+        globus_i_dsi_rest_request_t    *request = NULL;
+        CURL                           *handle = msg->easy_handle;
+        CURLcode                        rc = msg->data.result;
+
+        if (msg->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+        curl_easy_getinfo(handle, CURLINFO_PRIVATE, (char **) &request);
+        curl_multi_remove_handle(engine->multi, handle);
+        engine->active--;
+
+        globus_i_dsi_rest_perform_complete(request, rc);
+    }
+}
+/* globus_l_dsi_rest_engine_check_done() */
+
+static
+int
+globus_l_dsi_rest_engine_socket(
+    CURL                               *easy,
+    curl_socket_t                       s,
+    int                                 what,
+    void                               *userp,
+    void                               *socketp)
+{
+    globus_l_dsi_rest_engine_t         *engine = userp;
+    size_t                              i;
+
+    for (i = 0; i < engine->sockets_count; i++)
+    {
+        if (engine->sockets[i].fd == s)
+        {
+            break;
+        }
+    }
+
+    if (what == CURL_POLL_REMOVE)
+    {
+        if (i < engine->sockets_count)
+        {
+            engine->sockets[i] = engine->sockets[--engine->sockets_count];
+        }
+        return 0;
+    }
+    if (i == engine->sockets_count)
+    {
+        if (engine->sockets_count == engine->sockets_len)
+        {
+            size_t                      new_len = engine->sockets_len + 8;
+            globus_l_dsi_rest_engine_socket_t
+                                       *new_sockets;
+
+            new_sockets = realloc(engine->sockets,
+                    new_len * sizeof(globus_l_dsi_rest_engine_socket_t));
+            if (new_sockets == NULL)
+            {
+                return -1;
+            }
+            engine->sockets = new_sockets;
+            engine->sockets_len = new_len;
+        }
+        engine->sockets[engine->sockets_count++].fd = s;
+    }
+    engine->sockets[i].events = 0;
+    if (what & CURL_POLL_IN)
+    {
+        engine->sockets[i].events |= POLLIN;
+    }
+    if (what & CURL_POLL_OUT)
+    {
+        engine->sockets[i].events |= POLLOUT;
+    }
+    return 0;
+}
+/* globus_l_dsi_rest_engine_socket() */
+
+static
+int
+globus_l_dsi_rest_engine_timer(
+    CURLM                              *multi,
+    long                                timeout_ms,
+    void                               *userp)
+{
+    globus_l_dsi_rest_engine_t         *engine = userp;
+
+    if (timeout_ms < 0)
+    {
+        engine->deadline = -1;
+    }
+    else
+    {
+        engine->deadline = globus_l_dsi_rest_engine_now() + timeout_ms;
+    }
+
+    return 0;
+}
+/* globus_l_dsi_rest_engine_timer() */
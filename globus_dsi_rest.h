@@ -45,6 +45,46 @@
  *  
  * The interface for this library is described in the @ref globus_dsi_rest.h
  * header.
+ *
+ * @section globus_dsi_rest_environment Environment Variables
+ *
+ * The following environment variables are read when the module is activated:
+ *
+ * - GLOBUS_DSI_REST_ENGINE_THREADS\n
+ *   Number of threads (0-64, default 0) that drive requests which have a
+ *   complete callback through libcurl's multi interface. When 0, each such
+ *   request runs in a thread of its own. Requests using the GridFTP
+ *   operation readers or writers always run in their own thread, as those
+ *   block waiting for the data channel.
+ * - GLOBUS_DSI_REST_MAX_CONNECTS\n
+ *   Maximum number of idle connections (default 16) kept in the connection
+ *   cache shared by all requests. Connections are reused by later requests
+ *   to the same server, avoiding new TCP and TLS handshakes.
+ * - GLOBUS_DSI_REST_HANDLE_CACHE_SIZE\n
+ *   Number of idle CURL handles kept for reuse by later requests, in
+ *   addition to one per thread. Defaults to 4 per CPU, but at least 16.
+ * - GLOBUS_DSI_REST_POSTFIELDS_MAX\n
+ *   JSON and form bodies up to this many bytes (default 65536) are passed
+ *   to libcurl in a single buffer instead of through the read callback.
+ *   0 disables this.
+ * - GLOBUS_DSI_REST_BUFFER_POOL_MAX\n
+ *   Maximum number of bytes (default 1 GiB) of data channel buffers held by
+ *   all GridFTP operation readers and writers together. Released buffers are
+ *   kept for reuse by later operations. When the limit is reached, an
+ *   operation waits for its own buffers to be released before reading more.
+ *   The parts buffered by globus_dsi_rest_write_gridftp_op_parallel() count
+ *   against the limit too, but as their data has already been read they
+ *   are allocated even when it is reached.
+ *   0 removes the limit and disables reuse.
+ * - GLOBUS_DSI_REST_BUFFER_HUGE_PAGES\n
+ *   If 1, data channel buffers of 2 MiB or more are aligned to and backed
+ *   by transparent huge pages, reducing TLB misses when copying large
+ *   blocks. Set the GridFTP block size to a multiple of 2 MiB to use this.
+ *   Default 0.
+ * - GLOBUS_DSI_REST_BUFFER_NUMA\n
+ *   If 1, data channel buffers are bound to the NUMA node of the thread
+ *   that allocates them, and reused buffers are taken from that node when
+ *   possible. Default 0.
  */
 
 #ifndef GLOBUS_DSI_REST_H
@@ -361,6 +401,153 @@ globus_dsi_rest_request(
     const globus_dsi_rest_key_array_t  *headers,
     const globus_dsi_rest_callbacks_t  *callbacks);
 
+/**
+ * @brief Prepared request
+ * @ingroup globus_dsi_rest_data
+ * @details
+ *     A method, base URI, query parameters, and headers which are checked,
+ *     encoded, and formatted once by globus_dsi_rest_prepare(), to be used
+ *     by any number of calls to globus_dsi_rest_request_prepared().
+ */
+typedef struct globus_dsi_rest_prepared_s *globus_dsi_rest_prepared_t;
+
+/**
+ * @brief Prepare a request to perform repeatedly
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Copies and formats the parts of a request which are the same each
+ *     time it is performed. The parameters are as for
+ *     globus_dsi_rest_request(), and none of them need to remain valid
+ *     after this returns.
+ *
+ * @param[in] method
+ *     The HTTP method to invoke for the resource.
+ * @param[in] uri
+ *     The base URI of the web resource to access.
+ * @param[in] query_parameters
+ *     Query parameters to include in each request. This may be NULL.
+ * @param[in] headers
+ *     HTTP headers to include in each request. This may be NULL.
+ * @param[out] preparedp
+ *     Pointer to store the prepared request in. Free it with
+ *     globus_dsi_rest_prepared_destroy().
+ */
+globus_result_t
+globus_dsi_rest_prepare(
+    const char                         *method,
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_dsi_rest_prepared_t         *preparedp);
+
+/**
+ * @brief Perform a prepared REST request
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Performs the request prepared by globus_dsi_rest_prepare(), as
+ *     globus_dsi_rest_request() would. Only the path, additional query
+ *     parameters, and callbacks vary from one call to the next. A prepared
+ *     request may be performed by several threads at once.
+ *
+ * @param[in] prepared
+ *     The prepared request. It must not be destroyed until this request is
+ *     complete.
+ * @param[in] path
+ *     String to append to the prepared URI, before the query. This may be
+ *     NULL. It is not escaped.
+ * @param[in] query_parameters
+ *     Query parameters to append to those of the prepared request. This
+ *     may be NULL.
+ * @param[in] callbacks
+ *     Callbacks to call when processing this request.
+ */
+globus_result_t
+globus_dsi_rest_request_prepared(
+    globus_dsi_rest_prepared_t          prepared,
+    const char                         *path,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_callbacks_t  *callbacks);
+
+/**
+ * @brief Free a prepared request
+ * @ingroup globus_dsi_rest_api
+ */
+void
+globus_dsi_rest_prepared_destroy(
+    globus_dsi_rest_prepared_t          prepared);
+
+
+/**
+ * @brief Pre-rendered header set
+ * @ingroup globus_dsi_rest_data
+ * @details
+ *     Headers which are formatted once by
+ *     globus_dsi_rest_header_set_create() and then sent with any number of
+ *     requests by globus_dsi_rest_request_header_set(), without being
+ *     formatted or copied again. This suits headers like Authorization,
+ *     Accept, and User-Agent which are the same for many requests.
+ */
+typedef struct globus_dsi_rest_header_set_s *globus_dsi_rest_header_set_t;
+
+/**
+ * @brief Create a header set
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Formats each header with a non-NULL key and value. The headers do
+ *     not need to remain valid after this returns.
+ *
+ * @param[in] headers
+ *     HTTP headers to include in the set.
+ * @param[out] header_setp
+ *     Pointer to store the header set in. Free it with
+ *     globus_dsi_rest_header_set_destroy().
+ */
+globus_result_t
+globus_dsi_rest_header_set_create(
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_dsi_rest_header_set_t       *header_setp);
+
+/**
+ * @brief Perform a REST request with a header set
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     As globus_dsi_rest_request(), but also sends the headers in
+ *     header_set. The headers in the headers parameter are formatted for
+ *     this request and sent before those in the set. The data write
+ *     callbacks only see the headers parameter, so headers describing the
+ *     request body belong there rather than in the set.
+ *
+ * @param[in] method
+ *     The HTTP method to invoke for the resource.
+ * @param[in] uri
+ *     The URI of the web resource to access.
+ * @param[in] query_parameters
+ *     Query parameters to append to the URI. This may be NULL.
+ * @param[in] header_set
+ *     Headers to send with this request. This may be NULL. It must not be
+ *     destroyed until this request is complete, but may be used by
+ *     several requests at once.
+ * @param[in] headers
+ *     Additional HTTP headers for this request. This may be NULL.
+ * @param[in] callbacks
+ *     Callbacks to call when processing this request.
+ */
+globus_result_t
+globus_dsi_rest_request_header_set(
+    const char                         *method,
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    globus_dsi_rest_header_set_t        header_set,
+    const globus_dsi_rest_key_array_t  *headers,
+    const globus_dsi_rest_callbacks_t  *callbacks);
+
+/**
+ * @brief Free a header set
+ * @ingroup globus_dsi_rest_api
+ */
+void
+globus_dsi_rest_header_set_destroy(
+    globus_dsi_rest_header_set_t        header_set);
 
 /**
  * @brief Add query parameters to a URI base string
@@ -412,6 +599,41 @@ bool
 globus_dsi_rest_error_is_retryable(
     globus_result_t                     result);
 
+/**
+ * @brief Request Statistics
+ * @ingroup globus_dsi_rest_data
+ * @details
+ * Counters accumulated since the module was activated, returned by
+ * globus_dsi_rest_get_stats().
+ */
+typedef
+struct globus_dsi_rest_stats_s
+{
+    /** Requests which had to open one or more new connections */
+    uint64_t                            requests_new_connection;
+    /** Requests which reused a cached keep-alive connection */
+    uint64_t                            requests_reused_connection;
+    /** Total number of new connections opened */
+    uint64_t                            connections_opened;
+}
+globus_dsi_rest_stats_t;
+
+/**
+ * @brief Get request statistics
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Copies the current values of the library's counters into the
+ *     structure pointed to by stats.
+ *
+ * @param[out] stats
+ *     Pointer to the structure to fill in.
+ * @return
+ *     On success, return GLOBUS_SUCCESS. Otherwise, return an error result.
+ */
+globus_result_t
+globus_dsi_rest_get_stats(
+    globus_dsi_rest_stats_t            *stats);
+
 /**
  * @defgroup globus_dsi_rest_callback_specializations Callback Specializations
  */
@@ -454,11 +676,18 @@ extern globus_dsi_rest_write_t const    globus_dsi_rest_write_block;
  *     This function implements the globus_dsi_rest_write_t interface
  *     and is intended to be used in the situation when the data to send
  *     from the REST server is a json object. The callback will serialize the 
- *     json object and send it. The Content-Type header will be automatically
+ *     json object as it is sent, without first encoding all of it into
+ *     memory, unless it is small enough to pass to libcurl in one buffer
+ *     (see GLOBUS_DSI_REST_POSTFIELDS_MAX). Its length is only computed if
+ *     the request needs a Content-Length, so a caller which sets a
+ *     Transfer-Encoding header avoids that pass over the json. The
+ *     Content-Type header will be automatically
  *     set to application/json when this specialization is used, so it
  *     doesn't need to be set in the header explicitly.
  *
- *     The write_callback_arg used with this function <b>MUST BE</b> a json *.
+ *     The write_callback_arg used with this function <b>MUST BE</b> a json *
+ *     holding an object or an array; anything else fails the request with
+ *     a parameter error.
  */
 extern globus_dsi_rest_write_t const    globus_dsi_rest_write_json;
 
@@ -696,6 +925,129 @@ extern globus_dsi_rest_read_t const     globus_dsi_rest_read_multipart;
  */
 extern globus_dsi_rest_read_t const     globus_dsi_rest_read_json;
 
+/**
+ * @brief JSON array element callback
+ * @ingroup globus_dsi_rest_callback_specializations
+ * @details
+ *     Functions of this type are called by
+ *     globus_dsi_rest_read_json_elements() once for each element of the
+ *     array it is reading, as soon as the element has been received. The
+ *     element is released when the function returns, so it must call
+ *     json_incref() on anything it wants to keep. Returning an error
+ *     causes the request to fail.
+ */
+struct json_t;
+
+typedef
+globus_result_t
+(*globus_dsi_rest_json_element_t)(
+    void                               *element_callback_arg,
+    struct json_t                      *element);
+
+/**
+ * @brief JSON element read specialization data_read_callback_arg
+ * @ingroup globus_dsi_rest_callback_specializations
+ * @details
+ *     A pointer to a data structure of this type must be be used as the
+ *     data_read_callback_arg parameter when using the
+ *     globus_dsi_rest_read_json_elements() function as the
+ *     data_read_callback to globus_dsi_rest_request().
+ */
+typedef
+struct globus_dsi_rest_read_json_elements_arg_s
+{
+    /**
+     * Name of the member of the top-level object which holds the array,
+     * for example "DATA". The name is compared with the member names as
+     * they appear in the response, without decoding escapes. If this is
+     * NULL, the response itself must be the array.
+     */
+    const char                         *array_key;
+    /** Function to call with each element of the array */
+    globus_dsi_rest_json_element_t      element_callback;
+    /**
+     * An argument to pass to the element_callback function pointer. This
+     * may be NULL.
+     */
+    void                               *element_callback_arg;
+}
+globus_dsi_rest_read_json_elements_arg_t;
+
+/**
+ * @brief Streaming JSON array read specialization of globus_dsi_rest_read_t
+ * @ingroup globus_dsi_rest_callback_specializations
+ * @details
+ *     This function implements the globus_dsi_rest_read_t interface
+ *     and is intended to be used in the situation when the data to receive
+ *     from the REST server is a json array, or an object containing one,
+ *     which may be too large to hold in memory at once. Rather than
+ *     buffering the whole response as globus_dsi_rest_read_json() does,
+ *     this scans the data as it arrives and parses each element of the
+ *     array on its own, passing it to the element callback while the rest
+ *     of the response is still being received. Only the element being
+ *     received is held in memory. Anything outside of the array is skipped.
+ *
+ *     The read_callback_arg passed to this function <b>MUST BE</b> a
+ *     globus_dsi_rest_read_json_elements_arg_t * cast to a void *. This
+ *     function will cause the request to fail if an element is not
+ *     parseable as json, or if the response ends inside the array. If the
+ *     array is not found, the element callback is not called.
+ */
+extern globus_dsi_rest_read_t const     globus_dsi_rest_read_json_elements;
+
+/**
+ * @brief JSON pointer read specialization data_read_callback_arg
+ * @ingroup globus_dsi_rest_callback_specializations
+ * @details
+ *     A pointer to a data structure of this type must be be used as the
+ *     data_read_callback_arg parameter when using the
+ *     globus_dsi_rest_read_json_pointers() function as the
+ *     data_read_callback to globus_dsi_rest_request().
+ */
+typedef
+struct globus_dsi_rest_read_json_pointers_arg_s
+{
+    /** Number of elements in the pointers and values arrays */
+    size_t                              count;
+    /**
+     * JSON pointers (RFC 6901) to the values to extract from the
+     * response, for example "/size" or "/DATA/0/name". Member names are
+     * compared with the names as they appear in the response, without
+     * decoding escapes.
+     */
+    const char * const                 *pointers;
+    /**
+     * Array of count values, each set to a new reference to the value its
+     * pointer refers to, or NULL if the response does not contain it. The
+     * caller must json_decref() each value which is not NULL, even if the
+     * request fails.
+     */
+    struct json_t                     **values;
+}
+globus_dsi_rest_read_json_pointers_arg_t;
+
+/**
+ * @brief JSON pointer read specialization of globus_dsi_rest_read_t
+ * @ingroup globus_dsi_rest_callback_specializations
+ * @details
+ *     This function implements the globus_dsi_rest_read_t interface
+ *     and is intended to be used in the situation when only a few values
+ *     are needed from a json response. Instead of parsing the whole
+ *     response as globus_dsi_rest_read_json() does, this scans the data as
+ *     it arrives, keeping track of where it is in the document, and only
+ *     parses the values that the pointers refer to. Everything else is
+ *     skipped without being copied or allocated. Once every pointer has a
+ *     value, the rest of the response is ignored. If a member name is
+ *     repeated, the first one is used.
+ *
+ *     The read_callback_arg passed to this function <b>MUST BE</b> a
+ *     globus_dsi_rest_read_json_pointers_arg_t * cast to a void *. This
+ *     function will cause the request to fail if one of the pointers is
+ *     not a valid JSON pointer, or if a value it refers to is not parseable
+ *     as json.
+ */
+extern globus_dsi_rest_read_t const     globus_dsi_rest_read_json_pointers;
+
 /**
  * @brief GridFTP operation read specialization of globus_dsi_rest_read_t
  * @ingroup globus_dsi_rest_callback_specializations
@@ -708,10 +1060,278 @@ extern globus_dsi_rest_read_t const     globus_dsi_rest_read_json;
  *     the GridFTP data channel.
  *
  *     The read_callback_arg used with this function <b>MUST BE</b> a
- *     pointer to a globus_dsi_rest_gridftp_op_arg_t.
+ *     pointer to a globus_dsi_rest_gridftp_op_arg_t. If its length is not
+ *     -1, the response must hold exactly that much data: the request
+ *     fails if more arrives, or if it ends with less.
  */
 extern globus_dsi_rest_read_t const     globus_dsi_rest_read_gridftp_op;
 
+/**
+ * @brief Read a GridFTP operation's range with parallel ranged GETs
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Splits the range described by gridftp_op_arg into several byte ranges
+ *     and issues a GET request with a Range header for each of them at the
+ *     same time. Each request passes its data to
+ *     globus_gridftp_server_register_write() at the offset of its range, as
+ *     globus_dsi_rest_read_gridftp_op() does for a single request.
+ *
+ *     The server must reply to each request with a 206 response and a
+ *     Content-Range header matching the range asked for; otherwise that
+ *     request fails. Ranges are at least 1 MiB. If the length in
+ *     gridftp_op_arg is -1, a single request is made for the data from
+ *     the offset to the end of the resource. If the length is 0, no
+ *     request is made, and complete_callback, if not NULL, is called with
+ *     GLOBUS_SUCCESS before this function returns.
+ *
+ * @param[in] uri
+ *     The URI of the web resource to read.
+ * @param[in] query_parameters
+ *     Additional query parameters to append to each request. This may be
+ *     NULL.
+ * @param[in] headers
+ *     Additional HTTP headers to append to each request. This may be NULL,
+ *     and must not include a Range header.
+ * @param[in] gridftp_op_arg
+ *     The GridFTP operation, offset and length of the data to read.
+ * @param[in] max_streams
+ *     Maximum number of requests to run at the same time. If this is 0 or
+ *     less, the value from globus_gridftp_server_get_optimal_concurrency()
+ *     is used.
+ * @param[in] complete_callback
+ *     If not NULL, this function returns once the requests are registered,
+ *     and this is called once with the combined result when all of them
+ *     are done. If NULL, this function waits for the requests to finish.
+ * @param[in] complete_callback_arg
+ *     Argument to complete_callback.
+ * @return
+ *     On success, return GLOBUS_SUCCESS. Otherwise, return the first error
+ *     from any of the requests. If complete_callback is not NULL and an
+ *     error is returned, complete_callback will not be called.
+ */
+globus_result_t
+globus_dsi_rest_read_gridftp_op_parallel(
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_key_array_t  *headers,
+    const globus_dsi_rest_gridftp_op_arg_t
+                                       *gridftp_op_arg,
+    int                                 max_streams,
+    globus_dsi_rest_complete_t          complete_callback,
+    void                               *complete_callback_arg);
+
+/**
+ * @brief Read all of a GridFTP operation's ranges in one request
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Calls globus_gridftp_server_get_read_range() until it returns no more
+ *     ranges, and issues a single GET request with a Range header listing
+ *     all of them. Each part of the multipart/byteranges response is passed
+ *     to globus_gridftp_server_register_write() at the offset of its range,
+ *     as globus_dsi_rest_read_gridftp_op() does for a single request. This
+ *     replaces one request per range for sparse reads such as restarts.
+ *
+ *     Ranges are sorted, and overlapping or adjacent ranges are merged. The
+ *     parts of the response must match the ranges asked for, in order. If
+ *     the server replies with the whole resource, a single range, or a
+ *     part which doesn't match, the remaining ranges are read with one
+ *     request each, as globus_dsi_rest_read_gridftp_op_parallel() does
+ *     with one stream. A single range is always read that way.
+ *
+ *     This function waits for all requests to finish.
+ *
+ * @param[in] uri
+ *     The URI of the web resource to read.
+ * @param[in] query_parameters
+ *     Additional query parameters to append to each request. This may be
+ *     NULL.
+ * @param[in] headers
+ *     Additional HTTP headers to append to each request. This may be NULL,
+ *     and must not include a Range header.
+ * @param[in] op
+ *     The GridFTP operation to get the ranges from and send the data to.
+ * @return
+ *     On success, return GLOBUS_SUCCESS. Otherwise, return the error from
+ *     the request that failed.
+ */
+globus_result_t
+globus_dsi_rest_read_gridftp_op_ranges(
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_gfs_operation_t              op);
+
+/**
+ * @brief Part of a parallel upload
+ * @ingroup globus_dsi_rest_data
+ * @details
+ *     Describes one part of an upload made by
+ *     globus_dsi_rest_write_gridftp_op_parallel(). The library sets the
+ *     part_number, offset, and length fields. The part_start callback sets
+ *     the fields describing the request which sends the part's data.
+ */
+typedef
+struct globus_dsi_rest_part_s
+{
+    /** Index of this part, counting from 0 at the start of the upload */
+    uint64_t                            part_number;
+    /** Offset of the part's data in the file */
+    globus_off_t                        offset;
+    /** Length of the part's data */
+    globus_off_t                        length;
+    /** HTTP method for the part's request, typically "PUT" */
+    const char                         *method;
+    /** URI for the part's request */
+    const char                         *uri;
+    /** Query parameters for the part's request */
+    globus_dsi_rest_key_array_t         query_parameters;
+    /** Headers for the part's request */
+    globus_dsi_rest_key_array_t         headers;
+    /** Application data for this part, such as an entity tag to commit */
+    void                               *part_arg;
+}
+globus_dsi_rest_part_t;
+
+/**
+ * @brief Part Start Callback Signature
+ * @ingroup globus_dsi_rest_callback_signatures
+ * @details
+ *     Called when a part's data is complete, before its request is made.
+ *     The callback fills in the method, uri, query_parameters, and headers
+ *     fields of part, which must remain valid until the commit callback is
+ *     called. This is only called from the thread which called
+ *     globus_dsi_rest_write_gridftp_op_parallel().
+ *
+ * @param[in] part_callback_arg
+ *     DSI-specific callback argument.
+ * @param[inout] part
+ *     The part to upload.
+ * @return
+ *     Return GLOBUS_SUCCESS to upload the part. Otherwise, the upload is
+ *     aborted and the error is passed to the commit callback.
+ */
+typedef
+globus_result_t
+(*globus_dsi_rest_part_start_t) (
+    void                               *part_callback_arg,
+    globus_dsi_rest_part_t             *part);
+
+/**
+ * @brief Part Response Callback Signature
+ * @ingroup globus_dsi_rest_callback_signatures
+ * @details
+ *     Called with the response to a part's request. This may be called for
+ *     several parts at the same time from different threads.
+ *
+ * @param[in] part_callback_arg
+ *     DSI-specific callback argument.
+ * @param[inout] part
+ *     The part which was uploaded. The callback may set part_arg.
+ * @param[in] response_code
+ *     HTTP response code.
+ * @param[in] response_headers
+ *     The set of headers included in the response.
+ * @return
+ *     Return GLOBUS_SUCCESS if the part was uploaded. Otherwise, the upload
+ *     is aborted and the error is passed to the commit callback.
+ */
+typedef
+globus_result_t
+(*globus_dsi_rest_part_response_t) (
+    void                               *part_callback_arg,
+    globus_dsi_rest_part_t             *part,
+    int                                 response_code,
+    const globus_dsi_rest_key_array_t  *response_headers);
+
+/**
+ * @brief Part Commit Callback Signature
+ * @ingroup globus_dsi_rest_callback_signatures
+ * @details
+ *     Called once after all part requests are complete, or after an error.
+ *     The callback typically makes the request which assembles the parts
+ *     into the final object, or abandons the upload if result is an error.
+ *     The parts are freed after this returns.
+ *
+ * @param[in] part_callback_arg
+ *     DSI-specific callback argument.
+ * @param[in] parts
+ *     Array of the parts in order of part_number. After an error, elements
+ *     may be NULL if no data arrived for a part, and parts which were never
+ *     started have a NULL method.
+ * @param[in] part_count
+ *     Number of elements in parts.
+ * @param[in] result
+ *     The result of reading and uploading the parts.
+ * @return
+ *     The result returned by globus_dsi_rest_write_gridftp_op_parallel().
+ */
+typedef
+globus_result_t
+(*globus_dsi_rest_part_commit_t) (
+    void                               *part_callback_arg,
+    globus_dsi_rest_part_t            **parts,
+    size_t                              part_count,
+    globus_result_t                     result);
+
+/**
+ * @brief Parallel upload callbacks
+ * @ingroup globus_dsi_rest_data
+ */
+typedef
+struct globus_dsi_rest_part_callbacks_s
+{
+    /** Describes the request for a part. Must not be NULL */
+    globus_dsi_rest_part_start_t        part_start;
+    /**
+     * Checks the response for a part. If NULL, any 2xx response is
+     * accepted.
+     */
+    globus_dsi_rest_part_response_t     part_response;
+    /** Completes the upload. Must not be NULL */
+    globus_dsi_rest_part_commit_t       commit;
+    /** DSI-specific data passed to each of the callbacks */
+    void                               *callback_arg;
+}
+globus_dsi_rest_part_callbacks_t;
+
+/**
+ * @brief Upload a GridFTP operation's data in parallel parts
+ * @ingroup globus_dsi_rest_api
+ * @details
+ *     Reads the data for gridftp_op_arg from the GridFTP data channels and
+ *     divides it into parts of part_size bytes by offset. Each part is
+ *     uploaded in a request of its own as soon as all of its data has
+ *     arrived, with up to max_streams requests at the same time, so data
+ *     from parallel streams does not wait for earlier offsets. This suits
+ *     multipart upload APIs which accept numbered parts of an object.
+ *
+ *     This function returns after the commit callback returns.
+ *
+ * @param[inout] gridftp_op_arg
+ *     The GridFTP operation, offset and length of the data to upload. If
+ *     length is -1, data is read until eof. The eof field is updated as by
+ *     globus_dsi_rest_write_gridftp_op().
+ * @param[in] part_size
+ *     Size of each part but the last. If this is 0 or less, the GridFTP
+ *     block size is used.
+ * @param[in] max_streams
+ *     Maximum number of part requests to run at the same time. If this is
+ *     0 or less, the value from
+ *     globus_gridftp_server_get_optimal_concurrency() is used.
+ * @param[in] part_callbacks
+ *     Callbacks which describe, check, and commit the parts.
+ * @return
+ *     The result of the commit callback, or an error result if the
+ *     parameters are invalid.
+ */
+globus_result_t
+globus_dsi_rest_write_gridftp_op_parallel(
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg,
+    globus_off_t                        part_size,
+    int                                 max_streams,
+    const globus_dsi_rest_part_callbacks_t
+                                       *part_callbacks);
+
 /**
  * @brief Idle timeout specialization of globus_dsi_rest_progress_t
  * @ingroup globus_dsi_rest_callback_specializations
@@ -778,7 +1398,9 @@ globus_dsi_rest_response_arg_t;
  *     When this function is used, the response_code will be set to the HTTP
  *     response code, and the values in the desired_headers.key_value array
  *     will be updated for each of the keys which was present in the HTTP
- *     response.
+ *     response. Each value is a copy which the application must free. If
+ *     a key appears in desired_headers more than once, only its first
+ *     entry is updated.
  */
 extern globus_dsi_rest_response_t const globus_dsi_rest_response;
 
@@ -794,6 +1416,7 @@ enum
     GLOBUS_DSI_REST_ERROR_TIME_OUT,
     GLOBUS_DSI_REST_ERROR_THREAD_FAIL,
     GLOBUS_DSI_REST_ERROR_UNEXPECTED_DATA,
+    GLOBUS_DSI_REST_ERROR_UNEXPECTED_RESPONSE,
 };
 
 #define GLOBUS_DSI_REST_MODULE (&globus_i_dsi_rest_module)
@@ -27,6 +27,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "globus_dsi_rest.h"
 #include "globus_common.h"
@@ -35,23 +36,197 @@ extern "C" {
 #include <curl/curl.h>
 #include <jansson.h>
 
+/**
+ * @brief Memory owned by one request
+ * @details
+ *     Allocations from an arena live until the whole arena is released.
+ *     An arena with no chunks is empty and needs no other initialization.
+ */
+typedef
+struct globus_i_dsi_rest_arena_s
+{
+    // Chunks in the arena, the first being the one allocated from
+    struct globus_i_dsi_rest_arena_chunk_s
+                                       *chunks;
+}
+globus_i_dsi_rest_arena_t;
+
+/**
+ * @brief HTTP methods which libcurl is configured for specially
+ */
+typedef
+enum globus_i_dsi_rest_method_e
+{
+    GLOBUS_I_DSI_REST_METHOD_OTHER,
+    GLOBUS_I_DSI_REST_METHOD_GET,
+    GLOBUS_I_DSI_REST_METHOD_PUT,
+    GLOBUS_I_DSI_REST_METHOD_POST,
+    GLOBUS_I_DSI_REST_METHOD_HEAD,
+    GLOBUS_I_DSI_REST_METHOD_PATCH,
+    GLOBUS_I_DSI_REST_METHOD_DELETE
+}
+globus_i_dsi_rest_method_t;
+
+/**
+ * @brief Pre-rendered header set
+ * @details
+ *     The "Key: Value" line for each header, already linked together as a
+ *     libcurl list. Each request using the set links the end of its own
+ *     list to lines, so neither the lines nor the nodes are copied.
+ */
+typedef
+struct globus_dsi_rest_header_set_s
+{
+    // Shared by every request using this set, which must not modify it
+    struct curl_slist                  *lines;
+    // The set includes Transfer-Encoding or Content-Length
+    bool                                set_length;
+    // Holds the lines, for a set from globus_dsi_rest_header_set_create()
+    globus_i_dsi_rest_arena_t           arena;
+}
+globus_i_dsi_rest_header_set_t;
+
+/**
+ * @brief Parts of a request which don't change between executions
+ * @details
+ *     globus_dsi_rest_prepare() fills in all of this once, with the
+ *     prepared headers rendered into header_set. For an unprepared
+ *     request, globus_dsi_rest_request() fills in the fields up to
+ *     header_set on the stack, so that the headers are formatted for that
+ *     request.
+ */
+typedef
+struct globus_dsi_rest_prepared_s
+{
+    const char                         *method;
+    globus_i_dsi_rest_method_t          method_id;
+    // Base URI, to which a path and the query are appended
+    const char                         *uri;
+    globus_dsi_rest_key_array_t         headers;
+    // Headers or header_set include Transfer-Encoding or Content-Length
+    bool                                headers_set_length;
+    // Headers to add after those formatted for each request, or NULL
+    const globus_i_dsi_rest_header_set_t
+                                       *header_set;
+
+    // Leading entries of headers which header_set already holds
+    size_t                              headers_rendered;
+    // Escaped query string, starting with '?', or empty
+    const char                         *query;
+    // Holds all of the above for a prepared request
+    globus_i_dsi_rest_arena_t           arena;
+}
+globus_i_dsi_rest_prepared_t;
+
 typedef
 struct globus_i_dsi_rest_read_json_arg_s
 {
     size_t                              buffer_used;
+    // Allocated size of buffer, including room for a terminating NUL
     size_t                              buffer_len;
     char                               *buffer;
     json_t                            **json_out;
 }
 globus_i_dsi_rest_read_json_arg_t;
 
+typedef
+struct globus_i_dsi_rest_read_json_elements_arg_s
+{
+    globus_dsi_rest_read_json_elements_arg_t
+                                        arg;
+    // Nesting depth of objects and arrays at the current position
+    int                                 depth;
+    // Depth inside the array whose elements are reported, 0 until found
+    int                                 array_depth;
+    bool                                array_done;
+    bool                                in_string;
+    bool                                escape;
+    // The top-level value is an object, which may hold the array
+    bool                                top_level_object;
+    // At depth 1, true when the next string is a member name
+    bool                                expect_key;
+    bool                                in_key;
+    // Whether the member name so far matches arg.array_key[key_matched]
+    bool                                key_matches;
+    size_t                              key_matched;
+    // The last member name at depth 1 was arg.array_key
+    bool                                key_found;
+    // Bytes of the element being received, when it spans reads
+    bool                                in_element;
+    size_t                              element_used;
+    size_t                              element_len;
+    char                               *element;
+}
+globus_i_dsi_rest_read_json_elements_arg_t;
+
+typedef
+struct globus_i_dsi_rest_json_pointer_token_s
+{
+    // Member name with ~1 and ~0 decoded, pointing into the pointer's copy
+    const char                         *name;
+    size_t                              length;
+    // Array index, or -1 if the token is not one
+    long                                index;
+}
+globus_i_dsi_rest_json_pointer_token_t;
+
+typedef
+struct globus_i_dsi_rest_json_pointer_s
+{
+    char                               *copy;
+    globus_i_dsi_rest_json_pointer_token_t
+                                       *tokens;
+    size_t                              count;
+    // Number of leading tokens which match the path being scanned
+    size_t                              matched;
+    // The value being captured contains this pointer's value
+    bool                                capture;
+}
+globus_i_dsi_rest_json_pointer_t;
+
+typedef
+struct globus_i_dsi_rest_read_json_pointers_arg_s
+{
+    size_t                              count;
+    globus_i_dsi_rest_json_pointer_t   *pointers;
+    json_t                            **values;
+    size_t                              found;
+    // Most tokens in any pointer; containers deeper than this are skipped
+    size_t                              max_tokens;
+    // Type and current index of each open container up to max_tokens
+    bool                               *container_object;
+    long                               *container_index;
+    size_t                              depth;
+    bool                                in_string;
+    bool                                escape;
+    bool                                expect_key;
+    // Member name being received, only kept when a pointer may match it
+    bool                                in_key;
+    size_t                              key_used;
+    size_t                              key_len;
+    char                               *key;
+    // Value being received for one or more pointers, when it spans reads
+    bool                                capturing;
+    size_t                              capture_depth;
+    size_t                              capture_used;
+    size_t                              capture_len;
+    char                               *capture;
+}
+globus_i_dsi_rest_read_json_pointers_arg_t;
+
 typedef struct
 globus_i_dsi_rest_buffer_s
 {
     size_t                              buffer_len;
     size_t                              buffer_used;
+    // Start of the data not yet consumed, transfer_offset is its offset
+    size_t                              buffer_consumed;
     uint64_t                            transfer_offset;
     struct globus_i_dsi_rest_buffer_s  *next;
+    // Length of the mmap()ed region holding the buffer, 0 if malloc()ed
+    size_t                              mapped_len;
+    // NUMA node the buffer's memory is bound to, or -1
+    int                                 numa_node;
     unsigned char                       buffer[];
 }
 globus_i_dsi_rest_buffer_t;
@@ -76,28 +251,55 @@ struct globus_i_dsi_rest_gridftp_op_arg_s
 
     uint64_t                            offset;
     uint64_t                            end_offset;
+    // Offset just past the data received from the REST server, which
+    // must reach end_offset, and not pass it, when that is known
+    uint64_t                            received_offset;
     // If we hit EOF or end of expected read
     bool                                eof;
     // Points to app's gridftp_op_arg's eof field, only set to true
     // if we get an eof response from the GridFTP server.
     bool                               *eofp;
 
+    // Buffers waiting to be written to the GridFTP data channel, in order
     globus_i_dsi_rest_buffer_t         *pending_buffers;
     globus_i_dsi_rest_buffer_t        **pending_buffers_last;
 
+    // Buffers read from the GridFTP data channel, in a min-heap by
+    // transfer_offset
+    globus_i_dsi_rest_buffer_t        **pending_heap;
+    size_t                              pending_heap_count;
+    size_t                              pending_heap_size;
+    globus_off_t                        pending_bytes;
+
     globus_i_dsi_rest_buffer_t         *current_buffer;
 
-    globus_i_dsi_rest_buffer_t         *registered_buffers;
+    // Registered buffers are found from the data pointer passed to the
+    // GridFTP callback, so only their count and size are kept
     int                                 registered_buffers_count;
+    globus_off_t                        registered_bytes;
 
     globus_i_dsi_rest_buffer_t         *free_buffers;
 }
 globus_i_dsi_rest_gridftp_op_arg_t;
 
+/**
+ * @brief Find the buffer containing a data array
+ * @details
+ *     The data passed to the GridFTP server is the flexible array member
+ *     at the end of a globus_i_dsi_rest_buffer_t, so the buffer is found
+ *     from the pointer passed back to a read or write callback without
+ *     searching for it.
+ */
+#define GlobusDsiRestBufferFromData(data) \
+    ((globus_i_dsi_rest_buffer_t *) \
+        ((unsigned char *) (data) - offsetof(globus_i_dsi_rest_buffer_t, buffer)))
+
 
 typedef
 struct globus_i_dsi_rest_write_multipart_arg_s
 {
+    // Arena of the request, holding the boundaries written between parts
+    globus_i_dsi_rest_arena_t          *arena;
     char                               *boundary;
     size_t                              num_parts;
     size_t                              part_index;
@@ -121,6 +323,44 @@ struct globus_i_dsi_rest_write_block_arg_s
 }
 globus_i_dsi_rest_write_block_arg_t;
 
+typedef
+struct globus_i_dsi_rest_write_json_frame_s
+{
+    json_t                             *container;
+    // Next member of an object
+    void                               *iter;
+    // Number of members or elements written
+    size_t                              index;
+}
+globus_i_dsi_rest_write_json_frame_t;
+
+typedef
+struct globus_i_dsi_rest_write_json_arg_s
+{
+    json_t                             *json;
+    // Whole body, kept from the length pass when it is small enough
+    globus_i_dsi_rest_write_block_arg_t block;
+    bool                                started;
+    bool                                done;
+    // Object member value to write after its name
+    json_t                             *next_value;
+    // Containers being written
+    globus_i_dsi_rest_write_json_frame_t
+                                       *stack;
+    size_t                              depth;
+    size_t                              stack_len;
+    // String being written, and whether it is an object member name
+    const char                         *string;
+    size_t                              string_len;
+    size_t                              string_pos;
+    bool                                string_key;
+    // Output which didn't fit in the caller's buffer
+    char                                pending[64];
+    size_t                              pending_len;
+    size_t                              pending_pos;
+}
+globus_i_dsi_rest_write_json_arg_t;
+
 typedef
 struct globus_i_dsi_rest_write_blocks_arg_s
 {
@@ -134,17 +374,77 @@ typedef
 struct globus_i_dsi_rest_write_part_s
 {
     globus_dsi_rest_key_array_t         headers;
-    globus_dsi_rest_key_array_t         malloced_headers;
 
     globus_dsi_rest_write_t             data_write_callback;
     void                               *data_write_callback_arg;
 }
 globus_i_dsi_rest_write_part_t;
 
+/**
+ * @brief Location of a parsed header in its header block
+ */
+typedef
+struct globus_i_dsi_rest_header_view_s
+{
+    uint32_t                            key_offset;
+    uint32_t                            key_len;
+    uint32_t                            value_offset;
+    uint32_t                            value_len;
+}
+globus_i_dsi_rest_header_view_t;
+
+/**
+ * @brief Parsed response headers
+ * @details
+ *     Each header line is copied once into buffer, where its key and
+ *     value are NUL-terminated in place, and located by a view. Both
+ *     arrays grow within the arena, so they are found by offset rather
+ *     than by pointer.
+ */
+typedef
+struct globus_i_dsi_rest_header_block_s
+{
+    char                               *buffer;
+    size_t                              buffer_used;
+    size_t                              buffer_len;
+    globus_i_dsi_rest_header_view_t    *views;
+    size_t                              count;
+    size_t                              views_len;
+}
+globus_i_dsi_rest_header_block_t;
+
+/**
+ * @brief Case-insensitive hash of the desired header names
+ * @details
+ *     Used by globus_dsi_rest_response to find each response header among
+ *     the desired headers with one probe instead of comparing it to each.
+ */
+typedef
+struct globus_i_dsi_rest_header_match_slot_s
+{
+    uint32_t                            hash;
+    // 0 if the slot is empty, otherwise 1 + index into desired
+    uint32_t                            index;
+}
+globus_i_dsi_rest_header_match_slot_t;
+
+typedef
+struct globus_i_dsi_rest_header_match_s
+{
+    const globus_dsi_rest_key_array_t  *desired;
+    // Open addressing table of a power of two slots
+    globus_i_dsi_rest_header_match_slot_t
+                                       *slots;
+    size_t                              mask;
+}
+globus_i_dsi_rest_header_match_t;
+
 typedef
 struct globus_i_dsi_rest_read_part_s
 {
+    // Only filled in from header_block for the response callback
     globus_dsi_rest_key_array_t         headers;
+    globus_i_dsi_rest_header_block_t    header_block;
 
     globus_dsi_rest_response_t          response_callback;
     void                               *response_callback_arg;
@@ -154,25 +454,64 @@ struct globus_i_dsi_rest_read_part_s
 }
 globus_i_dsi_rest_read_part_t;
 
+/**
+ * @brief Multipart delimiter with its search tables
+ */
+typedef
+struct globus_i_dsi_rest_delimiter_s
+{
+    char                               *string;
+    size_t                              length;
+    // KMP failure function: fallback[i] is the length of the longest
+    // proper prefix of string[0..i) which is also a suffix of it
+    size_t                             *fallback;
+    // Horspool shift for each value of the byte aligned with the end of
+    // the delimiter
+    size_t                              skip[256];
+}
+globus_i_dsi_rest_delimiter_t;
+
+enum
+{
+    // \r\n\r\n between a part's headers and its body
+    GLOBUS_I_DSI_REST_DELIMITER_HEADER_END,
+    // --${boundary}\r\n before the first part
+    GLOBUS_I_DSI_REST_DELIMITER_OPENING,
+    // \r\n--${boundary} after each part, followed by \r\n if another
+    // part follows, or by -- after the last
+    GLOBUS_I_DSI_REST_DELIMITER_BODY_END,
+    GLOBUS_I_DSI_REST_DELIMITER_COUNT
+};
+
 typedef
 struct globus_i_dsi_rest_read_multipart_arg_s
 {
+    // Arena of the request, holding the parsed part headers
+    globus_i_dsi_rest_arena_t          *arena;
     size_t                              num_parts;
     size_t                              part_index;
     globus_i_dsi_rest_read_part_t      *parts;
 
     char                               *boundary;
     size_t                              boundary_length;
+    // Set up by globus_i_dsi_rest_read_multipart_delimiters_init() once the
+    // boundary is known
+    globus_i_dsi_rest_delimiter_t       delimiters[
+                                        GLOBUS_I_DSI_REST_DELIMITER_COUNT];
 
-    char                               *boundary_buffer;
-    size_t                              boundary_buffer_length;
-    size_t                              boundary_buffer_offset;
-    
+    // Number of bytes of the current delimiter matched at the end of the
+    // data seen so far, held back until the match completes or fails
     size_t                              match_counter;
 
+    // The bytes after a body's delimiter seen so far, while need_suffix
+    char                                suffix[2];
+    size_t                              suffix_length;
+    bool                                need_suffix;
+
     bool                                need_header;
     char                               *header_buffer;
     size_t                              header_buffer_offset;
+    size_t                              header_buffer_length;
 }
 globus_i_dsi_rest_read_multipart_arg_t;
 
@@ -185,8 +524,11 @@ struct globus_i_dsi_rest_request_s
     CURL                               *handle;
     globus_result_t                     result;
     const char                         *method;
+    globus_i_dsi_rest_method_t          method_id;
     int                                 response_code;
     char                                response_reason[64];
+    // Holds the request itself and everything allocated to set it up
+    globus_i_dsi_rest_arena_t           arena;
     struct curl_slist                  *request_headers;
     char                               *complete_uri;
 
@@ -198,6 +540,8 @@ struct globus_i_dsi_rest_request_s
 
     globus_dsi_rest_response_t          response_callback;
     void                               *response_callback_arg;
+    // For globus_dsi_rest_response, which is filled in as headers arrive
+    globus_i_dsi_rest_header_match_t    desired_match;
 
     globus_dsi_rest_complete_t          complete_callback;
     void                               *complete_callback_arg;
@@ -209,6 +553,11 @@ struct globus_i_dsi_rest_request_s
 
     uint64_t                            request_content_length;
     bool                                request_content_length_set;
+    /** Body is passed to libcurl with CURLOPT_POSTFIELDS */
+    bool                                request_postfields;
+
+    /** Link in an engine thread's queue of requests to start */
+    struct globus_i_dsi_rest_request_s *engine_next;
 }
 globus_i_dsi_rest_request_t;
 
@@ -231,6 +580,22 @@ globus_i_dsi_rest_handle_get(
     CURL                              **handlep,
     void                               *callback_arg);
 
+/**
+ * @brief Set the options common to all requests on a new CURL handle
+ * @details
+ *     Sets the share, protocol, and callback function options. These are
+ *     kept when the handle is released to the cache, so this is only
+ *     called when a handle is created.
+ *
+ * @param[in] handle
+ *     The new handle.
+ * @return
+ *     CURLE_OK on success, otherwise the error from curl_easy_setopt().
+ */
+CURLcode
+globus_i_dsi_rest_handle_init(
+    CURL                               *handle);
+
 /**
  * @brief Release a CURL handle after completion of a request
  * @details
@@ -247,47 +612,400 @@ globus_i_dsi_rest_handle_release(
     CURL                               *handle);
 
 
+/**
+ * @brief Add headers to a libcurl header list
+ * @details
+ *     If arena is not NULL, the list nodes are allocated from it, and the
+ *     list must not be passed to curl_slist_free_all(). Otherwise they are
+ *     allocated by curl_slist_append().
+ */
 globus_result_t
 globus_i_dsi_rest_compute_headers(
+    globus_i_dsi_rest_arena_t          *arena,
     struct curl_slist                 **request_headers,
     const globus_dsi_rest_key_array_t  *headers);
 
+/**
+ * @brief Find the method_id of an HTTP method name
+ */
+globus_i_dsi_rest_method_t
+globus_i_dsi_rest_method_lookup(
+    const char                         *method);
+
 globus_result_t
 globus_i_dsi_rest_set_request(
     CURL                               *curl,
     const char                         *method,
+    globus_i_dsi_rest_method_t          method_id,
     const char                         *uri,
     struct curl_slist                  *headers,
     const globus_dsi_rest_callbacks_t  *callbacks);
 
 globus_result_t
 globus_i_dsi_rest_add_header(
+    globus_i_dsi_rest_arena_t          *arena,
     struct curl_slist                 **request_headers,
     const char                         *header_name,
     const char                         *header_value);
 
+/**
+ * @brief Render headers into a header set
+ * @details
+ *     Formats each header with a non-NULL key and value as a line, and
+ *     links the lines in order, allocating everything from arena.
+ */
+globus_result_t
+globus_i_dsi_rest_header_set_init(
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_header_set_t     *header_set,
+    const globus_dsi_rest_key_array_t  *headers);
+
+/**
+ * @brief Check whether headers say how the body is framed
+ * @details
+ *     Returns true if headers include Transfer-Encoding or Content-Length,
+ *     in which case the library doesn't add either.
+ */
+bool
+globus_i_dsi_rest_headers_set_length(
+    const globus_dsi_rest_key_array_t  *headers);
+
+/**
+ * @brief Start a request
+ * @details
+ *     Common to globus_dsi_rest_request() and
+ *     globus_dsi_rest_request_prepared(). The complete URI is the prepared
+ *     URI, followed by path if not NULL, the prepared query, and then
+ *     query_parameters.
+ */
+globus_result_t
+globus_i_dsi_rest_request_start(
+    const globus_i_dsi_rest_prepared_t *prepared,
+    const char                         *path,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_callbacks_t  *callbacks);
+
 globus_result_t
 globus_i_dsi_rest_perform(
     globus_i_dsi_rest_request_t        *request);
 
+globus_result_t
+globus_i_dsi_rest_perform_finish(
+    globus_i_dsi_rest_request_t        *request,
+    CURLcode                            rc);
+
+void
+globus_i_dsi_rest_perform_complete(
+    globus_i_dsi_rest_request_t        *request,
+    CURLcode                            rc);
+
+/**
+ * @brief Initialize the CURL handle cache
+ * @details
+ *     Allocates size global cache slots. If size is negative, uses
+ *     4 per CPU, but at least GLOBUS_I_DSI_REST_HANDLE_CACHE_SIZE.
+ */
+int
+globus_i_dsi_rest_handle_cache_init(
+    long                                size);
+
+/**
+ * @brief Free all cached CURL handles
+ */
+void
+globus_i_dsi_rest_handle_cache_destroy(void);
+
+/**
+ * @brief Take a cached CURL handle
+ * @details
+ *     Returns the calling thread's cached handle if it has one, otherwise
+ *     one from the global slots, otherwise NULL.
+ */
+CURL *
+globus_i_dsi_rest_handle_cache_pop(void);
+
+/**
+ * @brief Cache a CURL handle
+ * @details
+ *     Stores handle in the calling thread's slot, moving any handle already
+ *     there to the global slots. If those are full, the handle is cleaned up.
+ */
+void
+globus_i_dsi_rest_handle_cache_put(
+    CURL                               *handle);
+
+/**
+ * @brief Update counters after a request
+ * @details
+ *     Adds the connection use of the request's handle to
+ *     globus_i_dsi_rest_stats. Called before the handle is released.
+ */
+void
+globus_i_dsi_rest_stats_request_done(
+    globus_i_dsi_rest_request_t        *request);
+
+/**
+ * @brief Start the request engine threads
+ * @details
+ *     Creates globus_i_dsi_rest_engine_threads threads, each driving a
+ *     curl multi handle, to process asynchronous requests. When
+ *     globus_i_dsi_rest_engine_threads is 0, this does nothing and
+ *     asynchronous requests each run in a thread of their own.
+ */
+int
+globus_i_dsi_rest_engine_init(void);
+
+/**
+ * @brief Stop the request engine threads
+ * @details
+ *     Waits for all requests queued to the engine threads to complete, and
+ *     then stops the threads.
+ */
+void
+globus_i_dsi_rest_engine_destroy(void);
+
+/**
+ * @brief Queue an asynchronous request to an engine thread
+ * @details
+ *     The request's handle is added to an engine thread's multi handle, and
+ *     its complete callback is called from that thread.
+ */
+globus_result_t
+globus_i_dsi_rest_engine_add(
+    globus_i_dsi_rest_request_t        *request);
+
 globus_result_t
 globus_i_dsi_rest_encode_form_data(
     const globus_dsi_rest_key_array_t  *form_fields,
     char                              **form_datap);
 
+/**
+ * @brief Get the buffer to fill for a GridFTP op
+ * @details
+ *     Returns the op's current buffer, or a buffer from its free list or the
+ *     buffer pool. Returns NULL if memory is short, or if the pool's budget
+ *     is used up while the op has buffers registered with the GridFTP
+ *     server; in that case the caller should wait for one of those to come
+ *     back.
+ */
 globus_i_dsi_rest_buffer_t *
 globus_i_dsi_rest_buffer_get(
     globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg,
     size_t                              size);
 
+int
+globus_i_dsi_rest_buffer_pool_init(
+    long                                max_bytes);
+
+void
+globus_i_dsi_rest_buffer_pool_destroy(void);
+
+/**
+ * @brief Get a buffer of at least size bytes from the buffer pool
+ * @details
+ *     If allocating the buffer would exceed the pool's budget, return NULL
+ *     unless force is true. Callers pass force when they have no buffers
+ *     outstanding, so that every operation can make progress.
+ */
+globus_i_dsi_rest_buffer_t *
+globus_i_dsi_rest_buffer_pool_get(
+    size_t                              size,
+    bool                                force);
+
+void
+globus_i_dsi_rest_buffer_pool_put(
+    globus_i_dsi_rest_buffer_t         *buffer);
+
+/**
+ * @brief Return the bytes held by the buffer pool
+ * @details
+ *     Sets *allocated to the bytes in all buffers from the pool, in use or
+ *     free, and *cached to the bytes in its free lists.
+ */
+void
+globus_i_dsi_rest_buffer_pool_totals(
+    size_t                             *allocated,
+    size_t                             *cached);
+
+int
+globus_i_dsi_rest_arena_pool_init(void);
+
+void
+globus_i_dsi_rest_arena_pool_destroy(void);
+
+/**
+ * @brief Allocate size bytes from an arena
+ * @details
+ *     The memory is aligned for any type and is not initialized. Returns
+ *     NULL if memory is short.
+ */
+void *
+globus_i_dsi_rest_arena_alloc(
+    globus_i_dsi_rest_arena_t          *arena,
+    size_t                              size);
+
+void *
+globus_i_dsi_rest_arena_calloc(
+    globus_i_dsi_rest_arena_t          *arena,
+    size_t                              count,
+    size_t                              size);
+
+/**
+ * @brief Grow an allocation from an arena
+ * @details
+ *     If p, allocated with old_size bytes, is the most recent allocation
+ *     from the arena and there's room after it, it is extended in place.
+ *     Otherwise new memory is allocated and the contents of p are copied
+ *     to it; the old memory stays in the arena. Returns NULL if memory is short, leaving p as it was.
+ */
+void *
+globus_i_dsi_rest_arena_grow(
+    globus_i_dsi_rest_arena_t          *arena,
+    void                               *p,
+    size_t                              old_size,
+    size_t                              new_size);
+
+char *
+globus_i_dsi_rest_arena_strdup(
+    globus_i_dsi_rest_arena_t          *arena,
+    const char                         *s);
+
+char *
+globus_i_dsi_rest_arena_strndup(
+    globus_i_dsi_rest_arena_t          *arena,
+    const char                         *s,
+    size_t                              n);
+
+/**
+ * @brief Release everything allocated from an arena
+ * @details
+ *     Chunks of the standard size go back to the free list, and the arena
+ *     is left empty. The arena itself may be in memory allocated from it,
+ *     so callers pass a copy.
+ */
+void
+globus_i_dsi_rest_arena_release(
+    globus_i_dsi_rest_arena_t          *arena);
+
+/**
+ * @brief Build the request URI in an arena
+ * @details
+ *     Like globus_dsi_rest_uri_add_query(), except that the URI is
+ *     allocated from arena, or with malloc() if arena is NULL.
+ */
+globus_result_t
+globus_i_dsi_rest_uri_add_query(
+    globus_i_dsi_rest_arena_t          *arena,
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    char                              **complete_urip);
+
+void
+globus_i_dsi_rest_write_json_init(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    json_t                             *json);
+
+void
+globus_i_dsi_rest_write_json_destroy(
+    globus_i_dsi_rest_write_json_arg_t *jdata);
+
+globus_result_t
+globus_i_dsi_rest_write_json_length(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    uint64_t                           *lengthp);
+
+globus_result_t
+globus_i_dsi_rest_read_json_reserve(
+    globus_i_dsi_rest_read_json_arg_t  *jdata,
+    size_t                              size);
+
+globus_result_t
+globus_i_dsi_rest_read_json_pointers_init(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata,
+    const globus_dsi_rest_read_json_pointers_arg_t
+                                       *arg);
+
+void
+globus_i_dsi_rest_read_json_pointers_destroy(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata);
+
+globus_result_t
+globus_i_dsi_rest_content_range_check(
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_off_t                        offset,
+    globus_off_t                        length);
+
+globus_result_t
+globus_i_dsi_rest_read_multipart_delimiters_init(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *read_multipart);
+
 void
+globus_i_dsi_rest_read_multipart_delimiters_destroy(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *read_multipart);
+
+globus_result_t
+globus_i_dsi_rest_buffer_heap_push(
+    globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg,
+    globus_i_dsi_rest_buffer_t         *buffer);
+
+globus_i_dsi_rest_buffer_t *
+globus_i_dsi_rest_buffer_heap_pop(
+    globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg);
+
+/**
+ * @brief Length of raw_len bytes at raw once URI-escaped
+ */
+size_t
+globus_i_dsi_rest_uri_escaped_length(
+    const char                         *raw,
+    size_t                              raw_len);
+
+/**
+ * @brief URI-escape raw_len bytes at raw
+ * @details
+ *     Writes globus_i_dsi_rest_uri_escaped_length() bytes to encoded, with
+ *     no terminating NUL, and returns a pointer to the byte after them.
+ */
+char *
 globus_i_dsi_rest_uri_escape(
     const char                         *raw,
-    char                              **encodedp,
-    size_t                             *availablep);
+    size_t                              raw_len,
+    char                               *encoded);
+
+size_t
+globus_i_dsi_rest_multipart_boundary_length(
+    const char                         *delimiter,
+    bool                                final,
+    const globus_dsi_rest_key_array_t  *part_header);
 
+/**
+ * @brief Compute the length of a request body
+ * @details
+ *     If the total number of bytes that will be produced by the write
+ *     callback of part is known in advance, set the value pointed to by
+ *     lengthp to it and return true. This is the case for the write
+ *     specializations except for globus_dsi_rest_write_gridftp_op() with
+ *     a length of -1, and for multipart bodies where all parts are
+ *     known. A part without a write callback has length 0.
+ */
+bool
+globus_i_dsi_rest_write_part_length(
+    const globus_i_dsi_rest_write_part_t
+                                       *part,
+    uint64_t                           *lengthp);
+
+/**
+ * @brief Format the boundary and headers before a part, or the final boundary
+ * @details
+ *     The string is allocated from arena.
+ */
 globus_result_t
 globus_i_dsi_rest_multipart_boundary_prepare(
+    globus_i_dsi_rest_arena_t          *arena,
     const char                         *delimiter,
     bool                                final,
     globus_dsi_rest_key_array_t        *part_header,
@@ -322,12 +1040,96 @@ globus_i_dsi_rest_header(
     size_t                              nitems,
     void                               *callback_arg);
 
+/**
+ * @brief Find the key and value in a header line
+ * @details
+ *     Sets view to the key and value relative to buffer, skipping
+ *     whitespace before the value, and ending the value at the first CR
+ *     or NUL. For a line without a ':', view->key_len is 0.
+ */
+globus_result_t
+globus_i_dsi_rest_header_split(
+    const char                         *buffer,
+    size_t                              size,
+    globus_i_dsi_rest_header_view_t    *view);
+
+/**
+ * @brief Parse a header line into a header block
+ * @details
+ *     Lines without a ':' are ignored. The line is copied, so buffer
+ *     need not outlive the call.
+ */
 globus_result_t
 globus_i_dsi_rest_header_parse(
-    globus_dsi_rest_key_array_t        *headers,
-    char                               *buffer,
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_header_block_t   *header_block,
+    const char                         *buffer,
     size_t                              size);
 
+/**
+ * @brief Forget the headers in a header block, keeping its memory
+ */
+void
+globus_i_dsi_rest_header_block_reset(
+    globus_i_dsi_rest_header_block_t   *header_block);
+
+/**
+ * @brief Find the value of the first header named name, or NULL
+ */
+const char *
+globus_i_dsi_rest_header_block_find(
+    const globus_i_dsi_rest_header_block_t
+                                       *header_block,
+    const char                         *name);
+
+/**
+ * @brief Fill in a key array pointing into a header block
+ * @details
+ *     Only the array is allocated, from arena. The strings stay in the
+ *     header block.
+ */
+globus_result_t
+globus_i_dsi_rest_header_block_key_array(
+    globus_i_dsi_rest_arena_t          *arena,
+    const globus_i_dsi_rest_header_block_t
+                                       *header_block,
+    globus_dsi_rest_key_array_t        *headers);
+
+/**
+ * @brief Number of slots for matching count desired headers
+ */
+size_t
+globus_i_dsi_rest_header_match_slots(
+    size_t                              count);
+
+/**
+ * @brief Hash the desired header names into slots
+ * @details
+ *     slots must have room for globus_i_dsi_rest_header_match_slots()
+ *     entries. If a name is desired more than once, only the first is
+ *     matched.
+ */
+void
+globus_i_dsi_rest_header_match_init(
+    globus_i_dsi_rest_header_match_t   *match,
+    const globus_dsi_rest_key_array_t  *desired,
+    globus_i_dsi_rest_header_match_slot_t
+                                       *slots);
+
+/**
+ * @brief Find a header name among the desired headers
+ * @details
+ *     Returns the index of the desired header whose name matches the
+ *     key_len bytes at key, ignoring case, or SIZE_MAX if none does. The
+ *     key must not contain a NUL.
+ */
+size_t
+globus_i_dsi_rest_header_match_find(
+    const globus_i_dsi_rest_header_match_t
+                                       *match,
+    const char                         *key,
+    size_t                              key_len);
+
 size_t
 globus_i_dsi_rest_write_data(
     char                               *ptr,
@@ -358,6 +1160,8 @@ globus_i_dsi_rest_read_data(
     globus_error_put(GlobusDsiRestErrorThreadFailObject(rc))
 #define GlobusDsiRestErrorUnexpectedData(s, len) \
     globus_error_put(GlobusDsiRestErrorUnexpectedDataObject(s, len))
+#define GlobusDsiRestErrorUnexpectedResponse(code) \
+    globus_error_put(GlobusDsiRestErrorUnexpectedResponseObject(code))
 
 #define GlobusDsiRestErrorParameterObject() \
     globus_error_construct_error( \
@@ -434,6 +1238,15 @@ globus_i_dsi_rest_read_data(
         __func__, \
         __LINE__, \
         "Unexpected data failed: %.*s", (int)len, s)
+#define GlobusDsiRestErrorUnexpectedResponseObject(code) \
+    globus_error_construct_error( \
+        GLOBUS_DSI_REST_MODULE, \
+        NULL, \
+        GLOBUS_DSI_REST_ERROR_UNEXPECTED_RESPONSE, \
+        __FILE__, \
+        __func__, \
+        __LINE__, \
+        "Unexpected HTTP response code %d", code)
 
 /* Logging */
 GlobusDebugDeclare(GLOBUS_DSI_REST);
@@ -510,12 +1323,30 @@ extern const char * globus_i_dsi_rest_debug_level_names[];
         } \
     } while (0)
 
-extern globus_mutex_t                   globus_i_dsi_rest_handle_cache_mutex;
-extern size_t                           globus_i_dsi_rest_handle_cache_index;
-extern CURL                            *globus_i_dsi_rest_handle_cache[];
+extern size_t                           globus_i_dsi_rest_handle_cache_size;
+extern CURL                           **globus_i_dsi_rest_handle_cache;
 extern CURLSH                          *globus_i_dsi_rest_share;
+extern int                              globus_i_dsi_rest_engine_threads;
+extern long                             globus_i_dsi_rest_max_connects;
+extern long                             globus_i_dsi_rest_postfields_max;
+extern long                             globus_i_dsi_rest_buffer_pool_max;
+extern long                             globus_i_dsi_rest_buffer_huge_pages;
+extern long                             globus_i_dsi_rest_buffer_numa;
+extern globus_dsi_rest_stats_t          globus_i_dsi_rest_stats;
 
 enum { GLOBUS_I_DSI_REST_HANDLE_CACHE_SIZE = 16 };
+enum { GLOBUS_I_DSI_REST_ENGINE_THREADS_MAX = 64 };
+/* libcurl's default CURLOPT_UPLOAD_BUFFERSIZE */
+enum { GLOBUS_I_DSI_REST_UPLOAD_BUFFERSIZE = 64*1024 };
+/* Buffers at least this large are backed by huge pages when enabled */
+enum { GLOBUS_I_DSI_REST_HUGE_PAGE_SIZE = 2*1024*1024 };
+/* Largest Content-Length trusted to presize a JSON response buffer */
+enum { GLOBUS_I_DSI_REST_JSON_PRESIZE_MAX = 64*1024*1024 };
+/* Smallest range worth its own request in a parallel GET */
+enum { GLOBUS_I_DSI_REST_PARALLEL_RANGE_MIN = 1024*1024 };
+/* Size of a request arena chunk, and how many free ones are kept */
+enum { GLOBUS_I_DSI_REST_ARENA_CHUNK_SIZE = 8*1024 };
+enum { GLOBUS_I_DSI_REST_ARENA_POOL_MAX = 512 };
 
 #ifdef __cplusplus
 }
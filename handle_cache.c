@@ -0,0 +1,316 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file handle_cache.c GridFTP DSI REST CURL Handle Cache
+ * @details
+ *     Released handles are kept first in a slot private to the releasing
+ *     thread, and then in a fixed array of global slots. Both are updated
+ *     only with atomic exchanges, so handle get and release never block.
+ *     A lock is taken only when a thread creates its slot and when the
+ *     thread exits and its slot is freed.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+#include <unistd.h>
+
+/**
+ * @brief Per-thread handle slot
+ * @details
+ *     Allocated the first time a thread releases a handle, and freed when
+ *     the thread exits. While the thread is alive the slot is also linked
+ *     into a global list so that deactivation can free handles still held
+ *     by threads that have not exited.
+ */
+typedef
+struct globus_l_dsi_rest_handle_slot_s
+{
+    CURL                               *handle;
+    // Links in globus_l_dsi_rest_handle_slots, protected by
+    // globus_l_dsi_rest_handle_slots_mutex
+    struct globus_l_dsi_rest_handle_slot_s
+                                       *prev;
+    struct globus_l_dsi_rest_handle_slot_s
+                                       *next;
+}
+globus_l_dsi_rest_handle_slot_t;
+
+size_t                                  globus_i_dsi_rest_handle_cache_size;
+CURL                                  **globus_i_dsi_rest_handle_cache;
+static size_t                           globus_l_dsi_rest_handle_cache_count;
+static globus_thread_key_t              globus_l_dsi_rest_handle_key;
+static globus_l_dsi_rest_handle_slot_t *globus_l_dsi_rest_handle_slots;
+static globus_mutex_t                   globus_l_dsi_rest_handle_slots_mutex;
+/* Cleared at deactivation, after which the slots belong to it */
+static bool                             globus_l_dsi_rest_handle_slots_active;
+
+static
+bool
+globus_l_dsi_rest_handle_cache_push(
+    CURL                               *handle);
+
+static
+void
+globus_l_dsi_rest_handle_slot_destroy(
+    void                               *arg)
+{
+    globus_l_dsi_rest_handle_slot_t    *slot = arg;
+    CURL                               *handle;
+
+    globus_mutex_lock(&globus_l_dsi_rest_handle_slots_mutex);
+    if (!globus_l_dsi_rest_handle_slots_active)
+    {
+        /* Deactivation has already freed this slot */
+        globus_mutex_unlock(&globus_l_dsi_rest_handle_slots_mutex);
+        return;
+    }
+    if (slot->prev != NULL)
+    {
+        slot->prev->next = slot->next;
+    }
+    else
+    {
+        globus_l_dsi_rest_handle_slots = slot->next;
+    }
+    if (slot->next != NULL)
+    {
+        slot->next->prev = slot->prev;
+    }
+    handle = __atomic_exchange_n(&slot->handle, NULL, __ATOMIC_ACQ_REL);
+    if (handle != NULL && !globus_l_dsi_rest_handle_cache_push(handle))
+    {
+        curl_easy_cleanup(handle);
+    }
+    globus_mutex_unlock(&globus_l_dsi_rest_handle_slots_mutex);
+
+    free(slot);
+}
+/* globus_l_dsi_rest_handle_slot_destroy() */
+
+int
+globus_i_dsi_rest_handle_cache_init(
+    long                                size)
+{
+    int                                 rc = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (size < 0)
+    {
+        long                            ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        size = GLOBUS_I_DSI_REST_HANDLE_CACHE_SIZE;
+        if (ncpus > 0 && ncpus * 4 > size)
+        {
+            size = ncpus * 4;
+        }
+    }
+    globus_i_dsi_rest_handle_cache_size = size;
+    globus_l_dsi_rest_handle_cache_count = 0;
+    globus_l_dsi_rest_handle_slots = NULL;
+    globus_i_dsi_rest_handle_cache = NULL;
+
+    if (size > 0)
+    {
+        globus_i_dsi_rest_handle_cache = calloc(size, sizeof(CURL *));
+        if (globus_i_dsi_rest_handle_cache == NULL)
+        {
+            rc = GLOBUS_FAILURE;
+            goto cache_alloc_fail;
+        }
+    }
+    rc = globus_mutex_init(&globus_l_dsi_rest_handle_slots_mutex, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto mutex_init_fail;
+    }
+    rc = globus_thread_key_create(
+            &globus_l_dsi_rest_handle_key,
+            globus_l_dsi_rest_handle_slot_destroy);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto key_create_fail;
+    }
+    globus_l_dsi_rest_handle_slots_active = true;
+
+    if (rc != GLOBUS_SUCCESS)
+    {
+key_create_fail:
+        globus_mutex_destroy(&globus_l_dsi_rest_handle_slots_mutex);
+mutex_init_fail:
+        free(globus_i_dsi_rest_handle_cache);
+        globus_i_dsi_rest_handle_cache = NULL;
+    }
+
+cache_alloc_fail:
+    GlobusDsiRestExitInt(rc);
+    return rc;
+}
+/* globus_i_dsi_rest_handle_cache_init() */
+
+void
+globus_i_dsi_rest_handle_cache_destroy(void)
+{
+    globus_l_dsi_rest_handle_slot_t    *slot;
+
+    GlobusDsiRestEnter();
+
+    globus_thread_key_delete(globus_l_dsi_rest_handle_key);
+
+    /* Threads exiting from now on leave their slots to be freed here */
+    globus_mutex_lock(&globus_l_dsi_rest_handle_slots_mutex);
+    globus_l_dsi_rest_handle_slots_active = false;
+    slot = globus_l_dsi_rest_handle_slots;
+    globus_l_dsi_rest_handle_slots = NULL;
+    globus_mutex_unlock(&globus_l_dsi_rest_handle_slots_mutex);
+    globus_mutex_destroy(&globus_l_dsi_rest_handle_slots_mutex);
+
+    while (slot != NULL)
+    {
+        globus_l_dsi_rest_handle_slot_t *next = slot->next;
+
+        if (slot->handle != NULL)
+        {
+            curl_easy_cleanup(slot->handle);
+        }
+        free(slot);
+        slot = next;
+    }
+    for (size_t i = 0; i < globus_i_dsi_rest_handle_cache_size; i++)
+    {
+        if (globus_i_dsi_rest_handle_cache[i] != NULL)
+        {
+            curl_easy_cleanup(globus_i_dsi_rest_handle_cache[i]);
+        }
+    }
+    free(globus_i_dsi_rest_handle_cache);
+    globus_i_dsi_rest_handle_cache = NULL;
+    globus_i_dsi_rest_handle_cache_size = 0;
+
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_handle_cache_destroy() */
+
+CURL *
+globus_i_dsi_rest_handle_cache_pop(void)
+{
+    globus_l_dsi_rest_handle_slot_t    *slot;
+    CURL                               *handle = NULL;
+
+    slot = globus_thread_getspecific(globus_l_dsi_rest_handle_key);
+    if (slot != NULL)
+    {
+        handle = __atomic_exchange_n(&slot->handle, NULL, __ATOMIC_ACQ_REL);
+    }
+    if (handle != NULL
+        || __atomic_load_n(
+                &globus_l_dsi_rest_handle_cache_count, __ATOMIC_RELAXED) == 0)
+    {
+        goto done;
+    }
+    for (size_t i = 0; i < globus_i_dsi_rest_handle_cache_size; i++)
+    {
+        if (__atomic_load_n(
+                    &globus_i_dsi_rest_handle_cache[i], __ATOMIC_RELAXED)
+                == NULL)
+        {
+            continue;
+        }
+        handle = __atomic_exchange_n(
+                &globus_i_dsi_rest_handle_cache[i], NULL, __ATOMIC_ACQ_REL);
+        if (handle != NULL)
+        {
+            __atomic_fetch_sub(
+                    &globus_l_dsi_rest_handle_cache_count, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+done:
+    return handle;
+}
+/* globus_i_dsi_rest_handle_cache_pop() */
+
+static
+bool
+globus_l_dsi_rest_handle_cache_push(
+    CURL                               *handle)
+{
+    for (size_t i = 0; i < globus_i_dsi_rest_handle_cache_size; i++)
+    {
+        CURL                           *expected = NULL;
+
+        if (__atomic_load_n(
+                    &globus_i_dsi_rest_handle_cache[i], __ATOMIC_RELAXED)
+                != NULL)
+        {
+            continue;
+        }
+        if (__atomic_compare_exchange_n(
+                &globus_i_dsi_rest_handle_cache[i],
+                &expected,
+                handle,
+                false,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_RELAXED))
+        {
+            __atomic_fetch_add(
+                    &globus_l_dsi_rest_handle_cache_count, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+    return false;
+}
+/* globus_l_dsi_rest_handle_cache_push() */
+
+void
+globus_i_dsi_rest_handle_cache_put(
+    CURL                               *handle)
+{
+    globus_l_dsi_rest_handle_slot_t    *slot;
+
+    slot = globus_thread_getspecific(globus_l_dsi_rest_handle_key);
+    if (slot == NULL)
+    {
+        slot = calloc(1, sizeof(globus_l_dsi_rest_handle_slot_t));
+        if (slot == NULL
+            || globus_thread_setspecific(
+                    globus_l_dsi_rest_handle_key, slot) != GLOBUS_SUCCESS)
+        {
+            free(slot);
+            goto push;
+        }
+        globus_mutex_lock(&globus_l_dsi_rest_handle_slots_mutex);
+        slot->next = globus_l_dsi_rest_handle_slots;
+        if (slot->next != NULL)
+        {
+            slot->next->prev = slot;
+        }
+        globus_l_dsi_rest_handle_slots = slot;
+        globus_mutex_unlock(&globus_l_dsi_rest_handle_slots_mutex);
+    }
+    /* If this thread's slot was full, move its old handle to the shared ones */
+    handle = __atomic_exchange_n(&slot->handle, handle, __ATOMIC_ACQ_REL);
+
+push:
+    if (handle != NULL && !globus_l_dsi_rest_handle_cache_push(handle))
+    {
+        curl_easy_cleanup(handle);
+    }
+}
+/* globus_i_dsi_rest_handle_cache_put() */
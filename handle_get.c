@@ -33,105 +33,25 @@ globus_i_dsi_rest_handle_get(
 
     GlobusDsiRestEnter();
 
-    globus_mutex_lock(&globus_i_dsi_rest_handle_cache_mutex);
-    if (globus_i_dsi_rest_handle_cache_index > 0)
-    {
-        curl = globus_i_dsi_rest_handle_cache[--globus_i_dsi_rest_handle_cache_index];
-    }
-    globus_mutex_unlock(&globus_i_dsi_rest_handle_cache_mutex);
+    curl = globus_i_dsi_rest_handle_cache_pop();
 
     if (curl == NULL)
     {
         curl = curl_easy_init();
-    }
-
-    if (curl == NULL)
-    {
-        rc = CURLE_OUT_OF_MEMORY;
-        goto curlopt_init_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_SHARE, globus_i_dsi_rest_share);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_HEADER, 0L);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-#ifndef LIBCURL_NO_CURLPROTO
-    rc = curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTPS|CURLPROTO_HTTP);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_PROTOCOLS, CURLPROTO_HTTPS|CURLPROTO_HTTP);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-#endif
-#if LIBCURL_VERSION_NUM >= 0x072000
-    rc = curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, globus_i_dsi_rest_xferinfo);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-#else
-    rc = curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, globus_i_dsi_rest_progress);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-#endif
-    rc = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, globus_i_dsi_rest_header);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, globus_i_dsi_rest_write_data);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    rc = curl_easy_setopt(curl, CURLOPT_READFUNCTION, globus_i_dsi_rest_read_data);
-    if (rc != CURLE_OK)
-    {
-        goto curlopt_fail;
-    }
-    /*
-     * TODO: any benefit from using CURLOPT_SHARE for TLS session reuse with
-     * REST Apis?
-     */
 
-    /* Options below are request specific, all others are generic and
-     * can maybe live between curl_easy_perform()s if we cache CURL* values.
+        if (curl == NULL)
+        {
+            rc = CURLE_OUT_OF_MEMORY;
+            goto curlopt_init_fail;
+        }
+        rc = globus_i_dsi_rest_handle_init(curl);
+        if (rc != CURLE_OK)
+        {
+            goto curlopt_fail;
+        }
+    }
+    /* Options below are request specific. The generic ones set by
+     * globus_i_dsi_rest_handle_init() are kept by cached handles.
      */
 #if LIBCURL_VERSION_NUM >= 0x072000
     rc = curl_easy_setopt(curl, CURLOPT_XFERINFODATA, callback_arg);
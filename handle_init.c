@@ -0,0 +1,120 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file handle_init.c GridFTP DSI REST Handle Generic Options
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+CURLcode
+globus_i_dsi_rest_handle_init(
+    CURL                               *curl)
+{
+    CURLcode                            rc;
+
+    GlobusDsiRestEnter();
+
+    rc = curl_easy_setopt(curl, CURLOPT_SHARE, globus_i_dsi_rest_share);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_HEADER, 0L);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_MAXCONNECTS,
+            globus_i_dsi_rest_max_connects);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+#ifndef LIBCURL_NO_CURLPROTO
+    rc = curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTPS|CURLPROTO_HTTP);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_PROTOCOLS, CURLPROTO_HTTPS|CURLPROTO_HTTP);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072000
+    rc = curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, globus_i_dsi_rest_xferinfo);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+#else
+    rc = curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, globus_i_dsi_rest_progress);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+#endif
+    rc = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, globus_i_dsi_rest_header);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, globus_i_dsi_rest_write_data);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+    rc = curl_easy_setopt(curl, CURLOPT_READFUNCTION, globus_i_dsi_rest_read_data);
+    if (rc != CURLE_OK)
+    {
+        goto curlopt_fail;
+    }
+
+curlopt_fail:
+    GlobusDsiRestExitInt(rc);
+
+    return rc;
+}
+/* globus_i_dsi_rest_handle_init() */
@@ -28,27 +28,44 @@ globus_i_dsi_rest_handle_release(
 {
     GlobusDsiRestEnter();
 
-    if (handle != NULL)
+    if (handle == NULL)
     {
-        curl_easy_reset(handle);
+        goto done;
     }
-
-    globus_mutex_lock(&globus_i_dsi_rest_handle_cache_mutex);
-    if (globus_i_dsi_rest_handle_cache_index < GLOBUS_I_DSI_REST_HANDLE_CACHE_SIZE)
-    {
-        if (handle != NULL)
-        {
-            globus_i_dsi_rest_handle_cache[
-                    globus_i_dsi_rest_handle_cache_index++] = handle;
-            handle = NULL;
-        }
-    }
-    globus_mutex_unlock(&globus_i_dsi_rest_handle_cache_mutex);
-
-    if (handle != NULL)
+    /*
+     * Only clear the options that a request sets, so that the generic
+     * options from globus_i_dsi_rest_handle_init() survive in the cache.
+     * Pointers into the request must not outlive it.
+     */
+    if (curl_easy_setopt(handle, CURLOPT_POSTFIELDS, NULL) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, NULL) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_URL, NULL) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_HTTPHEADER, NULL) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_INFILESIZE_LARGE,
+                (curl_off_t) -1) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE,
+                (curl_off_t) -1) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_PRIVATE, NULL) != CURLE_OK
+#if LIBCURL_VERSION_NUM >= 0x073e00
+        || curl_easy_setopt(handle, CURLOPT_UPLOAD_BUFFERSIZE,
+                (long) GLOBUS_I_DSI_REST_UPLOAD_BUFFERSIZE) != CURLE_OK
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072000
+        || curl_easy_setopt(handle, CURLOPT_XFERINFODATA, NULL) != CURLE_OK
+#else
+        || curl_easy_setopt(handle, CURLOPT_PROGRESSDATA, NULL) != CURLE_OK
+#endif
+        || curl_easy_setopt(handle, CURLOPT_HEADERDATA, NULL) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_WRITEDATA, NULL) != CURLE_OK
+        || curl_easy_setopt(handle, CURLOPT_READDATA, NULL) != CURLE_OK)
     {
         curl_easy_cleanup(handle);
+        goto done;
     }
+    globus_i_dsi_rest_handle_cache_put(handle);
+
+done:
 
     GlobusDsiRestExit();
     return;
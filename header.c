@@ -22,6 +22,73 @@
 
 #include "globus_i_dsi_rest.h"
 
+/**
+ * @brief Copy a header's value if globus_dsi_rest_response wants it
+ * @details
+ *     The value is copied straight from libcurl's buffer for the caller
+ *     to free, and nothing is kept of headers which aren't desired.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_header_desired(
+    globus_i_dsi_rest_request_t        *request,
+    const char                         *buffer,
+    size_t                              size)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_i_dsi_rest_header_view_t     view;
+    globus_dsi_rest_key_value_t        *desired;
+    size_t                              i;
+
+    result = globus_i_dsi_rest_header_split(buffer, size, &view);
+    if (result != GLOBUS_SUCCESS || view.key_len == 0)
+    {
+        goto done;
+    }
+    i = globus_i_dsi_rest_header_match_find(
+            &request->desired_match,
+            buffer + view.key_offset,
+            view.key_len);
+    if (i == SIZE_MAX)
+    {
+        goto done;
+    }
+    desired = &request->desired_match.desired->key_value[i];
+    if (desired->value != NULL)
+    {
+        /* Only the first of repeated headers is kept */
+        goto done;
+    }
+    desired->value = strndup(buffer + view.value_offset, view.value_len);
+    if (desired->value == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+    }
+
+done:
+    return result;
+}
+/* globus_l_dsi_rest_header_desired() */
+
+/**
+ * @brief Forget the desired headers of a 100 Continue response
+ */
+static
+void
+globus_l_dsi_rest_header_desired_reset(
+    globus_i_dsi_rest_request_t        *request)
+{
+    const globus_dsi_rest_key_array_t  *desired;
+
+    desired = request->desired_match.desired;
+    for (size_t i = 0; i < desired->count; i++)
+    {
+        free((char *) desired->key_value[i].value);
+        desired->key_value[i].value = NULL;
+    }
+}
+/* globus_l_dsi_rest_header_desired_reset() */
+
 size_t
 globus_i_dsi_rest_header(
     char                               *buffer,
@@ -59,6 +126,35 @@ globus_i_dsi_rest_header(
         GlobusDsiRestDebug("%.*s", (int) (size*nitems), buffer); 
     }
 
+    if (request->read_part.data_read_callback == globus_dsi_rest_read_json
+        && request->response_code != 100
+        && memcmp(buffer, "\r\n", 2) == 0)
+    {
+        /* Presize the JSON buffer to hold the whole body */
+#if LIBCURL_VERSION_NUM >= 0x073700
+        curl_off_t                      content_length = -1;
+
+        curl_easy_getinfo(request->handle,
+                CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+#else
+        double                          content_length = -1;
+
+        curl_easy_getinfo(request->handle,
+                CURLINFO_CONTENT_LENGTH_DOWNLOAD, &content_length);
+#endif
+        if (content_length > 0)
+        {
+            if (content_length > GLOBUS_I_DSI_REST_JSON_PRESIZE_MAX)
+            {
+                content_length = GLOBUS_I_DSI_REST_JSON_PRESIZE_MAX;
+            }
+            /* Only a hint, so a failure here is left to the read callback */
+            (void) globus_i_dsi_rest_read_json_reserve(
+                request->read_part.data_read_callback_arg,
+                (size_t) content_length);
+        }
+    }
+
     if (request->response_callback == NULL
         && request->read_part.data_read_callback
             != globus_dsi_rest_read_multipart)
@@ -67,10 +163,21 @@ globus_i_dsi_rest_header(
         goto done;
     }
 
-    result = globus_i_dsi_rest_header_parse(
-        &request->read_part.headers,
-        buffer,
-        total);
+    if (request->response_callback == globus_dsi_rest_response)
+    {
+        result = globus_l_dsi_rest_header_desired(request, buffer, total);
+    }
+    if (result == GLOBUS_SUCCESS
+        && (request->response_callback != globus_dsi_rest_response
+            || request->read_part.data_read_callback
+                == globus_dsi_rest_read_multipart))
+    {
+        result = globus_i_dsi_rest_header_parse(
+            &request->arena,
+            &request->read_part.header_block,
+            buffer,
+            total);
+    }
 
     if (result != GLOBUS_SUCCESS)
     {
@@ -90,14 +197,12 @@ globus_i_dsi_rest_header(
              */
             request->response_code = 0;
             request->response_reason[0] = 0;
-            for (size_t i = 0; i < request->read_part.headers.count; i++)
+            globus_i_dsi_rest_header_block_reset(
+                    &request->read_part.header_block);
+            if (request->response_callback == globus_dsi_rest_response)
             {
-                free((char *) request->read_part.headers.key_value[i].key);
-                free((char *) request->read_part.headers.key_value[i].value);
+                globus_l_dsi_rest_header_desired_reset(request);
             }
-            free(request->read_part.headers.key_value);
-            request->read_part.headers.key_value = NULL;
-            request->read_part.headers.count = 0;
         }
         else
         {
@@ -105,8 +210,26 @@ globus_i_dsi_rest_header(
                                        *response
                                       = request->response_callback_arg;
 
+            if (request->request_postfields)
+            {
+                /* The read callback didn't count the bytes libcurl sent */
+#if LIBCURL_VERSION_NUM >= 0x073700
+                curl_off_t      uploaded = 0;
+
+                curl_easy_getinfo(request->handle,
+                        CURLINFO_SIZE_UPLOAD_T, &uploaded);
+#else
+                double          uploaded = 0;
+
+                curl_easy_getinfo(request->handle,
+                        CURLINFO_SIZE_UPLOAD, &uploaded);
+#endif
+                request->request_bytes_uploaded = (off_t) uploaded;
+            }
             if (request->response_callback == globus_dsi_rest_response)
             {
+                /* Its desired headers were filled in as they arrived */
+                response->response_code = request->response_code;
                 response->request_bytes_uploaded =
                         request->request_bytes_uploaded;
                 response->response_bytes_downloaded =
@@ -115,50 +238,50 @@ globus_i_dsi_rest_header(
             if (request->read_part.data_read_callback
                 == globus_dsi_rest_read_multipart)
             {
+                const char             *content_type;
                 const char             *boundary = NULL;
                 const char             *boundary_end = NULL;
                 globus_i_dsi_rest_read_multipart_arg_t
                                        *read_multipart
                                        = request->read_part.data_read_callback_arg;
 
-                for (size_t i = 0; i < request->read_part.headers.count; i++)
+                content_type = globus_i_dsi_rest_header_block_find(
+                        &request->read_part.header_block,
+                        "Content-Type");
+                if (content_type != NULL
+                    && strncasecmp(
+                        content_type,
+                        "multipart/",
+                        strlen("multipart/")) == 0)
+                {
+                    boundary = strcasestr(content_type, "boundary=");
+                }
+                if (boundary != NULL)
                 {
-                    if (strcasecmp(
-                            request->read_part.headers.key_value[i].key,
-                            "Content-Type") == 0
-                        && strncasecmp(
-                            request->read_part.headers.key_value[i].value,
-                            "multipart/",
-                            strlen("multipart/")) == 0)
+                    boundary += strlen("boundary=");
+                    if (*boundary == '"')
                     {
-                        boundary = strcasestr(
-                            request->read_part.headers.key_value[i].value,
-                            "boundary=");
-                        boundary += strlen("boundary=");
-                        if (*boundary == '"')
+                        boundary++;
+                        for (size_t b = 0; boundary[b] != 0; b++)
                         {
-                            boundary++;
-                            for (size_t b = 0; boundary[b] != 0; b++)
+                            if (boundary[b] == '"')
+                            {
+                                boundary_end = &boundary[b-1];
+                            }
+                            if (boundary[b] == '\\')
                             {
-                                if (boundary[b] == '"')
-                                {
-                                    boundary_end = &boundary[b-1];
-                                }
-                                if (boundary[b] == '\\')
-                                {
-                                    b++;
-                                }
+                                b++;
                             }
                         }
-                        else
+                    }
+                    else
+                    {
+                        for (size_t b = 0; boundary[b] != 0; b++)
                         {
-                            for (size_t b = 0; boundary[b] != 0; b++)
+                            if (isspace(boundary[b]))
                             {
-                                if (isspace(boundary[b]))
-                                {
-                                    boundary_end = &boundary[b-1];
-                                    break;
-                                }
+                                boundary_end = &boundary[b-1];
+                                break;
                             }
                         }
                     }
@@ -168,30 +291,45 @@ globus_i_dsi_rest_header(
                     if (boundary_end != NULL)
                     {
                         read_multipart->boundary =
-                            globus_common_create_string(
-                                "%.*s",
-                                (int) (boundary_end - boundary),
-                                boundary);
+                            globus_i_dsi_rest_arena_strndup(
+                                &request->arena,
+                                boundary,
+                                boundary_end - boundary);
                     }
                     else
                     {
                         read_multipart->boundary =
-                            globus_common_create_string(
-                                "%s", boundary);
+                            globus_i_dsi_rest_arena_strdup(
+                                &request->arena,
+                                boundary);
+                    }
+                    if (read_multipart->boundary == NULL)
+                    {
+                        result = GlobusDsiRestErrorMemory();
+                        goto done;
                     }
 
                     read_multipart->boundary_length = strlen(
                         read_multipart->boundary);
-                    /* \r\n--boundary--\r\n\0 */
-                    read_multipart->boundary_buffer_length = 
-                        read_multipart->boundary_length + 9;
-                    read_multipart->boundary_buffer = malloc(
-                        read_multipart->boundary_buffer_length);
-                    read_multipart->boundary_buffer_offset = 0;
+                    result = globus_i_dsi_rest_read_multipart_delimiters_init(
+                        read_multipart);
+                    if (result != GLOBUS_SUCCESS)
+                    {
+                        goto done;
+                    }
                 }
             }
-            if (request->response_callback != NULL)
+            if (request->response_callback != NULL
+                && request->response_callback != globus_dsi_rest_response)
             {
+                result = globus_i_dsi_rest_header_block_key_array(
+                    &request->arena,
+                    &request->read_part.header_block,
+                    &request->read_part.headers);
+                if (result != GLOBUS_SUCCESS)
+                {
+                    goto done;
+                }
                 result = request->response_callback(
                     request->response_callback_arg,
                     request->response_code,
@@ -0,0 +1,150 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file header_match.c GridFTP DSI REST Desired Header Hash
+ * @details
+ *     An open addressing table of the desired header names, hashed with
+ *     FNV-1a over the names with ASCII letters folded to lower case. A
+ *     received header is then looked up with one hash of its name and
+ *     usually one comparison, however many headers are desired.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+static
+uint32_t
+globus_l_dsi_rest_header_match_hash(
+    const char                         *key,
+    size_t                              key_len)
+{
+    uint32_t                            hash = 2166136261u;
+
+    for (size_t i = 0; i < key_len; i++)
+    {
+        /* Folds letters to lower case; other bytes collide harmlessly */
+        hash ^= (unsigned char) key[i] | 0x20;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+/* globus_l_dsi_rest_header_match_hash() */
+
+size_t
+globus_i_dsi_rest_header_match_slots(
+    size_t                              count)
+{
+    size_t                              slots = 8;
+
+    /* At most half full, so probes stay short */
+    while (slots < 2 * count)
+    {
+        slots *= 2;
+    }
+    return slots;
+}
+/* globus_i_dsi_rest_header_match_slots() */
+
+void
+globus_i_dsi_rest_header_match_init(
+    globus_i_dsi_rest_header_match_t   *match,
+    const globus_dsi_rest_key_array_t  *desired,
+    globus_i_dsi_rest_header_match_slot_t
+                                       *slots)
+{
+    size_t                              nslots;
+
+    nslots = globus_i_dsi_rest_header_match_slots(desired->count);
+    memset(slots, 0, nslots * sizeof(globus_i_dsi_rest_header_match_slot_t));
+
+    *match = (globus_i_dsi_rest_header_match_t)
+    {
+        .desired = desired,
+        .slots = slots,
+        .mask = nslots - 1,
+    };
+
+    for (size_t i = 0; i < desired->count && i < UINT32_MAX; i++)
+    {
+        const char                     *key = desired->key_value[i].key;
+        size_t                          key_len;
+        uint32_t                        hash;
+        size_t                          s;
+
+        if (key == NULL)
+        {
+            continue;
+        }
+        key_len = strlen(key);
+        if (globus_i_dsi_rest_header_match_find(match, key, key_len)
+                != SIZE_MAX)
+        {
+            /* Already desired */
+            continue;
+        }
+        hash = globus_l_dsi_rest_header_match_hash(key, key_len);
+        for (s = hash & match->mask;
+             slots[s].index != 0;
+             s = (s + 1) & match->mask)
+        {
+        }
+        slots[s] = (globus_i_dsi_rest_header_match_slot_t)
+        {
+            .hash = hash,
+            .index = i + 1,
+        };
+    }
+}
+/* globus_i_dsi_rest_header_match_init() */
+
+size_t
+globus_i_dsi_rest_header_match_find(
+    const globus_i_dsi_rest_header_match_t
+                                       *match,
+    const char                         *key,
+    size_t                              key_len)
+{
+    uint32_t                            hash;
+
+    if (match->slots == NULL)
+    {
+        return SIZE_MAX;
+    }
+    hash = globus_l_dsi_rest_header_match_hash(key, key_len);
+
+    for (size_t s = hash & match->mask;
+         match->slots[s].index != 0;
+         s = (s + 1) & match->mask)
+    {
+        if (match->slots[s].hash == hash)
+        {
+            size_t                      i = match->slots[s].index - 1;
+            const char                 *desired;
+
+            desired = match->desired->key_value[i].key;
+            if (strncasecmp(desired, key, key_len) == 0
+                && desired[key_len] == 0)
+            {
+                return i;
+            }
+        }
+    }
+    return SIZE_MAX;
+}
+/* globus_i_dsi_rest_header_match_find() */
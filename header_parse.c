@@ -16,80 +16,257 @@
 
 #ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
 /**
- * @file header.c GridFTP DSI REST Header callback
+ * @file header_parse.c GridFTP DSI REST Header Parser
+ * @details
+ *     Header lines are copied into a buffer in the request arena, which
+ *     grows in place while nothing else is allocated between lines, and so
+ *     usually needs no copying. The key and value are NUL-terminated where
+ *     they lie in the copy, and their offsets recorded in a view. A key
+ *     array pointing at them is only built when a response callback needs
+ *     one.
  */
 #endif
 
 #include "globus_i_dsi_rest.h"
 
+enum
+{
+    GLOBUS_L_DSI_REST_HEADER_BUFFER_SIZE = 1024,
+    GLOBUS_L_DSI_REST_HEADER_VIEWS = 16
+};
+
+globus_result_t
+globus_i_dsi_rest_header_split(
+    const char                         *buffer,
+    size_t                              size,
+    globus_i_dsi_rest_header_view_t    *view)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    const char                         *colon;
+    const char                         *end;
+    size_t                              key_len;
+    size_t                              v;
+    size_t                              value_end;
+
+    *view = (globus_i_dsi_rest_header_view_t) {0};
+
+    colon = memchr(buffer, ':', size);
+    if (colon == NULL)
+    {
+        /* Not a header, like the blank line at the end of them */
+        goto done;
+    }
+    if (colon == buffer)
+    {
+        result = GlobusDsiRestErrorParse(buffer);
+        goto done;
+    }
+    if (size >= UINT32_MAX)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+
+    /* The header line may contain a NUL, which ends the string */
+    key_len = colon - buffer;
+    end = memchr(buffer, 0, key_len);
+    if (end != NULL)
+    {
+        key_len = end - buffer;
+    }
+
+    v = (colon - buffer) + 1;
+    while (v < size
+        && (buffer[v] == ' ' || buffer[v] == '\t'
+            || buffer[v] == '\r' || buffer[v] == '\n'))
+    {
+        v++;
+    }
+    /* The value ends at the first CR or NUL */
+    value_end = size;
+    end = memchr(buffer + v, '\r', size - v);
+    if (end != NULL)
+    {
+        value_end = end - buffer;
+    }
+    end = memchr(buffer + v, 0, value_end - v);
+    if (end != NULL)
+    {
+        value_end = end - buffer;
+    }
+
+    *view = (globus_i_dsi_rest_header_view_t)
+    {
+        .key_offset = 0,
+        .key_len = key_len,
+        .value_offset = v,
+        .value_len = value_end - v,
+    };
+
+done:
+    return result;
+}
+/* globus_i_dsi_rest_header_split() */
+
 globus_result_t
 globus_i_dsi_rest_header_parse(
-    globus_dsi_rest_key_array_t        *headers,
-    char                               *buffer,
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_header_block_t   *header_block,
+    const char                         *buffer,
     size_t                              size)
 {
     globus_result_t                     result = GLOBUS_SUCCESS;
-    const size_t                        HEADER_ALLOC_CHUNK_SIZE = 8;
-    char                               *k, *v;
-    char                               *kstring, *vstring;
+    globus_i_dsi_rest_header_view_t     view;
+    char                               *line;
 
     GlobusDsiRestEnter();
 
-    if (headers->key_value == NULL
-        || (headers->count > 0 &&
-            headers->count % HEADER_ALLOC_CHUNK_SIZE) == 0)
+    result = globus_i_dsi_rest_header_split(buffer, size, &view);
+    if (result != GLOBUS_SUCCESS || view.key_len == 0)
     {
-        size_t                          count;
-        globus_dsi_rest_key_value_t    *tmp;
+        goto done;
+    }
+    if (size >= UINT32_MAX - header_block->buffer_used)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
 
-        count = headers->count;
+    if (header_block->buffer_len - header_block->buffer_used < size + 1)
+    {
+        size_t                          new_len = header_block->buffer_len * 2;
+        char                           *tmp;
 
-        tmp = realloc(headers->key_value,
-                (count  + HEADER_ALLOC_CHUNK_SIZE)
-                * sizeof(globus_dsi_rest_key_value_t));
+        if (new_len < GLOBUS_L_DSI_REST_HEADER_BUFFER_SIZE)
+        {
+            new_len = GLOBUS_L_DSI_REST_HEADER_BUFFER_SIZE;
+        }
+        if (new_len < header_block->buffer_used + size + 1)
+        {
+            new_len = header_block->buffer_used + size + 1;
+        }
+        tmp = globus_i_dsi_rest_arena_grow(
+                arena,
+                header_block->buffer,
+                header_block->buffer_len,
+                new_len);
         if (tmp == NULL)
         {
             result = GlobusDsiRestErrorMemory();
-
             goto done;
         }
-        headers->key_value = tmp;
+        header_block->buffer = tmp;
+        header_block->buffer_len = new_len;
     }
-
-    if (memchr(buffer, ':', size) != NULL)
+    if (header_block->count == header_block->views_len)
     {
-        k = buffer;
-        v = memchr(k, ':', size);
-        if (v == NULL || k == v)
+        size_t                          new_len = header_block->views_len * 2;
+        globus_i_dsi_rest_header_view_t *tmp;
+
+        if (new_len < GLOBUS_L_DSI_REST_HEADER_VIEWS)
         {
-            result = GlobusDsiRestErrorParse(buffer);
+            new_len = GLOBUS_L_DSI_REST_HEADER_VIEWS;
+        }
+        tmp = globus_i_dsi_rest_arena_grow(
+                arena,
+                header_block->views,
+                header_block->views_len
+                    * sizeof(globus_i_dsi_rest_header_view_t),
+                new_len * sizeof(globus_i_dsi_rest_header_view_t));
+        if (tmp == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
             goto done;
         }
-        kstring = malloc(v-k+1);
-        snprintf(kstring, v-k+1, "%s", k);
+        header_block->views = tmp;
+        header_block->views_len = new_len;
+    }
 
-        v++;
-        while (*v == ' ' || *v == '\t' || *v == '\r' || *v == '\n')
+    line = header_block->buffer + header_block->buffer_used;
+    memcpy(line, buffer, size);
+    line[view.key_len] = 0;
+    line[view.value_offset + view.value_len] = 0;
+
+    view.key_offset += header_block->buffer_used;
+    view.value_offset += header_block->buffer_used;
+    header_block->views[header_block->count++] = view;
+    header_block->buffer_used += size + 1;
+
+done:
+    GlobusDsiRestExitResult(result);
+
+    return result;
+}
+/* globus_i_dsi_rest_header_parse() */
+
+void
+globus_i_dsi_rest_header_block_reset(
+    globus_i_dsi_rest_header_block_t   *header_block)
+{
+    header_block->buffer_used = 0;
+    header_block->count = 0;
+}
+/* globus_i_dsi_rest_header_block_reset() */
+
+const char *
+globus_i_dsi_rest_header_block_find(
+    const globus_i_dsi_rest_header_block_t
+                                       *header_block,
+    const char                         *name)
+{
+    size_t                              name_len = strlen(name);
+
+    for (size_t i = 0; i < header_block->count; i++)
+    {
+        const globus_i_dsi_rest_header_view_t
+                                       *view = &header_block->views[i];
+
+        if (view->key_len == name_len
+            && strcasecmp(header_block->buffer + view->key_offset, name) == 0)
         {
-            v++;
+            return header_block->buffer + view->value_offset;
         }
-        vstring = malloc(size - (v-buffer) + 1);
-        snprintf(vstring, size - (v-buffer) + 1, "%s", v);
-        if ((v = strchr(vstring, '\r')) != NULL)
+    }
+    return NULL;
+}
+/* globus_i_dsi_rest_header_block_find() */
+
+globus_result_t
+globus_i_dsi_rest_header_block_key_array(
+    globus_i_dsi_rest_arena_t          *arena,
+    const globus_i_dsi_rest_header_block_t
+                                       *header_block,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_dsi_rest_key_value_t        *key_value = NULL;
+
+    if (header_block->count > 0)
+    {
+        key_value = globus_i_dsi_rest_arena_alloc(
+                arena,
+                header_block->count * sizeof(globus_dsi_rest_key_value_t));
+        if (key_value == NULL)
         {
-            *v = 0;
+            result = GlobusDsiRestErrorMemory();
+            goto done;
         }
-
-        headers->key_value[headers->count++] = (globus_dsi_rest_key_value_t)
+    }
+    for (size_t i = 0; i < header_block->count; i++)
+    {
+        key_value[i] = (globus_dsi_rest_key_value_t)
         {
-            .key = kstring,
-            .value = vstring
+            .key = header_block->buffer + header_block->views[i].key_offset,
+            .value = header_block->buffer + header_block->views[i].value_offset,
         };
     }
+    *headers = (globus_dsi_rest_key_array_t)
+    {
+        .count = header_block->count,
+        .key_value = key_value,
+    };
 
 done:
-    GlobusDsiRestExitResult(result);
-
     return result;
 }
-/* globus_i_dsi_rest_header_parse() */
+/* globus_i_dsi_rest_header_block_key_array() */
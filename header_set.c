@@ -0,0 +1,153 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file header_set.c GridFTP DSI REST Header Set
+ * @details
+ *     A header set holds the libcurl list of its "Key: Value" lines, each
+ *     node allocated next to its line. A request using the set links the
+ *     end of its own list to the set's list just before handing it to
+ *     libcurl, so nothing in the set is formatted, copied, or modified.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+globus_result_t
+globus_i_dsi_rest_header_set_init(
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_header_set_t     *header_set,
+    const globus_dsi_rest_key_array_t  *headers)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    struct curl_slist                 **lastp = &header_set->lines;
+
+    GlobusDsiRestEnter();
+
+    header_set->lines = NULL;
+    header_set->set_length = false;
+
+    for (size_t i = 0; headers != NULL && i < headers->count; i++)
+    {
+        const char                     *key = headers->key_value[i].key;
+        const char                     *value = headers->key_value[i].value;
+        struct curl_slist              *node;
+        size_t                          key_len;
+        size_t                          value_len;
+
+        /* Allow NULL key or value for placeholders that aren't used */
+        if (key == NULL || value == NULL)
+        {
+            continue;
+        }
+        key_len = strlen(key);
+        value_len = strlen(value);
+
+        node = globus_i_dsi_rest_arena_alloc(
+                arena, sizeof(*node) + key_len + value_len + 3);
+        if (node == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto error_memory;
+        }
+        node->data = (char *) (node + 1);
+        node->next = NULL;
+        memcpy(node->data, key, key_len);
+        memcpy(node->data + key_len, ": ", 2);
+        memcpy(node->data + key_len + 2, value, value_len + 1);
+
+        *lastp = node;
+        lastp = &node->next;
+    }
+    header_set->set_length = (headers != NULL)
+            && globus_i_dsi_rest_headers_set_length(headers);
+
+error_memory:
+    GlobusDsiRestExitResult(result);
+
+    return result;
+}
+/* globus_i_dsi_rest_header_set_init() */
+
+globus_result_t
+globus_dsi_rest_header_set_create(
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_dsi_rest_header_set_t       *header_setp)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_i_dsi_rest_arena_t           arena = {0};
+    globus_i_dsi_rest_header_set_t     *header_set = NULL;
+
+    GlobusDsiRestEnter();
+
+    if (header_setp == NULL)
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_params;
+    }
+
+    /* The set is the first thing in its own arena */
+    header_set = globus_i_dsi_rest_arena_alloc(
+            &arena, sizeof(globus_i_dsi_rest_header_set_t));
+    if (header_set == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto header_set_alloc_fail;
+    }
+    header_set->arena = arena;
+
+    result = globus_i_dsi_rest_header_set_init(
+            &header_set->arena,
+            header_set,
+            headers);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto init_fail;
+    }
+    *header_setp = header_set;
+
+    if (result != GLOBUS_SUCCESS)
+    {
+init_fail:
+        arena = header_set->arena;
+        globus_i_dsi_rest_arena_release(&arena);
+    }
+header_set_alloc_fail:
+bad_params:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_header_set_create() */
+
+void
+globus_dsi_rest_header_set_destroy(
+    globus_dsi_rest_header_set_t        header_set)
+{
+    globus_i_dsi_rest_arena_t           arena;
+
+    GlobusDsiRestEnter();
+
+    if (header_set != NULL)
+    {
+        arena = header_set->arena;
+        globus_i_dsi_rest_arena_release(&arena);
+    }
+
+    GlobusDsiRestExit();
+}
+/* globus_dsi_rest_header_set_destroy() */
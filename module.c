@@ -17,6 +17,9 @@
 #include "globus_i_dsi_rest.h"
 #include "version.h"
 
+#include <errno.h>
+#include <limits.h>
+
 const char *                            globus_i_dsi_rest_debug_level_names[] =
 {
     [GLOBUS_DSI_REST_DATA]            = "DATA",
@@ -27,14 +30,14 @@ const char *                            globus_i_dsi_rest_debug_level_names[] =
     [GLOBUS_DSI_REST_ERROR]           = "ERROR"
 };
 
-globus_mutex_t                          globus_i_dsi_rest_handle_cache_mutex;
-size_t                                  globus_i_dsi_rest_handle_cache_index;
-CURL                                   *globus_i_dsi_rest_handle_cache[GLOBUS_I_DSI_REST_HANDLE_CACHE_SIZE];
 CURLSH                                 *globus_i_dsi_rest_share;
 static globus_rw_mutex_t                globus_l_dsi_rest_share_share_lock;
 static globus_rw_mutex_t                globus_l_dsi_rest_share_cookie_lock;
 static globus_rw_mutex_t                globus_l_dsi_rest_share_dns_lock;
 static globus_rw_mutex_t                globus_l_dsi_rest_share_ssl_lock;
+static globus_rw_mutex_t                globus_l_dsi_rest_share_connect_lock;
+long                                    globus_i_dsi_rest_max_connects;
+long                                    globus_i_dsi_rest_postfields_max;
 
 static
 struct globus_l_dsi_rest_write_lock_owners_s
@@ -43,6 +46,7 @@ struct globus_l_dsi_rest_write_lock_owners_s
     globus_thread_t                     cookie_lock_owner;
     globus_thread_t                     dns_lock_owner;
     globus_thread_t                     ssl_lock_owner;
+    globus_thread_t                     connect_lock_owner;
 }
 globus_l_dsi_rest_write_lock_owners;
 
@@ -63,6 +67,41 @@ globus_l_dsi_rest_share_unlock(
 
 GlobusDebugDefine(GLOBUS_DSI_REST);
 
+/**
+ * @brief Read an integer tuning parameter from the environment
+ * @details
+ *     Returns the value of the environment variable named by name, or
+ *     default_value if it is unset, not a number, or outside
+ *     [min_value, max_value].
+ */
+static
+long
+globus_l_dsi_rest_getenv_long(
+    const char                         *name,
+    long                                default_value,
+    long                                min_value,
+    long                                max_value)
+{
+    const char                         *value = getenv(name);
+    char                               *end = NULL;
+    long                                result;
+
+    if (value == NULL || *value == '\0')
+    {
+        return default_value;
+    }
+    errno = 0;
+    result = strtol(value, &end, 0);
+    if (errno != 0 || *end != '\0' || result < min_value || result > max_value)
+    {
+        GlobusDsiRestWarn("Ignoring invalid %s value \"%s\"\n", name, value);
+
+        return default_value;
+    }
+    return result;
+}
+/* globus_l_dsi_rest_getenv_long() */
+
 static
 int
 globus_l_dsi_rest_activate(void)
@@ -78,11 +117,6 @@ globus_l_dsi_rest_activate(void)
     {
         goto activate_fail;
     }
-    rc = globus_mutex_init(&globus_i_dsi_rest_handle_cache_mutex, NULL);
-    if (rc != GLOBUS_SUCCESS)
-    {
-        goto mutex_init_fail;
-    }
     rc = globus_rw_mutex_init(&globus_l_dsi_rest_share_share_lock, NULL);
     if (rc != GLOBUS_SUCCESS)
     {
@@ -103,6 +137,11 @@ globus_l_dsi_rest_activate(void)
     {
         goto share_ssl_lock_init_fail;
     }
+    rc = globus_rw_mutex_init(&globus_l_dsi_rest_share_connect_lock, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto share_connect_lock_init_fail;
+    }
     globus_i_dsi_rest_share = curl_share_init();
     if (globus_i_dsi_rest_share == NULL)
     {
@@ -157,16 +196,96 @@ globus_l_dsi_rest_activate(void)
     {
         goto share_setopt_fail;
     }
+#if LIBCURL_VERSION_NUM >= 0x073900
+    rc = curl_share_setopt(
+            globus_i_dsi_rest_share,
+            CURLSHOPT_SHARE,
+            CURL_LOCK_DATA_CONNECT);
+    if (rc != CURLE_OK && rc != CURLSHE_BAD_OPTION)
+    {
+        goto share_setopt_fail;
+    }
+#endif
     rc = GLOBUS_SUCCESS;
-    globus_i_dsi_rest_handle_cache_index = 0;
+
+    memset(&globus_i_dsi_rest_stats, 0, sizeof(globus_i_dsi_rest_stats));
 
     GlobusDebugInit(GLOBUS_DSI_REST, DATA TRACE INFO DEBUG WARN ERROR);
 
+    globus_i_dsi_rest_max_connects = globus_l_dsi_rest_getenv_long(
+            "GLOBUS_DSI_REST_MAX_CONNECTS",
+            16,
+            1,
+            INT_MAX);
+    globus_i_dsi_rest_postfields_max = globus_l_dsi_rest_getenv_long(
+            "GLOBUS_DSI_REST_POSTFIELDS_MAX",
+            65536,
+            0,
+            LONG_MAX);
+    rc = globus_i_dsi_rest_handle_cache_init(
+            globus_l_dsi_rest_getenv_long(
+                    "GLOBUS_DSI_REST_HANDLE_CACHE_SIZE",
+                    -1,
+                    0,
+                    INT_MAX));
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto handle_cache_init_fail;
+    }
+
+    globus_i_dsi_rest_buffer_huge_pages = globus_l_dsi_rest_getenv_long(
+            "GLOBUS_DSI_REST_BUFFER_HUGE_PAGES",
+            0,
+            0,
+            1);
+    globus_i_dsi_rest_buffer_numa = globus_l_dsi_rest_getenv_long(
+            "GLOBUS_DSI_REST_BUFFER_NUMA",
+            0,
+            0,
+            1);
+    rc = globus_i_dsi_rest_buffer_pool_init(
+            globus_l_dsi_rest_getenv_long(
+                    "GLOBUS_DSI_REST_BUFFER_POOL_MAX",
+                    1073741824L,
+                    0,
+                    LONG_MAX));
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto buffer_pool_init_fail;
+    }
+
+    rc = globus_i_dsi_rest_arena_pool_init();
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto arena_pool_init_fail;
+    }
+
+    globus_i_dsi_rest_engine_threads = globus_l_dsi_rest_getenv_long(
+            "GLOBUS_DSI_REST_ENGINE_THREADS",
+            0,
+            0,
+            GLOBUS_I_DSI_REST_ENGINE_THREADS_MAX);
+    rc = globus_i_dsi_rest_engine_init();
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto engine_init_fail;
+    }
+
     if (rc != 0)
     {
+engine_init_fail:
+        globus_i_dsi_rest_arena_pool_destroy();
+arena_pool_init_fail:
+        globus_i_dsi_rest_buffer_pool_destroy();
+buffer_pool_init_fail:
+        globus_i_dsi_rest_handle_cache_destroy();
+handle_cache_init_fail:
+        GlobusDebugDestroy(GLOBUS_DSI_REST);
 share_setopt_fail:
         curl_share_cleanup(globus_i_dsi_rest_share);
 share_init_fail:
+        globus_rw_mutex_destroy(&globus_l_dsi_rest_share_connect_lock);
+share_connect_lock_init_fail:
         globus_rw_mutex_destroy(&globus_l_dsi_rest_share_ssl_lock);
 share_ssl_lock_init_fail:
         globus_rw_mutex_destroy(&globus_l_dsi_rest_share_dns_lock);
@@ -175,8 +294,6 @@ share_dns_lock_init_fail:
 share_cookie_lock_init_fail:
         globus_rw_mutex_destroy(&globus_l_dsi_rest_share_share_lock);
 share_share_lock_init_fail:
-        globus_mutex_destroy(&globus_i_dsi_rest_handle_cache_mutex);
-mutex_init_fail:
         globus_module_deactivate(GLOBUS_COMMON_MODULE);
     }
 activate_fail:
@@ -189,19 +306,18 @@ static
 int
 globus_l_dsi_rest_deactivate(void)
 {
-    globus_mutex_lock(&globus_i_dsi_rest_handle_cache_mutex);
-    while (globus_i_dsi_rest_handle_cache_index > 0)
-    {
-        curl_easy_cleanup(globus_i_dsi_rest_handle_cache[--globus_i_dsi_rest_handle_cache_index]);
-    }
-    globus_mutex_unlock(&globus_i_dsi_rest_handle_cache_mutex);
+    globus_i_dsi_rest_engine_destroy();
+
+    globus_i_dsi_rest_arena_pool_destroy();
+    globus_i_dsi_rest_buffer_pool_destroy();
+    globus_i_dsi_rest_handle_cache_destroy();
     curl_share_cleanup(globus_i_dsi_rest_share);
 
+    globus_rw_mutex_destroy(&globus_l_dsi_rest_share_connect_lock);
     globus_rw_mutex_destroy(&globus_l_dsi_rest_share_ssl_lock);
     globus_rw_mutex_destroy(&globus_l_dsi_rest_share_dns_lock);
     globus_rw_mutex_destroy(&globus_l_dsi_rest_share_cookie_lock);
     globus_rw_mutex_destroy(&globus_l_dsi_rest_share_share_lock);
-    globus_mutex_destroy(&globus_i_dsi_rest_handle_cache_mutex);
 
     globus_module_deactivate(GLOBUS_COMMON_MODULE);
     curl_global_cleanup();
@@ -227,7 +343,11 @@ globus_l_dsi_rest_share_lock(
     assert (data == CURL_LOCK_DATA_SHARE
             || data == CURL_LOCK_DATA_COOKIE
             || data == CURL_LOCK_DATA_DNS
-            || data == CURL_LOCK_DATA_SSL_SESSION);
+            || data == CURL_LOCK_DATA_SSL_SESSION
+#if LIBCURL_VERSION_NUM >= 0x073900
+            || data == CURL_LOCK_DATA_CONNECT
+#endif
+            );
     assert (access == CURL_LOCK_ACCESS_SHARED
             || access == CURL_LOCK_ACCESS_SINGLE);
 
@@ -249,6 +369,12 @@ globus_l_dsi_rest_share_lock(
             lock = &globus_l_dsi_rest_share_ssl_lock;
             owner = &owners->ssl_lock_owner;
             break;
+#if LIBCURL_VERSION_NUM >= 0x073900
+        case CURL_LOCK_DATA_CONNECT:
+            lock = &globus_l_dsi_rest_share_connect_lock;
+            owner = &owners->connect_lock_owner;
+            break;
+#endif
         default:
             return;
     }
@@ -279,7 +405,11 @@ globus_l_dsi_rest_share_unlock(
     assert (data == CURL_LOCK_DATA_SHARE
             || data == CURL_LOCK_DATA_COOKIE
             || data == CURL_LOCK_DATA_DNS
-            || data == CURL_LOCK_DATA_SSL_SESSION);
+            || data == CURL_LOCK_DATA_SSL_SESSION
+#if LIBCURL_VERSION_NUM >= 0x073900
+            || data == CURL_LOCK_DATA_CONNECT
+#endif
+            );
 
     switch (data)
     {
@@ -299,6 +429,12 @@ globus_l_dsi_rest_share_unlock(
             lock = &globus_l_dsi_rest_share_ssl_lock;
             owner = &owners->ssl_lock_owner;
             break;
+#if LIBCURL_VERSION_NUM >= 0x073900
+        case CURL_LOCK_DATA_CONNECT:
+            lock = &globus_l_dsi_rest_share_connect_lock;
+            owner = &owners->connect_lock_owner;
+            break;
+#endif
         default:
             return;
     }
@@ -22,8 +22,35 @@
 
 #include "globus_i_dsi_rest.h"
 
+size_t
+globus_i_dsi_rest_multipart_boundary_length(
+    const char                         *delimiter,
+    bool                                final,
+    const globus_dsi_rest_key_array_t  *part_header)
+{
+    size_t                              boundary_length = 0;
+
+    boundary_length += 8 + strlen(delimiter);
+    if (!final && part_header != NULL)
+    {
+        for (size_t i = 0; i < part_header->count; i++)
+        {
+            if (part_header->key_value[i].key != NULL
+                && part_header->key_value[i].value != NULL)
+            {
+                boundary_length += strlen(part_header->key_value[i].key);
+                boundary_length += strlen(part_header->key_value[i].value);
+                boundary_length += 4;
+            }
+        }
+    }
+    return boundary_length;
+}
+/* globus_i_dsi_rest_multipart_boundary_length() */
+
 globus_result_t
 globus_i_dsi_rest_multipart_boundary_prepare(
+    globus_i_dsi_rest_arena_t          *arena,
     const char                         *delimiter,
     bool                                final,
     globus_dsi_rest_key_array_t        *part_header,
@@ -37,23 +64,12 @@ globus_i_dsi_rest_multipart_boundary_prepare(
 
     GlobusDsiRestEnter();
 
+    boundary_length = globus_i_dsi_rest_multipart_boundary_length(
+            delimiter, final, part_header);
     if (!final)
     {
-        boundary_length += 8 + strlen(delimiter);
-        if (part_header != NULL)
-        {
-            for (size_t i = 0; i < part_header->count; i++)
-            {
-                if (part_header->key_value[i].key != NULL
-                    && part_header->key_value[i].value != NULL)
-                {
-                    boundary_length += strlen(part_header->key_value[i].key);
-                    boundary_length += strlen(part_header->key_value[i].value);
-                    boundary_length += 4;
-                }
-            }
-        }
-        p = boundary = malloc(boundary_length + 1);
+        p = boundary = globus_i_dsi_rest_arena_alloc(
+                arena, boundary_length + 1);
         if (boundary == NULL)
         {
             result = GlobusDsiRestErrorMemory();
@@ -79,8 +95,8 @@ globus_i_dsi_rest_multipart_boundary_prepare(
     }
     else
     {
-        boundary_length = 8 + strlen(delimiter);
-        boundary = malloc(boundary_length + 1);
+        boundary = globus_i_dsi_rest_arena_alloc(
+                arena, boundary_length + 1);
         if (boundary == NULL)
         {
             result = GlobusDsiRestErrorMemory();
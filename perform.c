@@ -32,6 +32,18 @@ globus_result_t
 globus_l_dsi_rest_perform(
     globus_i_dsi_rest_request_t        *request);
 
+static
+bool
+globus_l_dsi_rest_write_part_may_block(
+    const globus_i_dsi_rest_write_part_t
+                                       *write_part);
+
+static
+bool
+globus_l_dsi_rest_read_part_may_block(
+    const globus_i_dsi_rest_read_part_t
+                                       *read_part);
+
 globus_result_t
 globus_i_dsi_rest_perform(
     globus_i_dsi_rest_request_t        *request)
@@ -43,6 +55,18 @@ globus_i_dsi_rest_perform(
     {
         globus_thread_t                 thr;
 
+        /*
+         * The GridFTP op specializations wait for data channel callbacks
+         * from inside the curl callbacks, so they would stall every other
+         * request sharing an engine thread. Those keep a thread of their own.
+         */
+        if (globus_i_dsi_rest_engine_threads > 0
+            && !globus_l_dsi_rest_write_part_may_block(&request->write_part)
+            && !globus_l_dsi_rest_read_part_may_block(&request->read_part))
+        {
+            return globus_i_dsi_rest_engine_add(request);
+        }
+
         rc = globus_thread_create(
                 &thr,
                 NULL,
@@ -59,32 +83,80 @@ globus_i_dsi_rest_perform(
 }
 /* globus_i_dsi_rest_perform() */
 
-static
-void *
-globus_l_dsi_rest_perform_thread(
-    void                               *thread_arg)
+globus_result_t
+globus_i_dsi_rest_perform_finish(
+    globus_i_dsi_rest_request_t        *request,
+    CURLcode                            rc)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    globus_i_dsi_rest_stats_request_done(request);
+
+    if (rc != CURLE_OK)
+    {
+        result = GlobusDsiRestErrorCurl(rc);
+
+        goto perform_fail;
+    }
+    if (request->read_part.data_read_callback != NULL)
+    {
+        result = request->read_part.data_read_callback(
+                request->read_part.data_read_callback_arg,
+                "",
+                0);
+    }
+
+perform_fail:
+    if (request->result == GLOBUS_SUCCESS)
+    {
+        request->result = result;
+    }
+    result = request->result;
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_i_dsi_rest_perform_finish() */
+
+void
+globus_i_dsi_rest_perform_complete(
+    globus_i_dsi_rest_request_t        *request,
+    CURLcode                            rc)
 {
-    globus_i_dsi_rest_request_t        *request = thread_arg;
     globus_dsi_rest_complete_t          complete_callback;
     void                               *complete_callback_arg;
     globus_result_t                     result;
 
-    result = globus_l_dsi_rest_perform(request);
+    GlobusDsiRestEnter();
+
+    result = globus_i_dsi_rest_perform_finish(request, rc);
 
     complete_callback = request->complete_callback;
     complete_callback_arg = request->complete_callback_arg;
 
-    if (request->result != GLOBUS_SUCCESS)
-    {
-        result = request->result;
-    }
-
     globus_i_dsi_rest_request_cleanup(request);
 
     complete_callback(
             complete_callback_arg,
             result);
 
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_perform_complete() */
+
+static
+void *
+globus_l_dsi_rest_perform_thread(
+    void                               *thread_arg)
+{
+    globus_i_dsi_rest_request_t        *request = thread_arg;
+
+    globus_i_dsi_rest_perform_complete(
+            request,
+            curl_easy_perform(request->handle));
+
     return NULL;
 }
 /* globus_l_dsi_rest_perform_thread() */
@@ -94,33 +166,68 @@ globus_result_t
 globus_l_dsi_rest_perform(
     globus_i_dsi_rest_request_t        *request)
 {
-    CURLcode                            rc = CURLE_OK;
     globus_result_t                     result = GLOBUS_SUCCESS;
 
     /* Perform request */
-    rc = curl_easy_perform(request->handle);
-    if (rc != CURLE_OK)
-    {
-        result = GlobusDsiRestErrorCurl(rc);
+    result = globus_i_dsi_rest_perform_finish(
+            request,
+            curl_easy_perform(request->handle));
 
-        goto perform_fail;
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_perform() */
+
+static
+bool
+globus_l_dsi_rest_write_part_may_block(
+    const globus_i_dsi_rest_write_part_t
+                                       *write_part)
+{
+    bool                                may_block = false;
+
+    if (write_part->data_write_callback == globus_dsi_rest_write_gridftp_op)
+    {
+        may_block = true;
     }
-    if (request->read_part.data_read_callback != NULL)
+    else if (write_part->data_write_callback
+            == globus_dsi_rest_write_multipart)
     {
-        result = request->read_part.data_read_callback(
-                request->read_part.data_read_callback_arg,
-                "",
-                0);
+        const globus_i_dsi_rest_write_multipart_arg_t
+                                       *arg = write_part->data_write_callback_arg;
+
+        for (size_t i = 0; i < arg->num_parts && !may_block; i++)
+        {
+            may_block = globus_l_dsi_rest_write_part_may_block(&arg->parts[i]);
+        }
     }
+    return may_block;
+}
+/* globus_l_dsi_rest_write_part_may_block() */
 
-perform_fail:
-    if (request->result == GLOBUS_SUCCESS)
+static
+bool
+globus_l_dsi_rest_read_part_may_block(
+    const globus_i_dsi_rest_read_part_t
+                                       *read_part)
+{
+    bool                                may_block = false;
+
+    if (read_part->data_read_callback == globus_dsi_rest_read_gridftp_op)
     {
-        request->result = result;
+        may_block = true;
     }
-    result = request->result;
+    else if (read_part->data_read_callback
+            == globus_dsi_rest_read_multipart)
+    {
+        const globus_i_dsi_rest_read_multipart_arg_t
+                                       *arg = read_part->data_read_callback_arg;
 
-    GlobusDsiRestExitResult(result);
-    return result;
+        for (size_t i = 0; i < arg->num_parts && !may_block; i++)
+        {
+            may_block = globus_l_dsi_rest_read_part_may_block(&arg->parts[i]);
+        }
+    }
+    return may_block;
 }
-/* globus_l_dsi_rest_perform() */
+/* globus_l_dsi_rest_read_part_may_block() */
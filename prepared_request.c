@@ -0,0 +1,197 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file prepared_request.c GridFTP DSI REST Prepared Request
+ * @details
+ *     A prepared request holds copies of its method, base URI, and headers,
+ *     with the method already resolved, the query already encoded, and
+ *     the headers already rendered into a header set, all in an arena of
+ *     its own. Requests performed from it share that header set instead of
+ *     formatting their own headers.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+globus_result_t
+globus_dsi_rest_prepare(
+    const char                         *method,
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_dsi_rest_prepared_t         *preparedp)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_i_dsi_rest_arena_t           arena = {0};
+    globus_i_dsi_rest_prepared_t       *prepared = NULL;
+    globus_dsi_rest_key_value_t        *key_value = NULL;
+    globus_i_dsi_rest_header_set_t     *header_set = NULL;
+    char                               *query = NULL;
+    size_t                              count = 0;
+
+    GlobusDsiRestEnter();
+
+    if (method == NULL || uri == NULL || preparedp == NULL)
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_params;
+    }
+    count = (headers != NULL) ? headers->count : 0;
+
+    /* Like a request, the prepared request lives in its own arena */
+    prepared = globus_i_dsi_rest_arena_alloc(
+            &arena, sizeof(globus_i_dsi_rest_prepared_t));
+    if (prepared == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto prepared_alloc_fail;
+    }
+    *prepared = (globus_i_dsi_rest_prepared_t)
+    {
+        .arena = arena,
+        .method_id = globus_i_dsi_rest_method_lookup(method),
+        .headers.count = count,
+    };
+    prepared->method = globus_i_dsi_rest_arena_strdup(
+            &prepared->arena, method);
+    prepared->uri = globus_i_dsi_rest_arena_strdup(&prepared->arena, uri);
+    if (prepared->method == NULL || prepared->uri == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto copy_fail;
+    }
+
+    /* Encoded with an empty base, this is just the query string */
+    result = globus_i_dsi_rest_uri_add_query(
+            &prepared->arena, "", query_parameters, &query);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto copy_fail;
+    }
+    prepared->query = query;
+
+    if (count > 0)
+    {
+        key_value = globus_i_dsi_rest_arena_calloc(
+                &prepared->arena, count, sizeof(globus_dsi_rest_key_value_t));
+        if (key_value == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto copy_fail;
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const char                     *key = headers->key_value[i].key;
+        const char                     *value = headers->key_value[i].value;
+
+        /* Allow NULL key or value for placeholders that aren't used */
+        if (key == NULL || value == NULL)
+        {
+            continue;
+        }
+        key_value[i] = (globus_dsi_rest_key_value_t)
+        {
+            .key = globus_i_dsi_rest_arena_strdup(&prepared->arena, key),
+            .value = globus_i_dsi_rest_arena_strdup(&prepared->arena, value),
+        };
+        if (key_value[i].key == NULL || key_value[i].value == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto copy_fail;
+        }
+    }
+    prepared->headers.key_value = key_value;
+
+    header_set = globus_i_dsi_rest_arena_calloc(
+            &prepared->arena, 1, sizeof(globus_i_dsi_rest_header_set_t));
+    if (header_set == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto copy_fail;
+    }
+    result = globus_i_dsi_rest_header_set_init(
+            &prepared->arena, header_set, &prepared->headers);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto copy_fail;
+    }
+    prepared->header_set = header_set;
+    prepared->headers_rendered = count;
+    prepared->headers_set_length = header_set->set_length;
+
+    *preparedp = prepared;
+
+    if (result != GLOBUS_SUCCESS)
+    {
+copy_fail:
+        arena = prepared->arena;
+        globus_i_dsi_rest_arena_release(&arena);
+    }
+prepared_alloc_fail:
+bad_params:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_prepare() */
+
+globus_result_t
+globus_dsi_rest_request_prepared(
+    globus_dsi_rest_prepared_t          prepared,
+    const char                         *path,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_callbacks_t  *callbacks)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (prepared == NULL)
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_params;
+    }
+    result = globus_i_dsi_rest_request_start(
+            prepared,
+            path,
+            query_parameters,
+            callbacks);
+
+bad_params:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_request_prepared() */
+
+void
+globus_dsi_rest_prepared_destroy(
+    globus_dsi_rest_prepared_t          prepared)
+{
+    globus_i_dsi_rest_arena_t           arena;
+
+    GlobusDsiRestEnter();
+
+    if (prepared != NULL)
+    {
+        arena = prepared->arena;
+        globus_i_dsi_rest_arena_release(&arena);
+    }
+
+    GlobusDsiRestExit();
+}
+/* globus_dsi_rest_prepared_destroy() */
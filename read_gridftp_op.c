@@ -47,11 +47,24 @@ globus_l_dsi_rest_read_gridftp_op(
     globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg = read_callback_arg;
     globus_result_t                     result = GLOBUS_SUCCESS;
     bool                                eof = (buffer_length == 0);
+    static const char                   long_msg[] = "data outside of range";
+    static const char                   short_msg[] = "missing data before eof";
 
     GlobusDsiRestEnter();
 
     globus_mutex_lock(&gridftp_op_arg->mutex);
 
+    if (gridftp_op_arg->end_offset != 0
+        && buffer_length > gridftp_op_arg->end_offset
+                - gridftp_op_arg->received_offset)
+    {
+        /* Don't write past the range into data that belongs elsewhere */
+        result = GlobusDsiRestErrorUnexpectedData(
+                long_msg, sizeof(long_msg) - 1);
+        goto send_fail;
+    }
+    gridftp_op_arg->received_offset += buffer_length;
+
     do
     {
         size_t                          copy_size;
@@ -97,11 +110,22 @@ globus_l_dsi_rest_read_gridftp_op(
                 gridftp_op_arg,
                 buffer_length);
 
+            /* If the buffer pool is full, wait for a write to complete */
+            while (current_buffer == NULL
+                && gridftp_op_arg->registered_buffers_count > 0)
+            {
+                globus_cond_wait(
+                    &gridftp_op_arg->cond,
+                    &gridftp_op_arg->mutex);
+                current_buffer = globus_i_dsi_rest_buffer_get(
+                    gridftp_op_arg,
+                    buffer_length);
+            }
             if (current_buffer == NULL)
             {
-                gridftp_op_arg->result = GlobusDsiRestErrorMemory();
+                result = gridftp_op_arg->result = GlobusDsiRestErrorMemory();
 
-                goto out;
+                goto send_fail;
             }
 
             if (buffer_length > (
@@ -175,10 +199,18 @@ send_fail:
                     &gridftp_op_arg->cond,
                     &gridftp_op_arg->mutex);
         }
+        if (result == GLOBUS_SUCCESS
+            && gridftp_op_arg->end_offset != 0
+            && gridftp_op_arg->received_offset != gridftp_op_arg->end_offset)
+        {
+            /* A short response, or a multipart body cut off early */
+            result = GlobusDsiRestErrorUnexpectedData(
+                    short_msg, sizeof(short_msg) - 1);
+        }
     }
 
     globus_mutex_unlock(&gridftp_op_arg->mutex);
-out:
+
     GlobusDsiRestExitResult(result);
     return result;
 }
@@ -249,6 +281,7 @@ globus_l_dsi_rest_send_pending(
             goto out;
         }
         gridftp_op_arg->registered_buffers_count++;
+        gridftp_op_arg->registered_bytes += buffer->buffer_used;
         gridftp_op_arg->offset += buffer->buffer_used;
         gridftp_op_arg->pending_buffers = buffer->next;
 
@@ -257,8 +290,7 @@ globus_l_dsi_rest_send_pending(
             gridftp_op_arg->pending_buffers_last =
                 &gridftp_op_arg->pending_buffers;
         }
-        buffer->next = gridftp_op_arg->registered_buffers;
-        gridftp_op_arg->registered_buffers = buffer;
+        buffer->next = NULL;
     }
 out:
     GlobusDsiRestExitResult(result);
@@ -300,7 +332,7 @@ globus_l_dsi_rest_gridftp_write_callback(
     void                               *user_arg)
 {
     globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg = user_arg;
-    globus_i_dsi_rest_buffer_t         *ptr, **last_next;
+    globus_i_dsi_rest_buffer_t         *rest_buffer;
 
     GlobusDsiRestEnter();
 
@@ -316,23 +348,12 @@ globus_l_dsi_rest_gridftp_write_callback(
 
     globus_mutex_lock(&gridftp_op_arg->mutex);
 
-    ptr = gridftp_op_arg->registered_buffers;
-    last_next = &gridftp_op_arg->registered_buffers;
-
-    while (ptr != NULL)
-    {
-        if (ptr->buffer == buffer)
-        {
-            /* Clear used offset and return to the free_buffers list */
-            ptr->buffer_used = 0;
-            *last_next = ptr->next;
-            ptr->next = gridftp_op_arg->free_buffers;
-            gridftp_op_arg->free_buffers = ptr;
-            break;
-        }
-        last_next = &ptr->next;
-        ptr = ptr->next;
-    }
+    /* Clear used offset and return to the free_buffers list */
+    rest_buffer = GlobusDsiRestBufferFromData(buffer);
+    gridftp_op_arg->registered_bytes -= rest_buffer->buffer_used;
+    rest_buffer->buffer_used = 0;
+    rest_buffer->next = gridftp_op_arg->free_buffers;
+    gridftp_op_arg->free_buffers = rest_buffer;
     gridftp_op_arg->registered_buffers_count--;
     globus_cond_signal(&gridftp_op_arg->cond);
 
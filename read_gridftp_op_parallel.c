@@ -0,0 +1,443 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file read_gridftp_op_parallel.c GridFTP DSI REST Parallel Ranged GET
+ * @details
+ *     Splits a GridFTP read range into several byte ranges, and GETs each of
+ *     them in a request of its own. Each request writes its data to the
+ *     GridFTP data channel at the offset of its range, so the streams do not
+ *     need to be ordered with respect to each other.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+#include "globus_gridftp_server.h"
+
+#include <inttypes.h>
+
+/**
+ * @brief One byte range of a parallel GET
+ */
+typedef
+struct globus_l_dsi_rest_range_s
+{
+    struct globus_l_dsi_rest_parallel_s*parallel;
+    globus_dsi_rest_gridftp_op_arg_t    gridftp_op_arg;
+    /* Whether a Range header was sent, so a 206 response is expected */
+    bool                                ranged;
+    char                                range_header[64];
+}
+globus_l_dsi_rest_range_t;
+
+/**
+ * @brief State shared by all ranges of a parallel GET
+ */
+typedef
+struct globus_l_dsi_rest_parallel_s
+{
+    globus_mutex_t                      mutex;
+    globus_cond_t                       cond;
+    /* Ranges still running, plus one while requests are being registered */
+    int                                 outstanding;
+    globus_result_t                     result;
+    globus_dsi_rest_complete_t          complete_callback;
+    void                               *complete_callback_arg;
+    globus_l_dsi_rest_range_t           ranges[];
+}
+globus_l_dsi_rest_parallel_t;
+
+static
+void
+globus_l_dsi_rest_parallel_destroy(
+    globus_l_dsi_rest_parallel_t       *parallel)
+{
+    globus_cond_destroy(&parallel->cond);
+    globus_mutex_destroy(&parallel->mutex);
+    free(parallel);
+}
+/* globus_l_dsi_rest_parallel_destroy() */
+
+/**
+ * @brief Drop one reference to the parallel GET state
+ * @details
+ *     Records result if it is the first error, and when the last reference
+ *     is dropped either calls the caller's complete callback or wakes the
+ *     thread waiting in globus_dsi_rest_read_gridftp_op_parallel().
+ */
+static
+void
+globus_l_dsi_rest_parallel_release(
+    globus_l_dsi_rest_parallel_t       *parallel,
+    globus_result_t                     result)
+{
+    globus_dsi_rest_complete_t          complete_callback = NULL;
+    void                               *complete_callback_arg = NULL;
+    bool                                done;
+
+    GlobusDsiRestEnter();
+
+    globus_mutex_lock(&parallel->mutex);
+    if (result != GLOBUS_SUCCESS && parallel->result == GLOBUS_SUCCESS)
+    {
+        parallel->result = result;
+    }
+    done = (--parallel->outstanding == 0);
+    if (done)
+    {
+        complete_callback = parallel->complete_callback;
+        complete_callback_arg = parallel->complete_callback_arg;
+        result = parallel->result;
+        globus_cond_signal(&parallel->cond);
+    }
+    globus_mutex_unlock(&parallel->mutex);
+
+    if (done && complete_callback != NULL)
+    {
+        globus_l_dsi_rest_parallel_destroy(parallel);
+        complete_callback(complete_callback_arg, result);
+    }
+    GlobusDsiRestExit();
+}
+/* globus_l_dsi_rest_parallel_release() */
+
+static
+void
+globus_l_dsi_rest_range_complete(
+    void                               *complete_callback_arg,
+    globus_result_t                     result)
+{
+    globus_l_dsi_rest_range_t          *range = complete_callback_arg;
+
+    GlobusDsiRestEnter();
+
+    GlobusDsiRestDebug(
+            "range offset=%"GLOBUS_OFF_T_FORMAT
+            " length=%"GLOBUS_OFF_T_FORMAT
+            " result=%#x\n",
+            range->gridftp_op_arg.offset,
+            range->gridftp_op_arg.length,
+            result);
+
+    globus_l_dsi_rest_parallel_release(range->parallel, result);
+
+    GlobusDsiRestExit();
+}
+/* globus_l_dsi_rest_range_complete() */
+
+/**
+ * @brief Check a response's Content-Range against the range asked for
+ * @details
+ *     Returns a parse error unless headers has a Content-Range of bytes
+ *     starting at offset, and, if length is not -1, ending at
+ *     offset+length-1.
+ */
+globus_result_t
+globus_i_dsi_rest_content_range_check(
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_off_t                        offset,
+    globus_off_t                        length)
+{
+    const char                         *content_range = NULL;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    uintmax_t                           start;
+    int                                 consumed = 0;
+
+    GlobusDsiRestEnter();
+
+    for (size_t i = 0; i < headers->count; i++)
+    {
+        if (strcasecmp(headers->key_value[i].key, "Content-Range") == 0)
+        {
+            content_range = headers->key_value[i].value;
+            break;
+        }
+    }
+    if (content_range == NULL
+        || sscanf(content_range, "bytes %"SCNuMAX"-%n", &start, &consumed) != 1
+        || consumed == 0
+        || start != (uintmax_t) offset)
+    {
+        result = GlobusDsiRestErrorParse("Content-Range");
+        goto done;
+    }
+    if (length != (globus_off_t) -1)
+    {
+        uintmax_t                       end;
+
+        if (sscanf(content_range + consumed, "%"SCNuMAX, &end) != 1
+            || end != (uintmax_t) (offset + length - 1))
+        {
+            result = GlobusDsiRestErrorParse("Content-Range");
+        }
+    }
+
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_i_dsi_rest_content_range_check() */
+
+/**
+ * @brief Check that the server sent the range that was asked for
+ * @details
+ *     A server which ignores the Range header replies 200 with the whole
+ *     resource, which would be written at the wrong offset, so anything but
+ *     a 206 with a matching Content-Range is an error.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_range_response(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    globus_l_dsi_rest_range_t          *range = response_callback_arg;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (!range->ranged)
+    {
+        if (response_code != 200)
+        {
+            result = GlobusDsiRestErrorUnexpectedResponse(response_code);
+        }
+        goto done;
+    }
+    if (response_code != 206)
+    {
+        result = GlobusDsiRestErrorUnexpectedResponse(response_code);
+        goto done;
+    }
+    result = globus_i_dsi_rest_content_range_check(
+            response_headers,
+            range->gridftp_op_arg.offset,
+            range->gridftp_op_arg.length);
+
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_range_response() */
+
+globus_result_t
+globus_dsi_rest_read_gridftp_op_parallel(
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_key_array_t  *headers,
+    const globus_dsi_rest_gridftp_op_arg_t
+                                       *gridftp_op_arg,
+    int                                 max_streams,
+    globus_dsi_rest_complete_t          complete_callback,
+    void                               *complete_callback_arg)
+{
+    globus_l_dsi_rest_parallel_t       *parallel = NULL;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    size_t                              header_count;
+    globus_off_t                        range_offset, range_length;
+    int                                 streams = max_streams;
+    int                                 registered = 0;
+    int                                 rc;
+
+    GlobusDsiRestEnter();
+
+    if (uri == NULL || gridftp_op_arg == NULL || gridftp_op_arg->offset < 0
+        || (gridftp_op_arg->length < 0
+            && gridftp_op_arg->length != (globus_off_t) -1))
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_param;
+    }
+    if (gridftp_op_arg->length == 0)
+    {
+        /* Nothing to read, and no valid Range header to ask for it with */
+        if (complete_callback != NULL)
+        {
+            complete_callback(complete_callback_arg, GLOBUS_SUCCESS);
+        }
+        goto done;
+    }
+
+    if (streams <= 0)
+    {
+        globus_gridftp_server_get_optimal_concurrency(
+                gridftp_op_arg->op,
+                &streams);
+    }
+    if (gridftp_op_arg->length == (globus_off_t) -1)
+    {
+        /* Without a length the range can't be split */
+        streams = 1;
+    }
+    else if (streams > gridftp_op_arg->length
+            / GLOBUS_I_DSI_REST_PARALLEL_RANGE_MIN)
+    {
+        streams = gridftp_op_arg->length
+                / GLOBUS_I_DSI_REST_PARALLEL_RANGE_MIN;
+    }
+    if (streams < 1)
+    {
+        streams = 1;
+    }
+
+    parallel = malloc(sizeof(globus_l_dsi_rest_parallel_t)
+            + streams * sizeof(globus_l_dsi_rest_range_t));
+    if (parallel == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto parallel_malloc_fail;
+    }
+    *parallel = (globus_l_dsi_rest_parallel_t)
+    {
+        .outstanding = 1,
+        .complete_callback = complete_callback,
+        .complete_callback_arg = complete_callback_arg,
+    };
+    rc = globus_mutex_init(&parallel->mutex, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        result = GlobusDsiRestErrorThreadFail(rc);
+        goto mutex_init_fail;
+    }
+    rc = globus_cond_init(&parallel->cond, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        result = GlobusDsiRestErrorThreadFail(rc);
+        goto cond_init_fail;
+    }
+
+    header_count = (headers != NULL) ? headers->count : 0;
+    range_offset = gridftp_op_arg->offset;
+    for (int i = 0; i < streams; i++)
+    {
+        globus_l_dsi_rest_range_t      *range = &parallel->ranges[i];
+        globus_dsi_rest_key_value_t     range_headers[header_count + 1];
+
+        if (gridftp_op_arg->length == (globus_off_t) -1)
+        {
+            range_length = -1;
+        }
+        else
+        {
+            /* Spread the remainder over the first ranges */
+            range_length = gridftp_op_arg->length / streams
+                    + (i < gridftp_op_arg->length % streams);
+        }
+        *range = (globus_l_dsi_rest_range_t)
+        {
+            .parallel = parallel,
+            .gridftp_op_arg =
+            {
+                .op = gridftp_op_arg->op,
+                .offset = range_offset,
+                .length = range_length,
+            },
+            .ranged = (range_length != -1 || range_offset != 0),
+        };
+        range_offset += range_length;
+
+        if (header_count > 0)
+        {
+            memcpy(range_headers, headers->key_value,
+                    header_count * sizeof(globus_dsi_rest_key_value_t));
+        }
+        if (range_length == -1)
+        {
+            snprintf(range->range_header, sizeof(range->range_header),
+                    "bytes=%"GLOBUS_OFF_T_FORMAT"-",
+                    range->gridftp_op_arg.offset);
+        }
+        else
+        {
+            snprintf(range->range_header, sizeof(range->range_header),
+                    "bytes=%"GLOBUS_OFF_T_FORMAT"-%"GLOBUS_OFF_T_FORMAT,
+                    range->gridftp_op_arg.offset,
+                    range->gridftp_op_arg.offset + range_length - 1);
+        }
+        range_headers[header_count] = (globus_dsi_rest_key_value_t)
+        {
+            .key = "Range",
+            .value = range->range_header,
+        };
+
+        globus_mutex_lock(&parallel->mutex);
+        parallel->outstanding++;
+        globus_mutex_unlock(&parallel->mutex);
+
+        result = globus_dsi_rest_request(
+                "GET",
+                uri,
+                query_parameters,
+                &(globus_dsi_rest_key_array_t)
+                {
+                    .count = header_count + range->ranged,
+                    .key_value = range_headers,
+                },
+                &(globus_dsi_rest_callbacks_t)
+                {
+                    .response_callback = globus_l_dsi_rest_range_response,
+                    .response_callback_arg = range,
+                    .data_read_callback = globus_dsi_rest_read_gridftp_op,
+                    .data_read_callback_arg = &range->gridftp_op_arg,
+                    .complete_callback = globus_l_dsi_rest_range_complete,
+                    .complete_callback_arg = range,
+                });
+        if (result != GLOBUS_SUCCESS)
+        {
+            /* Not registered, so its complete callback won't be called */
+            globus_l_dsi_rest_parallel_release(parallel, result);
+            break;
+        }
+        registered++;
+    }
+
+    if (registered == 0)
+    {
+        goto request_fail;
+    }
+    if (complete_callback != NULL)
+    {
+        /* Errors are reported through complete_callback from here on */
+        globus_l_dsi_rest_parallel_release(parallel, GLOBUS_SUCCESS);
+        result = GLOBUS_SUCCESS;
+        goto done;
+    }
+    globus_l_dsi_rest_parallel_release(parallel, GLOBUS_SUCCESS);
+
+    globus_mutex_lock(&parallel->mutex);
+    while (parallel->outstanding != 0)
+    {
+        globus_cond_wait(&parallel->cond, &parallel->mutex);
+    }
+    result = parallel->result;
+    globus_mutex_unlock(&parallel->mutex);
+
+request_fail:
+    globus_cond_destroy(&parallel->cond);
+cond_init_fail:
+    globus_mutex_destroy(&parallel->mutex);
+mutex_init_fail:
+    free(parallel);
+parallel_malloc_fail:
+bad_param:
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_read_gridftp_op_parallel() */
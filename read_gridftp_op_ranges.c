@@ -0,0 +1,459 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file read_gridftp_op_ranges.c GridFTP DSI REST Multi-Range GET
+ * @details
+ *     Collects all of the ranges the GridFTP server wants sent, and GETs
+ *     them in one request with a multi-range Range header. Each part of the
+ *     multipart/byteranges reply is passed through
+ *     globus_dsi_rest_read_gridftp_op() at its range's offset, which fails
+ *     unless the part holds exactly its range. Ranges the reply leaves out
+ *     or cuts short are read again one request at a time.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+#include "globus_gridftp_server.h"
+
+/**
+ * @brief State of a multi-range GET
+ */
+typedef
+struct globus_l_dsi_rest_ranges_s
+{
+    globus_dsi_rest_gridftp_op_arg_t   *ranges;
+    size_t                              range_count;
+    /* First range to GET on its own if the reply can't be used */
+    size_t                              fallback_index;
+    /* Whether the reply is multipart/byteranges */
+    bool                                multipart;
+    /* Parts of the reply whose Content-Range matched, in order */
+    size_t                              parts_started;
+}
+globus_l_dsi_rest_ranges_t;
+
+/**
+ * @brief Response callback argument for one part of the reply
+ */
+typedef
+struct globus_l_dsi_rest_ranges_part_s
+{
+    globus_l_dsi_rest_ranges_t         *state;
+    size_t                              index;
+}
+globus_l_dsi_rest_ranges_part_t;
+
+static
+int
+globus_l_dsi_rest_range_compare(
+    const void                         *a,
+    const void                         *b)
+{
+    const globus_dsi_rest_gridftp_op_arg_t
+                                       *ra = a, *rb = b;
+
+    return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+/* globus_l_dsi_rest_range_compare() */
+
+/**
+ * @brief Get all of the ranges the GridFTP server wants sent
+ * @details
+ *     The ranges are sorted, and overlapping or adjacent ranges are merged,
+ *     so that a server has no reason to coalesce parts of its reply.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_ranges_get(
+    globus_gfs_operation_t              op,
+    globus_dsi_rest_gridftp_op_arg_t  **rangesp,
+    size_t                             *range_countp)
+{
+    globus_dsi_rest_gridftp_op_arg_t   *ranges = NULL;
+    size_t                              range_count = 0;
+    size_t                              ranges_alloc = 0;
+    size_t                              merged = 0;
+    globus_off_t                        offset, length;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    for (;;)
+    {
+        globus_gridftp_server_get_read_range(op, &offset, &length);
+        if (length == 0)
+        {
+            break;
+        }
+        if (range_count == ranges_alloc)
+        {
+            globus_dsi_rest_gridftp_op_arg_t
+                                       *tmp;
+
+            ranges_alloc = ranges_alloc ? 2 * ranges_alloc : 8;
+            tmp = realloc(ranges, ranges_alloc * sizeof(*ranges));
+            if (tmp == NULL)
+            {
+                result = GlobusDsiRestErrorMemory();
+                goto realloc_fail;
+            }
+            ranges = tmp;
+        }
+        ranges[range_count++] = (globus_dsi_rest_gridftp_op_arg_t)
+        {
+            .op = op,
+            .offset = offset,
+            .length = length,
+        };
+    }
+    if (range_count == 0)
+    {
+        goto done;
+    }
+
+    qsort(ranges, range_count, sizeof(*ranges),
+            globus_l_dsi_rest_range_compare);
+    for (size_t i = 1; i < range_count; i++)
+    {
+        globus_dsi_rest_gridftp_op_arg_t
+                                       *last = &ranges[merged];
+
+        if (last->length == (globus_off_t) -1)
+        {
+            /* Already reads to the end */
+            continue;
+        }
+        if (ranges[i].offset <= last->offset + last->length)
+        {
+            if (ranges[i].length == (globus_off_t) -1)
+            {
+                last->length = -1;
+            }
+            else if (ranges[i].offset + ranges[i].length
+                    > last->offset + last->length)
+            {
+                last->length = ranges[i].offset + ranges[i].length
+                        - last->offset;
+            }
+            continue;
+        }
+        ranges[++merged] = ranges[i];
+    }
+    range_count = merged + 1;
+
+done:
+    *rangesp = ranges;
+    *range_countp = range_count;
+    GlobusDsiRestExitResult(result);
+    return result;
+
+realloc_fail:
+    free(ranges);
+    ranges = NULL;
+    range_count = 0;
+    goto done;
+}
+/* globus_l_dsi_rest_ranges_get() */
+
+/**
+ * @brief Format the Range header value for all ranges
+ */
+static
+char *
+globus_l_dsi_rest_ranges_header(
+    const globus_dsi_rest_gridftp_op_arg_t
+                                       *ranges,
+    size_t                              range_count)
+{
+    /* "bytes=" and, for each range, two offsets, "-" and "," */
+    size_t                              len = 7 + range_count * 44;
+    char                               *value;
+    size_t                              off;
+
+    value = malloc(len);
+    if (value == NULL)
+    {
+        return NULL;
+    }
+    off = snprintf(value, len, "bytes=");
+    for (size_t i = 0; i < range_count; i++)
+    {
+        if (ranges[i].length == (globus_off_t) -1)
+        {
+            off += snprintf(value + off, len - off,
+                    "%s%"GLOBUS_OFF_T_FORMAT"-",
+                    i ? "," : "",
+                    ranges[i].offset);
+        }
+        else
+        {
+            off += snprintf(value + off, len - off,
+                    "%s%"GLOBUS_OFF_T_FORMAT"-%"GLOBUS_OFF_T_FORMAT,
+                    i ? "," : "",
+                    ranges[i].offset,
+                    ranges[i].offset + ranges[i].length - 1);
+        }
+    }
+    return value;
+}
+/* globus_l_dsi_rest_ranges_header() */
+
+/**
+ * @brief Check that the reply is multipart/byteranges
+ * @details
+ *     A server which ignores the Range header replies 200 with the whole
+ *     resource, and one which coalesces the ranges replies with a single
+ *     part. In either case the request is stopped, and the ranges are
+ *     read one request at a time instead.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_ranges_response(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    globus_l_dsi_rest_ranges_t         *state = response_callback_arg;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (response_code == 206)
+    {
+        for (size_t i = 0; i < response_headers->count; i++)
+        {
+            if (strcasecmp(response_headers->key_value[i].key,
+                    "Content-Type") == 0
+                && strncasecmp(response_headers->key_value[i].value,
+                    "multipart/byteranges",
+                    strlen("multipart/byteranges")) == 0)
+            {
+                state->multipart = true;
+                goto done;
+            }
+        }
+    }
+    if (response_code == 200 || response_code == 206)
+    {
+        state->fallback_index = 0;
+    }
+    result = GlobusDsiRestErrorUnexpectedResponse(response_code);
+
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_ranges_response() */
+
+/**
+ * @brief Check that a part of the reply holds the range expected
+ * @details
+ *     Parts must come back in the order they were asked for. If one does
+ *     not, the request is stopped, and it and the ranges after it are read
+ *     one request at a time. The parts before it have already been sent.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_ranges_part_response(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    globus_l_dsi_rest_ranges_part_t    *part = response_callback_arg;
+    globus_l_dsi_rest_ranges_t         *state = part->state;
+    globus_result_t                     result;
+
+    GlobusDsiRestEnter();
+
+    result = globus_i_dsi_rest_content_range_check(
+            response_headers,
+            state->ranges[part->index].offset,
+            state->ranges[part->index].length);
+    if (result != GLOBUS_SUCCESS)
+    {
+        state->fallback_index = part->index;
+    }
+    else
+    {
+        state->parts_started = part->index + 1;
+    }
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_ranges_part_response() */
+
+globus_result_t
+globus_dsi_rest_read_gridftp_op_ranges(
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_key_array_t  *headers,
+    globus_gfs_operation_t              op)
+{
+    globus_l_dsi_rest_ranges_t          state = { .ranges = NULL };
+    globus_l_dsi_rest_ranges_part_t    *part_args = NULL;
+    struct globus_dsi_rest_read_part_s *parts = NULL;
+    char                               *range_header = NULL;
+    size_t                              header_count;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (uri == NULL)
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_param;
+    }
+    result = globus_l_dsi_rest_ranges_get(
+            op,
+            &state.ranges,
+            &state.range_count);
+    if (result != GLOBUS_SUCCESS || state.range_count == 0)
+    {
+        goto ranges_get_fail;
+    }
+    state.fallback_index = state.range_count;
+    if (state.range_count == 1)
+    {
+        state.fallback_index = 0;
+        goto fallback;
+    }
+
+    range_header = globus_l_dsi_rest_ranges_header(
+            state.ranges,
+            state.range_count);
+    part_args = malloc(state.range_count * sizeof(*part_args));
+    parts = malloc(state.range_count * sizeof(*parts));
+    if (range_header == NULL || part_args == NULL || parts == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto alloc_fail;
+    }
+    for (size_t i = 0; i < state.range_count; i++)
+    {
+        part_args[i] = (globus_l_dsi_rest_ranges_part_t)
+        {
+            .state = &state,
+            .index = i,
+        };
+        parts[i] = (struct globus_dsi_rest_read_part_s)
+        {
+            .response_callback = globus_l_dsi_rest_ranges_part_response,
+            .response_callback_arg = &part_args[i],
+            .data_read_callback = globus_dsi_rest_read_gridftp_op,
+            .data_read_callback_arg = &state.ranges[i],
+        };
+    }
+
+    header_count = (headers != NULL) ? headers->count : 0;
+    {
+        globus_dsi_rest_key_value_t     range_headers[header_count + 1];
+
+        if (header_count > 0)
+        {
+            memcpy(range_headers, headers->key_value,
+                    header_count * sizeof(globus_dsi_rest_key_value_t));
+        }
+        range_headers[header_count] = (globus_dsi_rest_key_value_t)
+        {
+            .key = "Range",
+            .value = range_header,
+        };
+        GlobusDsiRestDebug("Range: %s\n", range_header);
+
+        result = globus_dsi_rest_request(
+                "GET",
+                uri,
+                query_parameters,
+                &(globus_dsi_rest_key_array_t)
+                {
+                    .count = header_count + 1,
+                    .key_value = range_headers,
+                },
+                &(globus_dsi_rest_callbacks_t)
+                {
+                    .response_callback = globus_l_dsi_rest_ranges_response,
+                    .response_callback_arg = &state,
+                    .data_read_callback = globus_dsi_rest_read_multipart,
+                    .data_read_callback_arg =
+                        &(globus_dsi_rest_read_multipart_arg_t)
+                        {
+                            .num_parts = state.range_count,
+                            .parts = parts,
+                        },
+                });
+    }
+    if (result == GLOBUS_SUCCESS)
+    {
+        if (state.parts_started == state.range_count)
+        {
+            goto done;
+        }
+        /* The reply ended before all of the parts arrived */
+        state.fallback_index = state.parts_started;
+    }
+    else if (state.multipart && state.fallback_index == state.range_count)
+    {
+        /*
+         * The reply failed part way through. Each part before the last one
+         * started was checked to be complete when it ended, so only that
+         * one needs to be read again, along with those after it.
+         */
+        state.fallback_index = (state.parts_started > 0)
+                ? state.parts_started - 1 : 0;
+    }
+
+fallback:
+    if (state.fallback_index < state.range_count)
+    {
+        GlobusDsiRestDebug(
+                "reading ranges %zu-%zu separately\n",
+                state.fallback_index,
+                state.range_count - 1);
+        result = GLOBUS_SUCCESS;
+    }
+    for (size_t i = state.fallback_index; i < state.range_count; i++)
+    {
+        result = globus_dsi_rest_read_gridftp_op_parallel(
+                uri,
+                query_parameters,
+                headers,
+                &state.ranges[i],
+                1,
+                NULL,
+                NULL);
+        if (result != GLOBUS_SUCCESS)
+        {
+            break;
+        }
+    }
+
+done:
+alloc_fail:
+    free(parts);
+    free(part_args);
+    free(range_header);
+ranges_get_fail:
+    free(state.ranges);
+bad_param:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_read_gridftp_op_ranges() */
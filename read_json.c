@@ -22,6 +22,55 @@
 
 #include "globus_i_dsi_rest.h"
 
+/**
+ * @brief Make room for more data in the JSON buffer
+ * @details
+ *     Ensures the buffer has room for size more bytes plus a terminating
+ *     NUL. The buffer at least doubles each time it grows, so a response
+ *     arriving in many small chunks is copied a bounded number of times.
+ *     When called on an empty buffer, allocates exactly the room needed,
+ *     so the header callback can presize it from the Content-Length.
+ */
+globus_result_t
+globus_i_dsi_rest_read_json_reserve(
+    globus_i_dsi_rest_read_json_arg_t  *jdata,
+    size_t                              size)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    size_t                              needed;
+    size_t                              new_len;
+    char                               *resized;
+
+    if (jdata->buffer_len - jdata->buffer_used > size)
+    {
+        goto done;
+    }
+    if (size > SIZE_MAX - 1 - jdata->buffer_used)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+    needed = jdata->buffer_used + size + 1;
+    new_len = (jdata->buffer_len <= SIZE_MAX / 2)
+        ? jdata->buffer_len * 2 : SIZE_MAX;
+    if (new_len < needed)
+    {
+        new_len = needed;
+    }
+    resized = realloc(jdata->buffer, new_len);
+    if (resized == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+    jdata->buffer = resized;
+    jdata->buffer_len = new_len;
+
+done:
+    return result;
+}
+/* globus_i_dsi_rest_read_json_reserve() */
+
 static
 globus_result_t
 globus_l_dsi_rest_read_json(
@@ -38,19 +87,12 @@ globus_l_dsi_rest_read_json(
     if (buffer_length > 0)
     {
         /* accumulate json data into a buffer */
-        void                           *resized;
-
-        resized = realloc(
-            jdata->buffer, jdata->buffer_len + buffer_length + 1);
-        if (resized == NULL)
+        result = globus_i_dsi_rest_read_json_reserve(jdata, buffer_length);
+        if (result != GLOBUS_SUCCESS)
         {
-            result = GlobusDsiRestErrorMemory();
             goto done;
         }
 
-        jdata->buffer = resized;
-        jdata->buffer_len += buffer_length;
-
         memcpy(jdata->buffer + jdata->buffer_used, 
                 buffer,
                 buffer_length);
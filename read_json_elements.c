@@ -0,0 +1,306 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file read_json_elements.c GridFTP DSI REST Streaming JSON Array Callback
+ * @details
+ *     Scans the response as it arrives, tracking only the nesting depth and
+ *     whether it is inside a string, to find where each element of the
+ *     array begins and ends. Each element is parsed with json_loadb() as
+ *     soon as its last byte arrives. An element contained in a single read
+ *     is parsed in place; only one which spans reads is copied.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+static
+globus_result_t
+globus_l_dsi_rest_read_json_element_append(
+    globus_i_dsi_rest_read_json_elements_arg_t
+                                       *jdata,
+    const char                         *data,
+    size_t                              length)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    if (jdata->element_len - jdata->element_used < length)
+    {
+        size_t                          new_len = jdata->element_len * 2;
+        char                           *resized;
+
+        if (new_len < jdata->element_used + length)
+        {
+            new_len = jdata->element_used + length;
+        }
+        resized = realloc(jdata->element, new_len);
+        if (resized == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto done;
+        }
+        jdata->element = resized;
+        jdata->element_len = new_len;
+    }
+    memcpy(jdata->element + jdata->element_used, data, length);
+    jdata->element_used += length;
+
+done:
+    return result;
+}
+/* globus_l_dsi_rest_read_json_element_append() */
+
+static
+globus_result_t
+globus_l_dsi_rest_read_json_element_deliver(
+    globus_i_dsi_rest_read_json_elements_arg_t
+                                       *jdata,
+    const char                         *data,
+    size_t                              length)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    json_t                             *element = NULL;
+    json_error_t                        error;
+
+    if (jdata->element_used > 0)
+    {
+        /* Element began in an earlier read */
+        result = globus_l_dsi_rest_read_json_element_append(
+                jdata, data, length);
+        if (result != GLOBUS_SUCCESS)
+        {
+            goto done;
+        }
+        data = jdata->element;
+        length = jdata->element_used;
+    }
+
+    /* Elements may be any value, not only arrays and objects */
+    element = json_loadb(data, length, JSON_DECODE_ANY, &error);
+    if (element == NULL)
+    {
+        result = GlobusDsiRestErrorJson(data, length, &error);
+        goto done;
+    }
+    if (jdata->arg.element_callback != NULL)
+    {
+        result = jdata->arg.element_callback(
+                jdata->arg.element_callback_arg,
+                element);
+    }
+    json_decref(element);
+
+done:
+    jdata->element_used = 0;
+    jdata->in_element = false;
+
+    return result;
+}
+/* globus_l_dsi_rest_read_json_element_deliver() */
+
+static
+globus_result_t
+globus_l_dsi_rest_read_json_elements(
+    void                               *read_callback_arg,
+    void                               *buffer,
+    size_t                              buffer_length)
+{
+    globus_i_dsi_rest_read_json_elements_arg_t
+                                       *jdata = read_callback_arg;
+    const char                         *data = buffer;
+    const char                         *array_key = jdata->arg.array_key;
+    size_t                              element_start = 0;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (buffer_length == 0)
+    {
+        /* Final read */
+        if (jdata->array_depth != 0 && !jdata->array_done)
+        {
+            result = GlobusDsiRestErrorParse("truncated json array");
+        }
+        goto done;
+    }
+
+    for (size_t i = 0; i < buffer_length && !jdata->array_done; i++)
+    {
+        char                            c = data[i];
+
+        if (jdata->in_string)
+        {
+            if (!jdata->escape && !jdata->in_key)
+            {
+                /* Skip to the next quote or escape */
+                while (c != '"' && c != '\\' && ++i < buffer_length)
+                {
+                    c = data[i];
+                }
+                if (i == buffer_length)
+                {
+                    break;
+                }
+            }
+            if (jdata->escape)
+            {
+                jdata->escape = false;
+            }
+            else if (c == '\\')
+            {
+                jdata->escape = true;
+            }
+            else if (c == '"')
+            {
+                jdata->in_string = false;
+                if (jdata->in_key)
+                {
+                    jdata->in_key = false;
+                    jdata->key_found = jdata->key_matches
+                        && array_key[jdata->key_matched] == '\0';
+                }
+                continue;
+            }
+            if (jdata->in_key && jdata->key_matches)
+            {
+                if (array_key[jdata->key_matched] == c)
+                {
+                    jdata->key_matched++;
+                }
+                else
+                {
+                    jdata->key_matches = false;
+                }
+            }
+            continue;
+        }
+
+        switch (c)
+        {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+
+            case ':':
+                if (jdata->depth == 1)
+                {
+                    jdata->expect_key = false;
+                }
+                break;
+
+            case ',':
+            case '}':
+            case ']':
+                if (jdata->in_element && jdata->depth == jdata->array_depth)
+                {
+                    /* End of an element */
+                    result = globus_l_dsi_rest_read_json_element_deliver(
+                            jdata,
+                            data + element_start,
+                            i - element_start);
+                    if (result != GLOBUS_SUCCESS)
+                    {
+                        goto done;
+                    }
+                }
+                if (c == ',')
+                {
+                    if (jdata->depth == 1)
+                    {
+                        jdata->expect_key = jdata->top_level_object;
+                    }
+                }
+                else if (jdata->depth > 0)
+                {
+                    jdata->depth--;
+                    if (jdata->depth < jdata->array_depth)
+                    {
+                        jdata->array_done = true;
+                    }
+                }
+                break;
+
+            default:
+                if (c == '"' && jdata->depth == 1 && jdata->expect_key)
+                {
+                    jdata->in_string = true;
+                    jdata->in_key = true;
+                    jdata->key_matched = 0;
+                    jdata->key_matches = (array_key != NULL);
+                    break;
+                }
+
+                /* Start of a value */
+                if (jdata->array_depth == 0)
+                {
+                    if (c == '['
+                        && ((array_key == NULL && jdata->depth == 0)
+                            || (jdata->depth == 1 && jdata->key_found)))
+                    {
+                        jdata->array_depth = jdata->depth + 1;
+                    }
+                    if (jdata->depth == 1)
+                    {
+                        jdata->key_found = false;
+                    }
+                }
+                else if (jdata->depth == jdata->array_depth
+                    && !jdata->in_element)
+                {
+                    jdata->in_element = true;
+                    element_start = i;
+                }
+
+                if (c == '"')
+                {
+                    jdata->in_string = true;
+                }
+                else if (c == '{' || c == '[')
+                {
+                    if (jdata->depth == 0 && c == '{')
+                    {
+                        jdata->top_level_object = true;
+                        jdata->expect_key = true;
+                    }
+                    jdata->depth++;
+                }
+                break;
+        }
+    }
+
+    if (jdata->in_element)
+    {
+        /* Hold on to the start of an element that continues in the next
+         * read
+         */
+        result = globus_l_dsi_rest_read_json_element_append(
+                jdata,
+                data + element_start,
+                buffer_length - element_start);
+    }
+
+done:
+    GlobusDsiRestExitResult(result);
+
+    return result;
+}
+/* globus_l_dsi_rest_read_json_elements() */
+
+globus_dsi_rest_read_t const            globus_dsi_rest_read_json_elements
+                                      = globus_l_dsi_rest_read_json_elements;
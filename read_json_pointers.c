@@ -0,0 +1,617 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file read_json_pointers.c GridFTP DSI REST Read JSON Pointers Callback
+ * @details
+ *     Scans the response as it arrives, keeping the type and index of each
+ *     open container and, for each pointer, how many of its tokens match
+ *     the path to the current position. Member names are only kept when
+ *     some pointer could match them. When a value starts at a path which a
+ *     pointer refers to, its bytes are parsed with json_loadb() once it
+ *     ends; pointers to values inside it are then looked up in the result.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+static
+globus_result_t
+globus_l_dsi_rest_read_json_pointers_append(
+    char                              **buffer,
+    size_t                             *used,
+    size_t                             *len,
+    const char                         *data,
+    size_t                              length)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    if (length == 0)
+    {
+        goto done;
+    }
+    if (*len - *used < length)
+    {
+        size_t                          new_len = *len * 2;
+        char                           *resized;
+
+        if (new_len < *used + length)
+        {
+            new_len = *used + length;
+        }
+        resized = realloc(*buffer, new_len);
+        if (resized == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto done;
+        }
+        *buffer = resized;
+        *len = new_len;
+    }
+    memcpy(*buffer + *used, data, length);
+    *used += length;
+
+done:
+    return result;
+}
+/* globus_l_dsi_rest_read_json_pointers_append() */
+
+static
+globus_result_t
+globus_l_dsi_rest_json_pointer_parse(
+    globus_i_dsi_rest_json_pointer_t   *pointer,
+    const char                         *string)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    size_t                              count = 0;
+    char                               *out;
+
+    GlobusDsiRestEnter();
+
+    if (string == NULL || (string[0] != '\0' && string[0] != '/'))
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto done;
+    }
+    for (const char *p = string; *p != '\0'; p++)
+    {
+        if (*p == '/')
+        {
+            count++;
+        }
+    }
+    pointer->copy = malloc(strlen(string) + 1);
+    pointer->tokens = calloc(count + 1,
+            sizeof(globus_i_dsi_rest_json_pointer_token_t));
+    if (pointer->copy == NULL || pointer->tokens == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+
+    out = pointer->copy;
+    for (const char *p = string; *p != '\0'; )
+    {
+        globus_i_dsi_rest_json_pointer_token_t
+                                       *token;
+
+        token = &pointer->tokens[pointer->count++];
+
+        /* Skip the '/' and decode ~1 and ~0 up to the next one */
+        token->name = out;
+        for (p++; *p != '\0' && *p != '/'; p++)
+        {
+            if (*p == '~' && (p[1] == '0' || p[1] == '1'))
+            {
+                *out++ = (p[1] == '0') ? '~' : '/';
+                p++;
+            }
+            else
+            {
+                *out++ = *p;
+            }
+        }
+        token->length = out - token->name;
+        *out++ = '\0';
+
+        token->index = -1;
+        if (token->length > 0
+            && strspn(token->name, "0123456789") == token->length
+            && (token->name[0] != '0' || token->length == 1)
+            && token->length < 19)
+        {
+            token->index = strtol(token->name, NULL, 10);
+        }
+    }
+
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_json_pointer_parse() */
+
+/**
+ * @brief Prepare to read values from a JSON response
+ * @details
+ *     Parses the pointers in arg into tokens and allocates room to track
+ *     the containers they pass through. Sets each of the caller's values
+ *     to NULL.
+ */
+globus_result_t
+globus_i_dsi_rest_read_json_pointers_init(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata,
+    const globus_dsi_rest_read_json_pointers_arg_t
+                                       *arg)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    *jdata = (globus_i_dsi_rest_read_json_pointers_arg_t)
+    {
+        .values = arg->values,
+    };
+    jdata->pointers = calloc(arg->count + 1,
+            sizeof(globus_i_dsi_rest_json_pointer_t));
+    if (jdata->pointers == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+    for (size_t i = 0; i < arg->count; i++)
+    {
+        arg->values[i] = NULL;
+    }
+    for (size_t i = 0; i < arg->count; i++)
+    {
+        jdata->count++;
+        result = globus_l_dsi_rest_json_pointer_parse(
+                &jdata->pointers[i],
+                arg->pointers[i]);
+        if (result != GLOBUS_SUCCESS)
+        {
+            goto done;
+        }
+        if (jdata->pointers[i].count > jdata->max_tokens)
+        {
+            jdata->max_tokens = jdata->pointers[i].count;
+        }
+    }
+    jdata->container_object = calloc(jdata->max_tokens + 1, sizeof(bool));
+    jdata->container_index = calloc(jdata->max_tokens + 1, sizeof(long));
+    if (jdata->container_object == NULL || jdata->container_index == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_i_dsi_rest_read_json_pointers_init() */
+
+void
+globus_i_dsi_rest_read_json_pointers_destroy(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata)
+{
+    if (jdata->pointers != NULL)
+    {
+        for (size_t i = 0; i < jdata->count; i++)
+        {
+            free(jdata->pointers[i].copy);
+            free(jdata->pointers[i].tokens);
+        }
+        free(jdata->pointers);
+        jdata->pointers = NULL;
+    }
+    free(jdata->container_object);
+    jdata->container_object = NULL;
+    free(jdata->container_index);
+    jdata->container_index = NULL;
+    free(jdata->key);
+    jdata->key = NULL;
+    free(jdata->capture);
+    jdata->capture = NULL;
+}
+/* globus_i_dsi_rest_read_json_pointers_destroy() */
+
+/*
+ * Whether a member name of the object at the current depth could be the
+ * next token of some pointer.
+ */
+static
+bool
+globus_l_dsi_rest_read_json_pointers_key_wanted(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata)
+{
+    for (size_t i = 0; i < jdata->count; i++)
+    {
+        if (jdata->values[i] == NULL
+            && jdata->pointers[i].matched >= jdata->depth - 1
+            && jdata->pointers[i].count >= jdata->depth)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/* globus_l_dsi_rest_read_json_pointers_key_wanted() */
+
+/*
+ * Move the path at the current depth to a new member name or array index,
+ * updating how much of each pointer matches it.
+ */
+static
+void
+globus_l_dsi_rest_read_json_pointers_token(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata,
+    const char                         *name,
+    size_t                              length,
+    long                                index)
+{
+    size_t                              level = jdata->depth;
+
+    for (size_t i = 0; i < jdata->count; i++)
+    {
+        globus_i_dsi_rest_json_pointer_t
+                                       *pointer = &jdata->pointers[i];
+        const globus_i_dsi_rest_json_pointer_token_t
+                                       *token;
+
+        if (pointer->matched < level - 1)
+        {
+            continue;
+        }
+        pointer->matched = level - 1;
+        if (pointer->count < level)
+        {
+            continue;
+        }
+        token = &pointer->tokens[level - 1];
+        if (name != NULL
+            ? (token->length == length
+                && memcmp(token->name, name, length) == 0)
+            : token->index == index)
+        {
+            pointer->matched = level;
+        }
+    }
+}
+/* globus_l_dsi_rest_read_json_pointers_token() */
+
+/*
+ * At the start of a value, decide whether to capture it. It is captured
+ * if some pointer without a value refers to it, and every pointer without
+ * a value that refers into it is marked to be looked up in it.
+ */
+static
+bool
+globus_l_dsi_rest_read_json_pointers_value_start(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata)
+{
+    bool                                capture = false;
+
+    for (size_t i = 0; i < jdata->count; i++)
+    {
+        globus_i_dsi_rest_json_pointer_t
+                                       *pointer = &jdata->pointers[i];
+
+        pointer->capture = (jdata->values[i] == NULL
+            && pointer->matched == jdata->depth);
+        if (pointer->capture && pointer->count == jdata->depth)
+        {
+            capture = true;
+        }
+    }
+    return capture;
+}
+/* globus_l_dsi_rest_read_json_pointers_value_start() */
+
+static
+globus_result_t
+globus_l_dsi_rest_read_json_pointers_deliver(
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata,
+    const char                         *data,
+    size_t                              length)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    json_t                             *value = NULL;
+    json_error_t                        error;
+
+    if (jdata->capture_used > 0)
+    {
+        /* Value began in an earlier read */
+        result = globus_l_dsi_rest_read_json_pointers_append(
+                &jdata->capture,
+                &jdata->capture_used,
+                &jdata->capture_len,
+                data,
+                length);
+        if (result != GLOBUS_SUCCESS)
+        {
+            goto done;
+        }
+        data = jdata->capture;
+        length = jdata->capture_used;
+    }
+
+    GlobusDsiRestDebug("%.*s\n", (int) length, data);
+    /* The value may be a string, number or literal, not only a container */
+    value = json_loadb(data, length, JSON_DECODE_ANY, &error);
+    if (value == NULL)
+    {
+        result = GlobusDsiRestErrorJson(data, length, &error);
+        goto done;
+    }
+
+    for (size_t i = 0; i < jdata->count; i++)
+    {
+        globus_i_dsi_rest_json_pointer_t
+                                       *pointer = &jdata->pointers[i];
+        json_t                         *found = value;
+
+        if (!pointer->capture)
+        {
+            continue;
+        }
+        pointer->capture = false;
+        for (size_t t = jdata->capture_depth;
+             found != NULL && t < pointer->count;
+             t++)
+        {
+            if (json_is_object(found))
+            {
+                found = json_object_get(found, pointer->tokens[t].name);
+            }
+            else if (json_is_array(found) && pointer->tokens[t].index >= 0)
+            {
+                found = json_array_get(
+                        found, (size_t) pointer->tokens[t].index);
+            }
+            else
+            {
+                found = NULL;
+            }
+        }
+        if (found != NULL)
+        {
+            jdata->values[i] = json_incref(found);
+            jdata->found++;
+        }
+    }
+    json_decref(value);
+
+done:
+    jdata->capture_used = 0;
+    jdata->capturing = false;
+
+    return result;
+}
+/* globus_l_dsi_rest_read_json_pointers_deliver() */
+
+static
+globus_result_t
+globus_l_dsi_rest_read_json_pointers(
+    void                               *read_callback_arg,
+    void                               *buffer,
+    size_t                              buffer_length)
+{
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *jdata = read_callback_arg;
+    const char                         *data = buffer;
+    size_t                              key_start = 0;
+    size_t                              capture_start = 0;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (buffer_length == 0)
+    {
+        /* Final read, a top-level value ends here */
+        if (jdata->capturing)
+        {
+            result = globus_l_dsi_rest_read_json_pointers_deliver(
+                    jdata, NULL, 0);
+        }
+        goto done;
+    }
+
+    for (size_t i = 0; i < buffer_length && jdata->found < jdata->count; i++)
+    {
+        char                            c = data[i];
+
+        if (jdata->in_string)
+        {
+            if (!jdata->escape)
+            {
+                /* Skip to the next quote or escape */
+                while (c != '"' && c != '\\' && ++i < buffer_length)
+                {
+                    c = data[i];
+                }
+                if (i == buffer_length)
+                {
+                    break;
+                }
+            }
+            if (jdata->escape)
+            {
+                jdata->escape = false;
+            }
+            else if (c == '\\')
+            {
+                jdata->escape = true;
+            }
+            else
+            {
+                jdata->in_string = false;
+                if (jdata->in_key)
+                {
+                    jdata->in_key = false;
+                    result = globus_l_dsi_rest_read_json_pointers_append(
+                            &jdata->key,
+                            &jdata->key_used,
+                            &jdata->key_len,
+                            data + key_start,
+                            i - key_start);
+                    if (result != GLOBUS_SUCCESS)
+                    {
+                        goto done;
+                    }
+                    globus_l_dsi_rest_read_json_pointers_token(
+                            jdata, jdata->key, jdata->key_used, -1);
+                }
+            }
+            continue;
+        }
+
+        switch (c)
+        {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+
+            case ':':
+                jdata->expect_key = false;
+                break;
+
+            case ',':
+            case '}':
+            case ']':
+                if (jdata->capturing && jdata->depth == jdata->capture_depth)
+                {
+                    result = globus_l_dsi_rest_read_json_pointers_deliver(
+                            jdata,
+                            data + capture_start,
+                            i - capture_start);
+                    if (result != GLOBUS_SUCCESS)
+                    {
+                        goto done;
+                    }
+                }
+                if (c != ',')
+                {
+                    jdata->expect_key = false;
+                    if (jdata->depth > 0)
+                    {
+                        jdata->depth--;
+                    }
+                }
+                else if (!jdata->capturing
+                    && jdata->depth > 0
+                    && jdata->depth <= jdata->max_tokens)
+                {
+                    if (jdata->container_object[jdata->depth - 1])
+                    {
+                        jdata->expect_key = true;
+                    }
+                    else
+                    {
+                        jdata->container_index[jdata->depth - 1]++;
+                    }
+                }
+                break;
+
+            default:
+                if (c == '"' && jdata->expect_key && !jdata->capturing)
+                {
+                    /* Member name */
+                    jdata->in_string = true;
+                    jdata->in_key =
+                        globus_l_dsi_rest_read_json_pointers_key_wanted(jdata);
+                    jdata->key_used = 0;
+                    key_start = i + 1;
+                    break;
+                }
+
+                /* Start of a value */
+                if (!jdata->capturing)
+                {
+                    if (jdata->depth > 0
+                        && jdata->depth <= jdata->max_tokens
+                        && !jdata->container_object[jdata->depth - 1])
+                    {
+                        globus_l_dsi_rest_read_json_pointers_token(
+                                jdata,
+                                NULL,
+                                0,
+                                jdata->container_index[jdata->depth - 1]);
+                    }
+                    if (globus_l_dsi_rest_read_json_pointers_value_start(
+                                jdata))
+                    {
+                        jdata->capturing = true;
+                        jdata->capture_depth = jdata->depth;
+                        capture_start = i;
+                    }
+                }
+
+                if (c == '"')
+                {
+                    jdata->in_string = true;
+                }
+                else if (c == '{' || c == '[')
+                {
+                    if (!jdata->capturing && jdata->depth < jdata->max_tokens)
+                    {
+                        jdata->container_object[jdata->depth] = (c == '{');
+                        jdata->container_index[jdata->depth] = 0;
+                    }
+                    jdata->expect_key = (c == '{');
+                    jdata->depth++;
+                }
+                break;
+        }
+    }
+
+    if (jdata->in_key)
+    {
+        result = globus_l_dsi_rest_read_json_pointers_append(
+                &jdata->key,
+                &jdata->key_used,
+                &jdata->key_len,
+                data + key_start,
+                buffer_length - key_start);
+    }
+    else if (jdata->capturing)
+    {
+        result = globus_l_dsi_rest_read_json_pointers_append(
+                &jdata->capture,
+                &jdata->capture_used,
+                &jdata->capture_len,
+                data + capture_start,
+                buffer_length - capture_start);
+    }
+
+done:
+    GlobusDsiRestExitResult(result);
+
+    return result;
+}
+/* globus_l_dsi_rest_read_json_pointers() */
+
+globus_dsi_rest_read_t const            globus_dsi_rest_read_json_pointers
+                                      = globus_l_dsi_rest_read_json_pointers;
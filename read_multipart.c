@@ -22,6 +22,404 @@
 
 #include "globus_i_dsi_rest.h"
 
+/**
+ * @brief Pass data from the current section of a multipart response on
+ * @details
+ *     Data in a part's header section is collected in the header buffer,
+ *     data in its body is passed to the part's data_read_callback, and
+ *     the preamble and epilogue are dropped.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_read_multipart_deliver(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *state,
+    const void                         *data,
+    size_t                              data_length)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    if (data_length == 0)
+    {
+        goto done;
+    }
+    if (state->need_header)
+    {
+        if (state->header_buffer_length - state->header_buffer_offset
+                <= data_length)
+        {
+            char                       *header_buffer = NULL;
+            size_t                      header_buffer_length;
+
+            header_buffer_length = state->header_buffer_length
+                ? state->header_buffer_length : 256;
+            while (header_buffer_length - state->header_buffer_offset
+                    <= data_length)
+            {
+                header_buffer_length *= 2;
+            }
+            header_buffer = realloc(
+                state->header_buffer,
+                header_buffer_length);
+            if (header_buffer == NULL)
+            {
+                result = GlobusDsiRestErrorMemory();
+                goto done;
+            }
+            state->header_buffer = header_buffer;
+            state->header_buffer_length = header_buffer_length;
+        }
+
+        memcpy(
+            state->header_buffer + state->header_buffer_offset,
+            data,
+            data_length);
+
+        state->header_buffer_offset += data_length;
+        state->header_buffer[state->header_buffer_offset] = 0;
+    }
+    else if (state->part_index != (size_t) -1
+        && state->part_index < state->num_parts)
+    {
+        globus_i_dsi_rest_read_part_t  *part = &state->parts[state->part_index];
+
+        result = part->data_read_callback(
+            part->data_read_callback_arg,
+            (void *) data,
+            data_length);
+    }
+done:
+    return result;
+}
+/* globus_l_dsi_rest_read_multipart_deliver() */
+
+/**
+ * @brief Handle a complete delimiter
+ * @details
+ *     At the end of a header section, parse the part's headers and call
+ *     its response callback. At the end of a part's body, signal end of
+ *     data to its data_read_callback, and move on to the next part.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_read_multipart_boundary(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *state,
+    const globus_i_dsi_rest_delimiter_t
+                                       *delimiter)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    if (state->need_header)
+    {
+        char                           *start;
+        char                           *next;
+        char                           *crlf = NULL;
+
+        /* Keep the delimiter, so that every header line ends with \r\n */
+        result = globus_l_dsi_rest_read_multipart_deliver(
+            state,
+            delimiter->string,
+            delimiter->length);
+        if (result != GLOBUS_SUCCESS)
+        {
+            goto done;
+        }
+        start = next = state->header_buffer;
+
+        if (state->parts[state->part_index].response_callback != NULL)
+        {
+            for (crlf = strstr(next, "\r\n");
+                crlf != NULL;
+                next = crlf+2, crlf = strstr(next, "\r\n"))
+            {
+                if (crlf[2] != ' ' && crlf[2] != '\t')
+                {
+                    result = globus_i_dsi_rest_header_parse(
+                        state->arena,
+                        &state->parts[state->part_index].header_block,
+                        start,
+                        crlf-start);
+                    if (result != GLOBUS_SUCCESS)
+                    {
+                        goto done;
+                    }
+                    start = crlf+2;
+                }
+            }
+            result = globus_i_dsi_rest_header_block_key_array(
+                state->arena,
+                &state->parts[state->part_index].header_block,
+                &state->parts[state->part_index].headers);
+            if (result != GLOBUS_SUCCESS)
+            {
+                goto done;
+            }
+            result = state->parts[state->part_index].response_callback(
+                state->parts[state->part_index].response_callback_arg,
+                0,
+                NULL,
+                &state->parts[state->part_index].headers);
+        }
+
+        state->need_header = false;
+        state->header_buffer_offset = 0;
+    }
+    else if (state->part_index == (size_t) -1)
+    {
+        GlobusDsiRestDebug("Finished preface\n");
+
+        state->part_index++;
+        state->need_header = (state->num_parts > 0);
+    }
+    else
+    {
+        globus_i_dsi_rest_read_part_t  *part = &state->parts[state->part_index];
+
+        GlobusDsiRestDebug("Finished parsing part %zu\n", state->part_index);
+
+        /* Whatever follows, this part's data is complete */
+        result = part->data_read_callback(
+            part->data_read_callback_arg,
+            delimiter->string,
+            0);
+        state->need_suffix = true;
+        state->suffix_length = 0;
+    }
+done:
+    return result;
+}
+/* globus_l_dsi_rest_read_multipart_boundary() */
+
+/**
+ * @brief Handle the two bytes after a body's delimiter
+ * @details
+ *     \r\n starts another part, and -- ends the body, so that a reply
+ *     with fewer parts than expected ends the part before the missing ones
+ *     instead of running into the epilogue.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_read_multipart_suffix(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *state)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    state->need_suffix = false;
+    if (memcmp(state->suffix, "\r\n", 2) == 0)
+    {
+        state->part_index++;
+        state->need_header = (state->part_index < state->num_parts);
+    }
+    else if (memcmp(state->suffix, "--", 2) == 0)
+    {
+        GlobusDsiRestDebug(
+            "Finished body after %zu of %zu parts\n",
+            state->part_index + 1,
+            state->num_parts);
+
+        /* Ignore the epilogue */
+        state->part_index = state->num_parts;
+    }
+    else
+    {
+        result = GlobusDsiRestErrorParse(state->boundary);
+    }
+    return result;
+}
+/* globus_l_dsi_rest_read_multipart_suffix() */
+
+/**
+ * @brief Find the first occurrence of a delimiter in a buffer
+ * @details
+ *     Boyer-Moore-Horspool search: compare the last byte of the delimiter
+ *     at each position, and on a mismatch skip ahead by the distance from
+ *     that byte's last occurrence in the delimiter to its end. For the
+ *     usual boundaries of 30 or more bytes, most of the data is never
+ *     looked at.
+ */
+static
+const unsigned char *
+globus_l_dsi_rest_read_multipart_search(
+    const unsigned char                *data,
+    size_t                              data_length,
+    const globus_i_dsi_rest_delimiter_t
+                                       *delimiter)
+{
+    const unsigned char                *needle;
+    size_t                              last = delimiter->length - 1;
+
+    if (data_length < delimiter->length)
+    {
+        return NULL;
+    }
+    needle = (const unsigned char *) delimiter->string;
+    for (size_t i = 0;
+        i <= data_length - delimiter->length;
+        i += delimiter->skip[data[i + last]])
+    {
+        if (data[i + last] == needle[last]
+            && memcmp(data + i, needle, last) == 0)
+        {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+/* globus_l_dsi_rest_read_multipart_search() */
+
+/**
+ * @brief Advance a partial delimiter match by one byte
+ * @details
+ *     KMP step: on a mismatch fall back to the longest prefix of the
+ *     delimiter that is also a suffix of the matched bytes, instead of
+ *     starting over, so that a delimiter overlapping a partial match is
+ *     still found.
+ */
+static
+size_t
+globus_l_dsi_rest_read_multipart_step(
+    const globus_i_dsi_rest_delimiter_t
+                                       *delimiter,
+    size_t                              matched,
+    unsigned char                       c)
+{
+    while (matched > 0 && (unsigned char) delimiter->string[matched] != c)
+    {
+        matched = delimiter->fallback[matched];
+    }
+    if ((unsigned char) delimiter->string[matched] == c)
+    {
+        matched++;
+    }
+    return matched;
+}
+/* globus_l_dsi_rest_read_multipart_step() */
+
+/**
+ * @brief Compute a delimiter's search tables
+ * @details
+ *     Takes ownership of string, which is freed on failure.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_delimiter_init(
+    globus_i_dsi_rest_delimiter_t      *delimiter,
+    char                               *string)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    size_t                              length;
+
+    if (string == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto string_fail;
+    }
+    length = strlen(string);
+    delimiter->fallback = malloc((length + 1) * sizeof(size_t));
+    if (delimiter->fallback == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto fallback_fail;
+    }
+    delimiter->string = string;
+    delimiter->length = length;
+
+    delimiter->fallback[0] = delimiter->fallback[1] = 0;
+    for (size_t i = 1; i < length; i++)
+    {
+        delimiter->fallback[i+1] = globus_l_dsi_rest_read_multipart_step(
+            delimiter, delimiter->fallback[i], string[i]);
+    }
+    for (size_t i = 0; i < 256; i++)
+    {
+        delimiter->skip[i] = length;
+    }
+    for (size_t i = 0; i < length - 1; i++)
+    {
+        delimiter->skip[(unsigned char) string[i]] = length - 1 - i;
+    }
+
+    return result;
+
+fallback_fail:
+    free(string);
+string_fail:
+    return result;
+}
+/* globus_l_dsi_rest_delimiter_init() */
+
+/**
+ * @brief Build the delimiters for a multipart response's boundary
+ * @details
+ *     Called when the boundary is parsed from the response's Content-Type,
+ *     so that the read callback does no formatting of its own.
+ */
+globus_result_t
+globus_i_dsi_rest_read_multipart_delimiters_init(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *read_multipart)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    const char                         *boundary = read_multipart->boundary;
+
+    GlobusDsiRestEnter();
+
+    globus_i_dsi_rest_read_multipart_delimiters_destroy(read_multipart);
+
+    if (boundary == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+    result = globus_l_dsi_rest_delimiter_init(
+        &read_multipart->delimiters[GLOBUS_I_DSI_REST_DELIMITER_HEADER_END],
+        strdup("\r\n\r\n"));
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto fail;
+    }
+    result = globus_l_dsi_rest_delimiter_init(
+        &read_multipart->delimiters[GLOBUS_I_DSI_REST_DELIMITER_OPENING],
+        globus_common_create_string("--%s\r\n", boundary));
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto fail;
+    }
+    result = globus_l_dsi_rest_delimiter_init(
+        &read_multipart->delimiters[GLOBUS_I_DSI_REST_DELIMITER_BODY_END],
+        globus_common_create_string("\r\n--%s", boundary));
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto fail;
+    }
+done:
+    GlobusDsiRestExitResult(result);
+    return result;
+
+fail:
+    globus_i_dsi_rest_read_multipart_delimiters_destroy(read_multipart);
+    goto done;
+}
+/* globus_i_dsi_rest_read_multipart_delimiters_init() */
+
+void
+globus_i_dsi_rest_read_multipart_delimiters_destroy(
+    globus_i_dsi_rest_read_multipart_arg_t
+                                       *read_multipart)
+{
+    for (int i = 0; i < GLOBUS_I_DSI_REST_DELIMITER_COUNT; i++)
+    {
+        free(read_multipart->delimiters[i].string);
+        read_multipart->delimiters[i].string = NULL;
+        free(read_multipart->delimiters[i].fallback);
+        read_multipart->delimiters[i].fallback = NULL;
+        read_multipart->delimiters[i].length = 0;
+    }
+}
+/* globus_i_dsi_rest_read_multipart_delimiters_destroy() */
+
 static
 globus_result_t
 globus_l_dsi_rest_read_multipart(
@@ -32,228 +430,163 @@ globus_l_dsi_rest_read_multipart(
     globus_i_dsi_rest_read_multipart_arg_t
                                        *state = read_callback_arg;
     globus_result_t                     result = GLOBUS_SUCCESS;
-    char                                boundary[state->boundary_length+9];
 
     GlobusDsiRestEnter();
 
-    while (buffer_length > 0)
+    if (state->delimiters[GLOBUS_I_DSI_REST_DELIMITER_OPENING].string == NULL)
+    {
+        /* Not a multipart response (an error page, for example), so there
+         * are no parts to pass it to.
+         */
+        goto done;
+    }
+    if (buffer_length == 0)
+    {
+        /* The end of the response must not fall inside a part */
+        if (!state->need_suffix
+            && (state->part_index == (size_t) -1
+                || state->part_index < state->num_parts))
+        {
+            GlobusDsiRestDebug(
+                "Body ended in part %zd of %zu\n",
+                (ssize_t) state->part_index,
+                state->num_parts);
+
+            result = GlobusDsiRestErrorParse("truncated multipart body");
+        }
+        goto done;
+    }
+
+    while (buffer_length > 0 && result == GLOBUS_SUCCESS)
     {
-        size_t                          boundary_length = 0;
+        const unsigned char            *b = buffer;
+        const globus_i_dsi_rest_delimiter_t
+                                       *delimiter;
         size_t                          scanned = 0;
 
+        if (state->need_suffix)
+        {
+            while (state->suffix_length < 2 && scanned < buffer_length)
+            {
+                state->suffix[state->suffix_length++] = b[scanned++];
+            }
+            if (state->suffix_length == 2)
+            {
+                result = globus_l_dsi_rest_read_multipart_suffix(state);
+            }
+            buffer = ((char *)buffer) + scanned;
+            buffer_length -= scanned;
+            continue;
+        }
+
         /*
          * This breaks the input buffer into chunks
-         * based on the current boundary marker, keeping potential
-         * boundary markers in a buffer if needed.
+         * based on the current boundary marker. A partial match at the end
+         * of the buffer is held back in match_counter: the held bytes are
+         * always the first match_counter bytes of the boundary marker.
          */
         if (state->need_header)
         {
-            /* Boundary between the header section and the body of the part */
-            boundary_length = snprintf(
-                boundary,
-                sizeof(boundary),
-                "\r\n\r\n");
+            delimiter = &state->delimiters[
+                GLOBUS_I_DSI_REST_DELIMITER_HEADER_END];
         }
         else if (state->part_index == ((size_t) - 1))
         {
-            /* Initial boundary (before 1st part) is --${boundary}\r\n */
-            boundary_length = snprintf(
-                boundary,
-                sizeof(boundary),
-                "--%s\r\n",
-                state->boundary);
+            delimiter = &state->delimiters[
+                GLOBUS_I_DSI_REST_DELIMITER_OPENING];
         }
-        else if(state->part_index == (state->num_parts - 1))
+        else if (state->part_index < state->num_parts)
         {
-            /* Final boundary is \r\n--${boundary}--\r\n */
-            boundary_length = snprintf(
-                boundary,
-                sizeof(boundary),
-                "\r\n--%s--\r\n",
-                state->boundary);
+            delimiter = &state->delimiters[
+                GLOBUS_I_DSI_REST_DELIMITER_BODY_END];
         }
         else
         {
-            /* Other boundaries are \r\n--${boundary}\r\n */
-            boundary_length = snprintf(
-                boundary,
-                sizeof(boundary),
-                "\r\n--%s\r\n",
-                state->boundary);
+            /* Epilogue after the final boundary */
+            break;
         }
-        assert (boundary_length < sizeof(boundary));
 
-        for (size_t i = 0;
-            (i < buffer_length) && (state->match_counter < boundary_length);
-            i++)
+        if (state->match_counter > 0)
         {
-            const char                  *b = buffer;
-
-            scanned++;
+            /* Continue a match which started in an earlier buffer */
+            size_t                      matched = state->match_counter;
 
-            if (b[i] != boundary[state->match_counter])
+            while (scanned < buffer_length
+                && matched > 0
+                && matched < delimiter->length)
             {
-                state->match_counter = 0;
-                /*
-                 * Non-match. If there was anything in the boundary buffer,
-                 * pass it on
-                 */
-                if (state->boundary_buffer_offset > 0)
+                if (b[scanned] == (unsigned char) delimiter->string[matched])
                 {
-                    if (state->part_index != (size_t) -1)
-                    {
-                        globus_i_dsi_rest_read_part_t
-                                       *part = &state->parts[state->part_index];
-                        part->data_read_callback(
-                            part->data_read_callback_arg,
-                            state->boundary_buffer,
-                            state->boundary_buffer_offset);
-                    }
-                    state->boundary_buffer_offset = 0;
+                    matched++;
+                    scanned++;
                 }
-            }
-            if (b[i] == boundary[state->match_counter])
-            {
-                state->match_counter++;
-            }
-        }
-
-        GlobusDsiRestDebug(
-            "Scanned %zu bytes, match_counter=%zu\n",
-            scanned,
-            state->match_counter);
-
-        if (state->need_header)
-        {
-            char                       *header_buffer = NULL;
-            header_buffer = realloc(
-                state->header_buffer,
-                state->header_buffer_offset + scanned + 1);
-
-            state->header_buffer = header_buffer;
-
-            memcpy(
-                header_buffer,
-                buffer,
-                scanned);
-
-            state->header_buffer_offset += scanned;
-            state->header_buffer[state->header_buffer_offset] = 0;
-
-            if (state->match_counter == boundary_length)
-            {
-                char                   *start = state->header_buffer;
-                char                   *next = start;
-                char                   *crlf = NULL;
-
-                if (state->parts[state->part_index].response_callback != NULL)
+                else
                 {
-                    for (crlf = strstr(next, "\r\n");
-                        crlf != NULL;
-                        next = crlf+2, crlf = strstr(next, "\r\n"))
-                    {
-                        if (crlf[2] != ' ' && crlf[2] != '\t')
-                        {
-                            result = globus_i_dsi_rest_header_parse(
-                                &state->parts[state->part_index].headers,
-                                start,
-                                crlf-start);
-                            start = crlf+2;
-                        }
-                    }
-                    state->parts[state->part_index].response_callback(
-                        state->parts[state->part_index].response_callback_arg,
-                        0,
-                        NULL,
-                        &state->parts[state->part_index].headers);
+                    /* The bytes no longer part of a match were data */
+                    result = globus_l_dsi_rest_read_multipart_deliver(
+                        state,
+                        delimiter->string,
+                        matched - delimiter->fallback[matched]);
+                    matched = delimiter->fallback[matched];
                 }
-
-                state->need_header = false;
-                state->header_buffer_offset = 0;
-                state->match_counter = 0;
             }
+            state->match_counter = matched;
         }
-        else if (state->match_counter == boundary_length)
+        else
         {
-            globus_i_dsi_rest_read_part_t
-                                       *part = NULL;
-            /* Complete boundary reached */
-            if (state->part_index == (size_t) -1)
+            const unsigned char        *match;
+
+            match = globus_l_dsi_rest_read_multipart_search(
+                b,
+                buffer_length,
+                delimiter);
+            if (match != NULL)
             {
-                GlobusDsiRestDebug("Finished preface\n");
-                state->part_index++;
+                scanned = match - b + delimiter->length;
+                state->match_counter = delimiter->length;
             }
             else
             {
-                GlobusDsiRestData(
-                    "Finished parsing part %zu: %.*s\n",
-                    state->part_index,
-                    (int) scanned - boundary_length,
-                    buffer);
-                part = &state->parts[state->part_index];
-                if (scanned > boundary_length)
+                /* Hold back any suffix which could start a boundary */
+                size_t                  tail = delimiter->length - 1;
+                size_t                  matched = 0;
+
+                if (tail > buffer_length)
                 {
-                    part->data_read_callback(
-                        part->data_read_callback_arg,
-                        buffer,
-                        scanned - boundary_length);
+                    tail = buffer_length;
                 }
-                part->data_read_callback(
-                    part->data_read_callback_arg,
-                    buffer,
-                    0);
-                state->part_index++;
-            }
-            if (state->part_index < state->num_parts)
-            {
-                state->need_header = true;
-            }
-            state->match_counter = 0;
-            state->boundary_buffer_offset = 0;
-        }
-        else if (state->match_counter > 0)
-        {
-            /*
-             * Partial boundary match, call the user callback with the data
-             * before the beginning of the potential match, and save our matched
-             * data in the boundary buffer
-             */
-            if (state->part_index != (size_t) -1)
-            {
-                globus_i_dsi_rest_read_part_t
-                                       *part = &state->parts[state->part_index];
-                part->data_read_callback(
-                    part->data_read_callback_arg,
-                    buffer,
-                    scanned - state->match_counter);
+                for (size_t i = buffer_length - tail; i < buffer_length; i++)
+                {
+                    matched = globus_l_dsi_rest_read_multipart_step(
+                        delimiter, matched, b[i]);
+                }
+                scanned = buffer_length;
+                state->match_counter = matched;
             }
-            memcpy(
-                state->boundary_buffer + state->boundary_buffer_offset,
-                ((char *) buffer) + scanned - state->match_counter,
-                state->match_counter);
-            state->boundary_buffer_offset += state->match_counter;
+            result = globus_l_dsi_rest_read_multipart_deliver(
+                state,
+                b,
+                scanned - state->match_counter);
         }
-        else
+
+        GlobusDsiRestDebug(
+            "Scanned %zu bytes, match_counter=%zu\n",
+            scanned,
+            state->match_counter);
+
+        if (result == GLOBUS_SUCCESS
+            && state->match_counter == delimiter->length)
         {
-            /*
-             * Not a boundary match, pass to the read data
-             * callback
-             */
-            if (state->part_index != (size_t) -1)
-            {
-                globus_i_dsi_rest_read_part_t
-                                       *part = &state->parts[state->part_index];
-                part->data_read_callback(
-                    part->data_read_callback_arg,
-                    buffer,
-                    buffer_length);
-            }
-            state->boundary_buffer_offset = 0;
+            state->match_counter = 0;
+            result = globus_l_dsi_rest_read_multipart_boundary(
+                state,
+                delimiter);
         }
         buffer = ((char *)buffer) + scanned;
         buffer_length -= scanned;
     }
 
+done:
     GlobusDsiRestExitResult(result);
 
     return result;
@@ -25,6 +25,7 @@
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_callbacks(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     const globus_dsi_rest_key_array_t  *headers,
     globus_dsi_rest_write_t             data_write_callback,
@@ -33,6 +34,7 @@ globus_l_dsi_rest_prepare_write_callbacks(
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_multipart_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     globus_dsi_rest_write_multipart_arg_t
                                        *parts);
@@ -40,24 +42,28 @@ globus_l_dsi_rest_prepare_write_multipart_callback(
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_json_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     json_t                             *json);
 
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_form_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     globus_dsi_rest_key_array_t        *form);
 
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_gridftp_op_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg);
 
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_callbacks(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     globus_dsi_rest_read_t              data_read_callback,
     void *                              data_read_callback_arg);
@@ -65,18 +71,37 @@ globus_l_dsi_rest_prepare_read_callbacks(
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_json_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     json_t                            **jsonp);
 
+static
+globus_result_t
+globus_l_dsi_rest_prepare_read_json_elements(
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_read_part_t      *current_part,
+    globus_dsi_rest_read_json_elements_arg_t
+                                       *elements_arg);
+
+static
+globus_result_t
+globus_l_dsi_rest_prepare_read_json_pointers(
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_read_part_t      *current_part,
+    globus_dsi_rest_read_json_pointers_arg_t
+                                       *pointers_arg);
+
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_gridftp_op(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg);
 
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_multipart(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     globus_dsi_rest_read_multipart_arg_t
                                        *multipart_arg);
@@ -84,10 +109,80 @@ globus_l_dsi_rest_prepare_read_multipart(
 static
 globus_result_t
 globus_l_dsi_rest_add_part_header(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     const char                         *key,
     const char                         *value);
 
+static
+globus_result_t
+globus_l_dsi_rest_set_postfields(
+    globus_i_dsi_rest_request_t        *request);
+
+/*
+ * Small form bodies are already in one buffer, and small json bodies are
+ * kept in one when their length is computed, so hand that to libcurl
+ * directly instead of copying it out through the read callback.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_set_postfields(
+    globus_i_dsi_rest_request_t        *request)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_i_dsi_rest_write_block_arg_t*block_arg
+                                      = request->write_part.data_write_callback_arg;
+    CURLcode                            rc = CURLE_OK;
+
+    GlobusDsiRestEnter();
+
+    if (request->write_part.data_write_callback == globus_dsi_rest_write_json)
+    {
+        /* Encoded when its length was computed */
+        globus_i_dsi_rest_write_json_arg_t
+                                       *json_arg = (void *) block_arg;
+
+        block_arg = &json_arg->block;
+    }
+
+    rc = curl_easy_setopt(request->handle,
+            CURLOPT_POSTFIELDSIZE_LARGE,
+            (curl_off_t) block_arg->block_len);
+    if (rc != CURLE_OK)
+    {
+        goto setopt_fail;
+    }
+    /* Switch from upload (PUT) mode if set_request chose it to POST mode */
+    rc = curl_easy_setopt(request->handle, CURLOPT_UPLOAD, 0L);
+    if (rc != CURLE_OK)
+    {
+        goto setopt_fail;
+    }
+    rc = curl_easy_setopt(request->handle,
+            CURLOPT_POSTFIELDS,
+            block_arg->block_data);
+    if (rc != CURLE_OK)
+    {
+        goto setopt_fail;
+    }
+    if (request->method_id != GLOBUS_I_DSI_REST_METHOD_POST)
+    {
+        rc = curl_easy_setopt(request->handle,
+                CURLOPT_CUSTOMREQUEST,
+                request->method);
+    }
+    request->request_postfields = true;
+
+setopt_fail:
+    if (rc != CURLE_OK)
+    {
+        result = GlobusDsiRestErrorCurl(rc);
+    }
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_set_postfields() */
+
 static
 void
 globus_l_dsi_rest_headers_search(
@@ -102,20 +197,196 @@ globus_dsi_rest_request(
     const globus_dsi_rest_key_array_t  *query_parameters,
     const globus_dsi_rest_key_array_t  *headers,
     const globus_dsi_rest_callbacks_t  *callbacks)
+{
+    return globus_dsi_rest_request_header_set(
+            method,
+            uri,
+            query_parameters,
+            NULL,
+            headers,
+            callbacks);
+}
+/* globus_dsi_rest_request() */
+
+globus_result_t
+globus_dsi_rest_request_header_set(
+    const char                         *method,
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    globus_dsi_rest_header_set_t        header_set,
+    const globus_dsi_rest_key_array_t  *headers,
+    const globus_dsi_rest_callbacks_t  *callbacks)
 {
     globus_result_t                     result = GLOBUS_SUCCESS;
-    globus_i_dsi_rest_request_t        *request;
+    globus_i_dsi_rest_prepared_t        prepared;
 
     GlobusDsiRestEnter();
 
-
     if (method == NULL || uri == NULL)
     {
         result = GlobusDsiRestErrorParameter();
         goto bad_params;
     }
 
-    request = malloc(sizeof(globus_i_dsi_rest_request_t));
+    /* Everything but the header set is formatted for this request alone */
+    prepared = (globus_i_dsi_rest_prepared_t)
+    {
+        .method = method,
+        .method_id = globus_i_dsi_rest_method_lookup(method),
+        .uri = uri,
+        .header_set = header_set,
+        .headers_set_length = (header_set != NULL)
+                && header_set->set_length,
+    };
+    if (headers != NULL)
+    {
+        prepared.headers = *headers;
+        prepared.headers_set_length = prepared.headers_set_length
+                || globus_i_dsi_rest_headers_set_length(headers);
+    }
+
+    result = globus_i_dsi_rest_request_start(
+            &prepared,
+            NULL,
+            query_parameters,
+            callbacks);
+
+bad_params:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_request_header_set() */
+
+/**
+ * @brief Build the complete URI of a request
+ * @details
+ *     The path and prepared query are copied after the base URI, and then
+ *     query_parameters are encoded after them, joined to the prepared
+ *     query with '&'. Without a path or query parameters, the prepared URI
+ *     is used as is.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_request_uri(
+    globus_i_dsi_rest_arena_t          *arena,
+    const globus_i_dsi_rest_prepared_t *prepared,
+    const char                         *path,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    char                              **complete_urip)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    const char                         *query = prepared->query;
+    size_t                              uri_len = 0;
+    size_t                              path_len = 0;
+    size_t                              query_len = 0;
+    char                               *base = NULL;
+    bool                                more_query = false;
+
+    if (query == NULL)
+    {
+        query = "";
+    }
+    for (size_t i = 0; query_parameters != NULL
+            && i < query_parameters->count; i++)
+    {
+        if (query_parameters->key_value[i].key != NULL
+            && query_parameters->key_value[i].value != NULL)
+        {
+            more_query = true;
+            break;
+        }
+    }
+    if (path == NULL && *query == 0)
+    {
+        /* Same as an unprepared request */
+        result = globus_i_dsi_rest_uri_add_query(
+                arena, prepared->uri, query_parameters, complete_urip);
+        goto done;
+    }
+
+    uri_len = strlen(prepared->uri);
+    path_len = (path != NULL) ? strlen(path) : 0;
+    query_len = strlen(query);
+
+    base = globus_i_dsi_rest_arena_alloc(
+            arena, uri_len + path_len + query_len + 1);
+    if (base == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto done;
+    }
+    memcpy(base, prepared->uri, uri_len);
+    if (path_len > 0)
+    {
+        memcpy(base + uri_len, path, path_len);
+    }
+    memcpy(base + uri_len + path_len, query, query_len + 1);
+
+    if (!more_query)
+    {
+        *complete_urip = base;
+        goto done;
+    }
+    result = globus_i_dsi_rest_uri_add_query(
+            arena, base, query_parameters, complete_urip);
+    if (result == GLOBUS_SUCCESS && query_len > 0)
+    {
+        /* Continue the prepared query instead of starting another */
+        (*complete_urip)[uri_len + path_len + query_len] = '&';
+    }
+
+done:
+    return result;
+}
+/* globus_l_dsi_rest_request_uri() */
+
+/**
+ * @brief Build the libcurl header list of a request
+ * @details
+ *     Headers which aren't already in the prepared header set, including
+ *     those added for the body, are formatted for each request.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_request_headers(
+    globus_i_dsi_rest_request_t        *request,
+    const globus_i_dsi_rest_prepared_t *prepared)
+{
+    globus_dsi_rest_key_array_t         added = request->write_part.headers;
+
+    if (prepared->headers_rendered > 0)
+    {
+        /* The write callbacks add theirs after the prepared headers */
+        added.count -= prepared->headers_rendered;
+        added.key_value += prepared->headers_rendered;
+    }
+
+    return globus_i_dsi_rest_compute_headers(
+            &request->arena,
+            &request->request_headers,
+            &added);
+}
+/* globus_l_dsi_rest_request_headers() */
+
+globus_result_t
+globus_i_dsi_rest_request_start(
+    const globus_i_dsi_rest_prepared_t *prepared,
+    const char                         *path,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    const globus_dsi_rest_callbacks_t  *callbacks)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_i_dsi_rest_request_t        *request;
+    globus_i_dsi_rest_arena_t           arena = {0};
+
+    GlobusDsiRestEnter();
+
+    /*
+     * The request is the first thing in its own arena, and everything else
+     * it allocates comes from the same arena.
+     */
+    request = globus_i_dsi_rest_arena_alloc(
+            &arena, sizeof(globus_i_dsi_rest_request_t));
     if (request == NULL)
     {
         result = GlobusDsiRestErrorMemory();
@@ -124,7 +395,9 @@ globus_dsi_rest_request(
 
     *request = (globus_i_dsi_rest_request_t)
     {
-        .method                       = method,
+        .arena                        = arena,
+        .method                       = prepared->method,
+        .method_id                    = prepared->method_id,
         .response_callback            = callbacks->response_callback,
         .response_callback_arg        = callbacks->response_callback_arg,
         .complete_callback            = callbacks->complete_callback,
@@ -134,8 +407,9 @@ globus_dsi_rest_request(
     };
 
     result = globus_l_dsi_rest_prepare_write_callbacks(
+            &request->arena,
             &request->write_part,
-            headers ? headers : &(const globus_dsi_rest_key_array_t) {.count=0},
+            &prepared->headers,
             callbacks->data_write_callback,
             callbacks->data_write_callback_arg);
     if (result != GLOBUS_SUCCESS)
@@ -144,6 +418,7 @@ globus_dsi_rest_request(
     }
 
     result = globus_l_dsi_rest_prepare_read_callbacks(
+        &request->arena,
         &request->read_part,
         callbacks->data_read_callback,
         callbacks->data_read_callback_arg);
@@ -153,6 +428,32 @@ globus_dsi_rest_request(
         goto prepare_read_fail;
     }
 
+    if (callbacks->response_callback == globus_dsi_rest_response)
+    {
+        globus_dsi_rest_response_arg_t *response
+                                      = callbacks->response_callback_arg;
+        globus_dsi_rest_key_array_t    *desired = &response->desired_headers;
+        globus_i_dsi_rest_header_match_slot_t
+                                       *slots;
+
+        /* Desired headers are picked out as they arrive */
+        slots = globus_i_dsi_rest_arena_alloc(
+                &request->arena,
+                globus_i_dsi_rest_header_match_slots(desired->count)
+                    * sizeof(globus_i_dsi_rest_header_match_slot_t));
+        if (slots == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+            goto desired_match_fail;
+        }
+        for (size_t i = 0; i < desired->count; i++)
+        {
+            desired->key_value[i].value = NULL;
+        }
+        globus_i_dsi_rest_header_match_init(
+                &request->desired_match, desired, slots);
+    }
+
     if (callbacks->progress_callback == globus_dsi_rest_progress_idle_timeout)
     {
         request->idle_arg = (globus_i_dsi_rest_idle_arg_t)
@@ -169,35 +470,46 @@ globus_dsi_rest_request(
         goto no_handle;
     }
 
-    result = globus_dsi_rest_uri_add_query(
-            uri, query_parameters, &request->complete_uri);
+    result = globus_l_dsi_rest_request_uri(
+            &request->arena,
+            prepared,
+            path,
+            query_parameters,
+            &request->complete_uri);
 
     if (result != GLOBUS_SUCCESS)
     {
         goto invalid_uri;
     }
 
-    result = globus_i_dsi_rest_compute_headers(
-            &request->request_headers,
-            &request->write_part.headers);
+    result = globus_l_dsi_rest_request_headers(request, prepared);
     if (result != GLOBUS_SUCCESS)
     {
         goto invalid_headers;
     }
-    if (strcmp(method, "POST") == 0
-        || strcmp(method, "PATCH") == 0
-        || strcmp(method, "PUT") == 0
+    if (request->method_id == GLOBUS_I_DSI_REST_METHOD_POST
+        || request->method_id == GLOBUS_I_DSI_REST_METHOD_PATCH
+        || request->method_id == GLOBUS_I_DSI_REST_METHOD_PUT
         || callbacks->data_write_callback != NULL)
     {
-        for (size_t i = 0; i < ((headers != NULL) ? headers->count : 0); i++)
+        if (prepared->headers_set_length)
         {
-            if (strcasecmp(headers->key_value[i].key, "Transfer-Encoding") == 0
-                || strcasecmp(headers->key_value[i].key, "Content-Length") == 0)
-            {
-                goto skip_chunked_header;
-            }
+            goto skip_chunked_header;
+        }
+        /*
+         * If we know how much we'll send, let libcurl send Content-Length
+         * instead of chunking the body.
+         */
+        request->request_content_length_set =
+                globus_i_dsi_rest_write_part_length(
+                        &request->write_part,
+                        &request->request_content_length);
+        if (request->request_content_length_set)
+        {
+            goto skip_chunked_header;
         }
         result = globus_i_dsi_rest_add_header(
+                &request->arena,
                 &request->request_headers,
                 "Transfer-Encoding",
                 "chunked");
@@ -207,10 +519,25 @@ globus_dsi_rest_request(
         }
     }
 skip_chunked_header:
+    if (prepared->header_set != NULL && prepared->header_set->lines != NULL)
+    {
+        struct curl_slist             **lastp = &request->request_headers;
+
+        /*
+         * Nothing may be added to the list after this, as its tail is now
+         * shared with other requests.
+         */
+        while (*lastp != NULL)
+        {
+            lastp = &(*lastp)->next;
+        }
+        *lastp = prepared->header_set->lines;
+    }
     /* Set URI, method, headers */
     result = globus_i_dsi_rest_set_request(
             request->handle,
-            method,
+            request->method,
+            request->method_id,
             request->complete_uri,
             request->request_headers,
             callbacks);
@@ -218,29 +545,96 @@ skip_chunked_header:
     {
         goto invalid_method;
     }
+    if (request->request_content_length_set
+        && request->request_content_length
+                <= (uint64_t) globus_i_dsi_rest_postfields_max
+        && (request->write_part.data_write_callback
+                == globus_dsi_rest_write_json
+            || request->write_part.data_write_callback
+                == globus_dsi_rest_write_form)
+        && request->method_id != GLOBUS_I_DSI_REST_METHOD_HEAD
+        && request->method_id != GLOBUS_I_DSI_REST_METHOD_DELETE)
+    {
+        result = globus_l_dsi_rest_set_postfields(request);
+        if (result != GLOBUS_SUCCESS)
+        {
+            goto invalid_content_length;
+        }
+    }
+    else if (request->request_content_length_set)
+    {
+        CURLcode                        rc;
+
+        /* Upload mode uses INFILESIZE, POST mode uses POSTFIELDSIZE */
+        rc = curl_easy_setopt(request->handle,
+                CURLOPT_INFILESIZE_LARGE,
+                (curl_off_t) request->request_content_length);
+        if (rc == CURLE_OK)
+        {
+            rc = curl_easy_setopt(request->handle,
+                    CURLOPT_POSTFIELDSIZE_LARGE,
+                    (curl_off_t) request->request_content_length);
+        }
+        if (rc != CURLE_OK)
+        {
+            result = GlobusDsiRestErrorCurl(rc);
+            goto invalid_content_length;
+        }
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x073e00
+    if (request->write_part.data_write_callback
+            == globus_dsi_rest_write_gridftp_op)
+    {
+        globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg
+                                      = request->write_part.data_write_callback_arg;
+        globus_size_t                   blocksize;
+        CURLcode                        rc;
+
+        /*
+         * Let libcurl ask for a whole GridFTP block in each read callback,
+         * so blocks are copied out in one piece instead of many small ones.
+         * libcurl clamps this to its own limits.
+         */
+        globus_gridftp_server_get_block_size(gridftp_op_arg->op, &blocksize);
+        rc = curl_easy_setopt(request->handle,
+                CURLOPT_UPLOAD_BUFFERSIZE,
+                (long) blocksize);
+        if (rc != CURLE_OK)
+        {
+            result = GlobusDsiRestErrorCurl(rc);
+            goto invalid_buffer_size;
+        }
+    }
+#endif
 
     result = globus_i_dsi_rest_perform(request);
 
     if (result != GLOBUS_SUCCESS || callbacks->complete_callback == NULL)
     {
+#if LIBCURL_VERSION_NUM >= 0x073e00
+invalid_buffer_size:
+#endif
+invalid_content_length:
 invalid_method:
 invalid_headers:
 invalid_uri:
 no_handle:
+desired_match_fail:
 prepare_read_fail:
 prepare_write_fail:
         globus_i_dsi_rest_request_cleanup(request);
     }
 request_malloc_fail:
-bad_params:
     GlobusDsiRestExitResult(result);
     return result;
 }
-/* globus_dsi_rest_request() */
+/* globus_i_dsi_rest_request_start() */
 
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_callbacks(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     const globus_dsi_rest_key_array_t  *headers,
     globus_dsi_rest_write_t             data_write_callback,
@@ -258,8 +652,8 @@ globus_l_dsi_rest_prepare_write_callbacks(
     };
     if (headers->count > 0)
     {
-        current_part->headers.key_value = calloc(
-                headers->count, sizeof(globus_dsi_rest_key_value_t));
+        current_part->headers.key_value = globus_i_dsi_rest_arena_alloc(
+                arena, headers->count * sizeof(globus_dsi_rest_key_value_t));
         if (current_part->headers.key_value == NULL)
         {
             result = GlobusDsiRestErrorMemory();
@@ -277,6 +671,7 @@ globus_l_dsi_rest_prepare_write_callbacks(
     if (data_write_callback == globus_dsi_rest_write_multipart)
     {
         result = globus_l_dsi_rest_prepare_write_multipart_callback(
+                arena,
                 current_part,
                 data_write_callback_arg);
     }
@@ -290,7 +685,14 @@ globus_l_dsi_rest_prepare_write_callbacks(
         /* We pass a copy of the original arg to the callback so we can
          * track buffer offsets
          */
-        copied_arg = malloc(sizeof(globus_i_dsi_rest_write_block_arg_t));
+        copied_arg = globus_i_dsi_rest_arena_alloc(
+                arena, sizeof(globus_i_dsi_rest_write_block_arg_t));
+        if (copied_arg == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+
+            goto copied_arg_alloc_fail;
+        }
         *copied_arg = (globus_i_dsi_rest_write_block_arg_t)
         {
             .block_data = arg->block_data,
@@ -311,9 +713,19 @@ globus_l_dsi_rest_prepare_write_callbacks(
         /* We pass a copy of the original arg to the callback so we can
          * track buffer offsets
          */
-        block_args = calloc(
+        block_args = globus_i_dsi_rest_arena_calloc(
+            arena,
             arg->block_count,
             sizeof(globus_i_dsi_rest_write_block_arg_t));
+        copied_arg = globus_i_dsi_rest_arena_alloc(
+            arena,
+            sizeof(globus_i_dsi_rest_write_blocks_arg_t));
+        if ((block_args == NULL && arg->block_count > 0) || copied_arg == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
+
+            goto copied_arg_alloc_fail;
+        }
 
         for (size_t i = 0; i < arg->block_count; i++)
         {
@@ -324,7 +736,6 @@ globus_l_dsi_rest_prepare_write_callbacks(
                 .offset = 0,
             };
         }
-        copied_arg = malloc(sizeof(globus_i_dsi_rest_write_blocks_arg_t));
         *copied_arg = (globus_i_dsi_rest_write_blocks_arg_t)
         {
             .blocks = block_args,
@@ -336,27 +747,26 @@ globus_l_dsi_rest_prepare_write_callbacks(
     else if (data_write_callback == globus_dsi_rest_write_json)
     {
         result = globus_l_dsi_rest_prepare_write_json_callback(
+                arena,
                 current_part,
                 data_write_callback_arg);
     }
     else if (data_write_callback == globus_dsi_rest_write_form)
     {
         result = globus_l_dsi_rest_prepare_write_form_callback(
+                arena,
                 current_part,
                 data_write_callback_arg);
     }
     else if (data_write_callback == globus_dsi_rest_write_gridftp_op)
     {
         result = globus_l_dsi_rest_prepare_write_gridftp_op_callback(
+                arena,
                 current_part,
                 data_write_callback_arg);
     }
 
-    if (result != GLOBUS_SUCCESS)
-    {
-        free(current_part->headers.key_value);
-        current_part->headers.key_value = NULL;
-    }
+copied_arg_alloc_fail:
 headers_alloc_fail:
     GlobusDsiRestExitResult(result);
 
@@ -367,6 +777,7 @@ headers_alloc_fail:
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_multipart_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     globus_dsi_rest_write_multipart_arg_t
                                        *parts)
@@ -376,16 +787,23 @@ globus_l_dsi_rest_prepare_write_multipart_callback(
                                        *multipart_write_arg = NULL;
     const char                         *content_type_header = NULL;
 
-    multipart_write_arg = malloc(
+    multipart_write_arg = globus_i_dsi_rest_arena_alloc(
+        arena,
         sizeof(globus_i_dsi_rest_write_multipart_arg_t));
+    current_part->data_write_callback_arg = multipart_write_arg;
+    if (multipart_write_arg == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+
+        goto arg_alloc_fail;
+    }
 
     *multipart_write_arg = (globus_i_dsi_rest_write_multipart_arg_t)
     {
+        .arena = arena,
         .num_parts = parts->num_parts
     };
 
-    current_part->data_write_callback_arg = multipart_write_arg;
-
     /*
      * If a Content-Type header is present, and it's a multipart MIME type
      * we'll copy the boundary from the header and use it.
@@ -425,38 +843,44 @@ globus_l_dsi_rest_prepare_write_multipart_callback(
                     c++;
                 }
             }
-            multipart_write_arg->boundary = malloc(c-b+1);
+            multipart_write_arg->boundary = globus_i_dsi_rest_arena_strndup(
+                    arena, b, c-b);
             if (multipart_write_arg->boundary == NULL)
             {
                 result = GlobusDsiRestErrorMemory();
 
                 goto boundary_malloc_fail;
             }
-            memcpy(multipart_write_arg->boundary, b, c-b);
-            multipart_write_arg->boundary[c-b] = 0;
         }
     }
     else
     {
         globus_uuid_t               uuid;
-        globus_uuid_create(&uuid);
+        char                       *content_type = NULL;
+        size_t                      content_type_len = 0;
 
-        multipart_write_arg->boundary =
-                globus_common_create_string("globus_%s", uuid.text);
+        globus_uuid_create(&uuid);
 
-        if (multipart_write_arg->boundary == NULL)
+        content_type_len = snprintf(NULL, 0,
+                "multipart/related; boundary=globus_%s", uuid.text);
+        content_type = globus_i_dsi_rest_arena_alloc(
+                arena, content_type_len + 1);
+        if (content_type == NULL)
         {
             result = GlobusDsiRestErrorMemory();
 
             goto boundary_malloc_fail;
         }
+        snprintf(content_type, content_type_len + 1,
+                "multipart/related; boundary=globus_%s", uuid.text);
+        /* The boundary is the end of the header value */
+        multipart_write_arg->boundary = strstr(content_type, "globus_");
 
         result = globus_l_dsi_rest_add_part_header(
+                arena,
                 current_part,
-                strdup("Content-Type"),
-                globus_common_create_string(
-                        "multipart/related; boundary=%s",
-                        multipart_write_arg->boundary));
+                "Content-Type",
+                content_type);
         if (result != GLOBUS_SUCCESS)
         {
             goto add_part_header_fail;
@@ -465,12 +889,19 @@ globus_l_dsi_rest_prepare_write_multipart_callback(
     /*
      * Recursively add parts to the multipart_write_arg
      */
-    multipart_write_arg->parts = calloc(
-            parts->num_parts, sizeof(globus_i_dsi_rest_write_part_t));
+    multipart_write_arg->parts = globus_i_dsi_rest_arena_calloc(
+            arena, parts->num_parts, sizeof(globus_i_dsi_rest_write_part_t));
+    if (multipart_write_arg->parts == NULL && parts->num_parts > 0)
+    {
+        result = GlobusDsiRestErrorMemory();
+
+        goto parts_alloc_fail;
+    }
 
     for (size_t i = 0; i < parts->num_parts; i++)
     {
         result = globus_l_dsi_rest_prepare_write_callbacks(
+                arena,
                 &multipart_write_arg->parts[i],
                 &parts->parts[i].part_header,
                 parts->parts[i].data_write_callback,
@@ -486,20 +917,18 @@ globus_l_dsi_rest_prepare_write_multipart_callback(
     if (multipart_write_arg->boundary != NULL)
     {
         result = globus_i_dsi_rest_multipart_boundary_prepare(
+                arena,
                 multipart_write_arg->boundary,
                 false,
                 &multipart_write_arg->parts[0].headers,
                 &multipart_write_arg->current_boundary,
                 &multipart_write_arg->current_boundary_length);
     }
-    if (result != GLOBUS_SUCCESS)
-    {
 part_prepare_fail:
+parts_alloc_fail:
 add_part_header_fail:
-        free(multipart_write_arg->boundary);
-        multipart_write_arg->boundary = NULL;
-    }
 boundary_malloc_fail:
+arg_alloc_fail:
     GlobusDsiRestExitResult(result);
     return result;
 }
@@ -508,40 +937,47 @@ boundary_malloc_fail:
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_json_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     json_t                             *json)
 {
     globus_result_t                     result = GLOBUS_SUCCESS;
-    char                               *jstring = NULL;
-    globus_i_dsi_rest_write_block_arg_t*block_arg = NULL;
+    globus_i_dsi_rest_write_json_arg_t *json_arg = NULL;
 
     GlobusDsiRestEnter();
     /*
-     * We dump the json to a string and then use the block write 
-     * argument type, keeping the original so we can free it when we're
-     * done
+     * As json_dumps() without JSON_ENCODE_ANY, only send an object or an
+     * array as the body.
      */
-    jstring = json_dumps(json, JSON_COMPACT);
-
-    if (jstring == NULL)
+    if (!json_is_object(json) && !json_is_array(json))
     {
-        result = GlobusDsiRestErrorMemory();
-        goto json_encode_fail;
+        /* Not a globus_i_dsi_rest_write_json_arg_t for cleanup to destroy */
+        current_part->data_write_callback_arg = NULL;
+        result = GlobusDsiRestErrorParameter();
+        goto invalid_json;
     }
-    block_arg = malloc(sizeof(globus_i_dsi_rest_write_block_arg_t));
-    *block_arg = (globus_i_dsi_rest_write_block_arg_t)
+    /*
+     * The json is encoded as it is sent, so keep a reference to it until
+     * the request is done.
+     */
+    json_arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_write_json_arg_t));
+    if (json_arg == NULL)
     {
-        .block_data = jstring,
-        .block_len = strlen(jstring),
-        .offset = 0,
-    };
-    current_part->data_write_callback_arg = block_arg;
+        current_part->data_write_callback_arg = NULL;
+        result = GlobusDsiRestErrorMemory();
+        goto malloc_json_arg_fail;
+    }
+    globus_i_dsi_rest_write_json_init(json_arg, json_incref(json));
+    current_part->data_write_callback_arg = json_arg;
     result = globus_l_dsi_rest_add_part_header(
+            arena,
             current_part,
-            strdup("Content-Type"),
-            strdup("application/json; charset=UTF-8"));
+            "Content-Type",
+            "application/json; charset=UTF-8");
 
-json_encode_fail:
+malloc_json_arg_fail:
+invalid_json:
     GlobusDsiRestExitResult(result);
     return result;
 }
@@ -550,6 +986,7 @@ json_encode_fail:
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_form_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     globus_dsi_rest_key_array_t        *form)
 {
@@ -570,7 +1007,16 @@ globus_l_dsi_rest_prepare_write_form_callback(
     {
         goto form_encode_fail;
     }
-    block_arg = malloc(sizeof(globus_i_dsi_rest_write_block_arg_t));
+    block_arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_write_block_arg_t));
+    current_part->data_write_callback_arg = block_arg;
+    if (block_arg == NULL)
+    {
+        free(form_data);
+        result = GlobusDsiRestErrorMemory();
+
+        goto block_arg_alloc_fail;
+    }
 
     *block_arg = (globus_i_dsi_rest_write_block_arg_t)
     {
@@ -579,13 +1025,13 @@ globus_l_dsi_rest_prepare_write_form_callback(
         .offset = 0,
     };
 
-    current_part->data_write_callback_arg = block_arg;
-
     result = globus_l_dsi_rest_add_part_header(
+            arena,
             current_part,
-            strdup("Content-Type"),
-            strdup("application/x-www-form-urlencoded"));
+            "Content-Type",
+            "application/x-www-form-urlencoded");
 
+block_arg_alloc_fail:
 form_encode_fail:
     GlobusDsiRestExitResult(result);
     return result;
@@ -595,6 +1041,7 @@ form_encode_fail:
 static
 globus_result_t
 globus_l_dsi_rest_prepare_write_gridftp_op_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg)
 {
@@ -613,7 +1060,13 @@ globus_l_dsi_rest_prepare_write_gridftp_op_callback(
             gridftp_op_arg->offset,
             gridftp_op_arg->length);
 
-    arg = malloc(sizeof(globus_i_dsi_rest_gridftp_op_arg_t));
+    arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_gridftp_op_arg_t));
+    if (arg == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+        goto write_arg_alloc_fail;
+    }
 
     *arg = (globus_i_dsi_rest_gridftp_op_arg_t)
     {
@@ -653,6 +1106,7 @@ write_cond_init_fail:
     }
     
 write_mutex_init_fail:
+write_arg_alloc_fail:
 
     GlobusDsiRestExitResult(result);
 
@@ -663,6 +1117,7 @@ write_mutex_init_fail:
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_callbacks(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     globus_dsi_rest_read_t              data_read_callback,
     void *                              data_read_callback_arg)
@@ -685,26 +1140,39 @@ globus_l_dsi_rest_prepare_read_callbacks(
     if (data_read_callback == globus_dsi_rest_read_json)
     {
         result = globus_l_dsi_rest_prepare_read_json_callback(
+            arena,
+            current_part,
+            data_read_callback_arg);
+    }
+    else if (data_read_callback == globus_dsi_rest_read_json_elements)
+    {
+        result = globus_l_dsi_rest_prepare_read_json_elements(
+            arena,
+            current_part,
+            data_read_callback_arg);
+    }
+    else if (data_read_callback == globus_dsi_rest_read_json_pointers)
+    {
+        result = globus_l_dsi_rest_prepare_read_json_pointers(
+            arena,
             current_part,
             data_read_callback_arg);
     }
     else if (data_read_callback == globus_dsi_rest_read_gridftp_op)
     {
         result = globus_l_dsi_rest_prepare_read_gridftp_op(
+            arena,
             current_part,
             data_read_callback_arg);
     }
     else if (data_read_callback == globus_dsi_rest_read_multipart)
     {
         result = globus_l_dsi_rest_prepare_read_multipart(
+            arena,
             current_part,
             data_read_callback_arg);
     }
 
-    if (result != GLOBUS_SUCCESS)
-    {
-        free(current_part->headers.key_value);
-    }
     GlobusDsiRestExitResult(result);
 
     return result;
@@ -713,6 +1181,7 @@ globus_l_dsi_rest_prepare_read_callbacks(
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_json_callback(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     json_t                            **jsonp)
 {
@@ -721,7 +1190,8 @@ globus_l_dsi_rest_prepare_read_json_callback(
 
     GlobusDsiRestEnter();
 
-    json_arg = malloc(sizeof(globus_i_dsi_rest_read_json_arg_t));
+    json_arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_read_json_arg_t));
 
     if (json_arg == NULL)
     {
@@ -743,9 +1213,88 @@ malloc_json_arg_fail:
 }
 /* globus_l_dsi_rest_prepare_read_json_callback() */
 
+static
+globus_result_t
+globus_l_dsi_rest_prepare_read_json_elements(
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_read_part_t      *current_part,
+    globus_dsi_rest_read_json_elements_arg_t
+                                       *elements_arg)
+{
+    globus_i_dsi_rest_read_json_elements_arg_t
+                                       *wrapped_arg = NULL;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    wrapped_arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_read_json_elements_arg_t));
+
+    if (wrapped_arg == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+
+        goto malloc_arg_fail;
+    }
+
+    *wrapped_arg = (globus_i_dsi_rest_read_json_elements_arg_t)
+    {
+        .arg = *elements_arg,
+    };
+
+malloc_arg_fail:
+    current_part->data_read_callback_arg = wrapped_arg;
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_prepare_read_json_elements() */
+
+static
+globus_result_t
+globus_l_dsi_rest_prepare_read_json_pointers(
+    globus_i_dsi_rest_arena_t          *arena,
+    globus_i_dsi_rest_read_part_t      *current_part,
+    globus_dsi_rest_read_json_pointers_arg_t
+                                       *pointers_arg)
+{
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *wrapped_arg = NULL;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    wrapped_arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_read_json_pointers_arg_t));
+
+    if (wrapped_arg == NULL)
+    {
+        result = GlobusDsiRestErrorMemory();
+
+        goto malloc_arg_fail;
+    }
+
+    result = globus_i_dsi_rest_read_json_pointers_init(
+            wrapped_arg,
+            pointers_arg);
+    if (result != GLOBUS_SUCCESS)
+    {
+        globus_i_dsi_rest_read_json_pointers_destroy(wrapped_arg);
+        wrapped_arg = NULL;
+    }
+
+malloc_arg_fail:
+    current_part->data_read_callback_arg = wrapped_arg;
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_prepare_read_json_pointers() */
+
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_gridftp_op(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg)
 {
@@ -764,7 +1313,8 @@ globus_l_dsi_rest_prepare_read_gridftp_op(
             gridftp_op_arg->offset,
             gridftp_op_arg->length);
     
-    wrapped_arg = malloc(sizeof(globus_i_dsi_rest_gridftp_op_arg_t));
+    wrapped_arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_gridftp_op_arg_t));
     if (wrapped_arg == NULL)
     {
         result = GlobusDsiRestErrorMemory();
@@ -776,6 +1326,7 @@ globus_l_dsi_rest_prepare_read_gridftp_op(
         .op = gridftp_op_arg->op,
         .pending_buffers_last = &wrapped_arg->pending_buffers,
         .offset = gridftp_op_arg->offset,
+        .received_offset = gridftp_op_arg->offset,
     };
     if (gridftp_op_arg->length != (globus_off_t) -1)
     {
@@ -800,7 +1351,6 @@ globus_l_dsi_rest_prepare_read_gridftp_op(
 cond_init_fail:
         globus_mutex_destroy(&wrapped_arg->mutex);
 mutex_init_fail:
-        free(wrapped_arg);
 malloc_arg_fail:
         wrapped_arg = NULL;
     }
@@ -815,6 +1365,7 @@ malloc_arg_fail:
 static
 globus_result_t
 globus_l_dsi_rest_prepare_read_multipart(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_read_part_t      *current_part,
     globus_dsi_rest_read_multipart_arg_t
                                        *multipart_arg)
@@ -828,7 +1379,8 @@ globus_l_dsi_rest_prepare_read_multipart(
             " num_parts=%zu\n",
             multipart_arg->num_parts);
 
-    arg = malloc(sizeof(globus_i_dsi_rest_read_multipart_arg_t));
+    arg = globus_i_dsi_rest_arena_alloc(
+            arena, sizeof(globus_i_dsi_rest_read_multipart_arg_t));
     if (arg == NULL)
     {
         result = GlobusDsiRestErrorMemory();
@@ -838,14 +1390,16 @@ globus_l_dsi_rest_prepare_read_multipart(
 
     *arg = (globus_i_dsi_rest_read_multipart_arg_t)
     {
+        .arena = arena,
         .num_parts = multipart_arg->num_parts,
         .part_index = (size_t) -1,
-        .parts = calloc(
-            sizeof(globus_i_dsi_rest_read_part_t),
-            multipart_arg->num_parts),
+        .parts = globus_i_dsi_rest_arena_calloc(
+            arena,
+            multipart_arg->num_parts,
+            sizeof(globus_i_dsi_rest_read_part_t)),
     };
 
-    if (arg->parts == NULL)
+    if (arg->parts == NULL && multipart_arg->num_parts > 0)
     {
         result = GlobusDsiRestErrorMemory();
         goto parts_alloc_fail;
@@ -858,6 +1412,7 @@ globus_l_dsi_rest_prepare_read_multipart(
         arg->parts[i].response_callback_arg =
             multipart_arg->parts[i].response_callback_arg;
         result = globus_l_dsi_rest_prepare_read_callbacks(
+            arena,
             &arg->parts[i],
             multipart_arg->parts[i].data_read_callback,
             multipart_arg->parts[i].data_read_callback_arg);
@@ -880,6 +1435,7 @@ arg_alloc_fail:
 static
 globus_result_t
 globus_l_dsi_rest_add_part_header(
+    globus_i_dsi_rest_arena_t          *arena,
     globus_i_dsi_rest_write_part_t     *current_part,
     const char                         *key,
     const char                         *value)
@@ -889,47 +1445,35 @@ globus_l_dsi_rest_add_part_header(
 
     GlobusDsiRestEnter();
 
-    if (key == NULL || value == NULL)
+    /*
+     * The key and value must live as long as the request: they are either
+     * constant or allocated from the arena.
+     */
+    tmp = globus_i_dsi_rest_arena_alloc(
+            arena,
+            (current_part->headers.count+1)
+            * sizeof(globus_dsi_rest_key_value_t));
+    if (tmp == NULL)
     {
         result = GlobusDsiRestErrorMemory();
 
-        goto bad_param;
+        goto alloc_headers_keyvalue_fail;
     }
-    tmp = realloc(
-        current_part->malloced_headers.key_value,
-        (current_part->malloced_headers.count + 1) *
-        sizeof(globus_dsi_rest_key_value_t));
-
-    if (tmp == NULL)
+    if (current_part->headers.count > 0)
     {
-        result = GlobusDsiRestErrorMemory();
-
-        goto malloc_headers_fail;
+        memcpy(tmp, current_part->headers.key_value,
+                current_part->headers.count
+                * sizeof(globus_dsi_rest_key_value_t));
     }
-    current_part->malloced_headers.key_value = tmp;
-    current_part->malloced_headers.key_value[current_part->malloced_headers.count++] =
+    current_part->headers.key_value = tmp;
+    current_part->headers.key_value[current_part->headers.count++] =
     (globus_dsi_rest_key_value_t)
     {
         .key = key,
         .value = value,
     };
 
-
-    tmp = realloc(
-            current_part->headers.key_value,
-            (current_part->headers.count+1)
-            * sizeof(globus_dsi_rest_key_value_t));
-    if (tmp == NULL)
-    {
-        goto realloc_headers_keyvalue_fail;
-    }
-    current_part->headers.key_value = tmp;
-    current_part->headers.key_value[current_part->headers.count++] =
-    current_part->malloced_headers.key_value[current_part->malloced_headers.count-1];
-
-bad_param:
-malloc_headers_fail:
-realloc_headers_keyvalue_fail:
+alloc_headers_keyvalue_fail:
     GlobusDsiRestExitResult(result);
 
     return result;
@@ -959,3 +1503,22 @@ globus_l_dsi_rest_headers_search(
     GlobusDsiRestExitPointer(value);
 }
 /* globus_l_dsi_rest_headers_search() */
+
+bool
+globus_i_dsi_rest_headers_set_length(
+    const globus_dsi_rest_key_array_t  *headers)
+{
+    for (size_t i = 0; i < headers->count; i++)
+    {
+        const char                     *key = headers->key_value[i].key;
+
+        if (key != NULL
+            && (strcasecmp(key, "Transfer-Encoding") == 0
+                || strcasecmp(key, "Content-Length") == 0))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/* globus_i_dsi_rest_headers_set_length() */
@@ -35,25 +35,24 @@ void
 globus_i_dsi_rest_request_cleanup(
     globus_i_dsi_rest_request_t        *request)
 {
+    globus_i_dsi_rest_arena_t           arena;
+
     if (request == NULL)
     {
         return;
     }
-    if (request->request_headers != NULL)
-    {
-        curl_slist_free_all(request->request_headers);
-        request->request_headers = NULL;
-    }
-    free(request->complete_uri);
-    request->complete_uri = NULL;
     globus_i_dsi_rest_handle_release(request->handle);
     request->handle = NULL;
 
     globus_l_dsi_rest_request_cleanup_write_part(&request->write_part);
     globus_l_dsi_rest_request_cleanup_read_part(&request->read_part);
 
-
-    free(request);
+    /*
+     * The headers, URI, and callback arguments are in the arena, along with
+     * the request itself, so copy the arena out before releasing it.
+     */
+    arena = request->arena;
+    globus_i_dsi_rest_arena_release(&arena);
 }
 /* globus_i_dsi_rest_request_cleanup() */
 
@@ -62,39 +61,28 @@ void
 globus_l_dsi_rest_request_cleanup_write_part(
     globus_i_dsi_rest_write_part_t     *part)
 {
-    free(part->headers.key_value);
-    for (size_t i = 0; i < part->malloced_headers.count; i++)
-    {
-        free((char *) part->malloced_headers.key_value[i].key);
-        free((char *) part->malloced_headers.key_value[i].value);
-    }
-    free(part->malloced_headers.key_value);
-
-    if (part->data_write_callback == globus_dsi_rest_write_json
-        || part->data_write_callback == globus_dsi_rest_write_form)
+    if (part->data_write_callback == globus_dsi_rest_write_json)
     {
-        globus_i_dsi_rest_write_block_arg_t
-                                       *arg = part->data_write_callback_arg; 
-        free(arg->block_data);
-        arg->block_data = NULL;
+        globus_i_dsi_rest_write_json_arg_t
+                                       *arg = part->data_write_callback_arg;
 
-        free(arg);
-        part->data_write_callback_arg = NULL;
-    }
-    else if (part->data_write_callback == globus_dsi_rest_write_block)
-    {
-        globus_i_dsi_rest_write_blocks_arg_t
-                                       *arg = part->data_write_callback_arg; 
-        free(arg);
+        if (arg != NULL)
+        {
+            globus_i_dsi_rest_write_json_destroy(arg);
+            json_decref(arg->json);
+        }
         part->data_write_callback_arg = NULL;
     }
-    else if (part->data_write_callback == globus_dsi_rest_write_blocks)
+    else if (part->data_write_callback == globus_dsi_rest_write_form)
     {
-        globus_i_dsi_rest_write_blocks_arg_t
+        globus_i_dsi_rest_write_block_arg_t
                                        *arg = part->data_write_callback_arg; 
-        free(arg->blocks);
-        arg->blocks = NULL;
-        free(arg);
+
+        if (arg != NULL)
+        {
+            free(arg->block_data);
+            arg->block_data = NULL;
+        }
         part->data_write_callback_arg = NULL;
     }
     else if (part->data_write_callback == globus_dsi_rest_write_gridftp_op)
@@ -108,10 +96,14 @@ globus_l_dsi_rest_request_cleanup_write_part(
         {
             globus_i_dsi_rest_buffer_t *next = arg->free_buffers->next;
 
-            free(arg->free_buffers);
+            globus_i_dsi_rest_buffer_pool_put(arg->free_buffers);
             arg->free_buffers = next;
         }
-        free(arg);
+        for (size_t i = 0; i < arg->pending_heap_count; i++)
+        {
+            globus_i_dsi_rest_buffer_pool_put(arg->pending_heap[i]);
+        }
+        free(arg->pending_heap);
         part->data_write_callback_arg = NULL;
     }
     else if (part->data_write_callback == globus_dsi_rest_write_multipart)
@@ -119,14 +111,12 @@ globus_l_dsi_rest_request_cleanup_write_part(
         globus_i_dsi_rest_write_multipart_arg_t
                                        *arg = part->data_write_callback_arg;
 
-        for (size_t i = 0; i < arg->num_parts; i++)
+        for (size_t i = 0; arg != NULL && arg->parts != NULL
+                && i < arg->num_parts; i++)
         {
             globus_l_dsi_rest_request_cleanup_write_part(&arg->parts[i]);
         }
-        free(arg->boundary);
-        free(arg->current_boundary);
-        free(arg->parts);
-        free(arg);
+        part->data_write_callback_arg = NULL;
     }
 }
 /* globus_l_dsi_rest_request_cleanup_write_part() */
@@ -136,16 +126,6 @@ void
 globus_l_dsi_rest_request_cleanup_read_part(
     globus_i_dsi_rest_read_part_t      *read_part)
 {
-    if (read_part->headers.key_value != NULL)
-    {
-        for (size_t i = 0; i < read_part->headers.count; i++)
-        {
-            free((char *) read_part->headers.key_value[i].key);
-            free((char *) read_part->headers.key_value[i].value);
-        }
-        free(read_part->headers.key_value);
-    }
-
     if (read_part->data_read_callback == globus_dsi_rest_read_json)
     {
         globus_i_dsi_rest_read_json_arg_t
@@ -155,8 +135,30 @@ globus_l_dsi_rest_request_cleanup_read_part(
         {
             free(arg->buffer);
             arg->buffer = NULL;
+        }
+        read_part->data_read_callback_arg = NULL;
+    }
+    else if (read_part->data_read_callback
+            == globus_dsi_rest_read_json_elements)
+    {
+        globus_i_dsi_rest_read_json_elements_arg_t
+                                       *arg = read_part->data_read_callback_arg;
+
+        if (arg != NULL)
+        {
+            free(arg->element);
+        }
+        read_part->data_read_callback_arg = NULL;
+    }
+    else if (read_part->data_read_callback
+            == globus_dsi_rest_read_json_pointers)
+    {
+        globus_i_dsi_rest_read_json_pointers_arg_t
+                                       *arg = read_part->data_read_callback_arg;
 
-            free(arg);
+        if (arg != NULL)
+        {
+            globus_i_dsi_rest_read_json_pointers_destroy(arg);
         }
         read_part->data_read_callback_arg = NULL;
     }
@@ -183,10 +185,17 @@ globus_l_dsi_rest_request_cleanup_read_part(
         {
             globus_i_dsi_rest_buffer_t *next = arg->free_buffers->next;
 
-            free(arg->free_buffers);
+            globus_i_dsi_rest_buffer_pool_put(arg->free_buffers);
             arg->free_buffers = next;
         }
-        free(arg);
+        while (arg->pending_buffers != NULL)
+        {
+            globus_i_dsi_rest_buffer_t *next = arg->pending_buffers->next;
+
+            globus_i_dsi_rest_buffer_pool_put(arg->pending_buffers);
+            arg->pending_buffers = next;
+        }
+        globus_i_dsi_rest_buffer_pool_put(arg->current_buffer);
         read_part->data_read_callback_arg = NULL;
     }
     else if (read_part->data_read_callback == globus_dsi_rest_read_multipart)
@@ -194,28 +203,24 @@ globus_l_dsi_rest_request_cleanup_read_part(
         globus_i_dsi_rest_read_multipart_arg_t
                                        *arg = read_part->data_read_callback_arg;
 
-        if (arg->parts != NULL)
+        if (arg != NULL)
         {
-            for (size_t i = 0; i < arg->num_parts; i++)
+            if (arg->parts != NULL)
             {
-                globus_l_dsi_rest_request_cleanup_read_part(
-                        &arg->parts[i]);
+                for (size_t i = 0; i < arg->num_parts; i++)
+                {
+                    globus_l_dsi_rest_request_cleanup_read_part(
+                            &arg->parts[i]);
+                }
+                arg->parts = NULL;
+                arg->num_parts = 0;
             }
-            free(arg->parts);
-            arg->parts = NULL;
-            arg->num_parts = 0;
-        }
 
-        free(arg->boundary);
-        arg->boundary = NULL;
+            globus_i_dsi_rest_read_multipart_delimiters_destroy(arg);
 
-        free(arg->boundary_buffer);
-        arg->boundary_buffer = NULL;
-
-        free(arg->header_buffer);
-        arg->header_buffer = NULL;
-
-        free(arg);
+            free(arg->header_buffer);
+            arg->header_buffer = NULL;
+        }
 
         read_part->data_read_callback_arg = NULL;
     }
@@ -31,34 +31,45 @@ globus_l_dsi_rest_response(
     const globus_dsi_rest_key_array_t  *response_headers)
 {
     globus_dsi_rest_response_arg_t     *response_arg = response_callback_arg;
+    globus_dsi_rest_key_array_t        *desired = &response_arg->desired_headers;
+    globus_i_dsi_rest_header_match_t    match;
+    globus_i_dsi_rest_header_match_slot_t
+                                        slots[
+                                        globus_i_dsi_rest_header_match_slots(
+                                            desired->count)];
     globus_result_t                     result = GLOBUS_SUCCESS;
 
     GlobusDsiRestEnter();
 
     response_arg->response_code = response_code;
 
-    for (size_t i = 0; i < response_arg->desired_headers.count; i++)
+    for (size_t i = 0; i < desired->count; i++)
     {
-        globus_dsi_rest_key_value_t    *desired;
-        desired = &response_arg->desired_headers.key_value[i]; 
-        desired->value = NULL;
+        desired->key_value[i].value = NULL;
+    }
+    globus_i_dsi_rest_header_match_init(&match, desired, slots);
 
-        for (size_t j = 0; j < response_headers->count; j++)
-        {
-            globus_dsi_rest_key_value_t*response_header;
-            response_header = &response_headers->key_value[j];
+    for (size_t j = 0; j < response_headers->count; j++)
+    {
+        const globus_dsi_rest_key_value_t
+                                       *response_header;
+        size_t                          i;
 
-            if (strcasecmp(desired->key, response_header->key) == 0)
-            {
-                desired->value = strdup(response_header->value);
-                if (desired->value == NULL)
-                {
-                    result = GlobusDsiRestErrorMemory();
+        response_header = &response_headers->key_value[j];
+        i = globus_i_dsi_rest_header_match_find(
+                &match,
+                response_header->key,
+                strlen(response_header->key));
+        if (i == SIZE_MAX || desired->key_value[i].value != NULL)
+        {
+            continue;
+        }
+        desired->key_value[i].value = strdup(response_header->value);
+        if (desired->key_value[i].value == NULL)
+        {
+            result = GlobusDsiRestErrorMemory();
 
-                    goto strdup_fail;
-                }
-                break;
-            }
+            goto strdup_fail;
         }
     }
 
@@ -22,10 +22,41 @@
 
 #include "globus_i_dsi_rest.h"
 
+globus_i_dsi_rest_method_t
+globus_i_dsi_rest_method_lookup(
+    const char                         *method)
+{
+    static const struct
+    {
+        const char                     *name;
+        globus_i_dsi_rest_method_t      method_id;
+    }
+    methods[] =
+    {
+        { "GET",    GLOBUS_I_DSI_REST_METHOD_GET },
+        { "PUT",    GLOBUS_I_DSI_REST_METHOD_PUT },
+        { "POST",   GLOBUS_I_DSI_REST_METHOD_POST },
+        { "HEAD",   GLOBUS_I_DSI_REST_METHOD_HEAD },
+        { "PATCH",  GLOBUS_I_DSI_REST_METHOD_PATCH },
+        { "DELETE", GLOBUS_I_DSI_REST_METHOD_DELETE },
+    };
+
+    for (size_t i = 0; i < sizeof(methods)/sizeof(methods[0]); i++)
+    {
+        if (strcmp(method, methods[i].name) == 0)
+        {
+            return methods[i].method_id;
+        }
+    }
+    return GLOBUS_I_DSI_REST_METHOD_OTHER;
+}
+/* globus_i_dsi_rest_method_lookup() */
+
 globus_result_t
 globus_i_dsi_rest_set_request(
     CURL                               *handle,
     const char                         *method,
+    globus_i_dsi_rest_method_t          method_id,
     const char                         *uri,
     struct curl_slist                  *headers,
     const globus_dsi_rest_callbacks_t  *callbacks)
@@ -45,23 +76,23 @@ globus_i_dsi_rest_set_request(
     }
 
     rc = curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, NULL);
-    if (strcmp(method, "HEAD") == 0)
+    if (method_id == GLOBUS_I_DSI_REST_METHOD_HEAD)
     {
         rc = curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
     }
-    else if (strcmp(method, "GET") == 0)
+    else if (method_id == GLOBUS_I_DSI_REST_METHOD_GET)
     {
         rc = curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
     }
-    else if (strcmp(method, "PUT") == 0)
+    else if (method_id == GLOBUS_I_DSI_REST_METHOD_PUT)
     {
         rc = curl_easy_setopt(handle, CURLOPT_UPLOAD, 1L);
     }
-    else if (strcmp(method, "POST") == 0)
+    else if (method_id == GLOBUS_I_DSI_REST_METHOD_POST)
     {
         rc = curl_easy_setopt(handle, CURLOPT_POST, 1L);
     }
-    else if (strcmp(method, "DELETE") == 0)
+    else if (method_id == GLOBUS_I_DSI_REST_METHOD_DELETE)
     {
         rc = curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
         if (rc == CURLE_OK)
@@ -0,0 +1,92 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file stats.c GridFTP DSI REST Request Statistics
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+globus_dsi_rest_stats_t                 globus_i_dsi_rest_stats;
+
+void
+globus_i_dsi_rest_stats_request_done(
+    globus_i_dsi_rest_request_t        *request)
+{
+    long                                num_connects = 0;
+
+    GlobusDsiRestEnter();
+
+    if (curl_easy_getinfo(request->handle, CURLINFO_NUM_CONNECTS,
+                &num_connects) != CURLE_OK)
+    {
+        goto done;
+    }
+    if (num_connects > 0)
+    {
+        __atomic_fetch_add(
+                &globus_i_dsi_rest_stats.requests_new_connection,
+                1,
+                __ATOMIC_RELAXED);
+        __atomic_fetch_add(
+                &globus_i_dsi_rest_stats.connections_opened,
+                (uint64_t) num_connects,
+                __ATOMIC_RELAXED);
+    }
+    else if (request->response_code != 0)
+    {
+        /* Got a response without connecting, so the connection was reused */
+        __atomic_fetch_add(
+                &globus_i_dsi_rest_stats.requests_reused_connection,
+                1,
+                __ATOMIC_RELAXED);
+    }
+
+done:
+    GlobusDsiRestExit();
+}
+/* globus_i_dsi_rest_stats_request_done() */
+
+globus_result_t
+globus_dsi_rest_get_stats(
+    globus_dsi_rest_stats_t            *stats)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (stats == NULL)
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_param;
+    }
+    stats->requests_new_connection = __atomic_load_n(
+            &globus_i_dsi_rest_stats.requests_new_connection,
+            __ATOMIC_RELAXED);
+    stats->requests_reused_connection = __atomic_load_n(
+            &globus_i_dsi_rest_stats.requests_reused_connection,
+            __ATOMIC_RELAXED);
+    stats->connections_opened = __atomic_load_n(
+            &globus_i_dsi_rest_stats.connections_opened,
+            __ATOMIC_RELAXED);
+
+bad_param:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_get_stats() */
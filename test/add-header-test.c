@@ -47,6 +47,7 @@ main()
         {
             globus_result_t result;
             result = globus_i_dsi_rest_add_header(
+                    &request.arena,
                     &request.request_headers,
                     test_cases[j].key,
                     test_cases[j].value);
@@ -65,7 +66,7 @@ main()
         {
             ok = count_ok = false;
         }
-        curl_slist_free_all(request.request_headers);
+        globus_i_dsi_rest_arena_release(&request.arena);
 
         printf("%s %zu - %s%s%s\n",
             ok ? "ok" : "not ok",
@@ -0,0 +1,250 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares data buffer allocation modes on a large transfer. Buffers are
+ * first taken from the pool and released on the first CPU, as a previous
+ * transfer would leave them, and then taken again on the last CPU, which
+ * copies data through them. Reports the copy rate along with dTLB and
+ * remote NUMA node load misses for each mode, where the kernel provides
+ * those counters.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+enum
+{
+    DEFAULT_BLOCK_SIZE = 4*1024*1024,
+    DEFAULT_BUFFERS = 16,
+    DEFAULT_PASSES = 16
+};
+
+static
+double
+now_ns(void)
+{
+    struct timespec                     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static
+int
+counter_open(
+    uint64_t                            cache)
+{
+    struct perf_event_attr              attr =
+    {
+        .type = PERF_TYPE_HW_CACHE,
+        .size = sizeof(attr),
+        .config = cache
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        .disabled = 1,
+        .exclude_kernel = 1,
+        .exclude_hv = 1,
+    };
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static
+void
+pin(
+    int                                 cpu)
+{
+    cpu_set_t                           set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+static
+void
+print_counter(
+    const char                         *name,
+    int                                 fd)
+{
+    long long                           count;
+
+    if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+    {
+        printf("  %-20s %14s\n", name, "n/a");
+    }
+    else
+    {
+        printf("  %-20s %14lld\n", name, count);
+    }
+}
+
+static
+int
+run(
+    const char                         *name,
+    bool                                huge_pages,
+    bool                                numa,
+    size_t                              block_size,
+    int                                 buffers,
+    int                                 passes)
+{
+    globus_i_dsi_rest_buffer_t         *buf[buffers];
+    unsigned char                      *source;
+    int                                 tlb_fd, node_fd;
+    long                                ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double                              start, elapsed;
+
+    globus_i_dsi_rest_buffer_pool_destroy();
+    globus_i_dsi_rest_buffer_huge_pages = huge_pages;
+    globus_i_dsi_rest_buffer_numa = numa;
+    if (globus_i_dsi_rest_buffer_pool_init(2L * buffers * block_size) != 0)
+    {
+        fprintf(stderr, "buffer_pool_init failed\n");
+        return 1;
+    }
+
+    /* Leave buffers in the pool as an earlier transfer on another CPU
+     * would.
+     */
+    pin(0);
+    for (int i = 0; i < buffers; i++)
+    {
+        buf[i] = globus_i_dsi_rest_buffer_pool_get(block_size, true);
+        if (buf[i] == NULL)
+        {
+            fprintf(stderr, "buffer_pool_get failed\n");
+            return 1;
+        }
+        memset(buf[i]->buffer, 0, buf[i]->buffer_len);
+    }
+    for (int i = 0; i < buffers; i++)
+    {
+        globus_i_dsi_rest_buffer_pool_put(buf[i]);
+    }
+
+    pin(ncpus > 0 ? ncpus - 1 : 0);
+    source = malloc(block_size);
+    memset(source, 1, block_size);
+    for (int i = 0; i < buffers; i++)
+    {
+        buf[i] = globus_i_dsi_rest_buffer_pool_get(block_size, true);
+        if (buf[i] == NULL)
+        {
+            fprintf(stderr, "buffer_pool_get failed\n");
+            return 1;
+        }
+        memset(buf[i]->buffer, 0, buf[i]->buffer_len);
+    }
+
+    tlb_fd = counter_open(PERF_COUNT_HW_CACHE_DTLB);
+    node_fd = counter_open(PERF_COUNT_HW_CACHE_NODE);
+    if (tlb_fd >= 0)
+    {
+        ioctl(tlb_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (node_fd >= 0)
+    {
+        ioctl(node_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    start = now_ns();
+    for (int p = 0; p < passes; p++)
+    {
+        /* Data channel into the buffers, then out to the request */
+        for (int i = 0; i < buffers; i++)
+        {
+            memcpy(buf[i]->buffer, source, block_size);
+        }
+        for (int i = 0; i < buffers; i++)
+        {
+            memcpy(source, buf[i]->buffer, block_size);
+        }
+    }
+    elapsed = now_ns() - start;
+    if (tlb_fd >= 0)
+    {
+        ioctl(tlb_fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    if (node_fd >= 0)
+    {
+        ioctl(node_fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    printf("%s:\n", name);
+    printf("  %-20s %14.2f\n", "copy GB/s",
+            2.0 * passes * buffers * block_size / elapsed);
+    print_counter("dTLB load misses", tlb_fd);
+    print_counter("remote node misses", node_fd);
+
+    if (tlb_fd >= 0)
+    {
+        close(tlb_fd);
+    }
+    if (node_fd >= 0)
+    {
+        close(node_fd);
+    }
+    for (int i = 0; i < buffers; i++)
+    {
+        globus_i_dsi_rest_buffer_pool_put(buf[i]);
+    }
+    free(source);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    size_t                              block_size = DEFAULT_BLOCK_SIZE;
+    int                                 buffers = DEFAULT_BUFFERS;
+    int                                 passes = DEFAULT_PASSES;
+    int                                 rc = 0;
+
+    if (argc > 1)
+    {
+        block_size = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        buffers = strtol(argv[2], NULL, 0);
+    }
+    if (argc > 3)
+    {
+        passes = strtol(argv[3], NULL, 0);
+    }
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    printf("%d buffers of %zu bytes, %d passes\n", buffers, block_size, passes);
+    rc += run("malloc", false, false, block_size, buffers, passes);
+    rc += run("huge pages", true, false, block_size, buffers, passes);
+    rc += run("numa", false, true, block_size, buffers, passes);
+    rc += run("huge pages + numa", true, true, block_size, buffers, passes);
+
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
@@ -0,0 +1,91 @@
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+
+/*
+ * Pushes buffers to the pending buffer heap in several orders and checks
+ * that they pop in order of transfer_offset, with pending_bytes kept up to
+ * date.
+ */
+int
+main()
+{
+    int rc = 0;
+    uint64_t test_cases[][8] =
+    {
+        { 0, 1, 2, 3, 4, 5, 6, 7 },
+        { 7, 6, 5, 4, 3, 2, 1, 0 },
+        { 3, 7, 0, 5, 1, 6, 2, 4 },
+        { 4, 0, 6, 2, 7, 1, 5, 3 },
+    };
+    char *test_names[] = {
+        "in order",
+        "reverse order",
+        "shuffled",
+        "interleaved",
+    };
+    size_t num_cases = sizeof(test_cases)/sizeof(test_cases[0]);
+    size_t num_buffers = sizeof(test_cases[0])/sizeof(test_cases[0][0]);
+
+    printf("1..%zu\n", num_cases);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    for (size_t i = 0; i < num_cases; i++)
+    {
+        bool ok = true;
+        bool push_ok = true;
+        bool order_ok = true;
+        bool bytes_ok = true;
+        globus_i_dsi_rest_gridftp_op_arg_t arg = {.pending_heap = NULL};
+        globus_i_dsi_rest_buffer_t buffers[num_buffers];
+
+        for (size_t j = 0; j < num_buffers; j++)
+        {
+            buffers[j] = (globus_i_dsi_rest_buffer_t)
+            {
+                .buffer_used = 10,
+                .transfer_offset = test_cases[i][j] * 10,
+            };
+            if (globus_i_dsi_rest_buffer_heap_push(&arg, &buffers[j])
+                    != GLOBUS_SUCCESS)
+            {
+                ok = push_ok = false;
+            }
+        }
+        if (arg.pending_bytes != (globus_off_t) (10 * num_buffers))
+        {
+            ok = bytes_ok = false;
+        }
+        for (size_t j = 0; j < num_buffers; j++)
+        {
+            globus_i_dsi_rest_buffer_t *buffer;
+
+            buffer = globus_i_dsi_rest_buffer_heap_pop(&arg);
+            if (buffer == NULL || buffer->transfer_offset != j * 10)
+            {
+                ok = order_ok = false;
+            }
+        }
+        if (globus_i_dsi_rest_buffer_heap_pop(&arg) != NULL
+            || arg.pending_bytes != 0)
+        {
+            ok = bytes_ok = false;
+        }
+        free(arg.pending_heap);
+
+        printf("%s %zu - %s%s%s%s\n",
+            ok ? "ok" : "not ok",
+            i+1,
+            test_names[i],
+            push_ok ? "" : " push_fail",
+            order_ok ? "" : " order_fail",
+            bytes_ok ? "" : " bytes_fail");
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    return rc;
+}
+/* main() */
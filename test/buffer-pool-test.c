@@ -0,0 +1,132 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+
+/*
+ * Gets and puts buffers in a buffer pool with a budget of four of the
+ * smallest buffers, checking which gets the budget refuses, that freed
+ * buffers are reused, that free buffers of other sizes are released to make
+ * room, and the pool's allocated and cached totals after each step.
+ */
+enum
+{
+    SMALL = 64*1024,
+    POOL_MAX = 4 * SMALL,
+    /* Larger than the largest size class, so never cached */
+    HUGE = 64*1024*1024 + 1
+};
+
+static
+bool
+check_totals(
+    size_t                              allocated,
+    size_t                              cached)
+{
+    size_t                              pool_allocated, pool_cached;
+
+    globus_i_dsi_rest_buffer_pool_totals(&pool_allocated, &pool_cached);
+    if (pool_allocated != allocated || pool_cached != cached)
+    {
+        fprintf(stderr, "# allocated=%zu cached=%zu, expected %zu %zu\n",
+                pool_allocated, pool_cached, allocated, cached);
+        return false;
+    }
+    return true;
+}
+/* check_totals() */
+
+int
+main()
+{
+    globus_i_dsi_rest_buffer_t         *small[5] = {NULL};
+    globus_i_dsi_rest_buffer_t         *buffer = NULL;
+    globus_i_dsi_rest_buffer_t         *large = NULL;
+    char                                pool_max[32];
+    bool                                ok;
+    int                                 rc = 0;
+    int                                 test_num = 0;
+
+    snprintf(pool_max, sizeof(pool_max), "%d", POOL_MAX);
+    setenv("GLOBUS_DSI_REST_BUFFER_POOL_MAX", pool_max, 1);
+
+    printf("1..6\n");
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    ok = true;
+    for (int i = 0; i < 4; i++)
+    {
+        small[i] = globus_i_dsi_rest_buffer_pool_get(SMALL, false);
+        ok = ok && small[i] != NULL && small[i]->buffer_len == SMALL;
+    }
+    ok = check_totals(POOL_MAX, 0) && ok;
+    printf("%s %d - get up to the budget\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    buffer = globus_i_dsi_rest_buffer_pool_get(SMALL, false);
+    ok = buffer == NULL;
+    ok = check_totals(POOL_MAX, 0) && ok;
+    printf("%s %d - get past the budget\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    small[4] = globus_i_dsi_rest_buffer_pool_get(SMALL, true);
+    ok = small[4] != NULL;
+    ok = check_totals(POOL_MAX + SMALL, 0) && ok;
+    printf("%s %d - forced get past the budget\n",
+            ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    globus_i_dsi_rest_buffer_pool_put(small[0]);
+    ok = check_totals(POOL_MAX + SMALL, SMALL);
+    buffer = globus_i_dsi_rest_buffer_pool_get(SMALL, false);
+    ok = buffer == small[0] && ok;
+    ok = check_totals(POOL_MAX + SMALL, 0) && ok;
+    printf("%s %d - reuse after put\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    /*
+     * With all five small buffers free, making room for one twice their
+     * size releases three of them.
+     */
+    for (int i = 0; i < 5; i++)
+    {
+        globus_i_dsi_rest_buffer_pool_put(small[i]);
+    }
+    ok = check_totals(POOL_MAX + SMALL, POOL_MAX + SMALL);
+    large = globus_i_dsi_rest_buffer_pool_get(2 * SMALL, false);
+    ok = large != NULL && large->buffer_len == 2 * SMALL && ok;
+    ok = check_totals(POOL_MAX, 2 * SMALL) && ok;
+    printf("%s %d - release other sizes\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    /*
+     * A buffer too large for any size class releases every free buffer,
+     * and isn't kept when it is put back.
+     */
+    globus_i_dsi_rest_buffer_pool_put(large);
+    buffer = globus_i_dsi_rest_buffer_pool_get(HUGE, true);
+    ok = buffer != NULL && check_totals(HUGE, 0);
+    globus_i_dsi_rest_buffer_pool_put(buffer);
+    ok = check_totals(0, 0) && ok;
+    printf("%s %d - totals return to 0\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    unsetenv("GLOBUS_DSI_REST_BUFFER_POOL_MAX");
+
+    return rc;
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <curl/curl.h>
+
+#include "globus_dsi_rest.h"
+#include "test-xio-server.h"
+
+/*
+ * Registers all requests at once with the engine threads enabled, and
+ * checks that each complete callback is called once with the right result.
+ */
+struct test_case
+{
+    char                               *method;
+    char                               *uri_pattern;
+    char                               *upload_body;
+    int                                 response_code;
+    bool                                fail;
+    globus_dsi_rest_write_block_arg_t   write_block;
+    globus_result_t                     result;
+    int                                 done;
+};
+
+struct test_case                        tests[] =
+{
+    {
+        .method = "HEAD",
+        .uri_pattern = "/engine/head",
+        .response_code = 200,
+    },
+    {
+        .method = "HEAD",
+        .uri_pattern = "/engine/fail",
+        .response_code = 500,
+        .fail = true,
+    },
+    {
+        .method = "PUT",
+        .uri_pattern = "/engine/put",
+        .upload_body = "engine-data",
+        .response_code = 204,
+    },
+    {
+        .method = "GET",
+        .uri_pattern = "/engine/get",
+        .response_code = 200,
+    },
+    {
+        .method = "DELETE",
+        .uri_pattern = "/engine/delete",
+        .response_code = 204,
+    },
+};
+
+enum { TEST_COUNT = sizeof(tests)/sizeof(tests[0]) };
+
+static globus_mutex_t                   mutex;
+static globus_cond_t                    cond;
+static size_t                           completed;
+
+static
+globus_result_t
+response_callback(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    struct test_case                   *test = response_callback_arg;
+
+    if (response_code != test->response_code || response_code >= 300)
+    {
+        return GLOBUS_FAILURE;
+    }
+    return GLOBUS_SUCCESS;
+}
+/* response_callback() */
+
+static
+void
+complete_callback(
+    void                               *complete_callback_arg,
+    globus_result_t                     result)
+{
+    struct test_case                   *test = complete_callback_arg;
+
+    globus_mutex_lock(&mutex);
+    test->result = result;
+    test->done++;
+    completed++;
+    globus_cond_signal(&cond);
+    globus_mutex_unlock(&mutex);
+}
+/* complete_callback() */
+
+static
+globus_result_t
+request_test_handler(
+    void                               *route_arg,
+    void                               *request_body,
+    size_t                              request_body_length,
+    int                                *response_code,
+    void                               *response_body,
+    size_t                             *response_body_length,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    struct test_case                   *test = route_arg;
+
+    *response_code = test->response_code;
+    *response_body_length = 0;
+    headers->count = 0;
+
+    if (test->upload_body != NULL
+        && (strlen(test->upload_body) != request_body_length
+        || memcmp(test->upload_body, request_body, request_body_length) != 0))
+    {
+        *response_code = 400;
+    }
+
+    return GLOBUS_SUCCESS;
+}
+/* request_test_handler() */
+
+int main()
+{
+    globus_result_t                     result;
+    char                               *contact_string;
+    int                                 rc = 0;
+
+    setenv("GLOBUS_DSI_REST_ENGINE_THREADS", "2", 1);
+
+    globus_thread_set_model("pthread");
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    globus_module_activate(GLOBUS_XIO_MODULE);
+
+    printf("1..%d\n", TEST_COUNT);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+    globus_mutex_init(&mutex, NULL);
+    globus_cond_init(&cond, NULL);
+
+    result = globus_dsi_rest_test_server_init(&contact_string);
+
+    for (size_t i = 0; i < TEST_COUNT; i++)
+    {
+        result = globus_dsi_rest_test_server_add_route(
+            tests[i].uri_pattern,
+            request_test_handler,
+            &tests[i]);
+    }
+
+    for (size_t i = 0; i < TEST_COUNT; i++)
+    {
+        char uri_fmt[] = "http://%s%s";
+        size_t uri_len = strlen(contact_string) + sizeof(uri_fmt) + strlen(tests[i].uri_pattern);
+        char uri[uri_len+1];
+        snprintf(uri, sizeof(uri), uri_fmt, contact_string, tests[i].uri_pattern);
+
+        if (tests[i].upload_body != NULL)
+        {
+            tests[i].write_block.block_data = tests[i].upload_body;
+            tests[i].write_block.block_len = strlen(tests[i].upload_body);
+        }
+
+        result = globus_dsi_rest_request(
+            tests[i].method,
+            uri,
+            NULL,
+            NULL,
+            &(globus_dsi_rest_callbacks_t)
+            {
+                .data_write_callback = tests[i].upload_body
+                    ? globus_dsi_rest_write_block : NULL,
+                .data_write_callback_arg = tests[i].upload_body
+                    ? &tests[i].write_block : NULL,
+                .response_callback = response_callback,
+                .response_callback_arg = &tests[i],
+                .complete_callback = complete_callback,
+                .complete_callback_arg = &tests[i],
+            });
+
+        if (result != GLOBUS_SUCCESS)
+        {
+            globus_mutex_lock(&mutex);
+            tests[i].result = result;
+            tests[i].done = -1;
+            completed++;
+            globus_mutex_unlock(&mutex);
+        }
+    }
+
+    globus_mutex_lock(&mutex);
+    while (completed < TEST_COUNT)
+    {
+        globus_cond_wait(&cond, &mutex);
+    }
+    globus_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < TEST_COUNT; i++)
+    {
+        bool ok = true, register_ok = true, callback_ok = true;
+
+        if (tests[i].done == -1)
+        {
+            ok = register_ok = false;
+        }
+        else if (tests[i].done != 1
+            || tests[i].fail == (tests[i].result == GLOBUS_SUCCESS))
+        {
+            ok = callback_ok = false;
+        }
+
+        printf("%s %zu - %s %s%s%s\n",
+                ok?"ok":"not ok",
+                i+1,
+                tests[i].method,
+                tests[i].uri_pattern,
+                register_ok? "" : " register_fail",
+                callback_ok? "" : " callback_fail");
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+    globus_dsi_rest_test_server_destroy();
+
+    globus_cond_destroy(&cond);
+    globus_mutex_destroy(&mutex);
+    free(contact_string);
+    globus_module_deactivate_all();
+    curl_global_cleanup();
+    return rc;
+}
@@ -1,6 +1,24 @@
 #include "globus_i_dsi_rest.h"
 #include <stdbool.h>
 
+static
+void *
+release_in_thread(void *arg)
+{
+    CURL **handle = arg;
+    globus_i_dsi_rest_request_t request = { .handle = NULL };
+
+    if (globus_i_dsi_rest_handle_get(handle, &request) != GLOBUS_SUCCESS)
+    {
+        *handle = NULL;
+    }
+    else
+    {
+        globus_i_dsi_rest_handle_release(*handle);
+    }
+    return NULL;
+}
+
 int
 main()
 {
@@ -8,7 +26,8 @@ main()
     globus_i_dsi_rest_request_t requests[10] = { { .handle = NULL } };
     size_t cases = sizeof(requests)/sizeof(requests[0]);
 
-    printf("1..%zu\n", cases);
+    printf("1..%zu\n", cases + 2);
+    globus_thread_set_model("pthread");
     globus_module_activate(GLOBUS_DSI_REST_MODULE);
 
     for (size_t i = 0; i < cases; i++)
@@ -42,6 +61,63 @@ main()
         }
     }
 
+    /* A released handle is reused by the next get in the same thread */
+    {
+        bool ok = true;
+        CURL *first = NULL, *second = NULL;
+
+        if (globus_i_dsi_rest_handle_get(&first, &requests[0])
+                != GLOBUS_SUCCESS)
+        {
+            ok = false;
+        }
+        globus_i_dsi_rest_handle_release(first);
+        if (globus_i_dsi_rest_handle_get(&second, &requests[0])
+                != GLOBUS_SUCCESS
+            || second != first)
+        {
+            ok = false;
+        }
+        globus_i_dsi_rest_handle_release(second);
+
+        printf("%s %zu - reuse\n", ok ? "ok" : "not ok", cases + 1);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+
+    /* A handle left in the slot of a thread that exits moves to the global
+     * cache
+     */
+    {
+        bool ok = false;
+        CURL *handle = NULL;
+        globus_thread_t thread;
+
+        if (globus_thread_create(&thread, NULL, release_in_thread, &handle)
+                == GLOBUS_SUCCESS)
+        {
+            globus_thread_join(thread, NULL);
+        }
+        for (size_t i = 0;
+             handle != NULL && i < globus_i_dsi_rest_handle_cache_size;
+             i++)
+        {
+            if (globus_i_dsi_rest_handle_cache[i] == handle)
+            {
+                ok = true;
+            }
+        }
+
+        printf("%s %zu - thread exit\n", ok ? "ok" : "not ok", cases + 2);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
     return rc;
 }
 /* main() */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the cost of recycling a CURL handle between requests by
+ * resetting it and setting all generic options again, against releasing
+ * it to the cache with only the request options cleared.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum { DEFAULT_ITERATIONS = 200000 };
+
+static
+double
+now_ns(void)
+{
+    struct timespec                     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int
+main(int argc, char *argv[])
+{
+    globus_i_dsi_rest_request_t         request = { .handle = NULL };
+    long                                iterations = DEFAULT_ITERATIONS;
+    double                              start, reset_ns, cache_ns;
+    CURL                               *handle;
+
+    if (argc > 1)
+    {
+        iterations = strtol(argv[1], NULL, 0);
+    }
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    handle = curl_easy_init();
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        curl_easy_reset(handle);
+        if (globus_i_dsi_rest_handle_init(handle) != CURLE_OK)
+        {
+            fprintf(stderr, "handle_init failed\n");
+            return 1;
+        }
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &request);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &request);
+        curl_easy_setopt(handle, CURLOPT_READDATA, &request);
+        curl_easy_setopt(handle, CURLOPT_XFERINFODATA, &request);
+    }
+    reset_ns = (now_ns() - start) / iterations;
+    curl_easy_cleanup(handle);
+
+    globus_i_dsi_rest_handle_get(&request.handle, &request);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        globus_i_dsi_rest_handle_release(request.handle);
+        if (globus_i_dsi_rest_handle_get(&request.handle, &request)
+                != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "handle_get failed\n");
+            return 1;
+        }
+    }
+    cache_ns = (now_ns() - start) / iterations;
+    globus_i_dsi_rest_handle_release(request.handle);
+
+    printf("handle reset + generic options: %8.1f ns/request\n", reset_ns);
+    printf("handle release + get:           %8.1f ns/request\n", cache_ns);
+    printf("speedup:                        %8.2fx\n", reset_ns / cache_ns);
+
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return 0;
+}
+/* main() */
@@ -0,0 +1,102 @@
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+
+int
+main()
+{
+    int rc = 0;
+    globus_dsi_rest_key_value_t desired_headers[] =
+    {
+        { .key = "Content-Type" },
+        { .key = "ETag" },
+        { .key = "Location" },
+        { .key = "X-Object-Meta-Mtime" },
+        { .key = "etag" },
+        { .key = NULL },
+    };
+    globus_dsi_rest_key_array_t desired =
+    {
+        .count = sizeof(desired_headers)/sizeof(desired_headers[0]),
+        .key_value = desired_headers
+    };
+    struct
+    {
+        const char *name;
+        size_t expected;
+    }
+    lookups[] =
+    {
+        { "Content-Type", 0 },
+        { "content-type", 0 },
+        { "CONTENT-TYPE", 0 },
+        { "etag", 1 },
+        { "location", 2 },
+        { "x-object-meta-mtime", 3 },
+        { "Content-Length", SIZE_MAX },
+        { "Content-Typ", SIZE_MAX },
+        { "Content-Type2", SIZE_MAX },
+        { "", SIZE_MAX },
+    };
+    size_t num_lookups = sizeof(lookups)/sizeof(lookups[0]);
+    globus_dsi_rest_key_value_t response_headers[] =
+    {
+        { .key = "Date", .value = "Mon, 01 Jan 2018 00:00:00 GMT" },
+        { .key = "etag", .value = "\"first\"" },
+        { .key = "content-type", .value = "text/plain" },
+        { .key = "ETag", .value = "\"second\"" },
+    };
+    globus_dsi_rest_response_arg_t response_arg =
+    {
+        .desired_headers = desired
+    };
+    globus_i_dsi_rest_header_match_t match;
+    globus_i_dsi_rest_header_match_slot_t
+        slots[globus_i_dsi_rest_header_match_slots(desired.count)];
+    globus_result_t result;
+    bool ok;
+
+    printf("1..%zu\n", num_lookups + 1);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    globus_i_dsi_rest_header_match_init(&match, &desired, slots);
+
+    for (size_t i = 0; i < num_lookups; i++)
+    {
+        size_t found = globus_i_dsi_rest_header_match_find(
+                &match, lookups[i].name, strlen(lookups[i].name));
+
+        ok = (found == lookups[i].expected);
+        printf("%s %zu - find \"%s\"\n",
+                ok ? "ok" : "not ok", i+1, lookups[i].name);
+        rc += !ok;
+    }
+
+    result = globus_dsi_rest_response(
+            &response_arg,
+            200,
+            "OK",
+            &(globus_dsi_rest_key_array_t)
+            {
+                .count = sizeof(response_headers)/sizeof(response_headers[0]),
+                .key_value = response_headers
+            });
+    ok = result == GLOBUS_SUCCESS
+        && response_arg.response_code == 200
+        && desired_headers[0].value != NULL
+        && strcmp(desired_headers[0].value, "text/plain") == 0
+        && desired_headers[1].value != NULL
+        && strcmp(desired_headers[1].value, "\"first\"") == 0
+        && desired_headers[2].value == NULL
+        && desired_headers[3].value == NULL;
+    printf("%s %zu - response\n", ok ? "ok" : "not ok", num_lookups + 1);
+    rc += !ok;
+
+    for (size_t i = 0; i < desired.count; i++)
+    {
+        free((char *) desired_headers[i].value);
+    }
+
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    return rc;
+}
+/* main() */
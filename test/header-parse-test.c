@@ -0,0 +1,151 @@
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+
+struct test_case
+{
+    const char                         *name;
+    const char                         *line;
+    size_t                              line_len;
+    const char                         *key;
+    const char                         *value;
+};
+
+#define LINE(s) s, sizeof(s)-1
+
+int
+main()
+{
+    int rc = 0;
+    struct test_case test_cases[] =
+    {
+        {
+            .name = "simple",
+            LINE("Content-Type: text/plain\r\n"),
+            .key = "Content-Type",
+            .value = "text/plain"
+        },
+        {
+            .name = "no space",
+            LINE("Location:/next\r\n"),
+            .key = "Location",
+            .value = "/next"
+        },
+        {
+            .name = "empty value",
+            LINE("X-Empty:\r\n"),
+            .key = "X-Empty",
+            .value = ""
+        },
+        {
+            .name = "colon in value",
+            LINE("Date: Mon, 01 Jan 2018 00:00:00 GMT\r\n"),
+            .key = "Date",
+            .value = "Mon, 01 Jan 2018 00:00:00 GMT"
+        },
+        {
+            .name = "no crlf",
+            LINE("ETag: \"abc\""),
+            .key = "ETag",
+            .value = "\"abc\""
+        },
+        {
+            .name = "nul in value",
+            LINE("X-Nul: a\0b\r\n"),
+            .key = "X-Nul",
+            .value = "a"
+        },
+        {
+            .name = "folded",
+            LINE("X-Folded: one\r\n two"),
+            .key = "X-Folded",
+            .value = "one"
+        },
+    };
+    size_t num_cases = sizeof(test_cases)/sizeof(test_cases[0]);
+    globus_i_dsi_rest_arena_t arena = {0};
+    globus_i_dsi_rest_header_block_t header_block = {0};
+    globus_dsi_rest_key_array_t headers = {0};
+    globus_result_t result;
+    bool ok;
+    char many[64];
+    size_t t = 0;
+
+    printf("1..%zu\n", num_cases + 4);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    for (size_t i = 0; i < num_cases; i++)
+    {
+        const char *value;
+
+        result = globus_i_dsi_rest_header_parse(
+                &arena,
+                &header_block,
+                test_cases[i].line,
+                test_cases[i].line_len);
+        value = globus_i_dsi_rest_header_block_find(
+                &header_block,
+                test_cases[i].key);
+        ok = result == GLOBUS_SUCCESS
+            && value != NULL
+            && strcmp(value, test_cases[i].value) == 0;
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", ++t, test_cases[i].name);
+        rc += !ok;
+    }
+
+    /* Lines without a colon aren't headers */
+    result = globus_i_dsi_rest_header_parse(
+            &arena, &header_block, "\r\n", 2);
+    ok = result == GLOBUS_SUCCESS && header_block.count == num_cases;
+    printf("%s %zu - blank line\n", ok ? "ok" : "not ok", ++t);
+    rc += !ok;
+
+    result = globus_i_dsi_rest_header_parse(
+            &arena, &header_block, ": no key\r\n", 10);
+    ok = result != GLOBUS_SUCCESS && header_block.count == num_cases;
+    printf("%s %zu - no key\n", ok ? "ok" : "not ok", ++t);
+    rc += !ok;
+
+    /* Enough to grow the buffer and views, with other allocations between */
+    ok = true;
+    for (int i = 0; i < 200; i++)
+    {
+        snprintf(many, sizeof(many), "X-Many-%03d: value %d\r\n", i, i);
+        result = globus_i_dsi_rest_header_parse(
+                &arena, &header_block, many, strlen(many));
+        if (result != GLOBUS_SUCCESS)
+        {
+            ok = false;
+        }
+        if (i % 50 == 0)
+        {
+            globus_i_dsi_rest_arena_alloc(&arena, 100);
+        }
+    }
+    result = globus_i_dsi_rest_header_block_key_array(
+            &arena, &header_block, &headers);
+    ok = ok && result == GLOBUS_SUCCESS
+        && headers.count == num_cases + 200
+        && strcmp(headers.key_value[0].key, "Content-Type") == 0
+        && strcmp(headers.key_value[0].value, "text/plain") == 0
+        && strcmp(headers.key_value[num_cases + 199].key, "X-Many-199") == 0
+        && strcmp(headers.key_value[num_cases + 199].value, "value 199") == 0;
+    printf("%s %zu - key array\n", ok ? "ok" : "not ok", ++t);
+    rc += !ok;
+
+    globus_i_dsi_rest_header_block_reset(&header_block);
+    result = globus_i_dsi_rest_header_parse(
+            &arena, &header_block, LINE("Content-Length: 0\r\n"));
+    ok = result == GLOBUS_SUCCESS
+        && header_block.count == 1
+        && globus_i_dsi_rest_header_block_find(
+                &header_block, "Content-Type") == NULL
+        && strcmp(globus_i_dsi_rest_header_block_find(
+                &header_block, "content-length"), "0") == 0;
+    printf("%s %zu - reset\n", ok ? "ok" : "not ok", ++t);
+    rc += !ok;
+
+    globus_i_dsi_rest_arena_release(&arena);
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    return rc;
+}
+/* main() */
@@ -0,0 +1,117 @@
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+
+int
+main()
+{
+    int rc = 0;
+    globus_dsi_rest_key_value_t headers[] =
+    {
+        {
+            .key = "Authorization",
+            .value = "Bearer abc"
+        },
+        {
+            .key = "Placeholder",
+            .value = NULL
+        },
+        {
+            .key = "Accept",
+            .value = "application/json"
+        },
+        {
+            .key = "User-Agent",
+            .value = "nøn-áscîï"
+        },
+    };
+    const char *expected[] =
+    {
+        "Authorization: Bearer abc",
+        "Accept: application/json",
+        "User-Agent: nøn-áscîï"
+    };
+    size_t num_expected = sizeof(expected)/sizeof(expected[0]);
+    globus_dsi_rest_header_set_t header_set = NULL;
+    globus_result_t result;
+    bool ok;
+    size_t i;
+
+    printf("1..4\n");
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    result = globus_dsi_rest_header_set_create(
+            &(globus_dsi_rest_key_array_t)
+            {
+                .count = sizeof(headers)/sizeof(headers[0]),
+                .key_value = headers
+            },
+            &header_set);
+    ok = (result == GLOBUS_SUCCESS && header_set != NULL);
+    printf("%s 1 - create\n", ok ? "ok" : "not ok");
+    if (!ok)
+    {
+        printf("not ok 2 - lines # skipped\n");
+        printf("not ok 3 - set_length # skipped\n");
+        printf("not ok 4 - request # skipped\n");
+        rc = 4;
+        goto create_fail;
+    }
+
+    i = 0;
+    ok = true;
+    for (struct curl_slist *s = header_set->lines; s != NULL; s = s->next)
+    {
+        fprintf(stderr, "%s\n", s->data);
+        if (i >= num_expected || strcmp(s->data, expected[i]) != 0)
+        {
+            ok = false;
+        }
+        i++;
+    }
+    ok = ok && (i == num_expected);
+    printf("%s 2 - lines\n", ok ? "ok" : "not ok");
+    rc += !ok;
+
+    ok = !header_set->set_length;
+    printf("%s 3 - set_length\n", ok ? "ok" : "not ok");
+    rc += !ok;
+
+    /* A request's own headers come first, followed by the shared set */
+    ok = true;
+    for (int r = 0; r < 2; r++)
+    {
+        globus_i_dsi_rest_request_t request = {.handle = NULL};
+        struct curl_slist **lastp = &request.request_headers;
+
+        result = globus_i_dsi_rest_add_header(
+                &request.arena,
+                &request.request_headers,
+                "X-Request",
+                r ? "second" : "first");
+        ok = ok && (result == GLOBUS_SUCCESS);
+        while (ok && *lastp != NULL)
+        {
+            lastp = &(*lastp)->next;
+        }
+        *lastp = header_set->lines;
+
+        i = 0;
+        for (struct curl_slist *s = request.request_headers; s != NULL; s = s->next)
+        {
+            i++;
+        }
+        ok = ok && (i == num_expected + 1)
+            && strcmp(request.request_headers->data,
+                    r ? "X-Request: second" : "X-Request: first") == 0
+            && request.request_headers->next == header_set->lines;
+        globus_i_dsi_rest_arena_release(&request.arena);
+    }
+    printf("%s 4 - request\n", ok ? "ok" : "not ok");
+    rc += !ok;
+
+    globus_dsi_rest_header_set_destroy(header_set);
+create_fail:
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    return rc;
+}
+/* main() */
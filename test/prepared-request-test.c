@@ -0,0 +1,251 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <curl/curl.h>
+
+#include "globus_dsi_rest.h"
+#include "globus_i_dsi_rest.h"
+#include "test-xio-server.h"
+
+struct test_case
+{
+    char                               *path;
+    globus_dsi_rest_key_array_t        *query_parameters;
+    char                               *uri_pattern;
+    int                                 response_code;
+    char                               *download_body;
+    size_t                              client_read_offset;
+};
+
+struct test_case                        tests[] =
+{
+    {
+        .path = NULL,
+        .uri_pattern = "/prepared-test?prepared=yes",
+        .response_code = 200,
+        .download_body = "base\n"
+    },
+    {
+        .path = "/one",
+        .uri_pattern = "/prepared-test/one?prepared=yes",
+        .response_code = 200,
+        .download_body = "one\n"
+    },
+    {
+        .path = "/two",
+        .query_parameters = &(globus_dsi_rest_key_array_t)
+        {
+            .count = 1,
+            .key_value = &(globus_dsi_rest_key_value_t)
+            {
+                .key = "per call",
+                .value = "a/b"
+            }
+        },
+        .uri_pattern = "/prepared-test/two?prepared=yes&per+call=a%2Fb",
+        .response_code = 200,
+        .download_body = "two\n"
+    },
+    {
+        .path = "/missing",
+        .uri_pattern = "/prepared-test/missing?prepared=yes",
+        .response_code = 404,
+        .download_body = "Not Found\n"
+    },
+};
+
+static
+globus_result_t
+response_callback(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    struct test_case                   *test = response_callback_arg;
+
+    if (response_code != test->response_code)
+    {
+        return GLOBUS_FAILURE;
+    }
+    return GLOBUS_SUCCESS;
+}
+/* response_callback() */
+
+static
+globus_result_t
+read_callback(
+    void                               *read_callback_arg,
+    void                               *buffer,
+    size_t                              buffer_length)
+{
+    struct test_case                   *test = read_callback_arg;
+    size_t                              this_read;
+
+    this_read = strlen(test->download_body + test->client_read_offset);
+
+    if (this_read > buffer_length)
+    {
+        this_read = buffer_length;
+    }
+
+    if (memcmp(
+            test->download_body + test->client_read_offset,
+            buffer,
+            this_read) != 0)
+    {
+        return GLOBUS_FAILURE;
+    }
+    test->client_read_offset += this_read;
+
+    return GLOBUS_SUCCESS;
+}
+/* read_callback() */
+
+static
+globus_result_t
+prepared_test_handler(
+    void                               *route_arg,
+    void                               *request_body,
+    size_t                              request_body_length,
+    int                                *response_code,
+    void                               *response_body,
+    size_t                             *response_body_length,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    struct test_case                   *test = route_arg;
+
+    strcpy(response_body, test->download_body);
+    *response_body_length = strlen(test->download_body);
+    *response_code = test->response_code;
+
+    return GLOBUS_SUCCESS;
+}
+/* prepared_test_handler() */
+
+int main()
+{
+    globus_result_t                     result;
+    globus_dsi_rest_key_array_t         headers =
+    {
+        .count = 1,
+        .key_value = &(globus_dsi_rest_key_value_t) {
+            .key = "Accept",
+            .value = "text/plain"
+        }
+    };
+    globus_dsi_rest_key_array_t         query_parameters =
+    {
+        .count = 1,
+        .key_value = &(globus_dsi_rest_key_value_t) {
+            .key = "prepared",
+            .value = "yes"
+        }
+    };
+    globus_dsi_rest_prepared_t          prepared = NULL;
+    char                               *contact_string;
+    int                                 rc = 0;
+
+    globus_thread_set_model("pthread");
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    globus_module_activate(GLOBUS_XIO_MODULE);
+
+    printf("1..%zu\n", sizeof(tests)/sizeof(tests[0]));
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    result = globus_dsi_rest_test_server_init(&contact_string);
+
+    for (size_t i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        result = globus_dsi_rest_test_server_add_route(
+            tests[i].uri_pattern,
+            prepared_test_handler,
+            &tests[i]);
+    }
+
+    {
+        char uri_fmt[] = "http://%s/prepared-test";
+        char uri[strlen(contact_string) + sizeof(uri_fmt)];
+        snprintf(uri, sizeof(uri), uri_fmt, contact_string);
+
+        result = globus_dsi_rest_prepare(
+            "GET",
+            uri,
+            &query_parameters,
+            &headers,
+            &prepared);
+    }
+    if (result != GLOBUS_SUCCESS)
+    {
+        char *errstr = globus_error_print_friendly(globus_error_peek(result));
+        fprintf(stderr, "prepare result: %s\n", errstr);
+        free(errstr);
+        rc = sizeof(tests)/sizeof(tests[0]);
+        goto prepare_fail;
+    }
+
+    /* The same prepared request is performed with each suffix */
+    for (size_t i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        bool ok = true, transport_ok = true, download_ok = true;
+
+        result = globus_dsi_rest_request_prepared(
+            prepared,
+            tests[i].path,
+            tests[i].query_parameters,
+            &(globus_dsi_rest_callbacks_t)
+            {
+                .response_callback = response_callback,
+                .response_callback_arg = &tests[i],
+                .data_read_callback = read_callback,
+                .data_read_callback_arg = &tests[i]
+            });
+
+        if (result != GLOBUS_SUCCESS)
+        {
+            char *errstr = globus_error_print_friendly(globus_error_peek(result));
+            fprintf(stderr, "request result: %s\n", errstr);
+            free(errstr);
+            ok = transport_ok = false;
+        }
+        if (tests[i].client_read_offset != strlen(tests[i].download_body))
+        {
+            ok = download_ok = false;
+        }
+
+        printf("%s %zu - %s%s%s\n",
+                ok?"ok":"not ok",
+                i+1,
+                tests[i].uri_pattern,
+                transport_ok?"":" transport_fail",
+                download_ok?"":" download_fail");
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+    globus_dsi_rest_prepared_destroy(prepared);
+
+prepare_fail:
+    free(contact_string);
+    globus_dsi_rest_test_server_destroy();
+    globus_module_deactivate_all();
+    curl_global_cleanup();
+    return rc;
+}
@@ -0,0 +1,454 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Reads a test file to a stand-in GridFTP data channel with
+ * globus_dsi_rest_read_gridftp_op_parallel(). The test server answers each
+ * GET with the range its Range header asks for, unless the test case makes
+ * it reply with the whole file, a Content-Range which doesn't match, or an
+ * error. Checks the ranges asked for, that the data channel got exactly
+ * the bytes of the range read, and how the result is reported, both when
+ * waiting and through a complete callback.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <curl/curl.h>
+
+#include "globus_dsi_rest.h"
+#include "test-xio-server.h"
+#include "test-gridftp-op.h"
+
+enum
+{
+    MiB = 1024*1024,
+    /* Three of the smallest ranges the read is split into, and a bit */
+    FILE_SIZE = 3*MiB + 5,
+    MAX_REQUESTS = 8
+};
+
+enum reply
+{
+    /* 206 with the range asked for, or 200 with the file without a Range */
+    REPLY_RANGE,
+    /* 200 with the whole file, as a server which ignores Range does */
+    REPLY_WHOLE,
+    /* 206 with a Content-Range starting a byte after the one asked for */
+    REPLY_SHIFTED,
+    /* 500 to the request for the second range */
+    REPLY_FAIL_SECOND
+};
+
+struct test_case
+{
+    const char                         *name;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    int                                 max_streams;
+    /*
+     * Returned by the stand-in get_optimal_concurrency, 2 if 0; this also
+     * bounds the writes each range has outstanding, so it can't be 0
+     */
+    int                                 concurrency;
+    enum reply                          reply;
+    /* Pass a complete callback instead of waiting */
+    bool                                async;
+    bool                                fails;
+    /*
+     * Ranges expected to be asked for, as "start-end" or "start-", or
+     * "(none)" for a request without a Range header
+     */
+    const char                         *requests[MAX_REQUESTS];
+};
+
+static
+struct test_case                        tests[] =
+{
+    {
+        .name = "split in three",
+        .offset = 0,
+        .length = FILE_SIZE,
+        .max_streams = 3,
+        /* The remainder of 5 bytes goes to the first ranges */
+        .requests = { "0-1048577", "1048578-2097155", "2097156-3145732" },
+    },
+    {
+        .name = "streams from the optimal concurrency",
+        .offset = 11,
+        .length = 2*MiB + 3,
+        .concurrency = 4,
+        /* No more streams than whole 1 MiB ranges */
+        .requests = { "11-1048588", "1048589-2097165" },
+    },
+    {
+        .name = "more streams than ranges",
+        .offset = 0,
+        .length = FILE_SIZE,
+        .max_streams = 8,
+        .requests = { "0-1048577", "1048578-2097155", "2097156-3145732" },
+    },
+    {
+        .name = "less than 1 MiB in one range",
+        .offset = 1000,
+        .length = 1000,
+        .max_streams = 4,
+        .requests = { "1000-1999" },
+    },
+    {
+        .name = "complete callback",
+        .offset = 0,
+        .length = FILE_SIZE,
+        .max_streams = 3,
+        .async = true,
+        .requests = { "0-1048577", "1048578-2097155", "2097156-3145732" },
+    },
+    {
+        .name = "to the end of the file",
+        .offset = 100,
+        .length = -1,
+        .max_streams = 3,
+        .requests = { "100-" },
+    },
+    {
+        .name = "whole file",
+        .offset = 0,
+        .length = -1,
+        .max_streams = 3,
+        .requests = { "(none)" },
+    },
+    {
+        .name = "200 reply to a ranged GET",
+        .offset = 0,
+        .length = 2*MiB,
+        .max_streams = 2,
+        .reply = REPLY_WHOLE,
+        .fails = true,
+        .requests = { "0-1048575", "1048576-2097151" },
+    },
+    {
+        .name = "mismatched Content-Range",
+        .offset = 0,
+        .length = 2*MiB,
+        .max_streams = 2,
+        .reply = REPLY_SHIFTED,
+        .fails = true,
+        .requests = { "0-1048575", "1048576-2097151" },
+    },
+    {
+        .name = "one range fails",
+        .offset = 0,
+        .length = FILE_SIZE,
+        .max_streams = 3,
+        .reply = REPLY_FAIL_SECOND,
+        .fails = true,
+        .requests = { "0-1048577", "1048578-2097155", "2097156-3145732" },
+    },
+    {
+        .name = "one range fails with a complete callback",
+        .offset = 0,
+        .length = FILE_SIZE,
+        .max_streams = 3,
+        .reply = REPLY_FAIL_SECOND,
+        .async = true,
+        .fails = true,
+        .requests = { "0-1048577", "1048578-2097155", "2097156-3145732" },
+    },
+    {
+        .name = "length 0",
+        .offset = 10,
+        .length = 0,
+        .max_streams = 3,
+    },
+    {
+        .name = "length 0 with a complete callback",
+        .offset = 10,
+        .length = 0,
+        .max_streams = 3,
+        .async = true,
+    },
+};
+
+static unsigned char                    data[FILE_SIZE];
+static struct test_case                *current_test;
+static char                             content_range[64];
+
+/* Ranges asked for, in the order the requests arrived */
+static char                             requested[MAX_REQUESTS][64];
+static int                              requests;
+
+static globus_mutex_t                   complete_mutex;
+static globus_cond_t                    complete_cond;
+static int                              complete_calls;
+static globus_result_t                  complete_result;
+
+static
+globus_result_t
+parallel_handler(
+    void                               *route_arg,
+    void                               *request_body,
+    size_t                              request_body_length,
+    int                                *response_code,
+    void                               *response_body,
+    size_t                             *response_body_length,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    const char                         *range;
+    uintmax_t                           start = 0;
+    uintmax_t                           end = FILE_SIZE - 1;
+    int                                 consumed = 0;
+
+    range = globus_dsi_rest_test_server_request_header("Range");
+    if (requests < MAX_REQUESTS)
+    {
+        snprintf(requested[requests], sizeof(requested[requests]), "%s",
+                range ? range + strlen("bytes=") : "(none)");
+    }
+    requests++;
+
+    headers->count = 0;
+    if (range == NULL || current_test->reply == REPLY_WHOLE)
+    {
+        *response_code = 200;
+        memcpy(response_body, data, FILE_SIZE);
+        *response_body_length = FILE_SIZE;
+        return GLOBUS_SUCCESS;
+    }
+    if (sscanf(range, "bytes=%"SCNuMAX"-%n", &start, &consumed) != 1
+        || start >= FILE_SIZE)
+    {
+        return GLOBUS_FAILURE;
+    }
+    if (range[consumed] != '\0'
+        && sscanf(range + consumed, "%"SCNuMAX, &end) != 1)
+    {
+        return GLOBUS_FAILURE;
+    }
+    if (current_test->reply == REPLY_FAIL_SECOND
+        && start != 0 && end != FILE_SIZE - 1)
+    {
+        /* The middle of three ranges, whatever order they come in */
+        return GLOBUS_FAILURE;
+    }
+    if (end >= FILE_SIZE)
+    {
+        end = FILE_SIZE - 1;
+    }
+
+    headers->key_value = malloc(sizeof(globus_dsi_rest_key_value_t));
+    if (headers->key_value == NULL)
+    {
+        return GLOBUS_FAILURE;
+    }
+    snprintf(content_range, sizeof(content_range),
+            "bytes %"PRIuMAX"-%"PRIuMAX"/%d",
+            start + (current_test->reply == REPLY_SHIFTED),
+            end,
+            FILE_SIZE);
+    headers->count = 1;
+    headers->key_value[0].key = "Content-Range";
+    headers->key_value[0].value = content_range;
+    *response_code = 206;
+    memcpy(response_body, data + start, end - start + 1);
+    *response_body_length = end - start + 1;
+
+    return GLOBUS_SUCCESS;
+}
+/* parallel_handler() */
+
+static
+void
+complete_callback(
+    void                               *complete_callback_arg,
+    globus_result_t                     result)
+{
+    globus_mutex_lock(&complete_mutex);
+    complete_calls++;
+    complete_result = result;
+    globus_cond_signal(&complete_cond);
+    globus_mutex_unlock(&complete_mutex);
+}
+/* complete_callback() */
+
+/*
+ * Whether each range expected was asked for once, in any order, and
+ * nothing else.
+ */
+static
+bool
+check_requests(
+    struct test_case                   *test)
+{
+    int                                 expected = 0;
+    bool                                ok = true;
+
+    while (expected < MAX_REQUESTS && test->requests[expected] != NULL)
+    {
+        expected++;
+    }
+    if (requests != expected)
+    {
+        fprintf(stderr, "# %d requests, expected %d\n", requests, expected);
+        return false;
+    }
+    for (int i = 0; i < requests; i++)
+    {
+        bool                            found = false;
+
+        for (int j = 0; j < requests; j++)
+        {
+            found = found || strcmp(requested[j], test->requests[i]) == 0;
+        }
+        if (!found)
+        {
+            fprintf(stderr, "# range %s not asked for\n", test->requests[i]);
+            ok = false;
+        }
+    }
+    return ok;
+}
+/* check_requests() */
+
+int
+main()
+{
+    size_t                              num_tests;
+    char                               *contact_string = NULL;
+    char                               *uri = NULL;
+    unsigned char                      *written;
+    int                                 rc = 0;
+
+    num_tests = sizeof(tests)/sizeof(tests[0]);
+
+    globus_thread_set_model("pthread");
+    curl_global_init(CURL_GLOBAL_ALL);
+    globus_module_activate(GLOBUS_XIO_MODULE);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+    globus_mutex_init(&complete_mutex, NULL);
+    globus_cond_init(&complete_cond, NULL);
+
+    printf("1..%zu\n", num_tests);
+
+    written = malloc(FILE_SIZE);
+    if (written == NULL)
+    {
+        return 99;
+    }
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (unsigned char) ('A' + i % 53);
+    }
+    globus_dsi_rest_test_server_init(&contact_string);
+    globus_dsi_rest_test_server_add_route(
+            "/parallel", parallel_handler, NULL);
+    uri = globus_common_create_string("http://%s/parallel", contact_string);
+
+    for (size_t i = 0; i < num_tests; i++)
+    {
+        struct test_case               *test = &tests[i];
+        globus_dsi_rest_test_op_t       test_op;
+        globus_off_t                    end;
+        globus_result_t                 result;
+        bool                            ok = true;
+
+        memset(written, 0, FILE_SIZE);
+        globus_dsi_rest_test_op_init(&test_op, data, 64*1024,
+                test->concurrency > 0 ? test->concurrency : 2);
+        test_op.written = written;
+        test_op.written_length = FILE_SIZE;
+        current_test = test;
+        requests = 0;
+        complete_calls = 0;
+
+        result = globus_dsi_rest_read_gridftp_op_parallel(
+                uri,
+                NULL,
+                NULL,
+                &(globus_dsi_rest_gridftp_op_arg_t)
+                {
+                    .op = (globus_gfs_operation_t) &test_op,
+                    .offset = test->offset,
+                    .length = test->length,
+                },
+                test->max_streams,
+                test->async ? complete_callback : NULL,
+                NULL);
+        if (test->async && result == GLOBUS_SUCCESS)
+        {
+            globus_mutex_lock(&complete_mutex);
+            while (complete_calls == 0)
+            {
+                globus_cond_wait(&complete_cond, &complete_mutex);
+            }
+            globus_mutex_unlock(&complete_mutex);
+            result = complete_result;
+        }
+        globus_dsi_rest_test_op_destroy(&test_op);
+
+        if ((result != GLOBUS_SUCCESS) != test->fails)
+        {
+            fprintf(stderr, "# read %s\n", test->fails ? "passed" : "failed");
+            ok = false;
+        }
+        if (test->async && complete_calls != 1)
+        {
+            fprintf(stderr, "# complete callback called %d times\n",
+                    complete_calls);
+            ok = false;
+        }
+        if (!check_requests(test))
+        {
+            ok = false;
+        }
+        if (test_op.write_outside)
+        {
+            fprintf(stderr, "# write outside of the file\n");
+            ok = false;
+        }
+        end = (test->length == -1) ? FILE_SIZE : test->offset + test->length;
+        for (globus_off_t off = 0; ok && !test->fails && off < FILE_SIZE;
+             off++)
+        {
+            bool                        in_range;
+
+            in_range = (off >= test->offset && off < end);
+            if (written[off] != (in_range ? data[off] : 0))
+            {
+                fprintf(stderr, "# wrong data at offset %"GLOBUS_OFF_T_FORMAT
+                        "\n", off);
+                ok = false;
+            }
+        }
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", i + 1, test->name);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+
+    free(written);
+    free(uri);
+    free(contact_string);
+    globus_dsi_rest_test_server_destroy();
+    globus_cond_destroy(&complete_cond);
+    globus_mutex_destroy(&complete_mutex);
+    globus_module_deactivate_all();
+    curl_global_cleanup();
+
+    return rc;
+}
+/* main() */
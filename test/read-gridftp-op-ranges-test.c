@@ -0,0 +1,327 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Reads ranges of a test file to a stand-in GridFTP data channel with
+ * globus_dsi_rest_read_gridftp_op_ranges(). The test server replies to the
+ * multi-range GET with a multipart/byteranges body which may leave out or
+ * cut short some of the parts, or as a server which ignores or coalesces
+ * the ranges would, and to each request after that with the next range to
+ * be read again on its own. Checks that every range is
+ * written to the data channel exactly as in the file, and nothing else.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <curl/curl.h>
+
+#include "globus_dsi_rest.h"
+#include "test-xio-server.h"
+#include "test-gridftp-op.h"
+
+#define BOUNDARY "3d6b6a416f9b5e2c7a1d"
+
+enum
+{
+    FILE_SIZE = 256,
+    RANGE_COUNT = 3
+};
+
+static
+const globus_dsi_rest_test_extent_t     ranges[RANGE_COUNT] =
+{
+    { 16, 32 },
+    { 100, 20 },
+    { 200, 40 },
+};
+
+enum reply
+{
+    /* multipart/byteranges with the parts in sent */
+    REPLY_MULTIPART,
+    /* 200 with the whole file, as a server which ignores Range does */
+    REPLY_WHOLE,
+    /* 206 with one part from the first range to the end of the last */
+    REPLY_COALESCED
+};
+
+struct test_case
+{
+    const char                         *name;
+    /* Reply to the multi-range GET */
+    enum reply                          reply;
+    /* Bytes of each range sent in the multipart reply, or -1 to leave the
+     * part out
+     */
+    int                                 sent[RANGE_COUNT];
+    /* Whether the reply ends with the final delimiter */
+    bool                                final;
+    /* First range the test server expects to be asked for again */
+    size_t                              fallback_index;
+};
+
+static
+struct test_case                        tests[] =
+{
+    {
+        .name = "all parts",
+        .sent = { 32, 20, 40 },
+        .final = true,
+        .fallback_index = RANGE_COUNT,
+    },
+    {
+        .name = "missing last part",
+        .sent = { 32, 20, -1 },
+        .final = true,
+        .fallback_index = 2,
+    },
+    {
+        .name = "missing parts",
+        .sent = { 32, -1, -1 },
+        .final = true,
+        .fallback_index = 1,
+    },
+    {
+        .name = "short part",
+        .sent = { 32, 10, 40 },
+        .final = true,
+        .fallback_index = 1,
+    },
+    {
+        .name = "truncated body",
+        .sent = { 32, 10, -1 },
+        .final = false,
+        .fallback_index = 1,
+    },
+    {
+        .name = "200 reply",
+        .reply = REPLY_WHOLE,
+        .fallback_index = 0,
+    },
+    {
+        .name = "coalesced single part",
+        .reply = REPLY_COALESCED,
+        .fallback_index = 0,
+    },
+};
+
+static unsigned char                    data[FILE_SIZE];
+static struct test_case                *current_test;
+static int                              requests;
+static char                             content_range[64];
+
+static
+globus_result_t
+ranges_handler(
+    void                               *route_arg,
+    void                               *request_body,
+    size_t                              request_body_length,
+    int                                *response_code,
+    void                               *response_body,
+    size_t                             *response_body_length,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    char                               *body = response_body;
+    size_t                              n = 0;
+
+    headers->count = 1;
+    headers->key_value = malloc(sizeof(globus_dsi_rest_key_value_t));
+    if (headers->key_value == NULL)
+    {
+        return GLOBUS_FAILURE;
+    }
+    *response_code = 206;
+
+    if (requests == 0 && current_test->reply == REPLY_WHOLE)
+    {
+        requests++;
+        free(headers->key_value);
+        headers->key_value = NULL;
+        headers->count = 0;
+        *response_code = 200;
+        memcpy(body, data, FILE_SIZE);
+        n = FILE_SIZE;
+    }
+    else if (requests == 0 && current_test->reply == REPLY_COALESCED)
+    {
+        globus_off_t                    end;
+
+        requests++;
+        end = ranges[RANGE_COUNT-1].offset + ranges[RANGE_COUNT-1].length;
+        snprintf(content_range, sizeof(content_range),
+                "bytes %d-%d/%d",
+                (int) ranges[0].offset,
+                (int) (end - 1),
+                FILE_SIZE);
+        headers->key_value[0].key = "Content-Range";
+        headers->key_value[0].value = content_range;
+        memcpy(body, data + ranges[0].offset, end - ranges[0].offset);
+        n = end - ranges[0].offset;
+    }
+    else if (requests++ == 0)
+    {
+        headers->key_value[0].key = "Content-Type";
+        headers->key_value[0].value =
+                "multipart/byteranges; boundary=" BOUNDARY;
+        for (size_t i = 0; i < RANGE_COUNT; i++)
+        {
+            if (current_test->sent[i] < 0)
+            {
+                continue;
+            }
+            n += sprintf(body + n,
+                    "%s--" BOUNDARY "\r\n"
+                    "Content-Type: application/octet-stream\r\n"
+                    "Content-Range: bytes %d-%d/%d\r\n"
+                    "\r\n",
+                    n == 0 ? "" : "\r\n",
+                    (int) ranges[i].offset,
+                    (int) (ranges[i].offset + ranges[i].length - 1),
+                    FILE_SIZE);
+            memcpy(body + n, data + ranges[i].offset,
+                    current_test->sent[i]);
+            n += current_test->sent[i];
+        }
+        if (current_test->final)
+        {
+            n += sprintf(body + n, "\r\n--" BOUNDARY "--\r\n");
+        }
+    }
+    else
+    {
+        size_t                          i;
+
+        i = current_test->fallback_index + requests - 2;
+        if (i >= RANGE_COUNT)
+        {
+            free(headers->key_value);
+            headers->key_value = NULL;
+            headers->count = 0;
+            return GLOBUS_FAILURE;
+        }
+        snprintf(content_range, sizeof(content_range),
+                "bytes %d-%d/%d",
+                (int) ranges[i].offset,
+                (int) (ranges[i].offset + ranges[i].length - 1),
+                FILE_SIZE);
+        headers->key_value[0].key = "Content-Range";
+        headers->key_value[0].value = content_range;
+        memcpy(body, data + ranges[i].offset, ranges[i].length);
+        n = ranges[i].length;
+    }
+    *response_body_length = n;
+
+    return GLOBUS_SUCCESS;
+}
+/* ranges_handler() */
+
+int
+main()
+{
+    size_t                              num_tests;
+    char                               *contact_string = NULL;
+    char                               *uri = NULL;
+    int                                 rc = 0;
+
+    num_tests = sizeof(tests)/sizeof(tests[0]);
+
+    globus_thread_set_model("pthread");
+    curl_global_init(CURL_GLOBAL_ALL);
+    globus_module_activate(GLOBUS_XIO_MODULE);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    printf("1..%zu\n", num_tests);
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (unsigned char) ('A' + i % 53);
+    }
+    globus_dsi_rest_test_server_init(&contact_string);
+    globus_dsi_rest_test_server_add_route("/ranges", ranges_handler, NULL);
+    uri = globus_common_create_string("http://%s/ranges", contact_string);
+
+    for (size_t i = 0; i < num_tests; i++)
+    {
+        struct test_case               *test = &tests[i];
+        unsigned char                   written[FILE_SIZE] = {0};
+        globus_dsi_rest_test_op_t       test_op;
+        globus_result_t                 result;
+        bool                            ok = true;
+
+        globus_dsi_rest_test_op_init(&test_op, data, 1024, 1);
+        test_op.ranges = ranges;
+        test_op.range_count = RANGE_COUNT;
+        test_op.written = written;
+        test_op.written_length = sizeof(written);
+        current_test = test;
+        requests = 0;
+
+        result = globus_dsi_rest_read_gridftp_op_ranges(
+                uri,
+                NULL,
+                NULL,
+                (globus_gfs_operation_t) &test_op);
+        globus_dsi_rest_test_op_destroy(&test_op);
+
+        if (result != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "# read failed\n");
+            ok = false;
+        }
+        if (requests != 1 + RANGE_COUNT - test->fallback_index)
+        {
+            fprintf(stderr, "# %d requests, expected %zu\n",
+                    requests, 1 + RANGE_COUNT - test->fallback_index);
+            ok = false;
+        }
+        if (test_op.write_outside)
+        {
+            fprintf(stderr, "# write outside of the file\n");
+            ok = false;
+        }
+        for (size_t off = 0, r = 0; ok && off < FILE_SIZE; off++)
+        {
+            bool                        in_range;
+
+            while (r < RANGE_COUNT
+                && off >= ranges[r].offset + ranges[r].length)
+            {
+                r++;
+            }
+            in_range = (r < RANGE_COUNT && off >= ranges[r].offset);
+            if (written[off] != (in_range ? data[off] : 0))
+            {
+                fprintf(stderr, "# wrong data at offset %zu\n", off);
+                ok = false;
+            }
+        }
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", i + 1, test->name);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+
+    free(uri);
+    free(contact_string);
+    globus_dsi_rest_test_server_destroy();
+    globus_module_deactivate_all();
+    curl_global_cleanup();
+
+    return rc;
+}
+/* main() */
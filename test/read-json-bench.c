@@ -0,0 +1,319 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the cost of accumulating a large JSON directory listing in the
+ * JSON read callback, fed to it in chunks of the size libcurl normally
+ * passes to its write callback, with and without the buffer presized from
+ * the Content-Length. The time to parse the result is shown for scale.
+ * The streaming reader is then fed the same chunks, parsing each element of
+ * the listing as it completes, and the most memory it held is reported.
+ * Last, a few values are extracted from the end of the listing by JSON
+ * pointer, which scans the whole listing but parses only those values.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum
+{
+    DEFAULT_ENTRIES = 50000,
+    DEFAULT_CHUNK_SIZE = 16*1024,
+    ITERATIONS = 8
+};
+
+static
+double
+now_ns(void)
+{
+    struct timespec                     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static
+int
+run(
+    const char                         *listing,
+    size_t                              listing_length,
+    size_t                              chunk_size,
+    bool                                presize)
+{
+    double                              accumulate_ns = 0, parse_ns = 0;
+
+    /* The first pass warms up the allocator, and isn't counted */
+    for (int iter = -1; iter < ITERATIONS; iter++)
+    {
+        json_t                         *json = NULL;
+        globus_i_dsi_rest_read_json_arg_t
+                                        jdata = { .json_out = &json };
+        double                          start;
+
+        start = now_ns();
+        if (presize)
+        {
+            globus_i_dsi_rest_read_json_reserve(&jdata, listing_length);
+        }
+        for (size_t off = 0; off < listing_length; off += chunk_size)
+        {
+            if (globus_dsi_rest_read_json(
+                        &jdata,
+                        (char *) listing + off,
+                        listing_length - off < chunk_size
+                            ? listing_length - off : chunk_size)
+                    != GLOBUS_SUCCESS)
+            {
+                fprintf(stderr, "read_json failed\n");
+                return 1;
+            }
+        }
+        if (iter >= 0)
+        {
+            accumulate_ns += now_ns() - start;
+        }
+
+        start = now_ns();
+        if (globus_dsi_rest_read_json(&jdata, NULL, 0) != GLOBUS_SUCCESS
+            || json == NULL)
+        {
+            fprintf(stderr, "json parse failed\n");
+            return 1;
+        }
+        if (iter >= 0)
+        {
+            parse_ns += now_ns() - start;
+        }
+
+        json_decref(json);
+        free(jdata.buffer);
+    }
+    printf("%-12s accumulate: %8.2f GB/s  parse: %8.2f ms\n",
+            presize ? "presized" : "grown",
+            (double) ITERATIONS * listing_length / accumulate_ns,
+            parse_ns / ITERATIONS / 1e6);
+
+    return 0;
+}
+
+static
+globus_result_t
+count_element(
+    void                               *arg,
+    json_t                             *element)
+{
+    (*(long *) arg)++;
+
+    return GLOBUS_SUCCESS;
+}
+
+static
+int
+run_streamed(
+    const char                         *listing,
+    size_t                              listing_length,
+    size_t                              chunk_size,
+    long                                entries)
+{
+    double                              elapsed = 0;
+    size_t                              held = 0;
+
+    for (int iter = -1; iter < ITERATIONS; iter++)
+    {
+        long                            count = 0;
+        globus_i_dsi_rest_read_json_elements_arg_t
+                                        jdata =
+        {
+            .arg =
+            {
+                .array_key = "DATA",
+                .element_callback = count_element,
+                .element_callback_arg = &count,
+            },
+        };
+        double                          start;
+
+        start = now_ns();
+        for (size_t off = 0; off < listing_length; off += chunk_size)
+        {
+            if (globus_dsi_rest_read_json_elements(
+                        &jdata,
+                        (char *) listing + off,
+                        listing_length - off < chunk_size
+                            ? listing_length - off : chunk_size)
+                    != GLOBUS_SUCCESS)
+            {
+                fprintf(stderr, "read_json_elements failed\n");
+                return 1;
+            }
+        }
+        if (globus_dsi_rest_read_json_elements(&jdata, NULL, 0)
+                != GLOBUS_SUCCESS
+            || count != entries)
+        {
+            fprintf(stderr, "read_json_elements found %ld elements\n", count);
+            return 1;
+        }
+        if (iter >= 0)
+        {
+            elapsed += now_ns() - start;
+        }
+        held = jdata.element_len;
+        free(jdata.element);
+    }
+    printf("%-12s accumulate + parse: %8.2f ms  buffered: %zu bytes\n",
+            "streamed",
+            elapsed / ITERATIONS / 1e6,
+            held);
+
+    return 0;
+}
+
+static
+int
+run_pointers(
+    const char                         *listing,
+    size_t                              listing_length,
+    size_t                              chunk_size,
+    long                                entries)
+{
+    double                              elapsed = 0;
+    char                                name_pointer[64];
+    char                                size_pointer[64];
+    const char                         *pointers[] =
+    {
+        name_pointer,
+        size_pointer,
+    };
+    json_t                             *values[2];
+
+    snprintf(name_pointer, sizeof(name_pointer),
+            "/DATA/%ld/name", entries - 1);
+    snprintf(size_pointer, sizeof(size_pointer),
+            "/DATA/%ld/size", entries - 1);
+
+    for (int iter = -1; iter < ITERATIONS; iter++)
+    {
+        globus_dsi_rest_read_json_pointers_arg_t
+                                        arg =
+        {
+            .count = 2,
+            .pointers = pointers,
+            .values = values,
+        };
+        globus_i_dsi_rest_read_json_pointers_arg_t
+                                        jdata;
+        double                          start;
+
+        start = now_ns();
+        if (globus_i_dsi_rest_read_json_pointers_init(&jdata, &arg)
+                != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "read_json_pointers_init failed\n");
+            return 1;
+        }
+        for (size_t off = 0; off < listing_length; off += chunk_size)
+        {
+            if (globus_dsi_rest_read_json_pointers(
+                        &jdata,
+                        (char *) listing + off,
+                        listing_length - off < chunk_size
+                            ? listing_length - off : chunk_size)
+                    != GLOBUS_SUCCESS)
+            {
+                fprintf(stderr, "read_json_pointers failed\n");
+                return 1;
+            }
+        }
+        if (globus_dsi_rest_read_json_pointers(&jdata, NULL, 0)
+                != GLOBUS_SUCCESS
+            || values[0] == NULL
+            || values[1] == NULL)
+        {
+            fprintf(stderr, "read_json_pointers did not find values\n");
+            return 1;
+        }
+        if (iter >= 0)
+        {
+            elapsed += now_ns() - start;
+        }
+        globus_i_dsi_rest_read_json_pointers_destroy(&jdata);
+        json_decref(values[0]);
+        json_decref(values[1]);
+    }
+    printf("%-12s accumulate + parse: %8.2f ms\n",
+            "pointers",
+            elapsed / ITERATIONS / 1e6);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    long                                entries = DEFAULT_ENTRIES;
+    size_t                              chunk_size = DEFAULT_CHUNK_SIZE;
+    size_t                              listing_alloc;
+    size_t                              n = 0;
+    char                               *listing;
+    int                                 rc = 0;
+
+    if (argc > 1)
+    {
+        entries = strtol(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        chunk_size = strtoul(argv[2], NULL, 0);
+    }
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    listing_alloc = 64 + entries * 160;
+    listing = malloc(listing_alloc);
+    if (listing == NULL)
+    {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+    n += snprintf(listing + n, listing_alloc - n, "{\"DATA\":[");
+    for (long i = 0; i < entries; i++)
+    {
+        n += snprintf(listing + n, listing_alloc - n,
+                "%s{\"name\":\"file%08ld.dat\",\"type\":\"file\","
+                "\"size\":%ld,\"last_modified\":\"2016-01-01T00:00:00Z\","
+                "\"permissions\":\"0644\"}",
+                i ? "," : "",
+                i,
+                i * 4096);
+    }
+    n += snprintf(listing + n, listing_alloc - n, "]}");
+
+    printf("%zu byte listing of %ld entries, %zu byte chunks\n",
+            n, entries, chunk_size);
+    rc += run(listing, n, chunk_size, false);
+    rc += run(listing, n, chunk_size, true);
+    rc += run_streamed(listing, n, chunk_size, entries);
+    rc += run_pointers(listing, n, chunk_size, entries);
+
+    free(listing);
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
@@ -0,0 +1,254 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Passes JSON documents straight to globus_dsi_rest_read_json_elements(),
+ * split into two reads at every offset and then fed one byte at a time,
+ * so that every element, member name, string and escape crosses a read
+ * boundary. Checks the elements reported, in order, and whether the end
+ * of the document is accepted.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct test_case
+{
+    const char                         *name;
+    const char                         *array_key;
+    const char                         *body;
+    /* Each element reported, as compact JSON followed by a newline */
+    const char                         *elements;
+    /* Whether the end of the body is an error */
+    bool                                truncated;
+};
+
+static
+struct test_case                        tests[] =
+{
+    {
+        .name = "top-level array",
+        .body =
+            " [1, \"a,]\\\"b\", {\"c\": [2, {\"d\": \"]}\"}]},"
+            " true, null, -15, [[]], \"\"]\n",
+        .elements =
+            "1\n"
+            "\"a,]\\\"b\"\n"
+            "{\"c\":[2,{\"d\":\"]}\"}]}\n"
+            "true\n"
+            "null\n"
+            "-15\n"
+            "[[]]\n"
+            "\"\"\n",
+    },
+    {
+        .name = "array under a key",
+        .array_key = "DATA",
+        .body =
+            "{\"x\": [9], \"DA\": [8], \"DATAX\": [7],"
+            " \"nested\": {\"DATA\": [6]}, \"s\": \"\\\"DATA\\\": [5]\","
+            " \"DATA\": [1, {\"k\": \"v\"}], \"after\": [4]}",
+        .elements =
+            "1\n"
+            "{\"k\":\"v\"}\n",
+    },
+    {
+        .name = "escapes in names and strings",
+        .array_key = "DATA",
+        .body =
+            "{\"k\\\"DATA\": [0], \"DATA\\\\\": [0],"
+            " \"DATA\": [\"\\\\\", \"\\u005d\", \"\\\"]\", \"\\\\\\\"\"]}",
+        .elements =
+            "\"\\\\\"\n"
+            "\"]\"\n"
+            "\"\\\"]\"\n"
+            "\"\\\\\\\"\"\n",
+    },
+    {
+        .name = "top-level array with a key",
+        .array_key = "DATA",
+        .body = "[1, 2]",
+        .elements = "",
+    },
+    {
+        .name = "empty array",
+        .array_key = "DATA",
+        .body = "{\"DATA\": [ ], \"more\": [1]}",
+        .elements = "",
+    },
+    {
+        .name = "empty top-level array",
+        .body = "[]",
+        .elements = "",
+    },
+    {
+        .name = "not an array under the key",
+        .array_key = "DATA",
+        .body =
+            "{\"DATA\": {\"a\": [1]}, \"b\": [2], \"DATA\": \"[3]\"}",
+        .elements = "",
+    },
+    {
+        .name = "truncated body",
+        .array_key = "DATA",
+        .body = "{\"DATA\": [1, {\"a\": [2",
+        .elements = "1\n",
+        .truncated = true,
+    },
+};
+
+static
+globus_result_t
+collect_element(
+    void                               *element_callback_arg,
+    json_t                             *element)
+{
+    char                               *elements = element_callback_arg;
+    char                               *s;
+
+    s = json_dumps(element, JSON_COMPACT | JSON_ENCODE_ANY);
+    if (s == NULL)
+    {
+        return GLOBUS_FAILURE;
+    }
+    strcat(elements, s);
+    strcat(elements, "\n");
+    free(s);
+
+    return GLOBUS_SUCCESS;
+}
+/* collect_element() */
+
+/*
+ * Parse test->body in reads of the lengths in reads, which add up to the
+ * length of the body, and check the elements reported.
+ */
+static
+bool
+parse_reads(
+    struct test_case                   *test,
+    const size_t                       *reads,
+    size_t                              read_count)
+{
+    char                                elements[1024] = "";
+    globus_i_dsi_rest_read_json_elements_arg_t
+                                        jdata =
+    {
+        .arg =
+        {
+            .array_key = test->array_key,
+            .element_callback = collect_element,
+            .element_callback_arg = elements,
+        },
+    };
+    const char                         *body = test->body;
+    globus_result_t                     result;
+    bool                                ok = true;
+
+    for (size_t i = 0; ok && i < read_count; i++)
+    {
+        if (reads[i] == 0)
+        {
+            /* A read of 0 bytes is the end of the body */
+            continue;
+        }
+        if (globus_dsi_rest_read_json_elements(
+                    &jdata, (void *) body, reads[i]) != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "# read %zu failed\n", i);
+            ok = false;
+        }
+        body += reads[i];
+    }
+    if (ok)
+    {
+        result = globus_dsi_rest_read_json_elements(&jdata, "", 0);
+        if ((result == GLOBUS_SUCCESS) == test->truncated)
+        {
+            fprintf(stderr, "# end of body %s\n",
+                    test->truncated ? "accepted" : "failed");
+            ok = false;
+        }
+    }
+    if (ok && strcmp(elements, test->elements) != 0)
+    {
+        fprintf(stderr, "# elements:\n%s", elements);
+        ok = false;
+    }
+    free(jdata.element);
+
+    return ok;
+}
+/* parse_reads() */
+
+int
+main()
+{
+    size_t                              num_tests;
+    int                                 rc = 0;
+
+    num_tests = sizeof(tests)/sizeof(tests[0]);
+
+    printf("1..%zu\n", num_tests);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    for (size_t i = 0; i < num_tests; i++)
+    {
+        struct test_case               *test = &tests[i];
+        size_t                          length = strlen(test->body);
+        size_t                         *reads;
+        bool                            ok = true;
+
+        reads = malloc((length + 1) * sizeof(size_t));
+        if (reads == NULL)
+        {
+            return 99;
+        }
+        for (size_t split = 0; ok && split <= length; split++)
+        {
+            reads[0] = split;
+            reads[1] = length - split;
+            ok = parse_reads(test, reads, 2);
+            if (!ok)
+            {
+                fprintf(stderr, "# split at %zu\n", split);
+            }
+        }
+        for (size_t j = 0; j < length; j++)
+        {
+            reads[j] = 1;
+        }
+        if (ok && !parse_reads(test, reads, length))
+        {
+            fprintf(stderr, "# one byte at a time\n");
+            ok = false;
+        }
+        free(reads);
+
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", i + 1, test->name);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
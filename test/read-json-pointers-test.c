@@ -0,0 +1,262 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Passes JSON documents straight to globus_dsi_rest_read_json_pointers(),
+ * split into two reads at every offset and then fed one byte at a time,
+ * so that every member name and captured value crosses a read boundary.
+ * Checks the value found for each pointer, or that none is found.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+    MAX_POINTERS = 6
+};
+
+struct test_case
+{
+    const char                         *name;
+    const char                         *body;
+    const char                         *pointers[MAX_POINTERS];
+    /* Each value as compact JSON, or NULL if the pointer is not found */
+    const char                         *values[MAX_POINTERS];
+    size_t                              count;
+};
+
+static
+struct test_case                        tests[] =
+{
+    {
+        .name = "member names",
+        .body =
+            "{\"id\": \"abc\", \"size\": 1024, \"ok\": true,"
+            " \"meta\": {\"owner\": {\"name\": \"x\\\"y\"}, \"tags\": []}}",
+        .pointers = { "/size", "/id", "/meta/owner/name", "/meta/tags",
+                      "/ok" },
+        .values = { "1024", "\"abc\"", "\"x\\\"y\"", "[]", "true" },
+        .count = 5,
+    },
+    {
+        .name = "escaped tokens",
+        .body =
+            "{\"a/b\": 1, \"m~n\": 2, \"~1\": 3, \"a\": {\"b\": 4},"
+            " \"/\": {\"~\": 5}}",
+        .pointers = { "/a~1b", "/m~0n", "/~01", "/a/b", "/~1/~0" },
+        .values = { "1", "2", "3", "4", "5" },
+        .count = 5,
+    },
+    {
+        .name = "array indices",
+        .body =
+            "{\"list\": [\"zero\", {\"x\": [1, 2]}, [10, 11, 12], null,"
+            " \"four\", 5, 6, 7, 8, 9, {\"ten\": 10}]}",
+        .pointers = { "/list/0", "/list/1/x/1", "/list/2/2", "/list/3",
+                      "/list/10/ten", "/list/01" },
+        .values = { "\"zero\"", "2", "12", "null", "10", NULL },
+        .count = 6,
+    },
+    {
+        .name = "whole document",
+        .body = " {\"a\": [1, {\"b\": \"}\"}]}\n",
+        .pointers = { "", "/a/1/b" },
+        .values = { "{\"a\":[1,{\"b\":\"}\"}]}", "\"}\"" },
+        .count = 2,
+    },
+    {
+        .name = "whole document scalar",
+        .body = "-12.5e3",
+        .pointers = { "" },
+        .values = { "-12500.0" },
+        .count = 1,
+    },
+    {
+        .name = "repeated keys",
+        .body =
+            "{\"a\": \"first\", \"b\": {\"c\": 1}, \"a\": \"second\","
+            " \"b\": {\"c\": 2, \"d\": 3}}",
+        .pointers = { "/a", "/b/c", "/b/d" },
+        .values = { "\"first\"", "1", "3" },
+        .count = 3,
+    },
+    {
+        .name = "missing pointers",
+        .body =
+            "{\"a\": {\"b\": 1}, \"list\": [1, 2], \"s\": \"x\","
+            " \"ab\": 2, \"\": 3}",
+        .pointers = { "/b", "/a/c", "/list/2", "/s/0", "/list/x", "/" },
+        .values = { NULL, NULL, NULL, NULL, NULL, "3" },
+        .count = 6,
+    },
+    {
+        .name = "long names and values",
+        .body =
+            "{\"a very long member name which is not wanted\": 0,"
+            " \"another long member name which is wanted\":"
+            " {\"deep\": \"a long string value with \\\\ escapes \\u0041\"}}",
+        .pointers = { "/another long member name which is wanted" },
+        .values = { "{\"deep\":\"a long string value with \\\\ escapes A\"}" },
+        .count = 1,
+    },
+    {
+        .name = "nesting deeper than the pointers",
+        .body =
+            "{\"x\": {\"y\": {\"a\": 1, \"z\": [{\"a\": 2}, [[3], {\"a\": 4}]]},"
+            " \"a\": 5}, \"l\": [[[6], 7], {\"b\": [8]}, 9], \"a\": 10}",
+        .pointers = { "/a", "/x/a", "/l/2", "/l/1/b" },
+        .values = { "10", "5", "9", "[8]" },
+        .count = 4,
+    },
+};
+
+/*
+ * Parse test->body in reads of the lengths in reads, which add up to the
+ * length of the body, and check the values found.
+ */
+static
+bool
+parse_reads(
+    struct test_case                   *test,
+    const size_t                       *reads,
+    size_t                              read_count)
+{
+    json_t                             *values[MAX_POINTERS];
+    globus_dsi_rest_read_json_pointers_arg_t
+                                        arg =
+    {
+        .count = test->count,
+        .pointers = test->pointers,
+        .values = values,
+    };
+    globus_i_dsi_rest_read_json_pointers_arg_t
+                                        jdata;
+    const char                         *body = test->body;
+    bool                                ok = true;
+
+    if (globus_i_dsi_rest_read_json_pointers_init(&jdata, &arg)
+            != GLOBUS_SUCCESS)
+    {
+        fprintf(stderr, "# init failed\n");
+        globus_i_dsi_rest_read_json_pointers_destroy(&jdata);
+        return false;
+    }
+    for (size_t i = 0; ok && i < read_count; i++)
+    {
+        if (reads[i] == 0)
+        {
+            /* A read of 0 bytes is the end of the body */
+            continue;
+        }
+        if (globus_dsi_rest_read_json_pointers(
+                    &jdata, (void *) body, reads[i]) != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "# read %zu failed\n", i);
+            ok = false;
+        }
+        body += reads[i];
+    }
+    if (ok && globus_dsi_rest_read_json_pointers(&jdata, "", 0)
+            != GLOBUS_SUCCESS)
+    {
+        fprintf(stderr, "# end of body failed\n");
+        ok = false;
+    }
+    globus_i_dsi_rest_read_json_pointers_destroy(&jdata);
+
+    for (size_t i = 0; i < test->count; i++)
+    {
+        char                           *s = NULL;
+
+        if (values[i] != NULL)
+        {
+            s = json_dumps(values[i], JSON_COMPACT | JSON_ENCODE_ANY);
+            json_decref(values[i]);
+        }
+        if (ok && (s == NULL || test->values[i] == NULL
+                ? s != test->values[i]
+                : strcmp(s, test->values[i]) != 0))
+        {
+            fprintf(stderr, "# \"%s\" is %s\n",
+                    test->pointers[i], s ? s : "not found");
+            ok = false;
+        }
+        free(s);
+    }
+
+    return ok;
+}
+/* parse_reads() */
+
+int
+main()
+{
+    size_t                              num_tests;
+    int                                 rc = 0;
+
+    num_tests = sizeof(tests)/sizeof(tests[0]);
+
+    printf("1..%zu\n", num_tests);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    for (size_t i = 0; i < num_tests; i++)
+    {
+        struct test_case               *test = &tests[i];
+        size_t                          length = strlen(test->body);
+        size_t                         *reads;
+        bool                            ok = true;
+
+        reads = malloc((length + 1) * sizeof(size_t));
+        if (reads == NULL)
+        {
+            return 99;
+        }
+        for (size_t split = 0; ok && split <= length; split++)
+        {
+            reads[0] = split;
+            reads[1] = length - split;
+            ok = parse_reads(test, reads, 2);
+            if (!ok)
+            {
+                fprintf(stderr, "# split at %zu\n", split);
+            }
+        }
+        for (size_t j = 0; j < length; j++)
+        {
+            reads[j] = 1;
+        }
+        if (ok && !parse_reads(test, reads, length))
+        {
+            fprintf(stderr, "# one byte at a time\n");
+            ok = false;
+        }
+        free(reads);
+
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", i + 1, test->name);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
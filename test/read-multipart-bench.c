@@ -0,0 +1,165 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the throughput of the multipart response parser on a
+ * multipart/byteranges body of random binary data, fed to it in chunks
+ * of the size libcurl normally passes to its write callback.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum
+{
+    DEFAULT_PART_SIZE = 64*1024*1024,
+    DEFAULT_CHUNK_SIZE = 16*1024,
+    PARTS = 4,
+    ITERATIONS = 4
+};
+
+static const char                       boundary[] = "3d6b6a416f9b5e2c7a1d";
+
+static
+double
+now_ns(void)
+{
+    struct timespec                     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static
+globus_result_t
+count_data(
+    void                               *arg,
+    void                               *buffer,
+    size_t                              buffer_length)
+{
+    *(size_t *) arg += buffer_length;
+
+    return GLOBUS_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+    size_t                              part_size = DEFAULT_PART_SIZE;
+    size_t                              chunk_size = DEFAULT_CHUNK_SIZE;
+    size_t                              body_size;
+    size_t                              received;
+    unsigned char                      *body;
+    size_t                              n = 0;
+    double                              start, elapsed = 0;
+    int                                 rc = 0;
+
+    if (argc > 1)
+    {
+        part_size = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        chunk_size = strtoul(argv[2], NULL, 0);
+    }
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    body_size = PARTS * (part_size + 256);
+    body = malloc(body_size);
+    if (body == NULL)
+    {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+    srand(1);
+    n += sprintf((char *) body, "--%s\r\n", boundary);
+    for (int p = 0; p < PARTS; p++)
+    {
+        n += sprintf((char *) body + n,
+                "Content-Type: application/octet-stream\r\n"
+                "Content-Range: bytes %zu-%zu/%zu\r\n\r\n",
+                p * part_size,
+                (p + 1) * part_size - 1,
+                PARTS * part_size);
+        for (size_t i = 0; i < part_size; i++)
+        {
+            body[n++] = rand();
+        }
+        n += sprintf((char *) body + n,
+                p == PARTS - 1 ? "\r\n--%s--\r\n" : "\r\n--%s\r\n",
+                boundary);
+    }
+
+    for (int iter = 0; iter < ITERATIONS; iter++)
+    {
+        globus_i_dsi_rest_read_part_t   parts[PARTS];
+        globus_i_dsi_rest_read_multipart_arg_t
+                                        state =
+        {
+            .num_parts = PARTS,
+            .part_index = (size_t) -1,
+            .parts = parts,
+            .boundary = (char *) boundary,
+            .boundary_length = strlen(boundary),
+        };
+
+        if (globus_i_dsi_rest_read_multipart_delimiters_init(&state)
+                != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "delimiters_init failed\n");
+            return 1;
+        }
+        received = 0;
+        for (int p = 0; p < PARTS; p++)
+        {
+            parts[p] = (globus_i_dsi_rest_read_part_t)
+            {
+                .data_read_callback = count_data,
+                .data_read_callback_arg = &received,
+            };
+        }
+        start = now_ns();
+        for (size_t off = 0; off < n; off += chunk_size)
+        {
+            globus_dsi_rest_read_multipart(
+                    &state,
+                    body + off,
+                    n - off < chunk_size ? n - off : chunk_size);
+        }
+        elapsed += now_ns() - start;
+        free(state.header_buffer);
+        globus_i_dsi_rest_read_multipart_delimiters_destroy(&state);
+        if (received != PARTS * part_size)
+        {
+            fprintf(stderr, "received %zu bytes, expected %zu\n",
+                    received, PARTS * part_size);
+            rc = 1;
+        }
+    }
+
+    printf("multipart parse: %8.2f GB/s (%zu byte chunks)\n",
+            (double) ITERATIONS * n / elapsed,
+            chunk_size);
+
+    free(body);
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
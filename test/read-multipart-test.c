@@ -19,9 +19,410 @@
 #include <curl/curl.h>
 #include <jansson.h>
 
-#include "globus_dsi_rest.h"
+#include "globus_i_dsi_rest.h"
 #include "test-xio-server.h"
 
+enum
+{
+    MAX_PARTS = 4
+};
+
+/* 640 bytes, so that a header section holding it outgrows the initial
+ * 256 byte header buffer more than once
+ */
+#define LONG_VALUE_64 \
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-_"
+#define LONG_VALUE \
+    LONG_VALUE_64 LONG_VALUE_64 LONG_VALUE_64 LONG_VALUE_64 LONG_VALUE_64 \
+    LONG_VALUE_64 LONG_VALUE_64 LONG_VALUE_64 LONG_VALUE_64 LONG_VALUE_64
+
+/*
+ * Multipart bodies passed straight to globus_dsi_rest_read_multipart(),
+ * split into two reads at every offset and then fed one byte at a time,
+ * so that every delimiter and header line crosses a read boundary, and
+ * the header buffer grows a few bytes at a time.
+ * Part data contains prefixes of the delimiters which overlap each other,
+ * so a partial match must fall back to a shorter one rather than start
+ * over.
+ */
+struct parse_test_case
+{
+    const char                         *name;
+    const char                         *boundary;
+    const char                         *body;
+    /* Whether the body ends before the last part does */
+    bool                                truncated;
+    size_t                              num_parts;
+    struct
+    {
+        /* Each header as "key: value\n", or NULL if the part is missing */
+        const char                     *headers;
+        const char                     *data;
+    }
+    parts[MAX_PARTS];
+};
+
+static
+struct parse_test_case                  parse_tests[] =
+{
+    {
+        .name = "delimiter prefixes in part data",
+        .boundary = "bb",
+        .body =
+            "preamble --b\r\n-bb\r\n"
+            "--bb\r\n"
+            "Content-ID: one\r\n"
+            "\r\n"
+            "\r\n--b\r\n--b\r\r\n-\r\n\r\n--"
+            "\r\n--bb\r\n"
+            "Content-ID: two\r\n"
+            "Content-Type: text/plain\r\n"
+            "\r\n"
+            "x\r\n--b\r\r\n--b-\r\n-b\r\n--b"
+            "\r\n--bb\r\n"
+            "Content-ID: three\r\n"
+            "\r\n"
+            "\r\n--bb--\r\n"
+            "epilogue\r\n--bb\r\n",
+        .num_parts = 3,
+        .parts =
+        {
+            {
+                .headers = "Content-ID: one\n",
+                .data = "\r\n--b\r\n--b\r\r\n-\r\n\r\n--",
+            },
+            {
+                .headers = "Content-ID: two\nContent-Type: text/plain\n",
+                .data = "x\r\n--b\r\r\n--b-\r\n-b\r\n--b",
+            },
+            {
+                .headers = "Content-ID: three\n",
+                .data = "",
+            },
+        },
+    },
+    {
+        .name = "dashes in the boundary",
+        .boundary = "--b",
+        .body =
+            "-------b\r\n"
+            "Content-ID: one\r\n"
+            "\r\n"
+            "\r\n-----b\r\n---"
+            "\r\n----b\r\n"
+            "Content-ID: two\r\n"
+            "\r\n"
+            "--"
+            "\r\n----b--\r\n",
+        .num_parts = 2,
+        .parts =
+        {
+            {
+                .headers = "Content-ID: one\n",
+                .data = "\r\n-----b\r\n---",
+            },
+            {
+                .headers = "Content-ID: two\n",
+                .data = "--",
+            },
+        },
+    },
+    {
+        .name = "long and folded headers",
+        .boundary = "batch_1zBmD2VAgTc_AAjSFEW5ztQ",
+        .body =
+            "--batch_1zBmD2VAgTc_AAjSFEW5ztQ\r\n"
+            "X-Long: " LONG_VALUE "\r\n"
+            "Content-ID:\r\n one\r\n"
+            "Content-Type: application/json\r\n"
+            "\r\n"
+            "{\"one\": 1}"
+            "\r\n--batch_1zBmD2VAgTc_AAjSFEW5ztQ\r\n"
+            "Content-ID: two\r\n"
+            "X-Long: " LONG_VALUE "\r\n"
+            "\r\n"
+            "[1, 2]"
+            "\r\n--batch_1zBmD2VAgTc_AAjSFEW5ztQ--\r\n",
+        .num_parts = 2,
+        .parts =
+        {
+            {
+                .headers =
+                    "X-Long: " LONG_VALUE "\n"
+                    "Content-ID: one\n"
+                    "Content-Type: application/json\n",
+                .data = "{\"one\": 1}",
+            },
+            {
+                .headers =
+                    "Content-ID: two\n"
+                    "X-Long: " LONG_VALUE "\n",
+                .data = "[1, 2]",
+            },
+        },
+    },
+    {
+        .name = "missing last part",
+        .boundary = "bb",
+        .body =
+            "--bb\r\n"
+            "Content-ID: one\r\n"
+            "\r\n"
+            "one"
+            "\r\n--bb\r\n"
+            "Content-ID: two\r\n"
+            "\r\n"
+            "two"
+            "\r\n--bb--\r\n"
+            "epilogue\r\n",
+        .num_parts = 3,
+        .parts =
+        {
+            {
+                .headers = "Content-ID: one\n",
+                .data = "one",
+            },
+            {
+                .headers = "Content-ID: two\n",
+                .data = "two",
+            },
+        },
+    },
+    {
+        .name = "truncated body",
+        .boundary = "bb",
+        .body =
+            "--bb\r\n"
+            "Content-ID: one\r\n"
+            "\r\n"
+            "one"
+            "\r\n--bb\r\n"
+            "Content-ID: two\r\n"
+            "\r\n"
+            "tw",
+        .truncated = true,
+        .num_parts = 2,
+        .parts =
+        {
+            {
+                .headers = "Content-ID: one\n",
+                .data = "one",
+            },
+        },
+    },
+};
+
+struct parse_part
+{
+    char                                headers[1024];
+    size_t                              headers_length;
+    char                                data[256];
+    size_t                              data_length;
+    int                                 eofs;
+    bool                                overflow;
+};
+
+static
+globus_result_t
+parse_response(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    struct parse_part                  *part = response_callback_arg;
+
+    for (size_t i = 0; i < response_headers->count; i++)
+    {
+        int                             n;
+
+        n = snprintf(part->headers + part->headers_length,
+                sizeof(part->headers) - part->headers_length,
+                "%s: %s\n",
+                response_headers->key_value[i].key,
+                response_headers->key_value[i].value);
+        if (n < 0 || n >= sizeof(part->headers) - part->headers_length)
+        {
+            part->overflow = true;
+            break;
+        }
+        part->headers_length += n;
+    }
+    return GLOBUS_SUCCESS;
+}
+/* parse_response() */
+
+static
+globus_result_t
+parse_data(
+    void                               *read_callback_arg,
+    void                               *buffer,
+    size_t                              buffer_length)
+{
+    struct parse_part                  *part = read_callback_arg;
+
+    if (buffer_length == 0)
+    {
+        part->eofs++;
+    }
+    else if (part->eofs > 0
+        || buffer_length > sizeof(part->data) - part->data_length)
+    {
+        part->overflow = true;
+    }
+    else
+    {
+        memcpy(part->data + part->data_length, buffer, buffer_length);
+        part->data_length += buffer_length;
+    }
+    return GLOBUS_SUCCESS;
+}
+/* parse_data() */
+
+/*
+ * Parse test->body in reads of the lengths in reads, which add up to the
+ * length of the body, and check what each part received.
+ */
+static
+bool
+parse_reads(
+    struct parse_test_case             *test,
+    const size_t                       *reads,
+    size_t                              read_count)
+{
+    struct parse_part                   results[MAX_PARTS] = {{{0}}};
+    globus_i_dsi_rest_read_part_t       parts[MAX_PARTS] = {{{0}}};
+    globus_i_dsi_rest_arena_t           arena = {0};
+    globus_i_dsi_rest_read_multipart_arg_t
+                                        state =
+    {
+        .arena = &arena,
+        .num_parts = test->num_parts,
+        .part_index = (size_t) -1,
+        .parts = parts,
+        .boundary = (char *) test->boundary,
+        .boundary_length = strlen(test->boundary),
+    };
+    const char                         *body = test->body;
+    bool                                ok = true;
+
+    for (size_t i = 0; i < test->num_parts; i++)
+    {
+        parts[i] = (globus_i_dsi_rest_read_part_t)
+        {
+            .response_callback = parse_response,
+            .response_callback_arg = &results[i],
+            .data_read_callback = parse_data,
+            .data_read_callback_arg = &results[i],
+        };
+    }
+    if (globus_i_dsi_rest_read_multipart_delimiters_init(&state)
+            != GLOBUS_SUCCESS)
+    {
+        return false;
+    }
+    for (size_t i = 0; ok && i < read_count; i++)
+    {
+        if (reads[i] == 0)
+        {
+            /* A read of 0 bytes is the end of the body */
+            continue;
+        }
+        if (globus_dsi_rest_read_multipart(
+                    &state, (void *) body, reads[i]) != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "# read %zu failed\n", i);
+            ok = false;
+        }
+        body += reads[i];
+    }
+    if (ok
+        && (globus_dsi_rest_read_multipart(&state, "", 0) == GLOBUS_SUCCESS)
+            == test->truncated)
+    {
+        fprintf(stderr, "# end of body %s\n",
+                test->truncated ? "accepted" : "failed");
+        ok = false;
+    }
+    for (size_t i = 0; ok && i < test->num_parts; i++)
+    {
+        struct parse_part              *part = &results[i];
+
+        if (test->parts[i].headers == NULL)
+        {
+            /* Part never started, or never finished */
+            if (part->eofs != 0)
+            {
+                fprintf(stderr, "# part %zu ended\n", i);
+                ok = false;
+            }
+            continue;
+        }
+        if (part->overflow
+            || part->eofs != 1
+            || strcmp(part->headers, test->parts[i].headers) != 0
+            || part->data_length != strlen(test->parts[i].data)
+            || memcmp(part->data, test->parts[i].data, part->data_length)
+                != 0)
+        {
+            fprintf(stderr,
+                    "# part %zu: %d eofs, headers \"%s\", %zu bytes \"%.*s\"\n",
+                    i,
+                    part->eofs,
+                    part->headers,
+                    part->data_length,
+                    (int) part->data_length,
+                    part->data);
+            ok = false;
+        }
+    }
+    free(state.header_buffer);
+    globus_i_dsi_rest_read_multipart_delimiters_destroy(&state);
+    globus_i_dsi_rest_arena_release(&arena);
+
+    return ok;
+}
+/* parse_reads() */
+
+static
+bool
+parse_test(
+    struct parse_test_case             *test)
+{
+    size_t                              length = strlen(test->body);
+    size_t                             *reads;
+    bool                                ok = true;
+
+    reads = malloc((length + 1) * sizeof(size_t));
+    if (reads == NULL)
+    {
+        return false;
+    }
+    for (size_t split = 0; ok && split <= length; split++)
+    {
+        reads[0] = split;
+        reads[1] = length - split;
+        ok = parse_reads(test, reads, 2);
+        if (!ok)
+        {
+            fprintf(stderr, "# split at %zu\n", split);
+        }
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        reads[i] = 1;
+    }
+    if (ok && !parse_reads(test, reads, length))
+    {
+        fprintf(stderr, "# one byte at a time\n");
+        ok = false;
+    }
+    free(reads);
+
+    return ok;
+}
+/* parse_test() */
+
 globus_result_t
 request_test_handler(
     void                               *route_arg,
@@ -79,6 +480,10 @@ int main()
     globus_dsi_rest_response_arg_t      response_arg_1 = {0};
     globus_dsi_rest_response_arg_t      response_arg_2 = {0};
     int                                 rc = 0;
+    int                                 parse_failures = 0;
+    size_t                              num_parse_tests;
+
+    num_parse_tests = sizeof(parse_tests)/sizeof(parse_tests[0]);
 
     globus_thread_set_model("pthread");
 
@@ -86,9 +491,21 @@ int main()
     globus_module_activate(GLOBUS_XIO_MODULE);
 
 
-    printf("1..1\n");
+    printf("1..%zu\n", num_parse_tests + 1);
     globus_module_activate(GLOBUS_DSI_REST_MODULE);
 
+    for (size_t i = 0; i < num_parse_tests; i++)
+    {
+        bool                            ok = parse_test(&parse_tests[i]);
+
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", i + 1,
+                parse_tests[i].name);
+        if (!ok)
+        {
+            parse_failures++;
+        }
+    }
+
     result = globus_dsi_rest_test_server_init(&contact_string);
     if (result != GLOBUS_SUCCESS)
     {
@@ -235,5 +652,5 @@ error:
             free(errstr);
         }
     }
-    return rc;
+    return rc + parse_failures;
 }
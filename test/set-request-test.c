@@ -51,6 +51,7 @@ main()
 
         globus_result_t result;
         result = globus_i_dsi_rest_compute_headers(
+                NULL,
                 &request.request_headers,
                 &test_array);
 
@@ -0,0 +1,194 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <curl/curl.h>
+
+#include "globus_dsi_rest.h"
+#include "test-xio-server.h"
+
+/*
+ * Checks that every completed request is counted as either opening a new
+ * connection or reusing one from the shared connection cache, and that a
+ * request on another handle reuses the connection a finished request left
+ * in the cache. The server keeps connections open, so every request after
+ * the first should reuse the one connection it opened.
+ */
+enum { REQUEST_COUNT = 8, NESTED_COUNT = 3 };
+
+static char                            *uri;
+static int                              nested_failed;
+
+static
+globus_result_t
+request_test_handler(
+    void                               *route_arg,
+    void                               *request_body,
+    size_t                              request_body_length,
+    int                                *response_code,
+    void                               *response_body,
+    size_t                             *response_body_length,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    *response_code = 204;
+    *response_body_length = 0;
+    headers->count = 0;
+
+    return GLOBUS_SUCCESS;
+}
+/* request_test_handler() */
+
+/*
+ * Called at the end of the (empty) response body, after curl is done with
+ * the connection but before the request's handle goes back to the handle
+ * cache, so the requests made here have to use other handles. They only
+ * find the connection through the connection cache shared by all handles.
+ */
+static
+globus_result_t
+nested_read(
+    void                               *read_callback_arg,
+    void                               *buffer,
+    size_t                              buffer_length)
+{
+    if (buffer_length != 0)
+    {
+        return GLOBUS_SUCCESS;
+    }
+    for (int i = 0; i < NESTED_COUNT; i++)
+    {
+        /*
+         * The server doesn't accept another connection while it keeps the
+         * first one open, so time out instead of hanging if the cached
+         * connection isn't found.
+         */
+        if (globus_dsi_rest_request(
+                "GET",
+                uri,
+                NULL,
+                NULL,
+                &(globus_dsi_rest_callbacks_t)
+                {
+                    .progress_callback = globus_dsi_rest_progress_idle_timeout,
+                    .progress_callback_arg = (void *) (uintptr_t) 2000,
+                }) != GLOBUS_SUCCESS)
+        {
+            nested_failed++;
+        }
+    }
+    return GLOBUS_SUCCESS;
+}
+/* nested_read() */
+
+int main()
+{
+    globus_result_t                     result;
+    char                               *contact_string;
+    globus_dsi_rest_stats_t             before, after;
+    bool                                ok;
+    int                                 rc = 0;
+    int                                 test_num = 0;
+
+    globus_thread_set_model("pthread");
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    globus_module_activate(GLOBUS_XIO_MODULE);
+
+    printf("1..4\n");
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    result = globus_dsi_rest_test_server_init(&contact_string);
+    result = globus_dsi_rest_test_server_add_route(
+        "/stats",
+        request_test_handler,
+        NULL);
+    globus_dsi_rest_test_server_set_keep_alive(true);
+    uri = globus_common_create_string("http://%s/stats", contact_string);
+
+    ok = (globus_dsi_rest_get_stats(NULL) != GLOBUS_SUCCESS);
+    printf("%s %d - get_stats(NULL)\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    result = globus_dsi_rest_get_stats(&before);
+
+    ok = true;
+    for (int i = 0; i < REQUEST_COUNT; i++)
+    {
+        result = globus_dsi_rest_request(
+            "GET",
+            uri,
+            NULL,
+            NULL,
+            &(globus_dsi_rest_callbacks_t) {0});
+        if (result != GLOBUS_SUCCESS)
+        {
+            ok = false;
+        }
+    }
+    printf("%s %d - requests\n", ok?"ok":"not ok", ++test_num);
+    rc += !ok;
+
+    result = globus_dsi_rest_get_stats(&after);
+    ok = result == GLOBUS_SUCCESS
+        && (after.requests_new_connection - before.requests_new_connection)
+         + (after.requests_reused_connection
+                - before.requests_reused_connection) == REQUEST_COUNT
+        && after.requests_new_connection > before.requests_new_connection
+        && after.connections_opened >= after.requests_new_connection;
+    printf("%s %d - counters new=%llu reused=%llu opened=%llu\n",
+            ok?"ok":"not ok",
+            ++test_num,
+            (unsigned long long) after.requests_new_connection,
+            (unsigned long long) after.requests_reused_connection,
+            (unsigned long long) after.connections_opened);
+    rc += !ok;
+
+    before = after;
+    result = globus_dsi_rest_request(
+        "GET",
+        uri,
+        NULL,
+        NULL,
+        &(globus_dsi_rest_callbacks_t)
+        {
+            .data_read_callback = nested_read,
+        });
+    globus_dsi_rest_get_stats(&after);
+    ok = result == GLOBUS_SUCCESS
+        && nested_failed == 0
+        && after.requests_reused_connection - before.requests_reused_connection
+            == NESTED_COUNT + 1
+        && after.requests_new_connection == before.requests_new_connection
+        && after.connections_opened == 1;
+    printf("%s %d - reuse on another handle reused=%llu opened=%llu\n",
+            ok?"ok":"not ok",
+            ++test_num,
+            (unsigned long long) after.requests_reused_connection,
+            (unsigned long long) after.connections_opened);
+    rc += !ok;
+
+    /* Close the kept connection so the server can stop */
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    globus_dsi_rest_test_server_destroy();
+
+    free(uri);
+    free(contact_string);
+    globus_module_deactivate_all();
+    curl_global_cleanup();
+    return rc;
+}
@@ -606,7 +606,6 @@ globus_l_dsi_rest_send(
     globus_gfs_transfer_info_t *        transfer_info,
     void *                              user_arg)
 {
-    globus_dsi_rest_gridftp_op_arg_t    gridftp_op_arg = {.op=op };
     globus_l_dsi_rest_handle_t         *dsi_rest_handle = user_arg;
     char                               *uri;
     globus_result_t                     result = GLOBUS_SUCCESS;
@@ -624,27 +623,11 @@ globus_l_dsi_rest_send(
 
     globus_gridftp_server_begin_transfer(op, 0, NULL);
 
-    do
-    {
-        globus_gridftp_server_get_read_range(
-                gridftp_op_arg.op,
-                &gridftp_op_arg.offset,
-                &gridftp_op_arg.length);
-        if (gridftp_op_arg.length != 0)
-        {
-            result = globus_dsi_rest_request(
-                    "GET",
-                    uri,
-                    NULL,
-                    NULL,
-                    &(globus_dsi_rest_callbacks_t)
-                    {
-                        .data_read_callback = globus_dsi_rest_read_gridftp_op,
-                        .data_read_callback_arg = &gridftp_op_arg,
-                    });
-        }
-    }
-    while (gridftp_op_arg.length != 0);
+    result = globus_dsi_rest_read_gridftp_op_ranges(
+            uri,
+            NULL,
+            NULL,
+            op);
 
 create_uri_fail:
     globus_gridftp_server_finished_transfer(op, result);
@@ -0,0 +1,278 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "test-gridftp-op.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef
+struct test_write_s
+{
+    globus_dsi_rest_test_op_t          *test_op;
+    globus_byte_t                      *buffer;
+    globus_size_t                       nbytes;
+    globus_gridftp_server_write_cb_t    callback;
+    void                               *user_arg;
+}
+test_write_t;
+
+typedef
+struct test_read_s
+{
+    globus_dsi_rest_test_op_t          *test_op;
+    globus_byte_t                      *buffer;
+    globus_size_t                       nbytes;
+    globus_off_t                        offset;
+    bool                                eof;
+    globus_gridftp_server_read_cb_t     callback;
+    void                               *user_arg;
+}
+test_read_t;
+
+void
+globus_dsi_rest_test_op_init(
+    globus_dsi_rest_test_op_t          *test_op,
+    const unsigned char                *data,
+    globus_size_t                       block_size,
+    int                                 concurrency)
+{
+    *test_op = (globus_dsi_rest_test_op_t)
+    {
+        .block_size = block_size,
+        .concurrency = concurrency,
+        .data = data,
+    };
+    globus_mutex_init(&test_op->mutex, NULL);
+    globus_cond_init(&test_op->cond, NULL);
+}
+
+void
+globus_dsi_rest_test_op_destroy(
+    globus_dsi_rest_test_op_t          *test_op)
+{
+    globus_mutex_lock(&test_op->mutex);
+    while (test_op->outstanding > 0)
+    {
+        globus_cond_wait(&test_op->cond, &test_op->mutex);
+    }
+    globus_mutex_unlock(&test_op->mutex);
+    globus_cond_destroy(&test_op->cond);
+    globus_mutex_destroy(&test_op->mutex);
+}
+
+static
+void
+test_op_callback_done(
+    globus_dsi_rest_test_op_t          *test_op)
+{
+    globus_mutex_lock(&test_op->mutex);
+    test_op->outstanding--;
+    globus_cond_signal(&test_op->cond);
+    globus_mutex_unlock(&test_op->mutex);
+}
+
+static
+void *
+test_read_thread(
+    void                               *arg)
+{
+    test_read_t                        *read = arg;
+
+    read->callback(
+            (globus_gfs_operation_t) read->test_op,
+            GLOBUS_SUCCESS,
+            read->buffer,
+            read->nbytes,
+            read->offset,
+            read->eof,
+            read->user_arg);
+    test_op_callback_done(read->test_op);
+    free(read);
+
+    return NULL;
+}
+
+static
+void *
+test_write_thread(
+    void                               *arg)
+{
+    test_write_t                       *write = arg;
+
+    write->callback(
+            (globus_gfs_operation_t) write->test_op,
+            GLOBUS_SUCCESS,
+            write->buffer,
+            write->nbytes,
+            write->user_arg);
+    test_op_callback_done(write->test_op);
+    free(write);
+
+    return NULL;
+}
+
+void
+globus_gridftp_server_get_block_size(
+    globus_gfs_operation_t              op,
+    globus_size_t                      *block_size)
+{
+    *block_size = ((globus_dsi_rest_test_op_t *) op)->block_size;
+}
+
+void
+globus_gridftp_server_get_optimal_concurrency(
+    globus_gfs_operation_t              op,
+    int                                *count)
+{
+    *count = ((globus_dsi_rest_test_op_t *) op)->concurrency;
+}
+
+void
+globus_gridftp_server_update_bytes_recvd(
+    globus_gfs_operation_t              op,
+    globus_off_t                        length)
+{
+}
+
+globus_result_t
+globus_gridftp_server_register_read(
+    globus_gfs_operation_t              op,
+    globus_byte_t                      *buffer,
+    globus_size_t                       length,
+    globus_gridftp_server_read_cb_t     callback,
+    void                               *user_arg)
+{
+    globus_dsi_rest_test_op_t          *test_op = (void *) op;
+    test_read_t                        *read;
+    globus_thread_t                     thread;
+
+    read = malloc(sizeof(test_read_t));
+    if (read == NULL)
+    {
+        return GLOBUS_FAILURE;
+    }
+    *read = (test_read_t)
+    {
+        .test_op = test_op,
+        .buffer = buffer,
+        .callback = callback,
+        .user_arg = user_arg,
+    };
+
+    globus_mutex_lock(&test_op->mutex);
+    if (test_op->reads_done < test_op->read_count)
+    {
+        const globus_dsi_rest_test_extent_t
+                                       *extent;
+
+        extent = &test_op->reads[test_op->reads_done++];
+        read->offset = extent->offset;
+        read->nbytes = extent->length;
+        if (read->nbytes > length)
+        {
+            read->nbytes = length;
+        }
+        memcpy(buffer, test_op->data + read->offset, read->nbytes);
+    }
+    else
+    {
+        read->eof = true;
+    }
+    test_op->outstanding++;
+    globus_mutex_unlock(&test_op->mutex);
+
+    if (globus_thread_create(&thread, NULL, test_read_thread, read) != 0)
+    {
+        test_op_callback_done(test_op);
+        free(read);
+        return GLOBUS_FAILURE;
+    }
+    return GLOBUS_SUCCESS;
+}
+
+void
+globus_gridftp_server_get_read_range(
+    globus_gfs_operation_t              op,
+    globus_off_t                       *offset,
+    globus_off_t                       *length)
+{
+    globus_dsi_rest_test_op_t          *test_op = (void *) op;
+
+    globus_mutex_lock(&test_op->mutex);
+    if (test_op->ranges_done < test_op->range_count)
+    {
+        *offset = test_op->ranges[test_op->ranges_done].offset;
+        *length = test_op->ranges[test_op->ranges_done].length;
+        test_op->ranges_done++;
+    }
+    else
+    {
+        *offset = 0;
+        *length = 0;
+    }
+    globus_mutex_unlock(&test_op->mutex);
+}
+
+globus_result_t
+globus_gridftp_server_register_write(
+    globus_gfs_operation_t              op,
+    globus_byte_t                      *buffer,
+    globus_size_t                       length,
+    globus_off_t                        offset,
+    int                                 stripe_ndx,
+    globus_gridftp_server_write_cb_t    callback,
+    void                               *user_arg)
+{
+    globus_dsi_rest_test_op_t          *test_op = (void *) op;
+    test_write_t                       *write;
+    globus_thread_t                     thread;
+
+    write = malloc(sizeof(test_write_t));
+    if (write == NULL)
+    {
+        return GLOBUS_FAILURE;
+    }
+    *write = (test_write_t)
+    {
+        .test_op = test_op,
+        .buffer = buffer,
+        .nbytes = length,
+        .callback = callback,
+        .user_arg = user_arg,
+    };
+
+    globus_mutex_lock(&test_op->mutex);
+    if (offset < 0 || offset + length > test_op->written_length)
+    {
+        test_op->write_outside = true;
+    }
+    else
+    {
+        memcpy(test_op->written + offset, buffer, length);
+    }
+    test_op->outstanding++;
+    globus_mutex_unlock(&test_op->mutex);
+
+    if (globus_thread_create(&thread, NULL, test_write_thread, write) != 0)
+    {
+        test_op_callback_done(test_op);
+        free(write);
+        return GLOBUS_FAILURE;
+    }
+    return GLOBUS_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Stand-ins for the GridFTP server's data channel functions, so that the
+ * GridFTP operation readers and writers can be tested without a server.
+ * Programs linked with this library pass a pointer to a
+ * globus_dsi_rest_test_op_t where a globus_gfs_operation_t is expected.
+ * Each read or write callback is called from a thread of its own, as the
+ * library may hold its own locks when it registers an operation.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "globus_gridftp_server.h"
+
+/** An offset and length of data in the test file */
+typedef
+struct globus_dsi_rest_test_extent_s
+{
+    globus_off_t                        offset;
+    globus_off_t                        length;
+}
+globus_dsi_rest_test_extent_t;
+
+typedef
+struct globus_dsi_rest_test_op_s
+{
+    globus_mutex_t                      mutex;
+    globus_cond_t                       cond;
+    globus_size_t                       block_size;
+    int                                 concurrency;
+
+    /* Contents of the test file, indexed by offset */
+    const unsigned char                *data;
+
+    /* Returned by successive register_read calls, followed by eof */
+    const globus_dsi_rest_test_extent_t
+                                       *reads;
+    size_t                              read_count;
+    size_t                              reads_done;
+
+    /* Returned by successive get_read_range calls, followed by a length
+     * of 0
+     */
+    const globus_dsi_rest_test_extent_t
+                                       *ranges;
+    size_t                              range_count;
+    size_t                              ranges_done;
+
+    /* Filled in by register_write, indexed by offset */
+    unsigned char                      *written;
+    size_t                              written_length;
+    /* Set if register_write was passed data beyond written_length */
+    bool                                write_outside;
+
+    /* Callbacks which have not returned yet */
+    int                                 outstanding;
+}
+globus_dsi_rest_test_op_t;
+
+void
+globus_dsi_rest_test_op_init(
+    globus_dsi_rest_test_op_t          *test_op,
+    const unsigned char                *data,
+    globus_size_t                       block_size,
+    int                                 concurrency);
+
+/* Wait for outstanding callbacks to return */
+void
+globus_dsi_rest_test_op_destroy(
+    globus_dsi_rest_test_op_t          *test_op);
@@ -26,6 +26,7 @@ static globus_mutex_t server_done_mutex;
 static globus_cond_t server_done_cond;
 static bool server_stop;
 static bool server_done;
+static bool server_keep_alive;
 
 typedef globus_result_t (*globus_dsi_rest_route_t)(
     void *route_arg,
@@ -46,11 +47,41 @@ typedef struct
 }
 globus_dsi_rest_route_entry_t;
 
+/* Method and headers of the request being passed to a route */
+static const char                             *request_method;
+static globus_hashtable_t                     *request_headers;
+
 static globus_xio_server_t                     xio_server;
 static globus_xio_stack_t                      xio_stack;
 static globus_xio_driver_t                     tcp_driver;
 static globus_xio_driver_t                     http_driver;
 
+const char *
+globus_dsi_rest_test_server_request_header(
+    const char                         *name)
+{
+    globus_xio_http_header_t           *header = NULL;
+
+    if (request_headers != NULL)
+    {
+        header = globus_hashtable_lookup(request_headers, (void *) name);
+    }
+    return header ? header->value : NULL;
+}
+
+const char *
+globus_dsi_rest_test_server_request_method(void)
+{
+    return request_method;
+}
+
+void
+globus_dsi_rest_test_server_set_keep_alive(
+    bool                                keep_alive)
+{
+    server_keep_alive = keep_alive;
+}
+
 static
 void *server_thread(void *arg);
 
@@ -225,8 +256,9 @@ void *server_thread(void *arg)
             globus_xio_http_version_t   http_version = 0;
             globus_hashtable_t          headers = NULL;
             globus_size_t               nbytes = 0;
-            unsigned char               upbuf[4096];
-            unsigned char               downbuf[4096];
+            /* Room for request and response bodies of a few MiB */
+            static unsigned char        upbuf[4*1024*1024];
+            static unsigned char        downbuf[4*1024*1024];
             size_t                      downbytes = 0;
             int                         response_code = 500;
             globus_size_t               read_total = 0;
@@ -277,7 +309,8 @@ void *server_thread(void *arg)
                     &http_version,
                     &headers);
 
-            if (result != GLOBUS_SUCCESS)
+            /* A kept connection ends with the client closing it */
+            if (result != GLOBUS_SUCCESS || method == NULL)
             {
                 goto end_this_socket;
             }
@@ -335,12 +368,16 @@ void *server_thread(void *arg)
 
             if (route != NULL)
             {
+                request_method = method;
+                request_headers = &headers;
                 result = route->route(
                         route->route_arg,
                         upbuf, read_total,
                         &response_code,
                         downbuf, &downbytes,
                         &response_headers);
+                request_method = NULL;
+                request_headers = NULL;
             }
 
             if (result != GLOBUS_SUCCESS || route == NULL)
@@ -365,12 +402,29 @@ void *server_thread(void *arg)
                         http_driver,
                         GLOBUS_XIO_HTTP_HANDLE_SET_RESPONSE_STATUS_CODE,
                         response_code);
-                globus_xio_handle_cntl(
-                        xio_handle,
-                        http_driver,
-                        GLOBUS_XIO_HTTP_HANDLE_SET_RESPONSE_HEADER,
-                        "Connection",
-                        "close");
+                if (server_keep_alive)
+                {
+                    char        content_length[32];
+
+                    /* Delimit the body so the connection can be reused */
+                    snprintf(content_length, sizeof(content_length),
+                            "%zu", downbytes);
+                    globus_xio_handle_cntl(
+                            xio_handle,
+                            http_driver,
+                            GLOBUS_XIO_HTTP_HANDLE_SET_RESPONSE_HEADER,
+                            "Content-Length",
+                            content_length);
+                }
+                else
+                {
+                    globus_xio_handle_cntl(
+                            xio_handle,
+                            http_driver,
+                            GLOBUS_XIO_HTTP_HANDLE_SET_RESPONSE_HEADER,
+                            "Connection",
+                            "close");
+                }
 
                 for (size_t i = 0; i < response_headers.count; i++)
                 {
@@ -395,6 +449,20 @@ void *server_thread(void *arg)
                             http_driver,
                             GLOBUS_XIO_HTTP_HANDLE_SET_END_OF_ENTITY);
                 }
+                if (server_keep_alive && result == GLOBUS_SUCCESS)
+                {
+                    if (downbytes == 0)
+                    {
+                        /* Nothing written, so the response isn't sent yet */
+                        result = globus_xio_handle_cntl(xio_handle,
+                                http_driver,
+                                GLOBUS_XIO_HTTP_HANDLE_SET_END_OF_ENTITY);
+                    }
+                    /* Wait for the next request on this connection */
+                    globus_xio_data_descriptor_destroy(descriptor);
+                    descriptor = NULL;
+                    continue;
+                }
             }
         end_this_socket:
             if (descriptor != NULL)
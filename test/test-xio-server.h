@@ -38,6 +38,29 @@ globus_dsi_rest_test_server_init(
 void
 globus_dsi_rest_test_server_destroy(void);
 
+/*
+ * Keep connections open after successful responses instead of closing
+ * them, so that clients can reuse them. Off by default.
+ */
+void
+globus_dsi_rest_test_server_set_keep_alive(
+    bool                                keep_alive);
+
+/*
+ * Value of a header of the request a route function is called for, or
+ * NULL if it has none. Only valid while the route function runs.
+ */
+const char *
+globus_dsi_rest_test_server_request_header(
+    const char                         *name);
+
+/*
+ * Method of the request a route function is called for. Only valid while
+ * the route function runs.
+ */
+const char *
+globus_dsi_rest_test_server_request_method(void);
+
 globus_result_t
 globus_dsi_rest_test_server_add_route(
     const char                         *uri,
@@ -0,0 +1,243 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Measures URI escaping of the kinds of strings a listing or stat of a
+ * large object store escapes for every request: long object keys, which
+ * are mostly unreserved bytes with a '/' every so often, and query values
+ * with spaces and other reserved bytes mixed in. Each is escaped with the
+ * per-byte switch that used to be used, after a strlen() to size the
+ * output at three times the input, and then with the table and block
+ * classifier, after a pass to find the exact size. Last, whole query
+ * strings are built with globus_dsi_rest_uri_add_query().
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum
+{
+    DEFAULT_ITERATIONS = 200000
+};
+
+static const char                      *inputs[] =
+{
+    "/data/projects/climate-model/run-2016-07-14/output/ensemble_member_042"
+        "/atmosphere/temperature_2m_hourly_000123.nc",
+    "home/user/sequencing/2016-11-02_HiSeq_4000/Sample_ABC-1234"
+        "/ABC-1234_S1_L001_R1_001.fastq.gz",
+    "/Users/someone/Documents/Project Notes (final) & Drafts/2016 Q3"
+        "/meeting notes #12.txt",
+    "prefix=photos/2016/summer vacation/&delimiter=/&max-keys=1000",
+    "file00001234.dat",
+};
+
+static
+double
+now_ns(void)
+{
+    struct timespec                     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* What globus_i_dsi_rest_uri_escape() used to do */
+static
+void
+switch_escape(
+    const char                         *raw,
+    char                              **encodedp)
+{
+    char                               *encoded = *encodedp;
+    static const char                  *encoding_table = "0123456789ABCDEF";
+
+    while (*raw != 0)
+    {
+        switch (*raw)
+        {
+            case 'a': case 'b': case 'c': case 'd': case 'e':
+            case 'f': case 'g': case 'h': case 'i': case 'j':
+            case 'k': case 'l': case 'm': case 'n': case 'o':
+            case 'p': case 'q': case 'r': case 's': case 't':
+            case 'u': case 'v': case 'w': case 'x': case 'y':
+            case 'z':
+            case 'A': case 'B': case 'C': case 'D': case 'E':
+            case 'F': case 'G': case 'H': case 'I': case 'J':
+            case 'K': case 'L': case 'M': case 'N': case 'O':
+            case 'P': case 'Q': case 'R': case 'S': case 'T':
+            case 'U': case 'V': case 'W': case 'X': case 'Y':
+            case 'Z':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+            case '-': case '_': case '.': case '~':
+                *(encoded++) = *(raw++);
+                break;
+            case ' ':
+                *(encoded++) = '+';
+                raw++;
+                break;
+            default:
+                *(encoded++) = '%';
+                *(encoded++) = encoding_table[(((unsigned int) (*raw)) >> 4) & 0xf];
+                *(encoded++) = encoding_table[(((unsigned int) (*raw)) & 0xf)];
+                raw++;
+                break;
+        }
+    }
+    *encodedp = encoded;
+}
+/* switch_escape() */
+
+static
+int
+run_escape(
+    const char                         *input,
+    long                                iterations,
+    bool                                report)
+{
+    size_t                              len = strlen(input);
+    double                              start, switch_ns, table_ns;
+    char                               *switch_encoded, *table_encoded;
+    char                               *p;
+    size_t                              size = 0;
+
+    switch_encoded = malloc(3 * len + 1);
+    table_encoded = malloc(3 * len + 1);
+    if (switch_encoded == NULL || table_encoded == NULL)
+    {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+
+    /* Sizing the output is counted along with escaping */
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        size += 3 * strlen(input) + 1;
+        p = switch_encoded;
+        switch_escape(input, &p);
+        *p = 0;
+    }
+    switch_ns = now_ns() - start;
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        size_t                          input_len = strlen(input);
+
+        size += globus_i_dsi_rest_uri_escaped_length(input, input_len) + 1;
+        p = globus_i_dsi_rest_uri_escape(input, input_len, table_encoded);
+        *p = 0;
+    }
+    table_ns = now_ns() - start;
+
+    if (strcmp(switch_encoded, table_encoded) != 0 || size == 0)
+    {
+        fprintf(stderr, "escaped differently:\n%s\n%s\n",
+                switch_encoded, table_encoded);
+        return 1;
+    }
+    if (report)
+    {
+        printf("%4zu bytes  switch: %7.1f ns %6.2f GB/s  "
+                "table: %7.1f ns %6.2f GB/s\n",
+                len,
+                switch_ns / iterations,
+                len * iterations / switch_ns,
+                table_ns / iterations,
+                len * iterations / table_ns);
+    }
+    free(switch_encoded);
+    free(table_encoded);
+
+    return 0;
+}
+/* run_escape() */
+
+static
+int
+run_add_query(
+    long                                iterations,
+    bool                                report)
+{
+    globus_dsi_rest_key_array_t         query_parameters =
+    {
+        .count = 3,
+        .key_value = (globus_dsi_rest_key_value_t[])
+        {
+            { "path", inputs[0] },
+            { "filter", "name:~*.nc&size>1048576" },
+            { "marker", inputs[4] },
+        },
+    };
+    double                              start;
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        char                           *complete_uri;
+
+        if (globus_dsi_rest_uri_add_query(
+                    "https://transfer.example.org/v0.10/operation/endpoint"
+                    "/ddb59aef-6d04-11e5-ba46-22000b92c6ec/ls",
+                    &query_parameters,
+                    &complete_uri) != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "uri_add_query failed\n");
+            return 1;
+        }
+        free(complete_uri);
+    }
+    if (report)
+    {
+        printf("uri_add_query: %7.1f ns\n", (now_ns() - start) / iterations);
+    }
+
+    return 0;
+}
+/* run_add_query() */
+
+int
+main(int argc, char *argv[])
+{
+    long                                iterations = DEFAULT_ITERATIONS;
+    int                                 rc = 0;
+
+    if (argc > 1)
+    {
+        iterations = strtol(argv[1], NULL, 0);
+    }
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    for (size_t i = 0; i < sizeof(inputs)/sizeof(inputs[0]); i++)
+    {
+        /* The first pass warms up the allocator, and isn't counted */
+        rc += run_escape(inputs[i], iterations / 10 + 1, false);
+        rc += run_escape(inputs[i], iterations, true);
+    }
+    rc += run_add_query(iterations / 10 + 1, false);
+    rc += run_add_query(iterations, true);
+
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
@@ -2,6 +2,277 @@
 #include <stdbool.h>
 #include "uri-decode.c"
 
+/*
+ * Longer than two of the largest blocks the escaper classifies at once, so
+ * that bytes to be escaped fall at each block edge and inside each block.
+ */
+#define BLOCK_TEST_LENGTH 100
+
+/* Bytes which must not be copied as they are */
+static const unsigned char              special_bytes[] =
+{
+    ' ', '/', '%', '+', '&', '=', '?', '@', '`', '{', 0x7f, 0x80, 0xe9, 0xff,
+    0x00, 0x1f, '!', ':', '[', '^'
+};
+
+/*
+ * Escape the way the escaper is specified to, one byte at a time: letters,
+ * digits, and "-._~" are copied, space becomes '+', and everything else is
+ * %XX. Returns the length of the result.
+ */
+static
+size_t
+reference_escape(
+    const unsigned char                *raw,
+    size_t                              raw_len,
+    char                               *encoded)
+{
+    size_t                              n = 0;
+
+    for (size_t i = 0; i < raw_len; i++)
+    {
+        unsigned char                   c = raw[i];
+
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9') || (c != 0 && strchr("-._~", c)))
+        {
+            encoded[n++] = c;
+        }
+        else if (c == ' ')
+        {
+            encoded[n++] = '+';
+        }
+        else
+        {
+            n += sprintf(encoded + n, "%%%02X", c);
+        }
+    }
+    return n;
+}
+/* reference_escape() */
+
+/*
+ * Check globus_i_dsi_rest_uri_escaped_length() and
+ * globus_i_dsi_rest_uri_escape() of raw against reference_escape().
+ */
+static
+bool
+check_escape(
+    const unsigned char                *raw,
+    size_t                              raw_len)
+{
+    char                               *expected = malloc(3 * raw_len + 1);
+    char                               *encoded = malloc(3 * raw_len + 1);
+    size_t                              expected_len;
+    size_t                              length;
+    char                               *end;
+    bool                                ok = true;
+
+    if (expected == NULL || encoded == NULL)
+    {
+        free(expected);
+        free(encoded);
+        return false;
+    }
+    expected_len = reference_escape(raw, raw_len, expected);
+    length = globus_i_dsi_rest_uri_escaped_length((const char *) raw, raw_len);
+    if (length != expected_len)
+    {
+        fprintf(stderr, "# escaped length %zu, expected %zu\n",
+                length, expected_len);
+        ok = false;
+    }
+    end = globus_i_dsi_rest_uri_escape((const char *) raw, raw_len, encoded);
+    if ((size_t) (end - encoded) != expected_len
+        || memcmp(encoded, expected, expected_len) != 0)
+    {
+        fprintf(stderr, "# escaped to \"%.*s\"\n# expected \"%.*s\"\n",
+                (int) (end - encoded), encoded,
+                (int) expected_len, expected);
+        ok = false;
+    }
+    free(expected);
+    free(encoded);
+
+    return ok;
+}
+/* check_escape() */
+
+/*
+ * Fill raw with unreserved bytes, cycling through letters, digits and
+ * "-._~" so that the ends of each range are used.
+ */
+static
+void
+fill_unreserved(
+    unsigned char                      *raw,
+    size_t                              raw_len)
+{
+    static const char                   unreserved[] =
+        "azAZ09-._~bcdefghijklmnopqrstuvwxyBCDEFGHIJKLMNOPQRSTUVWXY12345678";
+
+    for (size_t i = 0; i < raw_len; i++)
+    {
+        raw[i] = unreserved[i % (sizeof(unreserved) - 1)];
+    }
+}
+/* fill_unreserved() */
+
+/*
+ * One byte to be escaped at every offset of strings of every length up to
+ * BLOCK_TEST_LENGTH, both aligned and not.
+ */
+static
+bool
+test_one_special(void)
+{
+    unsigned char                       buffer[BLOCK_TEST_LENGTH + 8];
+
+    for (size_t len = 1; len <= BLOCK_TEST_LENGTH; len++)
+    {
+        for (size_t align = 0; align < 8; align += 7)
+        {
+            unsigned char              *raw = buffer + align;
+
+            for (size_t pos = 0; pos < len; pos++)
+            {
+                for (size_t s = 0; s < sizeof(special_bytes); s++)
+                {
+                    fill_unreserved(raw, len);
+                    raw[pos] = special_bytes[s];
+                    if (!check_escape(raw, len))
+                    {
+                        fprintf(stderr, "# 0x%02x at %zu of %zu\n",
+                                special_bytes[s], pos, len);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+/* test_one_special() */
+
+/*
+ * Runs of bytes to be escaped which start, end, or pass over the block
+ * edges, between runs of unreserved bytes.
+ */
+static
+bool
+test_special_runs(void)
+{
+    unsigned char                       raw[BLOCK_TEST_LENGTH];
+
+    for (size_t start = 0; start < sizeof(raw); start++)
+    {
+        for (size_t run = 1; start + run <= sizeof(raw); run++)
+        {
+            fill_unreserved(raw, sizeof(raw));
+            for (size_t i = 0; i < run; i++)
+            {
+                raw[start + i] =
+                        special_bytes[(start + i) % sizeof(special_bytes)];
+            }
+            if (!check_escape(raw, sizeof(raw)))
+            {
+                fprintf(stderr, "# %zu bytes at %zu\n", run, start);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+/* test_special_runs() */
+
+/*
+ * Every byte value at every offset of a block, and long strings made up
+ * only of bytes to be escaped, which overflow a block's per-byte counts
+ * if they are not added up in time.
+ */
+static
+bool
+test_all_bytes(void)
+{
+    unsigned char                       raw[256 + 64];
+    unsigned char                      *escaped;
+    size_t                              escaped_len = 64 * 1024 + 7;
+    bool                                ok = true;
+
+    for (size_t shift = 0; ok && shift < 64; shift++)
+    {
+        for (size_t i = 0; i < sizeof(raw); i++)
+        {
+            raw[i] = (unsigned char) (i + shift);
+        }
+        ok = check_escape(raw, sizeof(raw));
+    }
+
+    escaped = malloc(escaped_len);
+    if (escaped == NULL)
+    {
+        return false;
+    }
+    for (size_t i = 0; ok && i < sizeof(special_bytes); i++)
+    {
+        memset(escaped, special_bytes[i], escaped_len);
+        ok = check_escape(escaped, escaped_len);
+    }
+    for (size_t i = 0; ok && i < escaped_len; i++)
+    {
+        escaped[i] = (i % 3) ? 0xc3 : ' ';
+    }
+    if (ok)
+    {
+        ok = check_escape(escaped, escaped_len);
+    }
+    free(escaped);
+
+    return ok;
+}
+/* test_all_bytes() */
+
+/* Through the public interface, which works on NUL-terminated strings */
+static
+bool
+test_long_strings(void)
+{
+    static const char                  *strings[] =
+    {
+        "/data/projects/climate-model/run-2016-07-14/output/ensemble member"
+            "/temperature_2m_hourly_000123.nc",
+        "prefix=photos/2016/summer vacation/&delimiter=/&max-keys=1000",
+        "n\xc3\xb8n-\xc3\xa1sc\xc3\xae\xc3\xaf n\xc3\xb8n-\xc3\xa1"
+            "sc\xc3\xae\xc3\xaf n\xc3\xb8n-\xc3\xa1sc\xc3\xae\xc3\xaf",
+        "abcdefghijklmnopqrstuvwxyz01234 abcdefghijklmnopqrstuvwxyz0123456"
+            "/abcdefghijklmnopqrstuvwxyz012345678901234567890123456789\xff",
+    };
+
+    for (size_t i = 0; i < sizeof(strings)/sizeof(strings[0]); i++)
+    {
+        char                           *encoded = NULL;
+        bool                            ok;
+
+        if (globus_dsi_rest_uri_escape(strings[i], &encoded)
+                != GLOBUS_SUCCESS)
+        {
+            return false;
+        }
+        ok = check_escape(
+                (const unsigned char *) strings[i], strlen(strings[i]))
+            && uri_decode(encoded) == GLOBUS_SUCCESS
+            && strcmp(encoded, strings[i]) == 0;
+        free(encoded);
+        if (!ok)
+        {
+            fprintf(stderr, "# %s\n", strings[i]);
+            return false;
+        }
+    }
+    return true;
+}
+/* test_long_strings() */
+
 int
 main()
 {
@@ -32,8 +303,21 @@ main()
         "non-ascii"
     };
     size_t num_cases = sizeof(test_cases)/sizeof(test_cases[0]);
+    struct
+    {
+        bool (*test)(void);
+        const char *name;
+    }
+    block_tests[] =
+    {
+        { test_one_special, "one escaped byte at each offset" },
+        { test_special_runs, "runs of escaped bytes across blocks" },
+        { test_all_bytes, "every byte value" },
+        { test_long_strings, "long strings" },
+    };
+    size_t num_block_tests = sizeof(block_tests)/sizeof(block_tests[0]);
 
-    printf("1..%zu\n", num_cases);
+    printf("1..%zu\n", num_cases + num_block_tests);
     globus_module_activate(GLOBUS_DSI_REST_MODULE);
 
     for (size_t i = 0; i < num_cases; i++)
@@ -78,6 +362,17 @@ main()
             rc++;
         }
     }
+    for (size_t i = 0; i < num_block_tests; i++)
+    {
+        bool ok = block_tests[i].test();
+
+        printf("%s %zu - %s\n", ok?"ok":"not ok", num_cases+i+1,
+                block_tests[i].name);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
 
     return rc;
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Uploads data read from a stand-in GridFTP data channel with
+ * globus_dsi_rest_write_gridftp_op_parallel(), and checks the parts sent
+ * to the test server and the result passed to the commit callback. Each
+ * read returns the next extent of the test case, and then eof.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <curl/curl.h>
+
+#include "globus_dsi_rest.h"
+#include "test-xio-server.h"
+#include "test-gridftp-op.h"
+
+enum
+{
+    PART_SIZE = 1024,
+    MAX_PARTS = 4
+};
+
+struct test_case
+{
+    const char                         *name;
+    globus_off_t                        length;
+    globus_dsi_rest_test_extent_t       reads[MAX_PARTS];
+    size_t                              read_count;
+    bool                                expect_success;
+    /* Lengths of the parts committed, if expect_success */
+    globus_off_t                        part_lengths[MAX_PARTS];
+    size_t                              part_count;
+};
+
+static
+struct test_case                        tests[] =
+{
+    {
+        .name = "known length",
+        .length = 2*PART_SIZE + PART_SIZE/2,
+        .reads =
+        {
+            { 0, PART_SIZE },
+            { PART_SIZE, PART_SIZE },
+            { 2*PART_SIZE, PART_SIZE/2 },
+        },
+        .read_count = 3,
+        .expect_success = true,
+        .part_lengths = { PART_SIZE, PART_SIZE, PART_SIZE/2 },
+        .part_count = 3,
+    },
+    {
+        .name = "unknown length",
+        .length = -1,
+        .reads =
+        {
+            { 0, PART_SIZE },
+            { PART_SIZE, PART_SIZE },
+            { 2*PART_SIZE, PART_SIZE/2 },
+        },
+        .read_count = 3,
+        .expect_success = true,
+        .part_lengths = { PART_SIZE, PART_SIZE, PART_SIZE/2 },
+        .part_count = 3,
+    },
+    {
+        .name = "known length, eof on a part boundary",
+        .length = 3*PART_SIZE,
+        .reads =
+        {
+            { 0, PART_SIZE },
+            { PART_SIZE, PART_SIZE },
+        },
+        .read_count = 2,
+    },
+    {
+        .name = "unknown length, earlier part short",
+        .length = -1,
+        .reads =
+        {
+            { 0, PART_SIZE/2 },
+            { PART_SIZE, PART_SIZE },
+        },
+        .read_count = 2,
+    },
+    {
+        .name = "known length, no data",
+        .length = PART_SIZE,
+    },
+};
+
+static unsigned char                    data[MAX_PARTS * PART_SIZE];
+static char                            *contact_string;
+static char                             part_paths[MAX_PARTS][32];
+static char                             part_uris[MAX_PARTS][256];
+static int                              part_indexes[MAX_PARTS];
+
+struct upload
+{
+    struct test_case                   *test;
+    globus_off_t                        uploaded[MAX_PARTS];
+    bool                                body_ok;
+    bool                                committed;
+    globus_result_t                     commit_result;
+    globus_off_t                        part_lengths[MAX_PARTS];
+    size_t                              part_count;
+};
+
+static struct upload                   *current_upload;
+
+static
+globus_result_t
+part_handler(
+    void                               *route_arg,
+    void                               *request_body,
+    size_t                              request_body_length,
+    int                                *response_code,
+    void                               *response_body,
+    size_t                             *response_body_length,
+    globus_dsi_rest_key_array_t        *headers)
+{
+    int                                 index = *(int *) route_arg;
+
+    if (memcmp(request_body, data + index * PART_SIZE, request_body_length)
+            != 0)
+    {
+        current_upload->body_ok = false;
+    }
+    current_upload->uploaded[index] = request_body_length;
+    *response_code = 200;
+
+    return GLOBUS_SUCCESS;
+}
+/* part_handler() */
+
+static
+globus_result_t
+part_start(
+    void                               *part_callback_arg,
+    globus_dsi_rest_part_t             *part)
+{
+    part->method = "PUT";
+    part->uri = part_uris[part->part_number];
+
+    return GLOBUS_SUCCESS;
+}
+/* part_start() */
+
+static
+globus_result_t
+commit(
+    void                               *part_callback_arg,
+    globus_dsi_rest_part_t            **parts,
+    size_t                              part_count,
+    globus_result_t                     result)
+{
+    struct upload                      *upload = part_callback_arg;
+
+    upload->committed = true;
+    upload->commit_result = result;
+    upload->part_count = part_count;
+    for (size_t i = 0; i < part_count && i < MAX_PARTS; i++)
+    {
+        upload->part_lengths[i] = parts[i] ? parts[i]->length : -1;
+    }
+    return result;
+}
+/* commit() */
+
+int
+main()
+{
+    size_t                              num_tests;
+    int                                 rc = 0;
+
+    num_tests = sizeof(tests)/sizeof(tests[0]);
+
+    globus_thread_set_model("pthread");
+    curl_global_init(CURL_GLOBAL_ALL);
+    globus_module_activate(GLOBUS_XIO_MODULE);
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    printf("1..%zu\n", num_tests);
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (unsigned char) (i * 7 + i / 251);
+    }
+    globus_dsi_rest_test_server_init(&contact_string);
+    for (int i = 0; i < MAX_PARTS; i++)
+    {
+        part_indexes[i] = i;
+        snprintf(part_paths[i], sizeof(part_paths[i]),
+                "/parallel-upload/%d", i);
+        snprintf(part_uris[i], sizeof(part_uris[i]), "http://%s%s",
+                contact_string, part_paths[i]);
+        globus_dsi_rest_test_server_add_route(
+                part_paths[i], part_handler, &part_indexes[i]);
+    }
+
+    for (size_t i = 0; i < num_tests; i++)
+    {
+        struct test_case               *test = &tests[i];
+        struct upload                   upload =
+        {
+            .test = test,
+            .body_ok = true,
+        };
+        globus_dsi_rest_test_op_t       test_op;
+        globus_dsi_rest_gridftp_op_arg_t
+                                        gridftp_op_arg;
+        globus_result_t                 result;
+        bool                            ok = true;
+
+        globus_dsi_rest_test_op_init(&test_op, data, PART_SIZE, 1);
+        test_op.reads = test->reads;
+        test_op.read_count = test->read_count;
+        gridftp_op_arg = (globus_dsi_rest_gridftp_op_arg_t)
+        {
+            .op = (globus_gfs_operation_t) &test_op,
+            .length = test->length,
+        };
+        current_upload = &upload;
+
+        result = globus_dsi_rest_write_gridftp_op_parallel(
+                &gridftp_op_arg,
+                PART_SIZE,
+                1,
+                &(globus_dsi_rest_part_callbacks_t)
+                {
+                    .part_start = part_start,
+                    .commit = commit,
+                    .callback_arg = &upload,
+                });
+        globus_dsi_rest_test_op_destroy(&test_op);
+
+        if (!upload.committed
+            || (result == GLOBUS_SUCCESS) != test->expect_success
+            || (upload.commit_result == GLOBUS_SUCCESS)
+                != test->expect_success
+            || !upload.body_ok)
+        {
+            ok = false;
+        }
+        if (ok && test->expect_success)
+        {
+            if (upload.part_count != test->part_count)
+            {
+                ok = false;
+            }
+            for (size_t p = 0; ok && p < test->part_count; p++)
+            {
+                if (upload.part_lengths[p] != test->part_lengths[p]
+                    || upload.uploaded[p] != test->part_lengths[p])
+                {
+                    ok = false;
+                }
+            }
+        }
+        printf("%s %zu - %s\n", ok ? "ok" : "not ok", i + 1, test->name);
+        if (!ok)
+        {
+            rc++;
+        }
+    }
+
+    free(contact_string);
+    globus_dsi_rest_test_server_destroy();
+    globus_module_deactivate_all();
+    curl_global_cleanup();
+
+    return rc;
+}
+/* main() */
@@ -0,0 +1,198 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Compares encoding a large bulk-metadata request body with json_dumps()
+ * before the request starts against encoding it as libcurl asks for data,
+ * in chunks of the size of libcurl's upload buffer. Reports how long each
+ * takes to produce the first chunk and the whole body, the same for the
+ * streamed body when its length is counted first for a Content-Length
+ * header, and how long counting the length takes on its own.
+ */
+
+#include "globus_i_dsi_rest.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum
+{
+    DEFAULT_ENTRIES = 50000,
+    DEFAULT_CHUNK_SIZE = 64*1024,
+    ITERATIONS = 8
+};
+
+static
+double
+now_ns(void)
+{
+    struct timespec                     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int
+main(int argc, char *argv[])
+{
+    long                                entries = DEFAULT_ENTRIES;
+    size_t                              chunk_size = DEFAULT_CHUNK_SIZE;
+    json_t                             *body;
+    json_t                             *data;
+    char                               *chunk;
+    size_t                              body_length = 0;
+    double                              dumps_first = 0, dumps_all = 0;
+    double                              stream_first = 0, stream_all = 0;
+    double                              count = 0;
+    int                                 rc = 0;
+
+    if (argc > 1)
+    {
+        entries = strtol(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        chunk_size = strtoul(argv[2], NULL, 0);
+    }
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+    body = json_object();
+    data = json_array();
+    json_object_set_new(body, "DATA_TYPE", json_string("file_list"));
+    json_object_set_new(body, "DATA", data);
+    for (long i = 0; i < entries; i++)
+    {
+        json_t                         *entry = json_object();
+        char                            name[32];
+
+        snprintf(name, sizeof(name), "file%08ld.dat", i);
+        json_object_set_new(entry, "name", json_string(name));
+        json_object_set_new(entry, "type", json_string("file"));
+        json_object_set_new(entry, "size", json_integer(i * 4096));
+        json_object_set_new(entry, "last_modified",
+                json_string("2016-01-01T00:00:00Z"));
+        json_object_set_new(entry, "permissions", json_string("0644"));
+        json_array_append_new(data, entry);
+    }
+    chunk = malloc(chunk_size);
+
+    /* The first pass warms up the allocator, and isn't counted */
+    for (int iter = -1; iter < ITERATIONS; iter++)
+    {
+        globus_i_dsi_rest_write_json_arg_t
+                                        jdata;
+        char                           *dumped;
+        uint64_t                        length = 0;
+        size_t                          sent = 0;
+        size_t                          amt;
+        double                          start, first = 0;
+
+        start = now_ns();
+        dumped = json_dumps(body, JSON_COMPACT);
+        body_length = strlen(dumped);
+        for (size_t off = 0; off < body_length; off += chunk_size)
+        {
+            memcpy(chunk, dumped + off,
+                    body_length - off < chunk_size
+                        ? body_length - off : chunk_size);
+            if (off == 0)
+            {
+                first = now_ns() - start;
+            }
+        }
+        if (iter >= 0)
+        {
+            dumps_first += first;
+            dumps_all += now_ns() - start;
+        }
+        free(dumped);
+
+        /*
+         * A request with a Content-Length counts the body before sending
+         * any of it, so that pass is timed first and reported both on its
+         * own and as part of the streamed times.
+         */
+        start = now_ns();
+        globus_i_dsi_rest_write_json_init(&jdata, body);
+        if (globus_i_dsi_rest_write_json_length(&jdata, &length)
+                != GLOBUS_SUCCESS)
+        {
+            fprintf(stderr, "write_json_length failed\n");
+            return 1;
+        }
+        if (iter >= 0)
+        {
+            count += now_ns() - start;
+        }
+        globus_i_dsi_rest_write_json_destroy(&jdata);
+
+        start = now_ns();
+        globus_i_dsi_rest_write_json_init(&jdata, body);
+        do
+        {
+            if (globus_dsi_rest_write_json(&jdata, chunk, chunk_size, &amt)
+                    != GLOBUS_SUCCESS)
+            {
+                fprintf(stderr, "write_json failed\n");
+                return 1;
+            }
+            if (sent == 0)
+            {
+                first = now_ns() - start;
+            }
+            sent += amt;
+        }
+        while (amt > 0);
+        if (iter >= 0)
+        {
+            stream_first += first;
+            stream_all += now_ns() - start;
+        }
+        globus_i_dsi_rest_write_json_destroy(&jdata);
+
+        if (sent != body_length || length != body_length)
+        {
+            fprintf(stderr, "encoded %zu bytes, counted %llu, expected %zu\n",
+                    sent, (unsigned long long) length, body_length);
+            rc = 1;
+        }
+    }
+
+    printf("%zu byte body of %ld entries, %zu byte chunks\n",
+            body_length, entries, chunk_size);
+    printf("%-12s first chunk: %8.3f ms  whole body: %8.2f ms\n",
+            "json_dumps",
+            dumps_first / ITERATIONS / 1e6,
+            dumps_all / ITERATIONS / 1e6);
+    printf("%-12s first chunk: %8.3f ms  whole body: %8.2f ms\n",
+            "streamed",
+            stream_first / ITERATIONS / 1e6,
+            stream_all / ITERATIONS / 1e6);
+    printf("%-12s first chunk: %8.3f ms  whole body: %8.2f ms\n",
+            "with length",
+            (count + stream_first) / ITERATIONS / 1e6,
+            (count + stream_all) / ITERATIONS / 1e6);
+    printf("%-12s %8.2f ms\n", "length", count / ITERATIONS / 1e6);
+
+    free(chunk);
+    json_decref(body);
+    globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+
+    return rc;
+}
+/* main() */
@@ -16,16 +16,18 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <curl/curl.h>
 #include <jansson.h>
 
-#include "globus_dsi_rest.h"
+#include "globus_i_dsi_rest.h"
 #include "test-xio-server.h"
 
 struct json_reader_s
 {
-    char                                buffer[256];
+    char                               *buffer;
     size_t                              offset;
+    size_t                              length;
     json_t                             *json;
 };
 
@@ -53,11 +55,21 @@ read_callback(
     struct json_reader_s               *json_out = read_callback_arg;
     globus_result_t                     result = GLOBUS_SUCCESS;
 
+    if (json_out->length - json_out->offset < buffer_length + 1)
+    {
+        size_t new_length = 2 * json_out->length + buffer_length + 1;
+        char *resized = realloc(json_out->buffer, new_length);
 
-    assert (buffer_length <= (sizeof(json_out->buffer) - json_out->offset));
-
+        if (resized == NULL)
+        {
+            return GLOBUS_FAILURE;
+        }
+        json_out->buffer = resized;
+        json_out->length = new_length;
+    }
     memcpy(&json_out->buffer[json_out->offset], buffer, buffer_length);
     json_out->offset += buffer_length;
+    json_out->buffer[json_out->offset] = 0;
 
     return result;
 }
@@ -81,19 +93,154 @@ request_test_handler(
     return GLOBUS_SUCCESS;
 }
 
+/*
+ * A body over 64 KiB, larger than the length pass's scratch buffer and
+ * libcurl's upload buffer, with long strings full of escapes and long
+ * numbers, so that strings, escapes and numbers are split across reads.
+ */
+static
+json_t *
+large_body(void)
+{
+    json_t *body = json_object();
+    json_t *data = json_array();
+
+    json_object_set_new(body, "DATA_TYPE", json_string("file_list"));
+    json_object_set_new(body, "DATA", data);
+    for (int i = 0; i < 400; i++)
+    {
+        json_t *entry = json_object();
+        char name[256];
+        size_t n = 0;
+
+        while (n < sizeof(name) - 8)
+        {
+            /* Vary where each escape falls */
+            n += snprintf(name + n, sizeof(name) - n, "%.*s%s",
+                    i % 7 + 1, "abcdefgh",
+                    (const char *[]){ "\"", "\\", "\n", "\x01", "\xc3\xa9",
+                                      "\t", "/" }[(n + i) % 7]);
+        }
+        json_object_set_new(entry, "name \"quoted\"", json_string(name));
+        json_object_set_new(entry, "size",
+                json_integer(-1234567890123456789LL + i));
+        json_object_set_new(entry, "mtime",
+                json_real(1.2345678901234567e-300 * (i + 1)));
+        json_object_set_new(entry, "ratio", json_real(i / 7.0));
+        json_array_append_new(data, entry);
+    }
+    return body;
+}
+/* large_body() */
+
+/*
+ * Pass the json straight through globus_dsi_rest_write_json() in chunks
+ * of each size, after its length has been computed or not, and check
+ * that the bytes are the same as json_dumps().
+ */
+static
+bool
+check_chunks(
+    json_t                             *json,
+    const char                         *expected)
+{
+    static const size_t                 chunk_sizes[] =
+    {
+        1, 2, 5, 63, 64, 65, 4095, 4096, 16384, 65536
+    };
+    size_t                              expected_len = strlen(expected);
+    char                               *out = malloc(expected_len + 1);
+    bool                                ok = out != NULL;
+
+    size_t                              num_chunk_sizes;
+
+    num_chunk_sizes = sizeof(chunk_sizes)/sizeof(chunk_sizes[0]);
+
+    for (size_t c = 0; ok && c < 2 * num_chunk_sizes; c++)
+    {
+        size_t chunk_size = chunk_sizes[c / 2];
+        globus_i_dsi_rest_write_json_arg_t jdata;
+        uint64_t length = 0;
+        size_t sent = 0;
+        size_t amt = 0;
+
+        globus_i_dsi_rest_write_json_init(&jdata, json);
+        if (c % 2 == 1
+            && (globus_i_dsi_rest_write_json_length(&jdata, &length)
+                    != GLOBUS_SUCCESS
+                || length != expected_len))
+        {
+            fprintf(stderr, "# length %llu, expected %zu\n",
+                    (unsigned long long) length, expected_len);
+            ok = false;
+        }
+        do
+        {
+            size_t want = chunk_size;
+
+            if (want > expected_len + 1 - sent)
+            {
+                want = expected_len + 1 - sent;
+            }
+            if (globus_dsi_rest_write_json(&jdata, out + sent, want, &amt)
+                    != GLOBUS_SUCCESS)
+            {
+                ok = false;
+                break;
+            }
+            sent += amt;
+        }
+        while (ok && amt > 0 && sent <= expected_len);
+        globus_i_dsi_rest_write_json_destroy(&jdata);
+
+        if (ok && (sent != expected_len
+                || memcmp(out, expected, expected_len) != 0))
+        {
+            fprintf(stderr, "# %zu byte chunks%s: sent %zu bytes,"
+                    " expected %zu\n",
+                    chunk_size, c % 2 ? " after the length" : "",
+                    sent, expected_len);
+            ok = false;
+        }
+    }
+    free(out);
+
+    return ok;
+}
+/* check_chunks() */
+
 int main()
 {
     globus_result_t                     result;
     char                               *contact_string;
     int                                 rc = 0;
+    size_t                              test_num = 0;
     char                               *json_tests[] =
     {
         "{\"intval\":                   42}",
         "{\"stringval\":                \"some string\"}",
         "{\"floatval\":                 42.0}",
         "{\"arrayval\":                 [\"a\", \"b\", \"c\"]}",
-        "{\"object\":                   {\"a\": \"b\"}}"
+        "{\"object\":                   {\"a\": \"b\"}}",
+        "{\"escapes\":                  \"\\\"\\\\\\b\\f\\n\\r\\t\\u0001\"}",
+        "{\"nested\":                   [{\"a\": [1, -2, 0.5e-3]}, [], {}]}",
+        "[true, false, null, \"\\u00e9\"]",
+        "{\"exponents\":                [1e20, -1.5e-7, 2.5E+300, 1e-100]}",
+        "[0.1, 1e16, 12345678901234567890.0, 5e-324, -0.0, 1e300]",
+        /* large_body() */
+        NULL
     };
+    size_t num_json_tests = sizeof(json_tests)/sizeof(json_tests[0]);
+    /*
+     * Send each body as one CURLOPT_POSTFIELDS buffer when it is small
+     * enough, as by default, and then always through the write callback,
+     * so that the streaming encoder is tested.
+     */
+    const char *postfields_max[] = { NULL, "0" };
+    size_t num_passes = sizeof(postfields_max)/sizeof(postfields_max[0]);
+    json_t *invalid_json[] = { NULL, json_integer(1), json_string("a") };
+    const char *invalid_names[] = { "NULL", "integer", "string" };
+    size_t num_invalid = sizeof(invalid_json)/sizeof(invalid_json[0]);
 
     globus_thread_set_model("pthread");
 
@@ -101,8 +248,7 @@ int main()
     globus_module_activate(GLOBUS_XIO_MODULE);
 
 
-    printf("1..%zu\n", sizeof(json_tests)/sizeof(json_tests[0]));
-    globus_module_activate(GLOBUS_DSI_REST_MODULE);
+    printf("1..%zu\n", num_passes * num_json_tests + 1 + num_invalid);
 
     result = globus_dsi_rest_test_server_init(&contact_string);
 
@@ -111,22 +257,122 @@ int main()
         request_test_handler,
         NULL);
 
-    for (size_t i = 0; i < sizeof(json_tests)/sizeof(json_tests[0]); i++)
+    char uri_fmt[] = "http://%s/echo";
+    size_t uri_len = strlen(contact_string) + sizeof(uri_fmt);
+    char uri[uri_len+1];
+    snprintf(uri, sizeof(uri), uri_fmt, contact_string);
+
+    for (size_t pass = 0; pass < num_passes; pass++)
     {
-        json_t *json;
-        struct json_reader_s  json_out = {.offset=0};
-        bool ok = true, transport_ok = true, download_ok = true;
-        char uri_fmt[] = "http://%s/echo";
-        size_t uri_len = strlen(contact_string) + sizeof(uri_fmt);
-        char uri[uri_len+1];
-        snprintf(uri, sizeof(uri), uri_fmt, contact_string);
+        if (postfields_max[pass] != NULL)
+        {
+            setenv("GLOBUS_DSI_REST_POSTFIELDS_MAX", postfields_max[pass], 1);
+        }
+        else
+        {
+            unsetenv("GLOBUS_DSI_REST_POSTFIELDS_MAX");
+        }
+        globus_module_activate(GLOBUS_DSI_REST_MODULE);
+
+        for (size_t i = 0; i < num_json_tests; i++)
+        {
+            json_t *json;
+            char *expected;
+            struct json_reader_s  json_out = {.offset=0};
+            bool ok = true, transport_ok = true, download_ok = true;
+            bool encoding_ok = true;
+
+            if (json_tests[i] != NULL)
+            {
+                json = json_loads(json_tests[i], 0, NULL);
+            }
+            else
+            {
+                json = large_body();
+            }
+
+            if (!json)
+            {
+                return 99;
+            }
+            result = globus_dsi_rest_request(
+                "POST",
+                uri,
+                NULL,
+                NULL,
+                &(globus_dsi_rest_callbacks_t)
+                {
+                    .data_write_callback = globus_dsi_rest_write_json,
+                    .data_write_callback_arg = json,
+                    .data_read_callback = read_callback,
+                    .data_read_callback_arg = &json_out
+                });
+
+            if (result != GLOBUS_SUCCESS)
+            {
+                ok = transport_ok = false;
+            }
+            if (json_out.buffer != NULL)
+            {
+                json_out.json = json_loads(json_out.buffer, 0, NULL);
+            }
+
+            if (!json_equal(json, json_out.json))
+            {
+                ok = download_ok = false;
+            }
+            /* The body sent must be exactly what json_dumps() would write */
+            expected = json_dumps(json, JSON_COMPACT);
+            if (expected == NULL
+                || strlen(expected) != json_out.offset
+                || memcmp(expected, json_out.buffer, json_out.offset) != 0)
+            {
+                ok = encoding_ok = false;
+            }
+            free(expected);
+            json_decref(json);
+            json_decref(json_out.json);
+            free(json_out.buffer);
+
+            printf("%s %zu - %s%s %s%s%s\n",
+                    ok?"ok":"not ok",
+                    ++test_num,
+                    json_tests[i] ? json_tests[i] : "large body",
+                    postfields_max[pass] ? " streamed" : "",
+                    transport_ok?"":" transport_fail",
+                    download_ok?"":" download_fail",
+                    encoding_ok?"":" encoding_fail");
+            if (!ok)
+            {
+                rc++;
+            }
+        }
+        globus_module_deactivate(GLOBUS_DSI_REST_MODULE);
+    }
+    unsetenv("GLOBUS_DSI_REST_POSTFIELDS_MAX");
+    globus_module_activate(GLOBUS_DSI_REST_MODULE);
 
-        json = json_loads(json_tests[i], 0, NULL);
+    {
+        json_t *json = large_body();
+        char *expected = json_dumps(json, JSON_COMPACT);
+        bool ok = expected != NULL && check_chunks(json, expected);
 
-        if (!json)
+        printf("%s %zu - large body in chunks\n",
+                ok?"ok":"not ok", ++test_num);
+        if (!ok)
         {
-            return 99;
+            rc++;
         }
+        free(expected);
+        json_decref(json);
+    }
+
+    /* As with json_dumps(), only an object or array can be the body */
+    for (size_t i = 0; i < num_invalid; i++)
+    {
+        struct json_reader_s  json_out = {.offset=0};
+        bool ok;
+
         result = globus_dsi_rest_request(
             "POST",
             uri,
@@ -135,34 +381,21 @@ int main()
             &(globus_dsi_rest_callbacks_t)
             {
                 .data_write_callback = globus_dsi_rest_write_json,
-                .data_write_callback_arg = json,
+                .data_write_callback_arg = invalid_json[i],
                 .data_read_callback = read_callback,
                 .data_read_callback_arg = &json_out
             });
-
-        if (result != GLOBUS_SUCCESS)
-        {
-            ok = transport_ok = false;
-        }
-        json_out.json = json_loads(json_out.buffer, 0, NULL);
-
-        if (!json_equal(json, json_out.json))
-        {
-            ok = download_ok = false;
-        }
-        json_decref(json);
-        json_decref(json_out.json);
-
-        printf("%s %zu - %s %s%s\n",
+        ok = (result != GLOBUS_SUCCESS && json_out.offset == 0);
+        printf("%s %zu - %s body rejected\n",
                 ok?"ok":"not ok",
-                i+1,
-                json_tests[i],
-                transport_ok?"":" transport_fail",
-                download_ok?"":" download_fail");
+                ++test_num,
+                invalid_names[i]);
         if (!ok)
         {
             rc++;
         }
+        json_decref(invalid_json[i]);
+        free(json_out.buffer);
     }
 
     free(contact_string);
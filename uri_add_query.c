@@ -28,9 +28,20 @@ globus_dsi_rest_uri_add_query(
     const char                         *uri,
     const globus_dsi_rest_key_array_t  *query_parameters,
     char                              **complete_urip)
+{
+    return globus_i_dsi_rest_uri_add_query(
+            NULL, uri, query_parameters, complete_urip);
+}
+/* globus_dsi_rest_uri_add_query() */
+
+globus_result_t
+globus_i_dsi_rest_uri_add_query(
+    globus_i_dsi_rest_arena_t          *arena,
+    const char                         *uri,
+    const globus_dsi_rest_key_array_t  *query_parameters,
+    char                              **complete_urip)
 {
     size_t                              orig_uri_len = strlen(uri);
-    size_t                              left = 0;
     size_t                              complete_uri_len = orig_uri_len;
     char                               *complete_uri = NULL, *p;
     globus_result_t                     result = GLOBUS_SUCCESS;
@@ -44,64 +55,58 @@ globus_dsi_rest_uri_add_query(
     {
         char                            delim = '?';
 
+        /* Exactly the length of the result, so nothing is left over */
         for (size_t i = 0; i < query_parameters->count; i++)
         {
-            if (query_parameters->key_value[i].key != NULL
-                && query_parameters->key_value[i].value != NULL)
+            const char                 *key = query_parameters->key_value[i].key;
+            const char                 *value
+                                      = query_parameters->key_value[i].value;
+
+            if (key != NULL && value != NULL)
             {
                 complete_uri_len += 2
-                        + 3 * strlen(query_parameters->key_value[i].key)
-                        + 3 * strlen(query_parameters->key_value[i].value);
+                        + globus_i_dsi_rest_uri_escaped_length(
+                                key, strlen(key))
+                        + globus_i_dsi_rest_uri_escaped_length(
+                                value, strlen(value));
             }
         }
-        complete_uri = malloc(complete_uri_len + 1);
+        complete_uri = (arena != NULL)
+                ? globus_i_dsi_rest_arena_alloc(arena, complete_uri_len + 1)
+                : malloc(complete_uri_len + 1);
         if (complete_uri == NULL)
         {
             result = GlobusDsiRestErrorMemory();
 
             goto memory_fail;
         }
-        left = complete_uri_len + 1;
-        p = complete_uri;
-
-        strcpy(complete_uri, uri);
-
-        left -= orig_uri_len;
-        p += orig_uri_len;
+        memcpy(complete_uri, uri, orig_uri_len);
+        p = complete_uri + orig_uri_len;
 
         for (size_t i = 0; i < query_parameters->count; i++)
         {
-            if (query_parameters->key_value[i].key != NULL
-                && query_parameters->key_value[i].value != NULL)
+            const char                 *key = query_parameters->key_value[i].key;
+            const char                 *value
+                                      = query_parameters->key_value[i].value;
+
+            if (key != NULL && value != NULL)
             {
                 *(p++) = delim;
-                assert(left > 0);
-                left--;
-
                 delim = '&';
 
-                globus_i_dsi_rest_uri_escape(
-                    query_parameters->key_value[i].key,
-                    &p,
-                    &left);
-
+                p = globus_i_dsi_rest_uri_escape(key, strlen(key), p);
                 *(p++) = '=';
-                assert(left > 0);
-                left--;
-
-                globus_i_dsi_rest_uri_escape(
-                    query_parameters->key_value[i].value,
-                    &p,
-                    &left);
+                p = globus_i_dsi_rest_uri_escape(value, strlen(value), p);
             }
         }
         *p = 0;
-        assert(left > 0);
-        left--;
+        assert(p == complete_uri + complete_uri_len);
     }
     else
     {
-        complete_uri = strdup(uri);
+        complete_uri = (arena != NULL)
+                ? globus_i_dsi_rest_arena_strdup(arena, uri)
+                : strdup(uri);
         if (complete_uri == NULL)
         {
             result = GlobusDsiRestErrorMemory();
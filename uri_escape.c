@@ -14,79 +14,279 @@
  * limitations under the License.
  */
 
+
 #ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
 /**
  * @file uri_escape.c GridFTP DSI REST URI Escape
+ * @details
+ *     Each byte is looked up in a table which says whether it is copied,
+ *     replaced by '+', or percent-encoded. Where SSE2 or AVX2 is available
+ *     at compile time, 16 or 32 bytes are classified at once, so runs of
+ *     unreserved bytes, which make up most of a typical path or query, are
+ *     copied and counted a block at a time.
  */
 #endif
 
 #include "globus_i_dsi_rest.h"
 
-void
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+enum
+{
+    /* Unreserved, copied as is */
+    GLOBUS_L_DSI_REST_URI_COPY = 0,
+    /* Space, replaced by '+' */
+    GLOBUS_L_DSI_REST_URI_SPACE = 1,
+    /* Anything else, replaced by %XX */
+    GLOBUS_L_DSI_REST_URI_ESCAPE = 2
+};
+
+#define C GLOBUS_L_DSI_REST_URI_COPY
+#define S GLOBUS_L_DSI_REST_URI_SPACE
+#define E GLOBUS_L_DSI_REST_URI_ESCAPE
+static const unsigned char              globus_l_dsi_rest_uri_class[256] =
+{
+    /* 00 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* 10 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* 20 */ S, E, E, E, E, E, E, E, E, E, E, E, E, C, C, E,
+    /* 30 */ C, C, C, C, C, C, C, C, C, C, E, E, E, E, E, E,
+    /* 40 */ E, C, C, C, C, C, C, C, C, C, C, C, C, C, C, C,
+    /* 50 */ C, C, C, C, C, C, C, C, C, C, C, E, E, E, E, C,
+    /* 60 */ E, C, C, C, C, C, C, C, C, C, C, C, C, C, C, C,
+    /* 70 */ C, C, C, C, C, C, C, C, C, C, C, E, E, E, C, E,
+    /* 80 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* 90 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* A0 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* B0 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* C0 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* D0 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* E0 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+    /* F0 */ E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+};
+#undef C
+#undef S
+#undef E
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+#define GLOBUS_L_DSI_REST_URI_BLOCK 32
+typedef __m256i                         globus_l_dsi_rest_uri_vector_t;
+#define GlobusLDsiRestUriLoad(p) _mm256_loadu_si256((const __m256i *) (p))
+#define GlobusLDsiRestUriSet1(c) _mm256_set1_epi8(c)
+#define GlobusLDsiRestUriZero() _mm256_setzero_si256()
+#define GlobusLDsiRestUriOr(a, b) _mm256_or_si256(a, b)
+#define GlobusLDsiRestUriAnd(a, b) _mm256_and_si256(a, b)
+#define GlobusLDsiRestUriAndNot(a, b) _mm256_andnot_si256(a, b)
+#define GlobusLDsiRestUriSub(a, b) _mm256_sub_epi8(a, b)
+#define GlobusLDsiRestUriGt(a, b) _mm256_cmpgt_epi8(a, b)
+#define GlobusLDsiRestUriEq(a, b) _mm256_cmpeq_epi8(a, b)
+#define GlobusLDsiRestUriMask(a) ((uint32_t) _mm256_movemask_epi8(a))
+#else
+#define GLOBUS_L_DSI_REST_URI_BLOCK 16
+typedef __m128i                         globus_l_dsi_rest_uri_vector_t;
+#define GlobusLDsiRestUriLoad(p) _mm_loadu_si128((const __m128i *) (p))
+#define GlobusLDsiRestUriSet1(c) _mm_set1_epi8(c)
+#define GlobusLDsiRestUriZero() _mm_setzero_si128()
+#define GlobusLDsiRestUriOr(a, b) _mm_or_si128(a, b)
+#define GlobusLDsiRestUriAnd(a, b) _mm_and_si128(a, b)
+#define GlobusLDsiRestUriAndNot(a, b) _mm_andnot_si128(a, b)
+#define GlobusLDsiRestUriSub(a, b) _mm_sub_epi8(a, b)
+#define GlobusLDsiRestUriGt(a, b) _mm_cmpgt_epi8(a, b)
+#define GlobusLDsiRestUriEq(a, b) _mm_cmpeq_epi8(a, b)
+#define GlobusLDsiRestUriMask(a) ((uint32_t) _mm_movemask_epi8(a))
+#endif
+
+/* All bits set for a block made up only of unreserved bytes */
+#define GLOBUS_L_DSI_REST_URI_BLOCK_MASK \
+    ((uint32_t) ((1ull << GLOBUS_L_DSI_REST_URI_BLOCK) - 1))
+
+/**
+ * @brief Find the unreserved bytes in a block
+ * @details
+ *     Each byte of the result is 0xFF where the byte of v is unreserved,
+ *     and 0 elsewhere. The compares are signed, so bytes 0x80 and up are
+ *     never in range.
+ */
+static
+inline
+globus_l_dsi_rest_uri_vector_t
+globus_l_dsi_rest_uri_unreserved(
+    globus_l_dsi_rest_uri_vector_t      v)
+{
+    globus_l_dsi_rest_uri_vector_t      lower;
+    globus_l_dsi_rest_uri_vector_t      ok;
+
+    /* Folding in 0x20 maps A-Z onto a-z, and nothing else onto them */
+    lower = GlobusLDsiRestUriOr(v, GlobusLDsiRestUriSet1(0x20));
+    ok = GlobusLDsiRestUriAnd(
+            GlobusLDsiRestUriGt(lower, GlobusLDsiRestUriSet1('a' - 1)),
+            GlobusLDsiRestUriGt(GlobusLDsiRestUriSet1('z' + 1), lower));
+    ok = GlobusLDsiRestUriOr(ok, GlobusLDsiRestUriAnd(
+            GlobusLDsiRestUriGt(v, GlobusLDsiRestUriSet1('0' - 1)),
+            GlobusLDsiRestUriGt(GlobusLDsiRestUriSet1('9' + 1), v)));
+    ok = GlobusLDsiRestUriOr(ok, GlobusLDsiRestUriOr(
+            GlobusLDsiRestUriOr(
+                GlobusLDsiRestUriEq(v, GlobusLDsiRestUriSet1('-')),
+                GlobusLDsiRestUriEq(v, GlobusLDsiRestUriSet1('_'))),
+            GlobusLDsiRestUriOr(
+                GlobusLDsiRestUriEq(v, GlobusLDsiRestUriSet1('.')),
+                GlobusLDsiRestUriEq(v, GlobusLDsiRestUriSet1('~')))));
+
+    return ok;
+}
+/* globus_l_dsi_rest_uri_unreserved() */
+
+/**
+ * @brief Add up the bytes of a vector of per-byte counts
+ */
+static
+inline
+size_t
+globus_l_dsi_rest_uri_sum(
+    globus_l_dsi_rest_uri_vector_t      counts)
+{
+#if defined(__AVX2__)
+    __m256i                             sums;
+
+    sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+
+    return (size_t) _mm256_extract_epi64(sums, 0)
+         + (size_t) _mm256_extract_epi64(sums, 1)
+         + (size_t) _mm256_extract_epi64(sums, 2)
+         + (size_t) _mm256_extract_epi64(sums, 3);
+#else
+    __m128i                             sums;
+
+    sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+
+    return (size_t) _mm_cvtsi128_si32(sums)
+         + (size_t) _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+#endif
+}
+/* globus_l_dsi_rest_uri_sum() */
+#endif
+
+size_t
+globus_i_dsi_rest_uri_escaped_length(
+    const char                         *raw,
+    size_t                              raw_len)
+{
+    size_t                              escaped = 0;
+    size_t                              i = 0;
+
+#ifdef GLOBUS_L_DSI_REST_URI_BLOCK
+    globus_l_dsi_rest_uri_vector_t      counts = GlobusLDsiRestUriZero();
+    int                                 blocks = 0;
+
+    for (; raw_len - i >= GLOBUS_L_DSI_REST_URI_BLOCK;
+         i += GLOBUS_L_DSI_REST_URI_BLOCK)
+    {
+        globus_l_dsi_rest_uri_vector_t  v = GlobusLDsiRestUriLoad(raw + i);
+        globus_l_dsi_rest_uri_vector_t  escape;
+
+        /* 0xFF, which is -1, in each byte to be escaped */
+        escape = GlobusLDsiRestUriAndNot(
+                GlobusLDsiRestUriOr(
+                    globus_l_dsi_rest_uri_unreserved(v),
+                    GlobusLDsiRestUriEq(v, GlobusLDsiRestUriSet1(' '))),
+                GlobusLDsiRestUriSet1(-1));
+        counts = GlobusLDsiRestUriSub(counts, escape);
+
+        /* Add up the per-byte counts before they can overflow */
+        if (++blocks == 255)
+        {
+            escaped += globus_l_dsi_rest_uri_sum(counts);
+            counts = GlobusLDsiRestUriZero();
+            blocks = 0;
+        }
+    }
+    escaped += globus_l_dsi_rest_uri_sum(counts);
+#endif
+    for (; i < raw_len; i++)
+    {
+        escaped += globus_l_dsi_rest_uri_class[(unsigned char) raw[i]]
+                == GLOBUS_L_DSI_REST_URI_ESCAPE;
+    }
+
+    return raw_len + 2 * escaped;
+}
+/* globus_i_dsi_rest_uri_escaped_length() */
+
+static
+inline
+char *
+globus_l_dsi_rest_uri_escape_byte(
+    unsigned char                       c,
+    char                               *encoded)
+{
+    static const char                   encoding_table[] = "0123456789ABCDEF";
+
+    switch (globus_l_dsi_rest_uri_class[c])
+    {
+        case GLOBUS_L_DSI_REST_URI_COPY:
+            *(encoded++) = c;
+            break;
+        case GLOBUS_L_DSI_REST_URI_SPACE:
+            *(encoded++) = '+';
+            break;
+        default:
+            *(encoded++) = '%';
+            *(encoded++) = encoding_table[c >> 4];
+            *(encoded++) = encoding_table[c & 0xf];
+            break;
+    }
+    return encoded;
+}
+/* globus_l_dsi_rest_uri_escape_byte() */
+
+char *
 globus_i_dsi_rest_uri_escape(
     const char                         *raw,
-    char                              **encodedp,
-    size_t                             *availablep)
+    size_t                              raw_len,
+    char                               *encoded)
 {
-    char                               *encoded = *encodedp;
-    size_t                              available = *availablep;
-    static const char                  *encoding_table = "0123456789ABCDEF";
+    size_t                              i = 0;
 
-    while (*raw != 0)
+#ifdef GLOBUS_L_DSI_REST_URI_BLOCK
+    for (; raw_len - i >= GLOBUS_L_DSI_REST_URI_BLOCK;
+         i += GLOBUS_L_DSI_REST_URI_BLOCK)
     {
-        switch (*raw)
+        uint32_t                        reserved;
+        size_t                          pos = 0;
+
+        reserved = ~GlobusLDsiRestUriMask(
+                globus_l_dsi_rest_uri_unreserved(
+                    GlobusLDsiRestUriLoad(raw + i)))
+                & GLOBUS_L_DSI_REST_URI_BLOCK_MASK;
+
+        /* Copy the runs between the bytes which aren't unreserved */
+        while (reserved != 0)
         {
-            case 'a': case 'b': case 'c': case 'd': case 'e':
-            case 'f': case 'g': case 'h': case 'i': case 'j':
-            case 'k': case 'l': case 'm': case 'n': case 'o':
-            case 'p': case 'q': case 'r': case 's': case 't':
-            case 'u': case 'v': case 'w': case 'x': case 'y':
-            case 'z':
-
-            case 'A': case 'B': case 'C': case 'D': case 'E':
-            case 'F': case 'G': case 'H': case 'I': case 'J':
-            case 'K': case 'L': case 'M': case 'N': case 'O':
-            case 'P': case 'Q': case 'R': case 'S': case 'T':
-            case 'U': case 'V': case 'W': case 'X': case 'Y':
-            case 'Z':
-
-            case '0': case '1': case '2': case '3': case '4':
-            case '5': case '6': case '7': case '8': case '9':
-
-            case '-': case '_': case '.': case '~':
-                assert(available > 0);
-
-                *(encoded++) = *(raw++);
-                available--;
-                break;
-
-            case ' ':
-                assert(available > 0);
-                *(encoded++) = '+';
-                available--;
-                raw++;
-                break;
-                
-            default:
-                assert(available > 0);
-                *(encoded++) = '%';
-                available--;
-
-                assert(available > 0);
-                *(encoded++) = encoding_table[(((unsigned int) (*raw)) >> 4) & 0xf];
-                available--;
-
-                assert(available > 0);
-                *(encoded++) = encoding_table[(((unsigned int) (*raw)) & 0xf)];
-                available--;
-                raw++;
-                break;
+            size_t                      next = __builtin_ctz(reserved);
+
+            memcpy(encoded, raw + i + pos, next - pos);
+            encoded += next - pos;
+            encoded = globus_l_dsi_rest_uri_escape_byte(
+                    raw[i + next], encoded);
+            pos = next + 1;
+            reserved &= reserved - 1;
         }
+        memcpy(encoded, raw + i + pos, GLOBUS_L_DSI_REST_URI_BLOCK - pos);
+        encoded += GLOBUS_L_DSI_REST_URI_BLOCK - pos;
     }
-    *encodedp = encoded;
-    *availablep = available;
+#endif
+    for (; i < raw_len; i++)
+    {
+        encoded = globus_l_dsi_rest_uri_escape_byte(raw[i], encoded);
+    }
+
+    return encoded;
 }
-/* globus_l_dsi_rest_uri_encode() */
+/* globus_i_dsi_rest_uri_escape() */
 
 globus_result_t
 globus_dsi_rest_uri_escape(
@@ -94,20 +294,19 @@ globus_dsi_rest_uri_escape(
     char                              **escapedp)
 {
     size_t                              slen = strlen(s);
-    size_t                              elen = slen*3+1;
-    char                               *encoded = malloc(elen);
-    char                               *save = encoded;
-    char                              **p = &encoded;
+    char                               *encoded;
+    char                               *end;
 
+    encoded = malloc(globus_i_dsi_rest_uri_escaped_length(s, slen) + 1);
     if (encoded == NULL)
     {
         return GlobusDsiRestErrorMemory();
     }
 
-    globus_i_dsi_rest_uri_escape(s, p, &elen);
-    *(*p) = 0;
+    end = globus_i_dsi_rest_uri_escape(s, slen, encoded);
+    *end = 0;
 
-    *escapedp = save;
+    *escapedp = encoded;
     return GLOBUS_SUCCESS;
 }
 /* globus_dsi_rest_uri_escape() */
@@ -32,14 +32,6 @@ bool
 globus_l_dsi_rest_is_reading_complete(
     globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg);
 
-static
-void
-globus_l_dsi_rest_count_buffers(
-    globus_i_dsi_rest_buffer_t         *buffer,
-    int                                *currentp,
-    globus_off_t                       *bytes_availablep,
-    globus_off_t                       *bytes_usedp);
-
 static
 globus_result_t
 globus_l_dsi_rest_write_register_reads(
@@ -82,28 +74,12 @@ globus_l_dsi_rest_write_gridftp_op(
     while ((!globus_l_dsi_rest_is_transfer_offset_ready(gridftp_op_arg))
            && (!globus_l_dsi_rest_is_reading_complete(gridftp_op_arg)))
     {
-        int                             currently_registered = 0;
-        globus_off_t                    bytes_registered = 0;
-        int                             currently_pending = 0;
-        globus_off_t                    bytes_pending = 0;
-
         result = globus_l_dsi_rest_write_register_reads(gridftp_op_arg);
         if (gridftp_op_arg->result == GLOBUS_SUCCESS)
         {
             gridftp_op_arg->result = result;
         }
 
-        globus_l_dsi_rest_count_buffers(
-                gridftp_op_arg->registered_buffers,
-                &currently_registered,
-                &bytes_registered,
-                NULL);
-        globus_l_dsi_rest_count_buffers(
-                gridftp_op_arg->pending_buffers,
-                &currently_pending,
-                NULL,
-                &bytes_pending);
-
         GlobusDsiRestDebug(
             "waiting: "
             "op=%p "
@@ -112,19 +88,19 @@ globus_l_dsi_rest_write_gridftp_op(
             "eof=%s "
             "currently_registered=%d "
             "bytes_registered=%"GLOBUS_OFF_T_FORMAT" "
-            "currently_pending=%d "
+            "currently_pending=%zu "
             "bytes_pending=%"GLOBUS_OFF_T_FORMAT"\n",
             (void *) gridftp_op_arg->op,
             gridftp_op_arg->offset,
             gridftp_op_arg->result,
             gridftp_op_arg->eof ? "true" : "false",
-            currently_registered,
-            bytes_registered,
-            currently_pending,
-            bytes_pending);
+            gridftp_op_arg->registered_buffers_count,
+            gridftp_op_arg->registered_bytes,
+            gridftp_op_arg->pending_heap_count,
+            gridftp_op_arg->pending_bytes);
 
         if (gridftp_op_arg->result != GLOBUS_SUCCESS
-            && gridftp_op_arg->registered_buffers == NULL)
+            && gridftp_op_arg->registered_buffers_count == 0)
         {
             /* If globus_l_dsi_rest_write_register_reads() fails and no
              * buffers are registered, we have reached a state where the
@@ -145,45 +121,46 @@ globus_l_dsi_rest_write_gridftp_op(
     while ((buffer_filled < buffer_length)
             && globus_l_dsi_rest_is_transfer_offset_ready(gridftp_op_arg))
     {
-        int                             to_copy;
+        size_t                          to_copy;
 
-        rest_buffer = gridftp_op_arg->pending_buffers;
+        rest_buffer = gridftp_op_arg->pending_heap[0];
 
         to_copy = buffer_length - buffer_filled;
 
-        if (to_copy > rest_buffer->buffer_used)
+        if (to_copy > rest_buffer->buffer_used - rest_buffer->buffer_consumed)
         {
-            to_copy = rest_buffer->buffer_used;
+            to_copy = rest_buffer->buffer_used - rest_buffer->buffer_consumed;
         }
         assert (to_copy > 0);
 
-        memcpy(((char *)buffer)+buffer_filled, rest_buffer->buffer, to_copy);
+        memcpy(((char *)buffer)+buffer_filled,
+                rest_buffer->buffer + rest_buffer->buffer_consumed,
+                to_copy);
         buffer_filled += to_copy;
         gridftp_op_arg->offset += to_copy;
 
-        if (to_copy < rest_buffer->buffer_used)
+        if (to_copy < rest_buffer->buffer_used - rest_buffer->buffer_consumed)
         {
-            /* Partial buffer copy */
-            GlobusDsiRestTrace("partial_buffer_copy: op=%p bytes_copied=%d\n",
+            /* Partial buffer copy. The buffer's data still ends before the
+             * next one's starts, so it stays at the top of the heap.
+             */
+            GlobusDsiRestTrace("partial_buffer_copy: op=%p bytes_copied=%zu\n",
                     (void *) gridftp_op_arg->op,
                     to_copy);
-            memmove(rest_buffer->buffer, rest_buffer->buffer + to_copy, rest_buffer->buffer_used - to_copy);
-            rest_buffer->buffer_used -= to_copy;
+            rest_buffer->buffer_consumed += to_copy;
             rest_buffer->transfer_offset += to_copy;
+            gridftp_op_arg->pending_bytes -= to_copy;
         }
         else
         {
-            GlobusDsiRestTrace("add_to_pending_buffers: op=%p rest_buffer=%p\n",
+            GlobusDsiRestTrace("add_to_free_buffers: op=%p rest_buffer=%p\n",
                     (void *) gridftp_op_arg->op,
                     (void *) rest_buffer);
 
-            gridftp_op_arg->pending_buffers = rest_buffer->next;
-            if (gridftp_op_arg->pending_buffers == NULL)
-            {
-                gridftp_op_arg->pending_buffers_last = &gridftp_op_arg->pending_buffers;
-            }
+            globus_i_dsi_rest_buffer_heap_pop(gridftp_op_arg);
             rest_buffer->transfer_offset = UINT64_C(-1);
             rest_buffer->buffer_used = 0;
+            rest_buffer->buffer_consumed = 0;
 
             rest_buffer->next = gridftp_op_arg->free_buffers;
             gridftp_op_arg->free_buffers = rest_buffer;
@@ -224,8 +201,6 @@ globus_l_dsi_rest_gridftp_read_callback(
 {
     globus_i_dsi_rest_gridftp_op_arg_t *gridftp_op_arg = user_arg;
     globus_i_dsi_rest_buffer_t         *rest_buffer;
-    globus_i_dsi_rest_buffer_t         *tmp;
-    globus_i_dsi_rest_buffer_t        **prev_next;
     bool                                signal = eof;
 
     GlobusDsiRestEnter();
@@ -266,22 +241,10 @@ globus_l_dsi_rest_gridftp_read_callback(
 
     gridftp_op_arg->eof |= eof;
 
-    /* Remove from the registered buffer list */
-    rest_buffer = gridftp_op_arg->registered_buffers;
-    prev_next = &gridftp_op_arg->registered_buffers;
-
-    while (rest_buffer != NULL)
-    {
-        if (rest_buffer->buffer == buffer)
-        {
-            *prev_next = rest_buffer->next;
-            break;
-        }
-        prev_next = &rest_buffer->next;
-        rest_buffer = rest_buffer->next;
-    }
-
-    assert(rest_buffer != NULL);
+    /* No longer registered. buffer_used holds the length that was read */
+    rest_buffer = GlobusDsiRestBufferFromData(buffer);
+    gridftp_op_arg->registered_buffers_count--;
+    gridftp_op_arg->registered_bytes -= rest_buffer->buffer_used;
 
     /* Update the info about this buffer */
     rest_buffer->transfer_offset = offset;
@@ -305,39 +268,23 @@ globus_l_dsi_rest_gridftp_read_callback(
     {
         /* empty buffer */
         rest_buffer->transfer_offset = UINT64_C(-1);
-        rest_buffer->buffer_used = UINT64_C(-1);
 
         rest_buffer->next = gridftp_op_arg->free_buffers;
         gridftp_op_arg->free_buffers = rest_buffer;
     }
     else
     {
-        /* Add it to the pending buffer list (in order) */
-        tmp = gridftp_op_arg->pending_buffers;
-        prev_next = &gridftp_op_arg->pending_buffers;
-        while (tmp != NULL)
-        {
-            if ((tmp->transfer_offset + tmp->buffer_used)
-                        <= rest_buffer->transfer_offset)
-            {
-                prev_next = &tmp->next;
-                tmp = tmp->next;
-            }
-            else
-            {
-                break;
-            }
-        }
-        /* tmp is the first buffer in pending that starts after rest_buffer 
-         * (may be null) */
-        rest_buffer->next = tmp;
-        if (tmp == NULL)
+        /* Add it to the pending buffer heap */
+        result = globus_i_dsi_rest_buffer_heap_push(
+                gridftp_op_arg,
+                rest_buffer);
+        if (result != GLOBUS_SUCCESS)
         {
-            gridftp_op_arg->pending_buffers_last = &rest_buffer->next;
+            gridftp_op_arg->result = result;
+            gridftp_op_arg->eof = true;
+            goto bad_read;
         }
 
-        *prev_next = rest_buffer;
-
         signal = true;
     }
 
@@ -346,24 +293,12 @@ globus_l_dsi_rest_gridftp_read_callback(
         globus_cond_signal(&gridftp_op_arg->cond);
     }
 
-    if (GlobusDebugTrue(GLOBUS_DSI_REST, GLOBUS_DSI_REST_TRACE))
-    {
-        int                             currently_pending = 0;
-        globus_off_t                    bytes_pending = 0;
-
-        globus_l_dsi_rest_count_buffers(
-                gridftp_op_arg->pending_buffers,
-                &currently_pending,
-                NULL,
-                &bytes_pending);
-
-        GlobusDsiRestTrace(
-                "op=%p currently_pending=%d bytes_pending=%"GLOBUS_OFF_T_FORMAT" end_offset=%"GLOBUS_OFF_T_FORMAT"\n",
-                (void *) gridftp_op_arg->op,
-                currently_pending,
-                bytes_pending,
-                gridftp_op_arg->end_offset);
-    }
+    GlobusDsiRestTrace(
+            "op=%p currently_pending=%zu bytes_pending=%"GLOBUS_OFF_T_FORMAT" end_offset=%"GLOBUS_OFF_T_FORMAT"\n",
+            (void *) gridftp_op_arg->op,
+            gridftp_op_arg->pending_heap_count,
+            gridftp_op_arg->pending_bytes,
+            gridftp_op_arg->end_offset);
     globus_mutex_unlock(&gridftp_op_arg->mutex);
 
     GlobusDsiRestExit();
@@ -391,9 +326,7 @@ globus_l_dsi_rest_write_register_reads(
 {
     globus_i_dsi_rest_buffer_t         *buffer;
     globus_size_t                       optimal_blocksize;
-    globus_off_t                        bytes_registered = 0;
     int                                 optimal_concurrency;
-    int                                 currently_registered;
     globus_result_t                     result = GLOBUS_SUCCESS;
 
     GlobusDsiRestEnter();
@@ -401,17 +334,11 @@ globus_l_dsi_rest_write_register_reads(
 
     if (gridftp_op_arg->result == GLOBUS_SUCCESS && !gridftp_op_arg->eof)
     {
-        globus_l_dsi_rest_count_buffers(
-                gridftp_op_arg->registered_buffers,
-                &currently_registered,
-                &bytes_registered,
-                NULL);
-
         GlobusDsiRestTrace(
                 "op=%p currently_registered=%d bytes_registered=%"GLOBUS_OFF_T_FORMAT" end_offset=%"GLOBUS_OFF_T_FORMAT"\n",
                 (void *) gridftp_op_arg->op,
-                currently_registered,
-                bytes_registered,
+                gridftp_op_arg->registered_buffers_count,
+                gridftp_op_arg->registered_bytes,
                 gridftp_op_arg->end_offset);
 
         /* Reads still might be useful */
@@ -428,7 +355,7 @@ globus_l_dsi_rest_write_register_reads(
                 (size_t) optimal_blocksize,
                 optimal_concurrency);
 
-        for (int i = currently_registered; i < optimal_concurrency; i++)
+        while (gridftp_op_arg->registered_buffers_count < optimal_concurrency)
         {
             globus_off_t                this_read = 0;
             globus_off_t                remaining = optimal_blocksize;
@@ -436,12 +363,15 @@ globus_l_dsi_rest_write_register_reads(
             if (gridftp_op_arg->end_offset != (globus_off_t)-1)
             {
                 /* DSI requested partial transfer. This only works 
-                 * if the DSI forces ordering on the read callbacks
+                 * if the DSI forces ordering on the read callbacks.
+                 * Data already read but not yet sent counts as well as
+                 * data in outstanding reads.
                  */
                 remaining = gridftp_op_arg->end_offset
                         - gridftp_op_arg->offset
-                        - bytes_registered;
-                if (remaining == 0)
+                        - gridftp_op_arg->pending_bytes
+                        - gridftp_op_arg->registered_bytes;
+                if (remaining <= 0)
                 {
                     break;
                 }
@@ -452,8 +382,11 @@ globus_l_dsi_rest_write_register_reads(
 
             if (buffer == NULL)
             {
-                result = GlobusDsiRestErrorMemory();
-
+                if (gridftp_op_arg->registered_buffers_count == 0)
+                {
+                    result = GlobusDsiRestErrorMemory();
+                }
+                /* Otherwise wait for a registered buffer to come back */
                 goto buffer_fail;
             }
             buffer->transfer_offset = (uint64_t) -1;
@@ -476,6 +409,8 @@ globus_l_dsi_rest_write_register_reads(
                     (void *) buffer->buffer,
                     this_read);
 
+            /* The read callback uses this to update registered_bytes */
+            buffer->buffer_used = this_read;
             result = globus_gridftp_server_register_read(
                     gridftp_op_arg->op,
                     buffer->buffer,
@@ -484,16 +419,14 @@ globus_l_dsi_rest_write_register_reads(
                     gridftp_op_arg);
             if (result != GLOBUS_SUCCESS)
             {
+                buffer->buffer_used = 0;
                 buffer->next = gridftp_op_arg->free_buffers;
                 gridftp_op_arg->free_buffers = buffer;
                 goto register_fail;
             }
 
-            bytes_registered += this_read;
-
-            buffer->next = gridftp_op_arg->registered_buffers;
-            gridftp_op_arg->registered_buffers = buffer;
-
+            gridftp_op_arg->registered_buffers_count++;
+            gridftp_op_arg->registered_bytes += this_read;
         }
     }
 
@@ -513,7 +446,8 @@ globus_l_dsi_rest_is_transfer_offset_ready(
     bool                                b;
     
     GlobusDsiRestEnter();
-    dsi_rest_buffer = gridftp_op_arg->pending_buffers;
+    dsi_rest_buffer = (gridftp_op_arg->pending_heap_count > 0)
+            ? gridftp_op_arg->pending_heap[0] : NULL;
 
     b = (dsi_rest_buffer != NULL) &&
            (dsi_rest_buffer->transfer_offset == gridftp_op_arg->offset);
@@ -532,44 +466,12 @@ globus_l_dsi_rest_is_reading_complete(
     bool                                b;
     GlobusDsiRestEnter();
 
-    b = gridftp_op_arg->eof && (gridftp_op_arg->registered_buffers == NULL);
+    b = gridftp_op_arg->eof && (gridftp_op_arg->registered_buffers_count == 0);
 
     GlobusDsiRestExitBool(b);
     return b;
 }
 /* globus_l_dsi_rest_is_reading_complete() */
 
-static
-void
-globus_l_dsi_rest_count_buffers(
-    globus_i_dsi_rest_buffer_t         *buffer,
-    int                                *currentp,
-    globus_off_t                       *bytes_availablep,
-    globus_off_t                       *bytes_usedp)
-{
-    int                                 current = 0;
-    globus_off_t                        bytes_available = 0;
-    globus_off_t                        bytes_used = 0;
-
-    while (buffer != NULL)
-    {
-        current++;
-        bytes_available += buffer->buffer_len - buffer->buffer_used;
-        bytes_used += buffer->buffer_used;
-
-        buffer = buffer->next;
-    }
-    *currentp = current;
-    if (bytes_availablep != NULL)
-    {
-        *bytes_availablep = bytes_available;
-    }
-    if (bytes_usedp != NULL)
-    {
-        *bytes_usedp = bytes_used;
-    }
-}
-/* globus_l_dsi_rest_count_buffers() */
-
 globus_dsi_rest_write_t const           globus_dsi_rest_write_gridftp_op
                                       = globus_l_dsi_rest_write_gridftp_op;
@@ -0,0 +1,752 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file write_gridftp_op_parallel.c GridFTP DSI REST Parallel Part Upload
+ * @details
+ *     Data read from the GridFTP data channels is copied into fixed-size
+ *     parts keyed by offset. As soon as a part is full it is uploaded in a
+ *     request of its own, so data arriving out of order from parallel
+ *     streams is not held back waiting for the next offset in sequence.
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+#include "globus_gridftp_server.h"
+
+/**
+ * @brief Part upload state
+ */
+typedef
+struct globus_l_dsi_rest_upload_part_s
+{
+    /* Passed to the application's callbacks, so must be first */
+    globus_dsi_rest_part_t              part;
+    struct globus_l_dsi_rest_upload_s  *upload;
+    /* From the buffer pool, NULL once the part is uploaded */
+    globus_i_dsi_rest_buffer_t         *buffer;
+    globus_off_t                        filled;
+    globus_dsi_rest_write_block_arg_t   write_block;
+    struct globus_l_dsi_rest_upload_part_s
+                                       *next_ready;
+}
+globus_l_dsi_rest_upload_part_t;
+
+/**
+ * @brief Parallel upload state
+ */
+typedef
+struct globus_l_dsi_rest_upload_s
+{
+    globus_mutex_t                      mutex;
+    globus_cond_t                       cond;
+    globus_result_t                     result;
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg;
+    const globus_dsi_rest_part_callbacks_t
+                                       *callbacks;
+    globus_off_t                        part_size;
+    int                                 max_streams;
+
+    /* Bytes asked for in register_read calls which haven't come back short */
+    globus_off_t                        bytes_requested;
+    int                                 reads_registered;
+    bool                                eof;
+    globus_i_dsi_rest_buffer_t         *free_buffers;
+
+    /* Indexed by part number, NULL until data for the part arrives */
+    globus_l_dsi_rest_upload_part_t   **parts;
+    size_t                              part_count;
+    size_t                              parts_alloc;
+    /* Full parts which are waiting to upload or uploading */
+    int                                 parts_queued;
+    int                                 parts_uploading;
+    globus_l_dsi_rest_upload_part_t    *ready;
+    globus_l_dsi_rest_upload_part_t   **ready_last;
+}
+globus_l_dsi_rest_upload_t;
+
+static
+void
+globus_l_dsi_rest_upload_error(
+    globus_l_dsi_rest_upload_t         *upload,
+    globus_result_t                     result)
+{
+    if (result != GLOBUS_SUCCESS && upload->result == GLOBUS_SUCCESS)
+    {
+        upload->result = result;
+    }
+}
+/* globus_l_dsi_rest_upload_error() */
+
+static
+bool
+globus_l_dsi_rest_upload_reading_done(
+    const globus_l_dsi_rest_upload_t   *upload)
+{
+    return upload->eof
+        || upload->result != GLOBUS_SUCCESS
+        || (upload->gridftp_op_arg->length != (globus_off_t) -1
+            && upload->bytes_requested == upload->gridftp_op_arg->length);
+}
+/* globus_l_dsi_rest_upload_reading_done() */
+
+static
+void
+globus_l_dsi_rest_upload_part_ready(
+    globus_l_dsi_rest_upload_t         *upload,
+    globus_l_dsi_rest_upload_part_t    *upload_part)
+{
+    upload_part->next_ready = NULL;
+    *upload->ready_last = upload_part;
+    upload->ready_last = &upload_part->next_ready;
+    upload->parts_queued++;
+}
+/* globus_l_dsi_rest_upload_part_ready() */
+
+/**
+ * @brief Find or create the part containing offset
+ * @details
+ *     Called with the upload mutex locked. The part's buffer is taken from
+ *     the buffer pool with the part, and put back once its upload is
+ *     complete. The data for it has already arrived, so the buffer is
+ *     forced past the pool's budget if need be; register_reads() bounds
+ *     how many parts are waiting instead.
+ */
+static
+globus_l_dsi_rest_upload_part_t *
+globus_l_dsi_rest_upload_part_get(
+    globus_l_dsi_rest_upload_t         *upload,
+    globus_off_t                        offset)
+{
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg = upload->gridftp_op_arg;
+    globus_l_dsi_rest_upload_part_t    *upload_part = NULL;
+    size_t                              part_number;
+    globus_off_t                        part_offset, part_length;
+
+    part_number = (offset - gridftp_op_arg->offset) / upload->part_size;
+    if (part_number >= upload->parts_alloc)
+    {
+        size_t                          new_alloc = upload->parts_alloc * 2;
+        globus_l_dsi_rest_upload_part_t
+                                      **new_parts;
+
+        if (new_alloc <= part_number)
+        {
+            new_alloc = part_number + 1;
+        }
+        new_parts = realloc(upload->parts, new_alloc * sizeof(*new_parts));
+        if (new_parts == NULL)
+        {
+            goto fail;
+        }
+        memset(new_parts + upload->parts_alloc, 0,
+                (new_alloc - upload->parts_alloc) * sizeof(*new_parts));
+        upload->parts = new_parts;
+        upload->parts_alloc = new_alloc;
+    }
+    if (part_number >= upload->part_count)
+    {
+        upload->part_count = part_number + 1;
+    }
+    upload_part = upload->parts[part_number];
+    if (upload_part != NULL)
+    {
+        goto done;
+    }
+
+    part_offset = gridftp_op_arg->offset + part_number * upload->part_size;
+    part_length = upload->part_size;
+    if (gridftp_op_arg->length != (globus_off_t) -1
+        && part_offset + part_length
+                > gridftp_op_arg->offset + gridftp_op_arg->length)
+    {
+        part_length = gridftp_op_arg->offset + gridftp_op_arg->length
+                - part_offset;
+    }
+    upload_part = malloc(sizeof(globus_l_dsi_rest_upload_part_t));
+    if (upload_part == NULL)
+    {
+        goto fail;
+    }
+    *upload_part = (globus_l_dsi_rest_upload_part_t)
+    {
+        .part =
+        {
+            .part_number = part_number,
+            .offset = part_offset,
+            .length = part_length,
+        },
+        .upload = upload,
+        .buffer = globus_i_dsi_rest_buffer_pool_get(part_length, true),
+    };
+    if (upload_part->buffer == NULL)
+    {
+        free(upload_part);
+        upload_part = NULL;
+        goto fail;
+    }
+    upload->parts[part_number] = upload_part;
+
+done:
+fail:
+    return upload_part;
+}
+/* globus_l_dsi_rest_upload_part_get() */
+
+static
+void
+globus_l_dsi_rest_upload_read_callback(
+    globus_gfs_operation_t              op,
+    globus_result_t                     result,
+    globus_byte_t                      *buffer,
+    globus_size_t                       nbytes,
+    globus_off_t                        offset,
+    globus_bool_t                       eof,
+    void                               *user_arg)
+{
+    globus_l_dsi_rest_upload_t         *upload = user_arg;
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg = upload->gridftp_op_arg;
+    globus_i_dsi_rest_buffer_t         *rest_buffer;
+    globus_off_t                        copied = 0;
+
+    GlobusDsiRestEnter();
+
+    GlobusDsiRestDebug(
+        "op=%p "
+        "result=%#x "
+        "nbytes=%zu "
+        "offset=%"GLOBUS_OFF_T_FORMAT" "
+        "eof=%d\n",
+        (void *) op,
+        result,
+        (size_t) nbytes,
+        offset,
+        (int) eof);
+
+    rest_buffer = GlobusDsiRestBufferFromData(buffer);
+
+    globus_mutex_lock(&upload->mutex);
+
+    upload->reads_registered--;
+    upload->bytes_requested -= rest_buffer->buffer_used - nbytes;
+    upload->eof |= eof;
+    gridftp_op_arg->eof |= eof;
+    globus_l_dsi_rest_upload_error(upload, result);
+
+    if (nbytes > 0)
+    {
+        globus_gridftp_server_update_bytes_recvd(op, nbytes);
+    }
+    if (upload->result == GLOBUS_SUCCESS
+        && nbytes > 0
+        && (offset < gridftp_op_arg->offset
+            || (gridftp_op_arg->length != (globus_off_t) -1
+                && offset + nbytes
+                        > gridftp_op_arg->offset + gridftp_op_arg->length)))
+    {
+        static const char               msg[] = "data outside of range";
+
+        globus_l_dsi_rest_upload_error(
+                upload,
+                GlobusDsiRestErrorUnexpectedData(msg, sizeof(msg) - 1));
+    }
+
+    /* Copy the data into each part it overlaps */
+    while (upload->result == GLOBUS_SUCCESS && copied < nbytes)
+    {
+        globus_l_dsi_rest_upload_part_t*upload_part;
+        globus_off_t                    part_offset, to_copy;
+
+        upload_part = globus_l_dsi_rest_upload_part_get(
+                upload, offset + copied);
+        if (upload_part == NULL)
+        {
+            globus_l_dsi_rest_upload_error(upload, GlobusDsiRestErrorMemory());
+            break;
+        }
+        part_offset = offset + copied - upload_part->part.offset;
+        to_copy = upload_part->part.length - part_offset;
+        if (to_copy > nbytes - copied)
+        {
+            to_copy = nbytes - copied;
+        }
+        memcpy(upload_part->buffer->buffer + part_offset,
+                buffer + copied,
+                to_copy);
+        upload_part->filled += to_copy;
+        copied += to_copy;
+
+        if (upload_part->filled == upload_part->part.length)
+        {
+            globus_l_dsi_rest_upload_part_ready(upload, upload_part);
+        }
+    }
+
+    rest_buffer->buffer_used = 0;
+    rest_buffer->next = upload->free_buffers;
+    upload->free_buffers = rest_buffer;
+
+    globus_cond_signal(&upload->cond);
+    globus_mutex_unlock(&upload->mutex);
+
+    GlobusDsiRestExit();
+}
+/* globus_l_dsi_rest_upload_read_callback() */
+
+/**
+ * @brief Keep GridFTP reads registered
+ * @details
+ *     Called with the upload mutex locked. Stops registering reads while
+ *     too many full parts are waiting to be uploaded, so that slow uploads
+ *     hold back the data channel instead of using unbounded memory. Parts
+ *     which are only partly filled don't count, as they may need data from
+ *     reads which are not registered yet.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_upload_register_reads(
+    globus_l_dsi_rest_upload_t         *upload)
+{
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg = upload->gridftp_op_arg;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_size_t                       blocksize;
+    int                                 optimal_concurrency;
+
+    GlobusDsiRestEnter();
+
+    globus_gridftp_server_get_block_size(gridftp_op_arg->op, &blocksize);
+    globus_gridftp_server_get_optimal_concurrency(
+            gridftp_op_arg->op,
+            &optimal_concurrency);
+
+    while (!globus_l_dsi_rest_upload_reading_done(upload)
+        && upload->reads_registered < optimal_concurrency
+        && upload->parts_queued < 2 * upload->max_streams)
+    {
+        globus_i_dsi_rest_buffer_t     *buffer = upload->free_buffers;
+        globus_off_t                    this_read = blocksize;
+
+        if (gridftp_op_arg->length != (globus_off_t) -1
+            && this_read > gridftp_op_arg->length - upload->bytes_requested)
+        {
+            this_read = gridftp_op_arg->length - upload->bytes_requested;
+        }
+        if (buffer == NULL)
+        {
+            buffer = globus_i_dsi_rest_buffer_pool_get(
+                    blocksize,
+                    upload->reads_registered == 0);
+            if (buffer == NULL)
+            {
+                if (upload->reads_registered == 0)
+                {
+                    result = GlobusDsiRestErrorMemory();
+                }
+                /* Otherwise wait for a registered read to complete */
+                break;
+            }
+        }
+        else
+        {
+            upload->free_buffers = buffer->next;
+        }
+        buffer->next = NULL;
+        buffer->buffer_used = this_read;
+        buffer->buffer_consumed = 0;
+        buffer->transfer_offset = UINT64_C(-1);
+
+        result = globus_gridftp_server_register_read(
+                gridftp_op_arg->op,
+                buffer->buffer,
+                this_read,
+                globus_l_dsi_rest_upload_read_callback,
+                upload);
+        if (result != GLOBUS_SUCCESS)
+        {
+            buffer->next = upload->free_buffers;
+            upload->free_buffers = buffer;
+            break;
+        }
+        upload->reads_registered++;
+        upload->bytes_requested += this_read;
+    }
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_upload_register_reads() */
+
+static
+globus_result_t
+globus_l_dsi_rest_upload_part_response(
+    void                               *response_callback_arg,
+    int                                 response_code,
+    const char                         *response_status,
+    const globus_dsi_rest_key_array_t  *response_headers)
+{
+    globus_l_dsi_rest_upload_part_t    *upload_part = response_callback_arg;
+    const globus_dsi_rest_part_callbacks_t
+                                       *callbacks = upload_part->upload->callbacks;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (callbacks->part_response != NULL)
+    {
+        result = callbacks->part_response(
+                callbacks->callback_arg,
+                &upload_part->part,
+                response_code,
+                response_headers);
+    }
+    else if (response_code < 200 || response_code > 299)
+    {
+        result = GlobusDsiRestErrorUnexpectedResponse(response_code);
+    }
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_l_dsi_rest_upload_part_response() */
+
+static
+void
+globus_l_dsi_rest_upload_part_complete(
+    void                               *complete_callback_arg,
+    globus_result_t                     result)
+{
+    globus_l_dsi_rest_upload_part_t    *upload_part = complete_callback_arg;
+    globus_l_dsi_rest_upload_t         *upload = upload_part->upload;
+
+    GlobusDsiRestEnter();
+
+    GlobusDsiRestDebug(
+        "part_number=%"PRIu64" "
+        "offset=%"GLOBUS_OFF_T_FORMAT" "
+        "result=%#x\n",
+        upload_part->part.part_number,
+        upload_part->part.offset,
+        result);
+
+    globus_mutex_lock(&upload->mutex);
+    globus_l_dsi_rest_upload_error(upload, result);
+    globus_i_dsi_rest_buffer_pool_put(upload_part->buffer);
+    upload_part->buffer = NULL;
+    upload->parts_queued--;
+    upload->parts_uploading--;
+    globus_cond_signal(&upload->cond);
+    globus_mutex_unlock(&upload->mutex);
+
+    GlobusDsiRestExit();
+}
+/* globus_l_dsi_rest_upload_part_complete() */
+
+/**
+ * @brief Start uploads for parts which are full
+ * @details
+ *     Called with the upload mutex locked. The mutex is released while the
+ *     application's part_start callback is called and the request is
+ *     registered.
+ */
+static
+void
+globus_l_dsi_rest_upload_start_parts(
+    globus_l_dsi_rest_upload_t         *upload)
+{
+    const globus_dsi_rest_part_callbacks_t
+                                       *callbacks = upload->callbacks;
+
+    GlobusDsiRestEnter();
+
+    while (upload->ready != NULL
+        && upload->result == GLOBUS_SUCCESS
+        && upload->parts_uploading < upload->max_streams)
+    {
+        globus_l_dsi_rest_upload_part_t*upload_part = upload->ready;
+        globus_result_t                 result;
+
+        upload->ready = upload_part->next_ready;
+        if (upload->ready == NULL)
+        {
+            upload->ready_last = &upload->ready;
+        }
+        upload->parts_uploading++;
+        globus_mutex_unlock(&upload->mutex);
+
+        upload_part->write_block = (globus_dsi_rest_write_block_arg_t)
+        {
+            .block_data = upload_part->buffer->buffer,
+            .block_len = upload_part->part.length,
+        };
+        result = callbacks->part_start(
+                callbacks->callback_arg,
+                &upload_part->part);
+        if (result == GLOBUS_SUCCESS)
+        {
+            result = globus_dsi_rest_request(
+                    upload_part->part.method,
+                    upload_part->part.uri,
+                    &upload_part->part.query_parameters,
+                    &upload_part->part.headers,
+                    &(globus_dsi_rest_callbacks_t)
+                    {
+                        .data_write_callback = globus_dsi_rest_write_block,
+                        .data_write_callback_arg = &upload_part->write_block,
+                        .response_callback =
+                                globus_l_dsi_rest_upload_part_response,
+                        .response_callback_arg = upload_part,
+                        .complete_callback =
+                                globus_l_dsi_rest_upload_part_complete,
+                        .complete_callback_arg = upload_part,
+                    });
+        }
+        globus_mutex_lock(&upload->mutex);
+        if (result != GLOBUS_SUCCESS)
+        {
+            globus_l_dsi_rest_upload_error(upload, result);
+            globus_i_dsi_rest_buffer_pool_put(upload_part->buffer);
+            upload_part->buffer = NULL;
+            upload->parts_queued--;
+            upload->parts_uploading--;
+        }
+    }
+
+    GlobusDsiRestExit();
+}
+/* globus_l_dsi_rest_upload_start_parts() */
+
+/**
+ * @brief Queue the last, short part once all data has been read
+ * @details
+ *     Called with the upload mutex locked. When the length of the transfer
+ *     wasn't known, the last part is only known to be complete at eof. In
+ *     either case every part before the last must be full by then, and if
+ *     the length was known, the parts must add up to it, so that an upload
+ *     cut short by an early eof is not committed as a success.
+ */
+static
+void
+globus_l_dsi_rest_upload_finish_parts(
+    globus_l_dsi_rest_upload_t         *upload)
+{
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg = upload->gridftp_op_arg;
+    globus_l_dsi_rest_upload_part_t    *last_part;
+    globus_off_t                        total;
+    static const char                   msg[] = "missing data before eof";
+
+    GlobusDsiRestEnter();
+
+    if (upload->part_count == 0)
+    {
+        if (gridftp_op_arg->length > 0)
+        {
+            goto missing;
+        }
+        goto done;
+    }
+    for (size_t i = 0; i + 1 < upload->part_count; i++)
+    {
+        if (upload->parts[i] == NULL
+            || upload->parts[i]->filled != upload->parts[i]->part.length)
+        {
+            goto missing;
+        }
+    }
+    last_part = upload->parts[upload->part_count - 1];
+    total = last_part->part.offset - gridftp_op_arg->offset
+            + last_part->filled;
+    if (gridftp_op_arg->length != (globus_off_t) -1)
+    {
+        if (total != gridftp_op_arg->length)
+        {
+            goto missing;
+        }
+        /* The last part is full, so it has already been queued */
+        goto done;
+    }
+    if (last_part->filled != last_part->part.length)
+    {
+        last_part->part.length = last_part->filled;
+        globus_l_dsi_rest_upload_part_ready(upload, last_part);
+    }
+    goto done;
+
+missing:
+    globus_l_dsi_rest_upload_error(
+            upload,
+            GlobusDsiRestErrorUnexpectedData(msg, sizeof(msg) - 1));
+done:
+    GlobusDsiRestExit();
+}
+/* globus_l_dsi_rest_upload_finish_parts() */
+
+globus_result_t
+globus_dsi_rest_write_gridftp_op_parallel(
+    globus_dsi_rest_gridftp_op_arg_t   *gridftp_op_arg,
+    globus_off_t                        part_size,
+    int                                 max_streams,
+    const globus_dsi_rest_part_callbacks_t
+                                       *part_callbacks)
+{
+    globus_l_dsi_rest_upload_t          upload;
+    globus_dsi_rest_part_t            **parts = NULL;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    bool                                finished = false;
+    int                                 rc;
+
+    GlobusDsiRestEnter();
+
+    if (gridftp_op_arg == NULL
+        || gridftp_op_arg->offset < 0
+        || (gridftp_op_arg->length < 0
+            && gridftp_op_arg->length != (globus_off_t) -1)
+        || part_callbacks == NULL
+        || part_callbacks->part_start == NULL
+        || part_callbacks->commit == NULL)
+    {
+        result = GlobusDsiRestErrorParameter();
+        goto bad_param;
+    }
+    if (part_size <= 0)
+    {
+        globus_size_t                   blocksize;
+
+        globus_gridftp_server_get_block_size(gridftp_op_arg->op, &blocksize);
+        part_size = blocksize;
+    }
+    if (max_streams <= 0)
+    {
+        globus_gridftp_server_get_optimal_concurrency(
+                gridftp_op_arg->op,
+                &max_streams);
+        if (max_streams <= 0)
+        {
+            max_streams = 1;
+        }
+    }
+
+    upload = (globus_l_dsi_rest_upload_t)
+    {
+        .gridftp_op_arg = gridftp_op_arg,
+        .callbacks = part_callbacks,
+        .part_size = part_size,
+        .max_streams = max_streams,
+        .ready_last = &upload.ready,
+    };
+    gridftp_op_arg->eof = false;
+
+    rc = globus_mutex_init(&upload.mutex, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        result = GlobusDsiRestErrorThreadFail(rc);
+        goto mutex_init_fail;
+    }
+    rc = globus_cond_init(&upload.cond, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        result = GlobusDsiRestErrorThreadFail(rc);
+        goto cond_init_fail;
+    }
+
+    globus_mutex_lock(&upload.mutex);
+    while (true)
+    {
+        globus_l_dsi_rest_upload_error(
+                &upload,
+                globus_l_dsi_rest_upload_register_reads(&upload));
+
+        if (!finished
+            && upload.result == GLOBUS_SUCCESS
+            && upload.reads_registered == 0
+            && globus_l_dsi_rest_upload_reading_done(&upload))
+        {
+            globus_l_dsi_rest_upload_finish_parts(&upload);
+            finished = true;
+        }
+        globus_l_dsi_rest_upload_start_parts(&upload);
+
+        if (upload.reads_registered == 0
+            && upload.parts_uploading == 0
+            && (upload.result != GLOBUS_SUCCESS
+                || (finished && upload.ready == NULL)))
+        {
+            break;
+        }
+        GlobusDsiRestDebug(
+            "waiting: "
+            "op=%p "
+            "reads_registered=%d "
+            "parts_queued=%d "
+            "parts_uploading=%d\n",
+            (void *) gridftp_op_arg->op,
+            upload.reads_registered,
+            upload.parts_queued,
+            upload.parts_uploading);
+        globus_cond_wait(&upload.cond, &upload.mutex);
+    }
+    globus_mutex_unlock(&upload.mutex);
+
+    if (upload.part_count > 0)
+    {
+        parts = calloc(upload.part_count, sizeof(globus_dsi_rest_part_t *));
+        if (parts == NULL)
+        {
+            globus_l_dsi_rest_upload_error(
+                    &upload,
+                    GlobusDsiRestErrorMemory());
+            upload.part_count = 0;
+        }
+    }
+    for (size_t i = 0; i < upload.part_count; i++)
+    {
+        if (upload.parts[i] != NULL)
+        {
+            parts[i] = &upload.parts[i]->part;
+        }
+    }
+    result = part_callbacks->commit(
+            part_callbacks->callback_arg,
+            parts,
+            upload.part_count,
+            upload.result);
+
+    for (size_t i = 0; i < upload.parts_alloc; i++)
+    {
+        if (upload.parts[i] != NULL)
+        {
+            globus_i_dsi_rest_buffer_pool_put(upload.parts[i]->buffer);
+            free(upload.parts[i]);
+        }
+    }
+    free(upload.parts);
+    free(parts);
+    while (upload.free_buffers != NULL)
+    {
+        globus_i_dsi_rest_buffer_t     *next = upload.free_buffers->next;
+
+        globus_i_dsi_rest_buffer_pool_put(upload.free_buffers);
+        upload.free_buffers = next;
+    }
+    globus_cond_destroy(&upload.cond);
+cond_init_fail:
+    globus_mutex_destroy(&upload.mutex);
+mutex_init_fail:
+bad_param:
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_dsi_rest_write_gridftp_op_parallel() */
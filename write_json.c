@@ -17,11 +17,490 @@
 #ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
 /**
  * @file write_json.c GridFTP DSI REST Write JSON callback
+ * @details
+ *     The json is encoded as libcurl asks for data, walking the value with
+ *     a stack of the containers being written, rather than being dumped to
+ *     a string before the request starts. String contents are escaped
+ *     straight into libcurl's buffer; punctuation, numbers, and escape
+ *     sequences which don't fit are held in a small pending buffer until
+ *     the next call. The output matches json_dumps() with JSON_COMPACT.
+ *     The length is found by running the same encoder, only when a
+ *     Content-Length is wanted. Its output is kept if the body is small
+ *     enough to be sent with CURLOPT_POSTFIELDS, and discarded otherwise.
  */
 #endif
 
 #include "globus_i_dsi_rest.h"
 
+void
+globus_i_dsi_rest_write_json_init(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    json_t                             *json)
+{
+    *jdata = (globus_i_dsi_rest_write_json_arg_t)
+    {
+        .json = json,
+    };
+}
+/* globus_i_dsi_rest_write_json_init() */
+
+void
+globus_i_dsi_rest_write_json_destroy(
+    globus_i_dsi_rest_write_json_arg_t *jdata)
+{
+    free(jdata->block.block_data);
+    jdata->block.block_data = NULL;
+    free(jdata->stack);
+    jdata->stack = NULL;
+}
+/* globus_i_dsi_rest_write_json_destroy() */
+
+static
+void
+globus_l_dsi_rest_write_json_push(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    const char                         *s,
+    size_t                              len)
+{
+    memcpy(jdata->pending + jdata->pending_len, s, len);
+    jdata->pending_len += len;
+}
+/* globus_l_dsi_rest_write_json_push() */
+
+static
+void
+globus_l_dsi_rest_write_json_string_start(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    const char                         *string,
+    size_t                              string_len,
+    bool                                key)
+{
+    globus_l_dsi_rest_write_json_push(jdata, "\"", 1);
+    jdata->string = string;
+    jdata->string_len = string_len;
+    jdata->string_pos = 0;
+    jdata->string_key = key;
+}
+/* globus_l_dsi_rest_write_json_string_start() */
+
+/*
+ * Escape as much of the current string as fits in buffer, in the same way
+ * as jansson does without JSON_ENSURE_ASCII or JSON_ESCAPE_SLASH. Returns
+ * the number of bytes written.
+ */
+static
+size_t
+globus_l_dsi_rest_write_json_string(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    char                               *buffer,
+    size_t                              buffer_length)
+{
+    const unsigned char                *string
+                                      = (const unsigned char *) jdata->string;
+    size_t                              n = 0;
+
+    while (jdata->string_pos < jdata->string_len && n < buffer_length)
+    {
+        size_t                          run = jdata->string_pos;
+        size_t                          run_end = jdata->string_pos
+                                                + (buffer_length - n);
+        char                            escape[8];
+        size_t                          escape_len = 2;
+        unsigned char                   c;
+
+        if (run_end > jdata->string_len)
+        {
+            run_end = jdata->string_len;
+        }
+        while (run < run_end
+            && string[run] >= 0x20
+            && string[run] != '"'
+            && string[run] != '\\')
+        {
+            run++;
+        }
+        memcpy(buffer + n, string + jdata->string_pos, run - jdata->string_pos);
+        n += run - jdata->string_pos;
+        jdata->string_pos = run;
+
+        if (run == run_end)
+        {
+            continue;
+        }
+
+        c = string[jdata->string_pos++];
+        escape[0] = '\\';
+        switch (c)
+        {
+            case '"':  escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            default:
+                escape_len = sprintf(escape, "\\u%04X", c);
+                break;
+        }
+        if (escape_len <= buffer_length - n)
+        {
+            memcpy(buffer + n, escape, escape_len);
+            n += escape_len;
+        }
+        else
+        {
+            globus_l_dsi_rest_write_json_push(jdata, escape, escape_len);
+            goto done;
+        }
+    }
+    if (jdata->string_pos == jdata->string_len)
+    {
+        globus_l_dsi_rest_write_json_push(
+                jdata, "\":", jdata->string_key ? 2 : 1);
+        jdata->string = NULL;
+    }
+
+done:
+    return n;
+}
+/* globus_l_dsi_rest_write_json_string() */
+
+static
+globus_result_t
+globus_l_dsi_rest_write_json_value(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    json_t                             *value)
+{
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    switch (json_typeof(value))
+    {
+        case JSON_OBJECT:
+        case JSON_ARRAY:
+            if (jdata->depth == jdata->stack_len)
+            {
+                size_t                  new_len = jdata->stack_len
+                                                ? 2 * jdata->stack_len : 8;
+                globus_i_dsi_rest_write_json_frame_t
+                                       *resized;
+
+                resized = realloc(jdata->stack, new_len * sizeof(*resized));
+                if (resized == NULL)
+                {
+                    result = GlobusDsiRestErrorMemory();
+                    goto done;
+                }
+                jdata->stack = resized;
+                jdata->stack_len = new_len;
+            }
+            jdata->stack[jdata->depth++] = (globus_i_dsi_rest_write_json_frame_t)
+            {
+                .container = value,
+                .iter = json_is_object(value) ? json_object_iter(value) : NULL,
+            };
+            globus_l_dsi_rest_write_json_push(
+                    jdata, json_is_object(value) ? "{" : "[", 1);
+            break;
+        case JSON_STRING:
+            globus_l_dsi_rest_write_json_string_start(
+                    jdata,
+                    json_string_value(value),
+                    json_string_length(value),
+                    false);
+            break;
+        case JSON_INTEGER:
+            jdata->pending_len += snprintf(
+                    jdata->pending + jdata->pending_len,
+                    sizeof(jdata->pending) - jdata->pending_len,
+                    "%" JSON_INTEGER_FORMAT,
+                    json_integer_value(value));
+            break;
+        case JSON_REAL:
+        {
+            char                       *real = jdata->pending
+                                             + jdata->pending_len;
+            char                       *exponent;
+            int                         len;
+
+            /* As jansson formats reals (jsonp_dtostr), whatever the locale */
+            len = snprintf(real,
+                    sizeof(jdata->pending) - jdata->pending_len - 2,
+                    "%.17g",
+                    json_real_value(value));
+            for (int i = 0; i < len; i++)
+            {
+                if (real[i] == ',')
+                {
+                    real[i] = '.';
+                }
+            }
+            if (strpbrk(real, ".e") == NULL)
+            {
+                strcpy(real + len, ".0");
+                len += 2;
+            }
+            else if ((exponent = strchr(real, 'e')) != NULL)
+            {
+                /* Drop the exponent's + sign and leading zeros: 1e20, 1e-5 */
+                char                   *start = exponent + 1;
+                char                   *end;
+
+                if (*start == '-')
+                {
+                    start++;
+                }
+                end = start;
+                if (*end == '+')
+                {
+                    end++;
+                }
+                while (*end == '0')
+                {
+                    end++;
+                }
+                memmove(start, end, real + len + 1 - end);
+                len -= end - start;
+            }
+            jdata->pending_len += len;
+            break;
+        }
+        case JSON_TRUE:
+            globus_l_dsi_rest_write_json_push(jdata, "true", 4);
+            break;
+        case JSON_FALSE:
+            globus_l_dsi_rest_write_json_push(jdata, "false", 5);
+            break;
+        case JSON_NULL:
+            globus_l_dsi_rest_write_json_push(jdata, "null", 4);
+            break;
+    }
+
+done:
+    return result;
+}
+/* globus_l_dsi_rest_write_json_value() */
+
+/*
+ * Move to the next part of the value: the root, a member name, an element,
+ * or the end of a container.
+ */
+static
+globus_result_t
+globus_l_dsi_rest_write_json_step(
+    globus_i_dsi_rest_write_json_arg_t *jdata)
+{
+    globus_i_dsi_rest_write_json_frame_t
+                                       *frame;
+    json_t                             *value;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    if (jdata->next_value != NULL)
+    {
+        value = jdata->next_value;
+        jdata->next_value = NULL;
+        result = globus_l_dsi_rest_write_json_value(jdata, value);
+        goto done;
+    }
+    if (!jdata->started)
+    {
+        jdata->started = true;
+        result = globus_l_dsi_rest_write_json_value(jdata, jdata->json);
+        goto done;
+    }
+    if (jdata->depth == 0)
+    {
+        jdata->done = true;
+        goto done;
+    }
+
+    frame = &jdata->stack[jdata->depth - 1];
+    if (json_is_object(frame->container))
+    {
+        const char                     *key;
+
+        if (frame->iter == NULL)
+        {
+            jdata->depth--;
+            globus_l_dsi_rest_write_json_push(jdata, "}", 1);
+            goto done;
+        }
+        if (frame->index++ > 0)
+        {
+            globus_l_dsi_rest_write_json_push(jdata, ",", 1);
+        }
+        key = json_object_iter_key(frame->iter);
+        jdata->next_value = json_object_iter_value(frame->iter);
+        frame->iter = json_object_iter_next(frame->container, frame->iter);
+        globus_l_dsi_rest_write_json_string_start(
+                jdata, key, strlen(key), true);
+    }
+    else
+    {
+        if (frame->index == json_array_size(frame->container))
+        {
+            jdata->depth--;
+            globus_l_dsi_rest_write_json_push(jdata, "]", 1);
+            goto done;
+        }
+        if (frame->index > 0)
+        {
+            globus_l_dsi_rest_write_json_push(jdata, ",", 1);
+        }
+        result = globus_l_dsi_rest_write_json_value(
+                jdata,
+                json_array_get(frame->container, frame->index++));
+    }
+
+done:
+    return result;
+}
+/* globus_l_dsi_rest_write_json_step() */
+
+static
+globus_result_t
+globus_l_dsi_rest_write_json_encode(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    char                               *buffer,
+    size_t                              buffer_length,
+    size_t                             *amount_copied)
+{
+    size_t                              n = 0;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    while (n < buffer_length)
+    {
+        if (jdata->pending_pos < jdata->pending_len)
+        {
+            size_t                      amt = jdata->pending_len
+                                            - jdata->pending_pos;
+
+            if (amt > buffer_length - n)
+            {
+                amt = buffer_length - n;
+            }
+            memcpy(buffer + n, jdata->pending + jdata->pending_pos, amt);
+            n += amt;
+            jdata->pending_pos += amt;
+            continue;
+        }
+        jdata->pending_pos = jdata->pending_len = 0;
+
+        if (jdata->string != NULL)
+        {
+            n += globus_l_dsi_rest_write_json_string(
+                    jdata, buffer + n, buffer_length - n);
+        }
+        else if (jdata->done)
+        {
+            break;
+        }
+        else
+        {
+            result = globus_l_dsi_rest_write_json_step(jdata);
+            if (result != GLOBUS_SUCCESS)
+            {
+                break;
+            }
+        }
+    }
+    *amount_copied = n;
+
+    return result;
+}
+/* globus_l_dsi_rest_write_json_encode() */
+
+/**
+ * @brief Compute the length of a JSON request body
+ * @details
+ *     Runs the encoder over the json to find the length of what
+ *     globus_dsi_rest_write_json() will send. If that is no more than
+ *     GLOBUS_DSI_REST_POSTFIELDS_MAX, the output is kept in jdata->block,
+ *     so that it is sent from there instead of being encoded again.
+ */
+globus_result_t
+globus_i_dsi_rest_write_json_length(
+    globus_i_dsi_rest_write_json_arg_t *jdata,
+    uint64_t                           *lengthp)
+{
+    globus_i_dsi_rest_write_json_arg_t  counter;
+    char                                scratch[4096];
+    char                               *kept = NULL;
+    size_t                              kept_len = 0;
+    bool                                keep;
+    size_t                              amt = 0;
+    uint64_t                            length = 0;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GlobusDsiRestEnter();
+
+    if (jdata->block.block_data != NULL)
+    {
+        length = jdata->block.block_len;
+        goto done;
+    }
+    keep = (globus_i_dsi_rest_postfields_max > 0);
+
+    globus_i_dsi_rest_write_json_init(&counter, jdata->json);
+    do
+    {
+        result = globus_l_dsi_rest_write_json_encode(
+                &counter, scratch, sizeof(scratch), &amt);
+        if (keep && length + amt
+                > (uint64_t) globus_i_dsi_rest_postfields_max)
+        {
+            /* Too large to send in one piece, so only count it */
+            free(kept);
+            kept = NULL;
+            keep = false;
+        }
+        if (keep && amt > 0)
+        {
+            if (length + amt > kept_len)
+            {
+                size_t                  new_len = kept_len ? 2 * kept_len
+                                                : sizeof(scratch);
+                char                   *resized;
+
+                if (new_len > (size_t) globus_i_dsi_rest_postfields_max)
+                {
+                    new_len = globus_i_dsi_rest_postfields_max;
+                }
+                resized = realloc(kept, new_len);
+                if (resized == NULL)
+                {
+                    result = GlobusDsiRestErrorMemory();
+                    break;
+                }
+                kept = resized;
+                kept_len = new_len;
+            }
+            memcpy(kept + length, scratch, amt);
+        }
+        length += amt;
+    }
+    while (result == GLOBUS_SUCCESS && amt > 0);
+    globus_i_dsi_rest_write_json_destroy(&counter);
+
+    if (result == GLOBUS_SUCCESS && kept != NULL)
+    {
+        jdata->block.block_data = kept;
+        jdata->block.block_len = length;
+        kept = NULL;
+    }
+    free(kept);
+
+done:
+    if (result == GLOBUS_SUCCESS)
+    {
+        *lengthp = length;
+    }
+
+    GlobusDsiRestExitResult(result);
+    return result;
+}
+/* globus_i_dsi_rest_write_json_length() */
+
 static
 globus_result_t
 globus_l_dsi_rest_write_json(
@@ -30,12 +509,21 @@ globus_l_dsi_rest_write_json(
     size_t                              buffer_length,
     size_t                             *amount_copied)
 {
+    globus_i_dsi_rest_write_json_arg_t *jdata = write_callback_arg;
     globus_result_t                     result;
 
     GlobusDsiRestEnter();
 
-    result = globus_dsi_rest_write_block(
-            write_callback_arg, buffer, buffer_length, amount_copied);
+    if (jdata->block.block_data != NULL)
+    {
+        result = globus_dsi_rest_write_block(
+                &jdata->block, buffer, buffer_length, amount_copied);
+    }
+    else
+    {
+        result = globus_l_dsi_rest_write_json_encode(
+                jdata, buffer, buffer_length, amount_copied);
+    }
 
     GlobusDsiRestExitResult(result);
 
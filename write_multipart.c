@@ -31,15 +31,6 @@ globus_l_dsi_rest_write_boundary(
     size_t                              boundary_length,
     size_t                             *amount_copied);
 
-static
-globus_result_t
-globus_l_dsi_rest_prepare_boundary(
-    const char                         *delimiter,
-    bool                                final,
-    globus_dsi_rest_key_array_t        *part_header,
-    char                              **boundaryp,
-    size_t                             *boundary_lengthp);
-
 
 static
 globus_result_t
@@ -74,7 +65,6 @@ globus_l_dsi_rest_write_multipart(
 
         if (state->current_boundary_offset == state->current_boundary_length)
         {
-            free(state->current_boundary);
             state->current_boundary = NULL;
             state->current_boundary_offset = 0;
             state->current_boundary_length = 0;
@@ -107,7 +97,8 @@ globus_l_dsi_rest_write_multipart(
                 bool                    final =
                         (state->part_index == state->num_parts-1);
 
-                result = globus_l_dsi_rest_prepare_boundary(
+                result = globus_i_dsi_rest_multipart_boundary_prepare(
+                        state->arena,
                         state->boundary,
                         final,
                         final
@@ -142,7 +133,6 @@ globus_l_dsi_rest_write_multipart(
 
                 if (state->current_boundary_offset == state->current_boundary_length)
                 {
-                    free(state->current_boundary);
                     state->current_boundary = NULL;
                     state->current_boundary_offset = 0;
                     state->current_boundary_length = 0;
@@ -181,84 +171,5 @@ globus_l_dsi_rest_write_boundary(
 }
 /* globus_l_dsi_rest_write_boundary() */
 
-static
-globus_result_t
-globus_l_dsi_rest_prepare_boundary(
-    const char                         *delimiter,
-    bool                                final,
-    globus_dsi_rest_key_array_t        *part_header,
-    char                              **boundaryp,
-    size_t                             *boundary_lengthp)
-{
-    globus_result_t                     result = GLOBUS_SUCCESS;
-    char                               *boundary = NULL;
-    char                               *p = NULL;
-    size_t                              boundary_length = 0;
-
-    GlobusDsiRestEnter();
-
-    if (!final)
-    {
-        boundary_length += 8 + strlen(delimiter);
-        if (part_header != NULL)
-        {
-            for (size_t i = 0; i < part_header->count; i++)
-            {
-                if (part_header->key_value[i].key != NULL
-                    && part_header->key_value[i].value != NULL)
-                {
-                    boundary_length += strlen(part_header->key_value[i].key);
-                    boundary_length += strlen(part_header->key_value[i].value);
-                    boundary_length += 4;
-                }
-            }
-        }
-        p = boundary = malloc(boundary_length + 1);
-        if (boundary == NULL)
-        {
-            result = GlobusDsiRestErrorMemory();
-
-            goto boundary_alloc_fail;
-        }
-        p[0] = 0;
-        p += sprintf(p, "\r\n--%s\r\n", delimiter);
-        if (part_header != NULL)
-        {
-            for (size_t i = 0; i < part_header->count; i++)
-            {
-                if (part_header->key_value[i].key != NULL
-                    && part_header->key_value[i].value != NULL)
-                {
-                    p += sprintf(p, "%s: %s\r\n",
-                            part_header->key_value[i].key,
-                            part_header->key_value[i].value);
-                }
-            }
-        }
-        p += sprintf(p, "\r\n");
-    }
-    else
-    {
-        boundary_length = 8 + strlen(delimiter);
-        boundary = malloc(boundary_length + 1);
-        if (boundary == NULL)
-        {
-            result = GlobusDsiRestErrorMemory();
-
-            goto boundary_alloc_fail;
-        }
-
-        sprintf(boundary, "\r\n--%s--\r\n", delimiter);
-    }
-
-boundary_alloc_fail:
-    *boundaryp = boundary;
-    *boundary_lengthp = boundary_length;
-
-    GlobusDsiRestExitResult(result);
-    return result;
-}
-/* globus_l_dsi_rest_prepare_boundary() */
-
 globus_dsi_rest_write_t const           globus_dsi_rest_write_multipart
                                       = globus_l_dsi_rest_write_multipart;
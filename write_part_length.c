@@ -0,0 +1,123 @@
+/*
+ * Copyright 1999-2016 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file write_part_length.c GridFTP DSI REST Request Body Length
+ */
+#endif
+
+#include "globus_i_dsi_rest.h"
+
+bool
+globus_i_dsi_rest_write_part_length(
+    const globus_i_dsi_rest_write_part_t
+                                       *part,
+    uint64_t                           *lengthp)
+{
+    globus_dsi_rest_write_t             callback = part->data_write_callback;
+    uint64_t                            length = 0;
+    bool                                known = true;
+
+    GlobusDsiRestEnter();
+
+    if (callback == NULL)
+    {
+        length = 0;
+    }
+    else if (callback == globus_dsi_rest_write_json)
+    {
+        /*
+         * json bodies are encoded as they are sent, so count them here,
+         * keeping the encoding of a small one to send later
+         */
+        globus_i_dsi_rest_write_json_arg_t
+                                       *arg = part->data_write_callback_arg;
+
+        known = (globus_i_dsi_rest_write_json_length(arg, &length)
+                == GLOBUS_SUCCESS);
+    }
+    else if (callback == globus_dsi_rest_write_block
+        || callback == globus_dsi_rest_write_form)
+    {
+        /* form bodies are encoded to a block when prepared */
+        const globus_i_dsi_rest_write_block_arg_t
+                                       *arg = part->data_write_callback_arg;
+
+        length = arg->block_len;
+    }
+    else if (callback == globus_dsi_rest_write_blocks)
+    {
+        const globus_i_dsi_rest_write_blocks_arg_t
+                                       *arg = part->data_write_callback_arg;
+
+        for (size_t i = 0; i < arg->block_count; i++)
+        {
+            length += arg->blocks[i].block_len;
+        }
+    }
+    else if (callback == globus_dsi_rest_write_gridftp_op)
+    {
+        const globus_i_dsi_rest_gridftp_op_arg_t
+                                       *arg = part->data_write_callback_arg;
+
+        known = (arg->end_offset != (globus_off_t) -1);
+        if (known)
+        {
+            length = arg->end_offset - arg->offset;
+        }
+    }
+    else if (callback == globus_dsi_rest_write_multipart)
+    {
+        const globus_i_dsi_rest_write_multipart_arg_t
+                                       *arg = part->data_write_callback_arg;
+
+        known = (arg->num_parts > 0);
+        for (size_t i = 0; known && i < arg->num_parts; i++)
+        {
+            uint64_t                    part_length = 0;
+
+            known = globus_i_dsi_rest_write_part_length(
+                    &arg->parts[i], &part_length);
+            length += part_length;
+
+            if (arg->boundary != NULL)
+            {
+                /* Delimiter and headers before each part */
+                length += globus_i_dsi_rest_multipart_boundary_length(
+                        arg->boundary, false, &arg->parts[i].headers);
+            }
+        }
+        if (known && arg->boundary != NULL)
+        {
+            length += globus_i_dsi_rest_multipart_boundary_length(
+                    arg->boundary, true, NULL);
+        }
+    }
+    else
+    {
+        known = false;
+    }
+
+    if (known)
+    {
+        *lengthp = length;
+    }
+
+    GlobusDsiRestExitBool(known);
+    return known;
+}
+/* globus_i_dsi_rest_write_part_length() */